@@ -136,6 +136,10 @@ absl::StatusOr<std::unique_ptr<Executable>> InterpreterCompiler::RunBackend(
   auto evaluator = std::make_unique<HloEvaluator>();
   evaluator->set_use_fast_path(
       hlo_module->config().debug_options().xla_hlo_evaluator_use_fast_path());
+  evaluator->set_use_fast_elementwise_path(
+      hlo_module->config()
+          .debug_options()
+          .xla_hlo_evaluator_use_fast_elementwise_path());
   evaluator->set_custom_call_handler(HandleEvaluatorCustomCall);
 
   // Create executable from only the Hlo module.
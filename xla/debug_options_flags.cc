@@ -79,6 +79,7 @@ DebugOptions DefaultDebugOptionsIgnoringFlags() {
   opts.set_xla_cpu_use_acl(true);
 #endif
   opts.set_xla_cpu_use_xla_runtime(false);
+  opts.set_xla_cpu_use_thunk_runtime(false);
   opts.set_xla_cpu_sparse_cuda_threads(0);
 
   opts.set_xla_cpu_enable_fast_math(false);
@@ -761,6 +762,27 @@ void MakeDebugOptionsFlags(std::vector<tsl::Flag>* flag_list,
                 bool_setter_for(&DebugOptions::set_xla_cpu_use_xla_runtime),
                 debug_options->xla_cpu_use_xla_runtime(),
                 "Enable XLA Runtime in the CPU backend."));
+  flag_list->push_back(tsl::Flag(
+      "xla_cpu_use_thunk_runtime",
+      bool_setter_for(&DebugOptions::set_xla_cpu_use_thunk_runtime),
+      debug_options->xla_cpu_use_thunk_runtime(),
+      "Execute the entry computation of CPU executables as a graph of "
+      "per-instruction thunks, running independent thunks concurrently on "
+      "the intra-op thread pool."));
+  flag_list->push_back(tsl::Flag(
+      "xla_cpu_memory_limit_bytes",
+      int64_setter_for(&DebugOptions::set_xla_cpu_memory_limit_bytes),
+      debug_options->xla_cpu_memory_limit_bytes(),
+      "If positive, schedule CPU executables for the lowest peak memory and "
+      "rematerialize instructions to fit their buffers in this many bytes."));
+  flag_list->push_back(tsl::Flag(
+      "xla_hlo_evaluator_use_fast_elementwise_path",
+      bool_setter_for(
+          &DebugOptions::set_xla_hlo_evaluator_use_fast_elementwise_path),
+      debug_options->xla_hlo_evaluator_use_fast_elementwise_path(),
+      "Evaluate elementwise instructions, and fusions of them, in the HLO "
+      "evaluator and constant folding without materializing intermediate "
+      "results."));
   flag_list->push_back(tsl::Flag(
       "xla_cpu_sparse_cuda_threads",
       int32_setter_for(&DebugOptions::set_xla_cpu_sparse_cuda_threads),
@@ -929,6 +951,12 @@ void MakeDebugOptionsFlags(std::vector<tsl::Flag>* flag_list,
       debug_options->xla_hlo_graph_sharding_color(),
       "Assign colors based on sharding assignments when generating the HLO "
       "graphs."));
+  flag_list->push_back(tsl::Flag(
+      "xla_hlo_instruction_arena",
+      bool_setter_for(&DebugOptions::set_xla_hlo_instruction_arena),
+      debug_options->xla_hlo_instruction_arena(),
+      "Allocate the instructions of HLO modules from an arena owned by the "
+      "module while it is parsed, cloned or optimized."));
   flag_list->push_back(tsl::Flag(
       "xla_allow_excess_precision",
       bool_setter_for(&DebugOptions::set_xla_allow_excess_precision),
@@ -1277,6 +1305,15 @@ void MakeDebugOptionsFlags(std::vector<tsl::Flag>* flag_list,
       "By default, XLA:CPU will run fp16 dot/conv as fp32, as this is "
       "generally (much) faster on our hardware. Set this flag to true to "
       "disable this behavior."));
+  flag_list->push_back(tsl::Flag(
+      "xla_cpu_parallel_codegen_split_count",
+      int32_setter_for(
+          &DebugOptions::set_xla_cpu_parallel_codegen_split_count),
+      debug_options->xla_cpu_parallel_codegen_split_count(),
+      "Number of parts the LLVM module of a CPU executable is split into. "
+      "The parts are optimized and compiled to object code in parallel on "
+      "the compile thread pool. Values of 0 and 1 compile the module as a "
+      "whole."));
   flag_list->push_back(tsl::Flag(
       "xla_dump_latency_hiding_schedule",
       bool_setter_for(&DebugOptions::set_xla_dump_latency_hiding_schedule),
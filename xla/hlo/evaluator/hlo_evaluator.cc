@@ -50,6 +50,7 @@ limitations under the License.
 #include "Eigen/Core"  // from @eigen_archive
 #include "xla/array2d.h"
 #include "xla/comparison_util.h"
+#include "xla/hlo/evaluator/hlo_evaluator_elementwise.h"
 #include "xla/hlo/evaluator/hlo_evaluator_typed_visitor.h"
 #include "xla/hlo/ir/dfs_hlo_visitor_with_default.h"
 #include "xla/hlo/ir/hlo_casting_utils.h"
@@ -3223,6 +3224,13 @@ Status HloEvaluator::HandleCall(const HloInstruction* call) {
 }
 
 Status HloEvaluator::HandleFusion(const HloInstruction* fusion) {
+  if (use_fast_elementwise_path_) {
+    TF_ASSIGN_OR_RETURN(bool evaluated, TryEvaluateElementwise(fusion));
+    if (evaluated) {
+      return OkStatus();
+    }
+  }
+
   HloModuleConfig config;
   // Attach cloned computation to an empty HLO module so the existing ones are
   // not modified.
@@ -3260,6 +3268,25 @@ Status HloEvaluator::HandleFusion(const HloInstruction* fusion) {
   return OkStatus();
 }
 
+absl::StatusOr<bool> HloEvaluator::TryEvaluateElementwise(
+    const HloInstruction* hlo) {
+  std::optional<ElementwiseProgram> program = ElementwiseProgram::Build(hlo);
+  if (!program.has_value()) {
+    return false;
+  }
+  std::vector<const Literal*> operand_literals;
+  operand_literals.reserve(hlo->operand_count());
+  for (const HloInstruction* operand : hlo->operands()) {
+    const Literal& operand_literal = GetEvaluatedLiteralFor(operand);
+    if (!operand_literal.IsKnown()) {
+      return false;
+    }
+    operand_literals.push_back(&operand_literal);
+  }
+  TF_ASSIGN_OR_RETURN(evaluated_[hlo], program->Evaluate(operand_literals));
+  return true;
+}
+
 Status HloEvaluator::HandleConditional(const HloInstruction* conditional) {
   const auto& branch_index_literal =
       GetEvaluatedLiteralFor(conditional->operand(0));
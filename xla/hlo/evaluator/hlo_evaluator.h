@@ -91,6 +91,7 @@ class HloEvaluator : public ConstDfsHloVisitorWithDefault {
       int64_t max_loop_iterations) {
     auto result = std::make_unique<HloEvaluator>(max_loop_iterations);
     result->set_custom_call_handler(custom_call_handler_);
+    result->set_use_fast_elementwise_path(use_fast_elementwise_path_);
     return result;
   }
 
@@ -202,9 +203,19 @@ class HloEvaluator : public ConstDfsHloVisitorWithDefault {
     return dynamic_dimension_inference_;
   }
 
-  // Enable the fast path for certain operations like dot or convolution.
+  // Enable the fast path for certain operations like dot or convolution. Rank-2
+  // F32 dots use Eigen, other dots and convolutions the multi-threaded blocked
+  // kernels of hlo_evaluator_contraction.h.
   void set_use_fast_path(bool value) { use_fast_path_ = value; }
 
+  // Enable the fast path for elementwise instructions and fusions of
+  // elementwise, broadcast, reshape and transpose instructions, which are then
+  // evaluated in chunks without materializing intermediate results. See
+  // ElementwiseProgram.
+  void set_use_fast_elementwise_path(bool value) {
+    use_fast_elementwise_path_ = value;
+  }
+
   // Handles evaluation of a custom-call op.
   // Operand literals are provided in |operands| and implementations must
   // populate |output| before returning.
@@ -281,12 +292,23 @@ class HloEvaluator : public ConstDfsHloVisitorWithDefault {
   // Wraps around instruction handling to infer types before dispatching to
   // the corresponding typed Visitor.
   Status DefaultAction(const HloInstruction* hlo) override {
+    if (use_fast_elementwise_path_) {
+      TF_ASSIGN_OR_RETURN(bool evaluated, TryEvaluateElementwise(hlo));
+      if (evaluated) {
+        return OkStatus();
+      }
+    }
     return hlo->Visit(typed_visitors_[hlo->shape().element_type()].get());
   }
 
   Status Preprocess(const HloInstruction* hlo) override;
   Status Postprocess(const HloInstruction* hlo) override;
 
+  // Evaluates `hlo` with an ElementwiseProgram. Returns false, without
+  // evaluating it, if the program does not support `hlo` or an operand is not
+  // known.
+  absl::StatusOr<bool> TryEvaluateElementwise(const HloInstruction* hlo);
+
   // Operations that are type-agnostic or always return a specific type, such as
   // HandleIsFinite where boolean is always returned.
   //
@@ -434,6 +456,9 @@ class HloEvaluator : public ConstDfsHloVisitorWithDefault {
   // Use fast path that uses eigen in the evaluator.
   bool use_fast_path_ = false;
 
+  // Use ElementwiseProgram for elementwise instructions and fusions.
+  bool use_fast_elementwise_path_ = false;
+
  private:
   template <typename ReturnT, typename NativeT>
   static absl::StatusOr<Literal> ElementWiseUnaryOpImpl(
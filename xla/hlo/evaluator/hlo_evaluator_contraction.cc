@@ -0,0 +1,294 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/hlo/evaluator/hlo_evaluator_contraction.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xla/hlo/evaluator/hlo_evaluator_typed_visitor.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/layout_util.h"
+#include "xla/shape.h"
+#include "xla/shape_util.h"
+#include "xla/types.h"
+#include "xla/util.h"
+#include "xla/xla_data.pb.h"
+
+namespace xla {
+namespace {
+
+// The block of the output a task computes: rows are output rows of a matmul or
+// output positions of a convolution, columns are output features.
+constexpr int64_t kRowBlock = 64;
+constexpr int64_t kColumnBlock = 256;
+// The number of products accumulated into a block of output rows before moving
+// on, chosen so that the rhs slice of the block stays in cache.
+constexpr int64_t kDepthBlock = 128;
+// Kernels with fewer multiply-adds than this run on the calling thread.
+constexpr int64_t kParallelWork = int64_t{1} << 18;
+
+// Accumulates `lhs x rhs` into `out`, where lhs is an [m, k] and rhs a [k, n]
+// matrix with rows `lhs_stride` and `rhs_stride` elements apart. Row `i` of the
+// product is accumulated into row `out_rows[i]` of `out`, or into row `i` if
+// `out_rows` is null.
+template <typename T>
+void MatmulAccumulate(int64_t m, int64_t n, int64_t k, const T* lhs,
+                      int64_t lhs_stride, const T* rhs, int64_t rhs_stride,
+                      T* out, int64_t out_stride, const int64_t* out_rows) {
+  for (int64_t j0 = 0; j0 < n; j0 += kColumnBlock) {
+    const int64_t j1 = std::min(n, j0 + kColumnBlock);
+    // Depth blocks are visited in order, so every output element still sums
+    // its products in order of increasing k.
+    for (int64_t k0 = 0; k0 < k; k0 += kDepthBlock) {
+      const int64_t k1 = std::min(k, k0 + kDepthBlock);
+      for (int64_t i = 0; i < m; ++i) {
+        T* out_row = out + (out_rows ? out_rows[i] : i) * out_stride;
+        const T* lhs_row = lhs + i * lhs_stride;
+        for (int64_t kk = k0; kk < k1; ++kk) {
+          const auto lhs_value = ToArithmeticSafeType(lhs_row[kk]);
+          const T* rhs_row = rhs + kk * rhs_stride;
+          for (int64_t j = j0; j < j1; ++j) {
+            out_row[j] += lhs_value * ToArithmeticSafeType(rhs_row[j]);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Calls `task` for every index of `tasks`, in parallel if `work` is large
+// enough to amortize the scheduling.
+template <typename Task>
+void RunTasks(absl::Span<const int64_t> tasks, int64_t work, Task&& task) {
+  const Shape shape = ShapeUtil::MakeShape(S64, tasks);
+  if (work < kParallelWork || ShapeUtil::ElementsIn(shape) <= 1) {
+    ShapeUtil::ForEachIndex(shape, [&](absl::Span<const int64_t> index) {
+      task(index);
+      return true;
+    });
+    return;
+  }
+  ShapeUtil::ForEachIndexParallel(
+      shape,
+      [&](absl::Span<const int64_t> index, int) -> absl::StatusOr<bool> {
+        task(index);
+        return true;
+      });
+}
+
+}  // namespace
+
+DimensionVector RowMajorStrides(absl::Span<const int64_t> sizes) {
+  DimensionVector strides(sizes.size());
+  int64_t stride = 1;
+  for (int64_t i = sizes.size() - 1; i >= 0; --i) {
+    strides[i] = stride;
+    stride *= sizes[i];
+  }
+  return strides;
+}
+
+DimensionVector LayoutStrides(const Shape& shape) {
+  DimensionVector strides(shape.rank());
+  int64_t stride = 1;
+  for (int64_t dim : LayoutUtil::MinorToMajor(shape)) {
+    strides[dim] = stride;
+    stride *= shape.dimensions(dim);
+  }
+  return strides;
+}
+
+template <typename T>
+void BlockedBatchMatmul(int64_t batch, int64_t m, int64_t n, int64_t k,
+                        const T* lhs, const T* rhs, T* out) {
+  // Tasks own disjoint blocks of the output, so they need no synchronization.
+  RunTasks({batch, CeilOfRatio(m, kRowBlock), CeilOfRatio(n, kColumnBlock)},
+           batch * m * n * k, [&](absl::Span<const int64_t> task) {
+             const int64_t i0 = task[1] * kRowBlock;
+             const int64_t j0 = task[2] * kColumnBlock;
+             MatmulAccumulate(std::min(kRowBlock, m - i0),
+                              std::min(kColumnBlock, n - j0), k,
+                              lhs + (task[0] * m + i0) * k, k,
+                              rhs + task[0] * k * n + j0, n,
+                              out + (task[0] * m + i0) * n + j0, n,
+                              /*out_rows=*/nullptr);
+           });
+}
+
+template <typename T>
+void BlockedConvolution(const HloInstruction* conv, const T* input,
+                        const T* kernel, T* output) {
+  const ConvolutionDimensionNumbers& dnums =
+      conv->convolution_dimension_numbers();
+  const Window& window = conv->window();
+  const Shape& input_shape = conv->operand(0)->shape();
+  const Shape& kernel_shape = conv->operand(1)->shape();
+  const Shape& output_shape = conv->shape();
+  const int64_t num_spatial_dims = dnums.input_spatial_dimensions_size();
+
+  DimensionVector input_spatial_sizes;
+  DimensionVector output_spatial_sizes;
+  DimensionVector window_sizes;
+  for (int64_t i = 0; i < num_spatial_dims; ++i) {
+    input_spatial_sizes.push_back(
+        input_shape.dimensions(dnums.input_spatial_dimensions(i)));
+    output_spatial_sizes.push_back(
+        output_shape.dimensions(dnums.output_spatial_dimensions(i)));
+    window_sizes.push_back(
+        kernel_shape.dimensions(dnums.kernel_spatial_dimensions(i)));
+  }
+  const DimensionVector input_spatial_strides =
+      RowMajorStrides(input_spatial_sizes);
+  const int64_t input_spatial_size = Product(input_spatial_sizes);
+  const int64_t output_spatial_size = Product(output_spatial_sizes);
+  const int64_t input_features =
+      input_shape.dimensions(dnums.input_feature_dimension());
+  const int64_t output_features =
+      output_shape.dimensions(dnums.output_feature_dimension());
+  // The input features each output feature reads, which is all of them unless
+  // the features are grouped.
+  const int64_t depth =
+      kernel_shape.dimensions(dnums.kernel_input_feature_dimension());
+  const int64_t num_positions =
+      output_shape.dimensions(dnums.output_batch_dimension()) *
+      output_spatial_size;
+
+  // At most one of the group counts is larger than one. Group `g` computes the
+  // g-th slice of the output features from the g-th slice of the input
+  // features, or from the g-th slice of the input batch.
+  const int64_t feature_group_count = conv->feature_group_count();
+  const int64_t batch_group_count = conv->batch_group_count();
+  const int64_t group_count = feature_group_count * batch_group_count;
+  const int64_t group_output_features = output_features / group_count;
+  const int64_t batch_group_size =
+      input_shape.dimensions(dnums.input_batch_dimension()) /
+      batch_group_count;
+
+  // The window positions ("taps") in the order the slow path visits them, with
+  // the offset of the kernel slice each one multiplies with.
+  const int64_t num_taps = Product(window_sizes);
+  std::vector<int64_t> tap_indices(num_taps * num_spatial_dims);
+  std::vector<int64_t> tap_kernel_offsets(num_taps);
+  for (int64_t tap = 0; tap < num_taps; ++tap) {
+    int64_t remainder = tap;
+    int64_t kernel_tap = 0;
+    int64_t kernel_stride = 1;
+    for (int64_t d = num_spatial_dims - 1; d >= 0; --d) {
+      const int64_t index = remainder % window_sizes[d];
+      remainder /= window_sizes[d];
+      tap_indices[tap * num_spatial_dims + d] = index;
+      kernel_tap += (window.dimensions(d).window_reversal()
+                         ? window_sizes[d] - 1 - index
+                         : index) *
+                    kernel_stride;
+      kernel_stride *= window_sizes[d];
+    }
+    tap_kernel_offsets[tap] = kernel_tap * depth * output_features;
+  }
+
+  RunTasks(
+      {CeilOfRatio(num_positions, kRowBlock)},
+      num_positions * num_taps * depth * output_features,
+      [&](absl::Span<const int64_t> task) {
+        const int64_t p0 = task[0] * kRowBlock;
+        const int64_t rows = std::min(kRowBlock, num_positions - p0);
+
+        // The output batch and spatial index of every position of the block.
+        std::vector<int64_t> batches(rows);
+        std::vector<int64_t> spatial_indices(rows * num_spatial_dims);
+        for (int64_t r = 0; r < rows; ++r) {
+          int64_t remainder = p0 + r;
+          for (int64_t d = num_spatial_dims - 1; d >= 0; --d) {
+            spatial_indices[r * num_spatial_dims + d] =
+                remainder % output_spatial_sizes[d];
+            remainder /= output_spatial_sizes[d];
+          }
+          batches[r] = remainder;
+        }
+
+        // The im2col block of a tap: the input rows of the positions whose
+        // window position is inside the (dilated, padded) input.
+        std::vector<T> block(rows * depth);
+        std::vector<int64_t> block_rows(rows);
+        for (int64_t g = 0; g < group_count; ++g) {
+          const int64_t feature_offset =
+              feature_group_count > 1 ? g * depth : 0;
+          const int64_t batch_offset =
+              batch_group_count > 1 ? g * batch_group_size : 0;
+          for (int64_t tap = 0; tap < num_taps; ++tap) {
+            int64_t num_rows = 0;
+            for (int64_t r = 0; r < rows; ++r) {
+              int64_t spatial_offset = 0;
+              bool in_bounds = true;
+              for (int64_t d = 0; d < num_spatial_dims && in_bounds; ++d) {
+                const WindowDimension& window_dim = window.dimensions(d);
+                int64_t index =
+                    spatial_indices[r * num_spatial_dims + d] *
+                        window_dim.stride() -
+                    window_dim.padding_low() +
+                    tap_indices[tap * num_spatial_dims + d] *
+                        window_dim.window_dilation();
+                if (window_dim.base_dilation() > 1) {
+                  in_bounds = index % window_dim.base_dilation() == 0;
+                  index /= window_dim.base_dilation();
+                }
+                in_bounds =
+                    in_bounds && index >= 0 && index < input_spatial_sizes[d];
+                spatial_offset += index * input_spatial_strides[d];
+              }
+              if (!in_bounds) {
+                continue;
+              }
+              const T* input_row =
+                  input +
+                  ((batches[r] + batch_offset) * input_spatial_size +
+                   spatial_offset) *
+                      input_features +
+                  feature_offset;
+              std::copy(input_row, input_row + depth,
+                        block.data() + num_rows * depth);
+              block_rows[num_rows++] = p0 + r;
+            }
+            const int64_t column_offset = g * group_output_features;
+            MatmulAccumulate(
+                num_rows, group_output_features, depth, block.data(), depth,
+                kernel + tap_kernel_offsets[tap] + column_offset,
+                output_features, output + column_offset, output_features,
+                block_rows.data());
+          }
+        }
+      });
+}
+
+#define INSTANTIATE_CONTRACTION_KERNELS(T)                                    \
+  template void BlockedBatchMatmul<T>(int64_t, int64_t, int64_t, int64_t,     \
+                                      const T*, const T*, T*);                \
+  template void BlockedConvolution<T>(const HloInstruction*, const T*,        \
+                                      const T*, T*);
+
+INSTANTIATE_CONTRACTION_KERNELS(int64_t)
+INSTANTIATE_CONTRACTION_KERNELS(uint64_t)
+INSTANTIATE_CONTRACTION_KERNELS(float)
+INSTANTIATE_CONTRACTION_KERNELS(double)
+INSTANTIATE_CONTRACTION_KERNELS(complex64)
+INSTANTIATE_CONTRACTION_KERNELS(complex128)
+
+#undef INSTANTIATE_CONTRACTION_KERNELS
+
+}  // namespace xla
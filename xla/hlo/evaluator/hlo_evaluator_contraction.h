@@ -0,0 +1,153 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_HLO_EVALUATOR_HLO_EVALUATOR_CONTRACTION_H_
+#define XLA_HLO_EVALUATOR_HLO_EVALUATOR_CONTRACTION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/literal.h"
+#include "xla/shape.h"
+#include "xla/shape_util.h"
+#include "xla/util.h"
+
+// Blocked, multi-threaded kernels for the dot and convolution fast paths of
+// HloEvaluatorTypedVisitor.
+//
+// The kernels work on dense row-major arrays of the type the typed visitor
+// accumulates in (its ElementwiseT). Every output element accumulates its
+// products in the same order as the per-element loops of the slow paths, so
+// integer results are identical and floating point results only differ where
+// the compiler contracts a multiply-add.
+
+namespace xla {
+
+// Copies the array of `sizes` at `src` to `dst`, converting every element to
+// `Dst`. `src_strides` and `dst_strides` are the strides of every dimension of
+// the two arrays, which lets the copy transpose and change layouts.
+template <typename Src, typename Dst>
+void PermutedCopy(absl::Span<const int64_t> sizes, const Src* src,
+                  absl::Span<const int64_t> src_strides, Dst* dst,
+                  absl::Span<const int64_t> dst_strides) {
+  const int64_t rank = sizes.size();
+  if (rank == 0) {
+    *dst = static_cast<Dst>(*src);
+    return;
+  }
+  for (int64_t size : sizes) {
+    if (size == 0) {
+      return;
+    }
+  }
+  const int64_t minor_size = sizes[rank - 1];
+  const int64_t minor_src_stride = src_strides[rank - 1];
+  const int64_t minor_dst_stride = dst_strides[rank - 1];
+  DimensionVector index(rank, 0);
+  int64_t src_offset = 0;
+  int64_t dst_offset = 0;
+  while (true) {
+    for (int64_t i = 0; i < minor_size; ++i) {
+      dst[dst_offset + i * minor_dst_stride] =
+          static_cast<Dst>(src[src_offset + i * minor_src_stride]);
+    }
+    int64_t dim = rank - 2;
+    for (; dim >= 0; --dim) {
+      src_offset += src_strides[dim];
+      dst_offset += dst_strides[dim];
+      if (++index[dim] < sizes[dim]) {
+        break;
+      }
+      src_offset -= sizes[dim] * src_strides[dim];
+      dst_offset -= sizes[dim] * dst_strides[dim];
+      index[dim] = 0;
+    }
+    if (dim < 0) {
+      return;
+    }
+  }
+}
+
+// Returns the strides of a row-major array of `sizes`.
+DimensionVector RowMajorStrides(absl::Span<const int64_t> sizes);
+
+// Returns the strides of the dimensions of a dense array of `shape`.
+DimensionVector LayoutStrides(const Shape& shape);
+
+// Returns the elements of `literal`, whose elements are NativeT, converted to T
+// and transposed so that the dimensions `dims` of `literal` are a row-major
+// array.
+template <typename NativeT, typename T>
+std::vector<T> TransposeToArray(const Literal& literal,
+                                absl::Span<const int64_t> dims) {
+  const Shape& shape = literal.shape();
+  const DimensionVector strides = LayoutStrides(shape);
+  DimensionVector sizes;
+  DimensionVector src_strides;
+  for (int64_t dim : dims) {
+    sizes.push_back(shape.dimensions(dim));
+    src_strides.push_back(strides[dim]);
+  }
+  std::vector<T> array(ShapeUtil::ElementsIn(shape));
+  PermutedCopy(sizes, literal.data<NativeT>().data(), src_strides, array.data(),
+               RowMajorStrides(sizes));
+  return array;
+}
+
+// The inverse of TransposeToArray: returns a literal of `shape` holding the
+// elements of `array` converted to NativeT.
+template <typename NativeT, typename T>
+Literal TransposeFromArray(absl::Span<const T> array, const Shape& shape,
+                           absl::Span<const int64_t> dims) {
+  Literal literal(shape);
+  const DimensionVector strides = LayoutStrides(shape);
+  DimensionVector sizes;
+  DimensionVector dst_strides;
+  for (int64_t dim : dims) {
+    sizes.push_back(shape.dimensions(dim));
+    dst_strides.push_back(strides[dim]);
+  }
+  PermutedCopy(sizes, array.data(), RowMajorStrides(sizes),
+               literal.data<NativeT>().data(), dst_strides);
+  return literal;
+}
+
+// Accumulates the batched matrix product `lhs x rhs` into `out`, where `lhs`
+// is a [batch, m, k], `rhs` a [batch, k, n] and `out` a [batch, m, n] array.
+template <typename T>
+void BlockedBatchMatmul(int64_t batch, int64_t m, int64_t n, int64_t k,
+                        const T* lhs, const T* rhs, T* out);
+
+// Accumulates the convolution `conv` of `input` and `kernel` into `output`.
+// The arrays hold the operands and the result of `conv` with their dimensions
+// transposed to
+//
+//   input:  [batch, spatial..., feature]
+//   kernel: [spatial..., input feature, output feature]
+//   output: [batch, spatial..., feature]
+//
+// with the spatial dimensions in the order of the dimension numbers of `conv`.
+// Every window position is an im2col step: the input rows it reads are
+// gathered into a block, which is multiplied with the kernel slice of the
+// position by the blocked matmul kernel.
+template <typename T>
+void BlockedConvolution(const HloInstruction* conv, const T* input,
+                        const T* kernel, T* output);
+
+}  // namespace xla
+
+#endif  // XLA_HLO_EVALUATOR_HLO_EVALUATOR_CONTRACTION_H_
@@ -0,0 +1,1096 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/hlo/evaluator/hlo_evaluator_elementwise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xla/comparison_util.h"
+#include "xla/hlo/evaluator/hlo_evaluator_typed_visitor.h"
+#include "xla/hlo/ir/hlo_computation.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_opcode.h"
+#include "xla/layout_util.h"
+#include "xla/literal.h"
+#include "xla/primitive_util.h"
+#include "xla/shape.h"
+#include "xla/shape_util.h"
+#include "xla/status_macros.h"
+#include "xla/util.h"
+#include "xla/xla_data.pb.h"
+#include "tsl/platform/logging.h"
+
+namespace xla {
+namespace {
+
+using primitive_util::NativeTypeOf;
+
+// Number of elements every node of a program evaluates at once.
+constexpr int64_t kChunkSize = 1024;
+constexpr int64_t kMaxElementSize = sizeof(int64_t);
+
+// Number of elements evaluated by one task of a parallel evaluation. Results
+// smaller than that are evaluated on the calling thread.
+constexpr int64_t kElementsPerTask = 16 * kChunkSize;
+
+constexpr bool IsSupportedType(PrimitiveType type) {
+  switch (type) {
+    case PRED:
+    case S8:
+    case S16:
+    case S32:
+    case S64:
+    case U8:
+    case U16:
+    case U32:
+    case U64:
+    case F16:
+    case BF16:
+    case F32:
+    case F64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The type elements of `kType` are computed in, see the construction of the
+// typed visitors in HloEvaluator.
+template <PrimitiveType kType>
+using ElementwiseTypeOf = std::conditional_t<
+    primitive_util::IsSignedIntegralType(kType), int64_t,
+    std::conditional_t<
+        primitive_util::IsUnsignedIntegralType(kType), uint64_t,
+        std::conditional_t<primitive_util::IsFloatingPointType(kType) &&
+                               sizeof(NativeTypeOf<kType>) < sizeof(float),
+                           float, NativeTypeOf<kType>>>>;
+
+std::vector<int64_t> RowMajorStrides(absl::Span<const int64_t> dimensions) {
+  std::vector<int64_t> strides(dimensions.size());
+  int64_t stride = 1;
+  for (int64_t i = dimensions.size() - 1; i >= 0; --i) {
+    strides[i] = stride;
+    stride *= dimensions[i];
+  }
+  return strides;
+}
+
+// A chunk of logical linear indices into the shape of a node. Index `i` of the
+// chunk is `indices[i]` if `indices` is set and `start + i * stride` otherwise.
+struct IndexChunk {
+  // Identifies the chunk within an evaluation. A node evaluated repeatedly for
+  // the same chunk reuses its result.
+  int64_t id;
+  int64_t count;
+  int64_t start = 0;
+  int64_t stride = 1;
+  const int64_t* indices = nullptr;
+
+  int64_t operator[](int64_t i) const {
+    return indices != nullptr ? indices[i] : start + i * stride;
+  }
+  bool is_contiguous() const {
+    return indices == nullptr && (stride == 1 || count == 1);
+  }
+  bool is_uniform() const { return indices == nullptr && stride == 0; }
+};
+
+// Maps the logical linear index of an element of a shape with dimensions
+// `dimensions` to the sum of index_i * coefficients[i], where index_i is the
+// index of the element in dimension i. Broadcasts, transposes and layouts are
+// all expressed as such maps.
+class LinearIndexMap {
+ public:
+  LinearIndexMap(absl::Span<const int64_t> dimensions,
+                 std::vector<int64_t> coefficients)
+      : dimensions_(dimensions.begin(), dimensions.end()),
+        coefficients_(std::move(coefficients)),
+        is_identity_(true),
+        is_uniform_(true) {
+    std::vector<int64_t> strides = RowMajorStrides(dimensions_);
+    for (int64_t i = 0; i < dimensions_.size(); ++i) {
+      // The coefficient of a dimension of size one never contributes.
+      if (dimensions_[i] == 1) {
+        coefficients_[i] = 0;
+        continue;
+      }
+      is_identity_ &= coefficients_[i] == strides[i];
+      is_uniform_ &= coefficients_[i] == 0;
+    }
+  }
+
+  // Maps the logical indices of `shape` to the logical indices of its
+  // broadcast operand.
+  static LinearIndexMap ForBroadcast(const Shape& shape,
+                                     const Shape& operand_shape,
+                                     absl::Span<const int64_t> dimensions) {
+    std::vector<int64_t> operand_strides =
+        RowMajorStrides(operand_shape.dimensions());
+    std::vector<int64_t> coefficients(shape.rank(), 0);
+    for (int64_t i = 0; i < dimensions.size(); ++i) {
+      coefficients[dimensions[i]] = operand_strides[i];
+    }
+    return LinearIndexMap(shape.dimensions(), std::move(coefficients));
+  }
+
+  // Maps the logical indices of `shape` to the logical indices of its
+  // transpose operand.
+  static LinearIndexMap ForTranspose(const Shape& shape,
+                                     const Shape& operand_shape,
+                                     absl::Span<const int64_t> permutation) {
+    std::vector<int64_t> operand_strides =
+        RowMajorStrides(operand_shape.dimensions());
+    std::vector<int64_t> coefficients(shape.rank());
+    for (int64_t i = 0; i < permutation.size(); ++i) {
+      coefficients[i] = operand_strides[permutation[i]];
+    }
+    return LinearIndexMap(shape.dimensions(), std::move(coefficients));
+  }
+
+  // Maps the logical indices of `shape` to the positions of the elements in
+  // memory.
+  static LinearIndexMap ForLayout(const Shape& shape) {
+    std::vector<int64_t> coefficients(shape.rank());
+    int64_t stride = 1;
+    for (int64_t dimension : LayoutUtil::MinorToMajor(shape)) {
+      coefficients[dimension] = stride;
+      stride *= shape.dimensions(dimension);
+    }
+    return LinearIndexMap(shape.dimensions(), std::move(coefficients));
+  }
+
+  bool is_identity() const { return is_identity_; }
+  // True if all indices map to the same index.
+  bool is_uniform() const { return is_uniform_; }
+
+  int64_t Map(int64_t index) const {
+    int64_t result = 0;
+    for (int64_t i = dimensions_.size() - 1; i >= 0; --i) {
+      result += (index % dimensions_[i]) * coefficients_[i];
+      index /= dimensions_[i];
+    }
+    return result;
+  }
+
+  // Returns true if the contiguous indices [start, start + count) map to
+  // indices with the constant stride minor_coefficient().
+  bool IsAffineOn(int64_t start, int64_t count) const {
+    if (dimensions_.empty()) {
+      return false;
+    }
+    int64_t minor_dimension = dimensions_.back();
+    return start % minor_dimension + count <= minor_dimension;
+  }
+  int64_t minor_coefficient() const { return coefficients_.back(); }
+
+  // Writes the mapped indices of `chunk` to `out`.
+  void Map(const IndexChunk& chunk, int64_t* out) const {
+    if (!chunk.is_contiguous()) {
+      for (int64_t i = 0; i < chunk.count; ++i) {
+        out[i] = Map(chunk[i]);
+      }
+      return;
+    }
+    // Step through the multi-dimensional indices of a contiguous chunk
+    // instead of dividing for every index.
+    const int64_t rank = dimensions_.size();
+    absl::InlinedVector<int64_t, 8> multi_index(rank);
+    int64_t remaining = chunk.start;
+    int64_t offset = 0;
+    for (int64_t i = rank - 1; i >= 0; --i) {
+      multi_index[i] = remaining % dimensions_[i];
+      remaining /= dimensions_[i];
+      offset += multi_index[i] * coefficients_[i];
+    }
+    for (int64_t i = 0; i < chunk.count; ++i) {
+      out[i] = offset;
+      for (int64_t d = rank - 1; d >= 0; --d) {
+        offset += coefficients_[d];
+        if (++multi_index[d] < dimensions_[d]) {
+          break;
+        }
+        offset -= coefficients_[d] * dimensions_[d];
+        multi_index[d] = 0;
+      }
+    }
+  }
+
+ private:
+  std::vector<int64_t> dimensions_;
+  std::vector<int64_t> coefficients_;
+  bool is_identity_;
+  bool is_uniform_;
+};
+
+// Computes `count` elements of a node from the same elements of its operands.
+using Kernel = void (*)(absl::Span<const char* const> operands, int64_t count,
+                        char* out);
+
+template <typename NativeT, typename ElementwiseT,
+          ElementwiseT (*kOp)(ElementwiseT)>
+void UnaryKernel(absl::Span<const char* const> operands, int64_t count,
+                 char* out) {
+  const auto* operand = reinterpret_cast<const NativeT*>(operands[0]);
+  auto* result = reinterpret_cast<NativeT*>(out);
+  for (int64_t i = 0; i < count; ++i) {
+    result[i] =
+        static_cast<NativeT>(kOp(static_cast<ElementwiseT>(operand[i])));
+  }
+}
+
+template <typename NativeT, typename ElementwiseT,
+          ElementwiseT (*kOp)(ElementwiseT, ElementwiseT)>
+void BinaryKernel(absl::Span<const char* const> operands, int64_t count,
+                  char* out) {
+  const auto* lhs = reinterpret_cast<const NativeT*>(operands[0]);
+  const auto* rhs = reinterpret_cast<const NativeT*>(operands[1]);
+  auto* result = reinterpret_cast<NativeT*>(out);
+  for (int64_t i = 0; i < count; ++i) {
+    result[i] = static_cast<NativeT>(kOp(static_cast<ElementwiseT>(lhs[i]),
+                                         static_cast<ElementwiseT>(rhs[i])));
+  }
+}
+
+template <typename NativeT, bool (*kOp)(NativeT, NativeT)>
+void CompareKernel(absl::Span<const char* const> operands, int64_t count,
+                   char* out) {
+  const auto* lhs = reinterpret_cast<const NativeT*>(operands[0]);
+  const auto* rhs = reinterpret_cast<const NativeT*>(operands[1]);
+  auto* result = reinterpret_cast<bool*>(out);
+  for (int64_t i = 0; i < count; ++i) {
+    result[i] = kOp(lhs[i], rhs[i]);
+  }
+}
+
+template <typename NativeT>
+void SelectKernel(absl::Span<const char* const> operands, int64_t count,
+                  char* out) {
+  const auto* pred = reinterpret_cast<const bool*>(operands[0]);
+  const auto* on_true = reinterpret_cast<const NativeT*>(operands[1]);
+  const auto* on_false = reinterpret_cast<const NativeT*>(operands[2]);
+  auto* result = reinterpret_cast<NativeT*>(out);
+  for (int64_t i = 0; i < count; ++i) {
+    result[i] = pred[i] ? on_true[i] : on_false[i];
+  }
+}
+
+// Converts like Literal::Convert, which saturates when converting floating
+// point values to integers and maps NaN to zero.
+template <typename SrcT, typename DestT>
+DestT ConvertElement(SrcT src) {
+  if constexpr (!std::is_same_v<DestT, bool> &&
+                !std::numeric_limits<SrcT>::is_integer &&
+                std::numeric_limits<DestT>::is_integer) {
+    if (src != src) {
+      return DestT{0};
+    }
+    if (src >= static_cast<SrcT>(std::numeric_limits<DestT>::max())) {
+      return std::numeric_limits<DestT>::max();
+    }
+    if (src <= static_cast<SrcT>(std::numeric_limits<DestT>::lowest())) {
+      return std::numeric_limits<DestT>::lowest();
+    }
+  }
+  return static_cast<DestT>(src);
+}
+
+template <typename SrcT, typename DestT>
+void ConvertKernel(absl::Span<const char* const> operands, int64_t count,
+                   char* out) {
+  const auto* operand = reinterpret_cast<const SrcT*>(operands[0]);
+  auto* result = reinterpret_cast<DestT*>(out);
+  for (int64_t i = 0; i < count; ++i) {
+    result[i] = ConvertElement<SrcT, DestT>(operand[i]);
+  }
+}
+
+// The element functions below follow the lambdas of HloEvaluatorTypedVisitor.
+
+template <typename T>
+T Abs(T x) {
+  if constexpr (std::is_unsigned_v<T>) {
+    return x;
+  } else {
+    return std::abs(x);
+  }
+}
+
+template <typename NativeT, typename T>
+T Negate(T x) {
+  if constexpr (std::is_signed_v<NativeT> &&
+                !std::is_floating_point_v<NativeT>) {
+    return NativeT(-std::make_unsigned_t<NativeT>(x));
+  } else {
+    return -x;
+  }
+}
+
+template <typename T>
+T Not(T x) {
+  if constexpr (std::is_floating_point_v<T> || std::is_same_v<T, bool>) {
+    return !x;
+  } else {
+    return ~x;
+  }
+}
+
+template <typename T>
+T Exp(T x) {
+  return std::exp(x);
+}
+
+template <typename T>
+T Log(T x) {
+  return std::log(x);
+}
+
+template <typename T>
+T Sqrt(T x) {
+  return std::sqrt(x);
+}
+
+template <typename T>
+T Rsqrt(T x) {
+  return static_cast<T>(1) / std::sqrt(x);
+}
+
+template <typename T>
+T Tanh(T x) {
+  return std::tanh(x);
+}
+
+template <typename T>
+T Logistic(T x) {
+  return static_cast<T>(1) / (static_cast<T>(1) + std::exp(-x));
+}
+
+template <typename T>
+T Floor(T x) {
+  return std::floor(x);
+}
+
+template <typename T>
+T Ceil(T x) {
+  return std::ceil(x);
+}
+
+template <typename T>
+T Add(T lhs, T rhs) {
+  return T(ToArithmeticSafeType(lhs) + ToArithmeticSafeType(rhs));
+}
+
+template <typename T>
+T Subtract(T lhs, T rhs) {
+  return T(ToArithmeticSafeType(lhs) - ToArithmeticSafeType(rhs));
+}
+
+template <typename T>
+T Multiply(T lhs, T rhs) {
+  return T(ToArithmeticSafeType(lhs) * ToArithmeticSafeType(rhs));
+}
+
+template <typename T>
+T Divide(T lhs, T rhs) {
+  if constexpr (std::is_integral_v<T>) {
+    if constexpr (std::is_unsigned_v<T>) {
+      if (rhs == 0) {
+        return std::numeric_limits<T>::max();
+      }
+    }
+    if constexpr (std::is_signed_v<T>) {
+      if (rhs == 0) {
+        return static_cast<T>(-1);
+      }
+      if (rhs == -1 && lhs == std::numeric_limits<T>::min()) {
+        return lhs;
+      }
+    }
+  }
+  return lhs / rhs;
+}
+
+template <typename T>
+T Maximum(T lhs, T rhs) {
+  if constexpr (std::numeric_limits<T>::has_quiet_NaN) {
+    if (std::isnan(lhs)) {
+      return lhs;
+    }
+    if (std::isnan(rhs)) {
+      return rhs;
+    }
+  }
+  return std::max(lhs, rhs);
+}
+
+template <typename T>
+T Minimum(T lhs, T rhs) {
+  if constexpr (std::numeric_limits<T>::has_quiet_NaN) {
+    if (std::isnan(lhs)) {
+      return lhs;
+    }
+    if (std::isnan(rhs)) {
+      return rhs;
+    }
+  }
+  return std::min(lhs, rhs);
+}
+
+template <typename T>
+T And(T lhs, T rhs) {
+  return lhs & rhs;
+}
+
+template <typename T>
+T Or(T lhs, T rhs) {
+  return lhs | rhs;
+}
+
+template <typename T>
+T Xor(T lhs, T rhs) {
+  return lhs ^ rhs;
+}
+
+template <typename T>
+bool Eq(T lhs, T rhs) {
+  return lhs == rhs;
+}
+
+template <typename T>
+bool Ne(T lhs, T rhs) {
+  return lhs != rhs;
+}
+
+template <typename T>
+bool Ge(T lhs, T rhs) {
+  return lhs >= rhs;
+}
+
+template <typename T>
+bool Gt(T lhs, T rhs) {
+  return lhs > rhs;
+}
+
+template <typename T>
+bool Le(T lhs, T rhs) {
+  return lhs <= rhs;
+}
+
+template <typename T>
+bool Lt(T lhs, T rhs) {
+  return lhs < rhs;
+}
+
+template <PrimitiveType kType>
+Kernel GetUnaryKernel(HloOpcode opcode) {
+  using NativeT = NativeTypeOf<kType>;
+  using T = ElementwiseTypeOf<kType>;
+  constexpr bool kIsFloat = primitive_util::IsFloatingPointType(kType);
+  constexpr bool kIsIntegral = primitive_util::IsIntegralType(kType);
+  if constexpr (kIsFloat || kIsIntegral) {
+    switch (opcode) {
+      case HloOpcode::kAbs:
+        return &UnaryKernel<NativeT, T, &Abs<T>>;
+      case HloOpcode::kNegate:
+        return &UnaryKernel<NativeT, T, &Negate<NativeT, T>>;
+      default:
+        break;
+    }
+  }
+  if constexpr (kIsFloat) {
+    switch (opcode) {
+      case HloOpcode::kExp:
+        return &UnaryKernel<NativeT, T, &Exp<T>>;
+      case HloOpcode::kLog:
+        return &UnaryKernel<NativeT, T, &Log<T>>;
+      case HloOpcode::kSqrt:
+        return &UnaryKernel<NativeT, T, &Sqrt<T>>;
+      case HloOpcode::kRsqrt:
+        return &UnaryKernel<NativeT, T, &Rsqrt<T>>;
+      case HloOpcode::kTanh:
+        return &UnaryKernel<NativeT, T, &Tanh<T>>;
+      case HloOpcode::kLogistic:
+        return &UnaryKernel<NativeT, T, &Logistic<T>>;
+      case HloOpcode::kFloor:
+        return &UnaryKernel<NativeT, T, &Floor<T>>;
+      case HloOpcode::kCeil:
+        return &UnaryKernel<NativeT, T, &Ceil<T>>;
+      default:
+        break;
+    }
+  }
+  if constexpr (kIsIntegral || kType == PRED) {
+    if (opcode == HloOpcode::kNot) {
+      return &UnaryKernel<NativeT, T, &Not<T>>;
+    }
+  }
+  return nullptr;
+}
+
+template <PrimitiveType kType>
+Kernel GetBinaryKernel(HloOpcode opcode) {
+  using NativeT = NativeTypeOf<kType>;
+  using T = ElementwiseTypeOf<kType>;
+  constexpr bool kIsFloat = primitive_util::IsFloatingPointType(kType);
+  constexpr bool kIsIntegral = primitive_util::IsIntegralType(kType);
+  if constexpr (kIsFloat || kIsIntegral) {
+    switch (opcode) {
+      case HloOpcode::kAdd:
+        return &BinaryKernel<NativeT, T, &Add<T>>;
+      case HloOpcode::kSubtract:
+        return &BinaryKernel<NativeT, T, &Subtract<T>>;
+      case HloOpcode::kMultiply:
+        return &BinaryKernel<NativeT, T, &Multiply<T>>;
+      case HloOpcode::kDivide:
+        return &BinaryKernel<NativeT, T, &Divide<T>>;
+      case HloOpcode::kMaximum:
+        return &BinaryKernel<NativeT, T, &Maximum<T>>;
+      case HloOpcode::kMinimum:
+        return &BinaryKernel<NativeT, T, &Minimum<T>>;
+      default:
+        break;
+    }
+  }
+  if constexpr (kIsIntegral || kType == PRED) {
+    switch (opcode) {
+      case HloOpcode::kAnd:
+        return &BinaryKernel<NativeT, T, &And<T>>;
+      case HloOpcode::kOr:
+        return &BinaryKernel<NativeT, T, &Or<T>>;
+      case HloOpcode::kXor:
+        return &BinaryKernel<NativeT, T, &Xor<T>>;
+      default:
+        break;
+    }
+  }
+  return nullptr;
+}
+
+template <PrimitiveType kType>
+Kernel GetCompareKernel(ComparisonDirection direction) {
+  using NativeT = NativeTypeOf<kType>;
+  switch (direction) {
+    case ComparisonDirection::kEq:
+      return &CompareKernel<NativeT, &Eq<NativeT>>;
+    case ComparisonDirection::kNe:
+      return &CompareKernel<NativeT, &Ne<NativeT>>;
+    case ComparisonDirection::kGe:
+      return &CompareKernel<NativeT, &Ge<NativeT>>;
+    case ComparisonDirection::kGt:
+      return &CompareKernel<NativeT, &Gt<NativeT>>;
+    case ComparisonDirection::kLe:
+      return &CompareKernel<NativeT, &Le<NativeT>>;
+    case ComparisonDirection::kLt:
+      return &CompareKernel<NativeT, &Lt<NativeT>>;
+  }
+  return nullptr;
+}
+
+// Calls `f` with the PrimitiveTypeConstant of `type`, which must be supported.
+template <typename F>
+Kernel SupportedTypeSwitch(F&& f, PrimitiveType type) {
+  return primitive_util::PrimitiveTypeSwitch<Kernel>(
+      [&](auto primitive_type_constant) -> Kernel {
+        if constexpr (IsSupportedType(primitive_type_constant)) {
+          return f(primitive_type_constant);
+        }
+        return nullptr;
+      },
+      type);
+}
+
+Kernel GetConvertKernel(PrimitiveType from, PrimitiveType to) {
+  return SupportedTypeSwitch(
+      [&](auto from_constant) {
+        return SupportedTypeSwitch(
+            [&](auto to_constant) -> Kernel {
+              return &ConvertKernel<NativeTypeOf<from_constant>,
+                                    NativeTypeOf<to_constant>>;
+            },
+            to);
+      },
+      from);
+}
+
+// Fills `count` elements of `size` bytes at `out` with the element at `value`.
+void Fill(const char* value, int64_t size, int64_t count, char* out) {
+  auto fill = [&](auto element_type_tag) {
+    using T = decltype(element_type_tag);
+    T element;
+    std::memcpy(&element, value, sizeof(T));
+    std::fill_n(reinterpret_cast<T*>(out), count, element);
+  };
+  switch (size) {
+    case 1:
+      return fill(uint8_t{});
+    case 2:
+      return fill(uint16_t{});
+    case 4:
+      return fill(uint32_t{});
+    case 8:
+      return fill(uint64_t{});
+  }
+  LOG(FATAL) << "Unexpected element size " << size;
+}
+
+// Copies the elements of `data` at the indices of `chunk` to `out`.
+void Gather(const char* data, int64_t size, const IndexChunk& chunk,
+            char* out) {
+  auto gather = [&](auto element_type_tag) {
+    using T = decltype(element_type_tag);
+    const T* elements = reinterpret_cast<const T*>(data);
+    T* result = reinterpret_cast<T*>(out);
+    for (int64_t i = 0; i < chunk.count; ++i) {
+      result[i] = elements[chunk[i]];
+    }
+  };
+  switch (size) {
+    case 1:
+      return gather(uint8_t{});
+    case 2:
+      return gather(uint16_t{});
+    case 4:
+      return gather(uint32_t{});
+    case 8:
+      return gather(uint64_t{});
+  }
+  LOG(FATAL) << "Unexpected element size " << size;
+}
+
+}  // namespace
+
+struct ElementwiseProgram::Node {
+  enum class Kind {
+    // Reads an operand of the instruction the program is built for.
+    kInput,
+    // Reads the literal of a constant instruction.
+    kConstant,
+    // Forwards the elements of its operand at the indices given by
+    // `index_map`, or at the same indices if there is no map.
+    kForward,
+    // Computes its elements with `kernel`.
+    kCompute,
+  };
+
+  Kind kind;
+  Shape shape;
+  int64_t element_size;
+  std::vector<int64_t> operands;
+  int64_t num_users = 0;
+
+  int64_t input_index = -1;
+  const Literal* literal = nullptr;
+  std::optional<LinearIndexMap> index_map;
+  Kernel kernel = nullptr;
+};
+
+// The state of evaluating a program on one thread. Node results live in
+// buffers that are recycled for every chunk of the result.
+class ElementwiseProgram::Evaluation {
+ public:
+  // The elements read by an input or constant node.
+  struct Leaf {
+    const char* data = nullptr;
+    std::optional<LinearIndexMap> layout_map;
+  };
+
+  Evaluation(const ElementwiseProgram& program, absl::Span<const Leaf> leaves)
+      : program_(program), leaves_(leaves), cache_(program.nodes_.size()) {}
+
+  // Evaluates the elements [start, start + count) of the result into `out`.
+  void EvaluateChunk(int64_t start, int64_t count, char* out) {
+    num_used_buffers_ = 0;
+    const int64_t root = program_.nodes_.size() - 1;
+    const char* result =
+        Evaluate(root, IndexChunk{NextChunkId(), count, start});
+    std::memcpy(out, result, count * program_.nodes_[root].element_size);
+  }
+
+ private:
+  struct CachedResult {
+    int64_t chunk_id = -1;
+    const char* data = nullptr;
+  };
+
+  const char* Evaluate(int64_t id, const IndexChunk& chunk) {
+    const Node& node = program_.nodes_[id];
+    CachedResult& cached = cache_[id];
+    if (cached.chunk_id == chunk.id) {
+      return cached.data;
+    }
+
+    const char* result;
+    if (chunk.is_uniform() && chunk.count > 1) {
+      // All indices are the same, e.g. for the operand of a scalar broadcast,
+      // so evaluate one element and replicate it.
+      const char* element =
+          Evaluate(id, IndexChunk{NextChunkId(), 1, chunk.start});
+      char* out = Allocate();
+      Fill(element, node.element_size, chunk.count, out);
+      result = out;
+    } else {
+      switch (node.kind) {
+        case Node::Kind::kInput:
+        case Node::Kind::kConstant:
+          result = Load(leaves_[id], node.element_size, chunk);
+          break;
+        case Node::Kind::kForward:
+          result = Evaluate(node.operands[0],
+                            node.index_map.has_value()
+                                ? MapChunk(*node.index_map, chunk)
+                                : chunk);
+          break;
+        case Node::Kind::kCompute: {
+          absl::InlinedVector<const char*, 3> operands;
+          for (int64_t operand : node.operands) {
+            operands.push_back(Evaluate(operand, chunk));
+          }
+          char* out = Allocate();
+          node.kernel(operands, chunk.count, out);
+          result = out;
+          break;
+        }
+      }
+    }
+
+    if (node.num_users > 1) {
+      cached = CachedResult{chunk.id, result};
+    }
+    return result;
+  }
+
+  const char* Load(const Leaf& leaf, int64_t element_size,
+                   const IndexChunk& chunk) {
+    IndexChunk physical = leaf.layout_map.has_value()
+                              ? MapChunk(*leaf.layout_map, chunk)
+                              : chunk;
+    if (physical.is_contiguous()) {
+      return leaf.data + physical.start * element_size;
+    }
+    char* out = Allocate();
+    Gather(leaf.data, element_size, physical, out);
+    return out;
+  }
+
+  IndexChunk MapChunk(const LinearIndexMap& map, const IndexChunk& chunk) {
+    if (map.is_identity()) {
+      return chunk;
+    }
+    IndexChunk mapped{NextChunkId(), chunk.count};
+    if (chunk.is_uniform() || map.is_uniform()) {
+      mapped.start = map.Map(chunk[0]);
+      mapped.stride = 0;
+    } else if (chunk.is_contiguous() &&
+               map.IsAffineOn(chunk.start, chunk.count)) {
+      mapped.start = map.Map(chunk.start);
+      mapped.stride = map.minor_coefficient();
+    } else {
+      int64_t* indices = reinterpret_cast<int64_t*>(Allocate());
+      map.Map(chunk, indices);
+      mapped.indices = indices;
+    }
+    return mapped;
+  }
+
+  // Returns a buffer for kChunkSize elements, valid until the next chunk.
+  char* Allocate() {
+    if (num_used_buffers_ == buffers_.size()) {
+      buffers_.push_back(
+          std::make_unique<char[]>(kChunkSize * kMaxElementSize));
+    }
+    return buffers_[num_used_buffers_++].get();
+  }
+
+  int64_t NextChunkId() { return next_chunk_id_++; }
+
+  const ElementwiseProgram& program_;
+  absl::Span<const Leaf> leaves_;
+
+  std::vector<std::unique_ptr<char[]>> buffers_;
+  int64_t num_used_buffers_ = 0;
+  int64_t next_chunk_id_ = 0;
+  // The result of every node with multiple users for its last chunk.
+  std::vector<CachedResult> cache_;
+};
+
+ElementwiseProgram::ElementwiseProgram() = default;
+ElementwiseProgram::ElementwiseProgram(ElementwiseProgram&&) = default;
+ElementwiseProgram& ElementwiseProgram::operator=(ElementwiseProgram&&) =
+    default;
+ElementwiseProgram::~ElementwiseProgram() = default;
+
+/*static*/ std::optional<ElementwiseProgram> ElementwiseProgram::Build(
+    const HloInstruction* instruction) {
+  ElementwiseProgram program;
+  program.shape_ = instruction->shape();
+  if (instruction->opcode() == HloOpcode::kFusion) {
+    absl::flat_hash_map<const HloInstruction*, int64_t> node_ids;
+    for (const HloInstruction* fused_instruction :
+         instruction->fused_instructions_computation()
+             ->MakeInstructionPostOrder()) {
+      bool added;
+      if (fused_instruction->opcode() == HloOpcode::kParameter) {
+        added = program.AddInput(fused_instruction->parameter_number(),
+                                 fused_instruction->shape());
+      } else {
+        std::vector<int64_t> operands;
+        for (const HloInstruction* operand : fused_instruction->operands()) {
+          operands.push_back(node_ids.at(operand));
+        }
+        added = program.AddInstruction(fused_instruction, operands);
+      }
+      if (!added) {
+        return std::nullopt;
+      }
+      node_ids[fused_instruction] = program.nodes_.size() - 1;
+    }
+    if (node_ids.at(instruction->fused_expression_root()) !=
+        program.nodes_.size() - 1) {
+      return std::nullopt;
+    }
+  } else {
+    std::vector<int64_t> operands;
+    for (int64_t i = 0; i < instruction->operand_count(); ++i) {
+      if (!program.AddInput(i, instruction->operand(i)->shape())) {
+        return std::nullopt;
+      }
+      operands.push_back(i);
+    }
+    if (!program.AddInstruction(instruction, operands)) {
+      return std::nullopt;
+    }
+    // Broadcasts and the like are cheaper to evaluate on their own.
+    if (program.nodes_.back().kind != Node::Kind::kCompute) {
+      return std::nullopt;
+    }
+  }
+
+  for (const Node& node : program.nodes_) {
+    for (int64_t operand : node.operands) {
+      ++program.nodes_[operand].num_users;
+    }
+  }
+  return program;
+}
+
+bool ElementwiseProgram::AddInput(int64_t input_index, const Shape& shape) {
+  if (!shape.IsArray() || !shape.is_static() ||
+      !IsSupportedType(shape.element_type())) {
+    return false;
+  }
+  Node node;
+  node.kind = Node::Kind::kInput;
+  node.shape = shape;
+  node.element_size = ShapeUtil::ByteSizeOfPrimitiveType(shape.element_type());
+  node.input_index = input_index;
+  nodes_.push_back(std::move(node));
+  return true;
+}
+
+bool ElementwiseProgram::AddInstruction(const HloInstruction* instruction,
+                                        absl::Span<const int64_t> operands) {
+  const Shape& shape = instruction->shape();
+  if (!shape.IsArray() || !shape.is_static() ||
+      !IsSupportedType(shape.element_type())) {
+    return false;
+  }
+  const PrimitiveType type = shape.element_type();
+
+  Node node;
+  node.shape = shape;
+  node.element_size = ShapeUtil::ByteSizeOfPrimitiveType(type);
+  node.operands.assign(operands.begin(), operands.end());
+  auto operand_shape = [&](int64_t i) -> const Shape& {
+    return nodes_[operands[i]].shape;
+  };
+
+  switch (instruction->opcode()) {
+    case HloOpcode::kConstant:
+      node.kind = Node::Kind::kConstant;
+      node.literal = &instruction->literal();
+      break;
+    case HloOpcode::kBroadcast:
+      node.kind = Node::Kind::kForward;
+      node.index_map = LinearIndexMap::ForBroadcast(
+          shape, operand_shape(0), instruction->dimensions());
+      break;
+    case HloOpcode::kTranspose:
+      node.kind = Node::Kind::kForward;
+      node.index_map = LinearIndexMap::ForTranspose(
+          shape, operand_shape(0), instruction->dimensions());
+      break;
+    case HloOpcode::kReshape:
+    case HloOpcode::kCopy:
+      // Reshapes keep the logical linear index of every element.
+      node.kind = Node::Kind::kForward;
+      break;
+    case HloOpcode::kConvert:
+      if (operand_shape(0).element_type() == type) {
+        node.kind = Node::Kind::kForward;
+      } else {
+        node.kind = Node::Kind::kCompute;
+        node.kernel = GetConvertKernel(operand_shape(0).element_type(), type);
+      }
+      break;
+    case HloOpcode::kCompare: {
+      const PrimitiveType operand_type = operand_shape(0).element_type();
+      // Floating point comparisons in total order compare the sign-magnitude
+      // representation, which is left to the typed visitors.
+      if (primitive_util::IsFloatingPointType(operand_type) &&
+          instruction->comparison_order() == ComparisonOrder::kTotal) {
+        return false;
+      }
+      node.kind = Node::Kind::kCompute;
+      node.kernel = SupportedTypeSwitch(
+          [&](auto primitive_type_constant) {
+            return GetCompareKernel<primitive_type_constant>(
+                instruction->comparison_direction());
+          },
+          operand_type);
+      break;
+    }
+    case HloOpcode::kSelect:
+      // A scalar predicate selects a whole operand, see HandleSelect.
+      if (!ShapeUtil::SameDimensions(operand_shape(0), shape)) {
+        return false;
+      }
+      node.kind = Node::Kind::kCompute;
+      node.kernel = SupportedTypeSwitch(
+          [&](auto primitive_type_constant) -> Kernel {
+            return &SelectKernel<NativeTypeOf<primitive_type_constant>>;
+          },
+          type);
+      break;
+    default:
+      if (instruction->IsElementwise() &&
+          absl::c_all_of(operands, [&](int64_t operand) {
+            return nodes_[operand].shape.element_type() == type;
+          })) {
+        node.kind = Node::Kind::kCompute;
+        node.kernel = SupportedTypeSwitch(
+            [&](auto primitive_type_constant) -> Kernel {
+              if (instruction->operand_count() == 1) {
+                return GetUnaryKernel<primitive_type_constant>(
+                    instruction->opcode());
+              }
+              if (instruction->operand_count() == 2) {
+                return GetBinaryKernel<primitive_type_constant>(
+                    instruction->opcode());
+              }
+              return nullptr;
+            },
+            type);
+      }
+      if (node.kernel == nullptr) {
+        return false;
+      }
+      break;
+  }
+  if (node.kind == Node::Kind::kCompute && node.kernel == nullptr) {
+    return false;
+  }
+  nodes_.push_back(std::move(node));
+  return true;
+}
+
+absl::StatusOr<Literal> ElementwiseProgram::Evaluate(
+    absl::Span<const Literal* const> operands) const {
+  std::vector<Evaluation::Leaf> leaves(nodes_.size());
+  for (int64_t i = 0; i < nodes_.size(); ++i) {
+    const Node& node = nodes_[i];
+    const Literal* literal = node.literal;
+    if (node.kind == Node::Kind::kInput) {
+      TF_RET_CHECK(node.input_index < operands.size());
+      literal = operands[node.input_index];
+    }
+    if (literal == nullptr) {
+      continue;
+    }
+    TF_RET_CHECK(literal->shape().IsArray());
+    TF_RET_CHECK(ShapeUtil::SameDimensions(literal->shape(), node.shape));
+    TF_RET_CHECK(literal->shape().element_type() ==
+                 node.shape.element_type());
+    leaves[i].data = static_cast<const char*>(literal->untyped_data());
+    LinearIndexMap layout_map = LinearIndexMap::ForLayout(literal->shape());
+    if (!layout_map.is_identity()) {
+      leaves[i].layout_map = std::move(layout_map);
+    }
+  }
+
+  const Node& root = nodes_.back();
+  Literal result(ShapeUtil::MakeShapeWithDescendingLayout(
+      root.shape.element_type(), root.shape.dimensions()));
+  const int64_t num_elements = ShapeUtil::ElementsIn(root.shape);
+  char* out = static_cast<char*>(result.untyped_data());
+
+  // Evaluates the elements [start, start + count) of the result.
+  auto evaluate = [&](Evaluation& evaluation, int64_t start, int64_t count) {
+    for (int64_t chunk_start = start; chunk_start < start + count;
+         chunk_start += kChunkSize) {
+      int64_t chunk_size = std::min(kChunkSize, start + count - chunk_start);
+      evaluation.EvaluateChunk(chunk_start, chunk_size,
+                               out + chunk_start * root.element_size);
+    }
+  };
+
+  if (num_elements <= kElementsPerTask) {
+    Evaluation evaluation(*this, leaves);
+    evaluate(evaluation, 0, num_elements);
+    return ToInstructionLayout(std::move(result));
+  }
+
+  // Thread ids of the tasks are in [-1, thread count), -1 being the calling
+  // thread.
+  std::vector<std::unique_ptr<Evaluation>> evaluations(
+      ShapeUtil::GetForEachIndexParallelThreadCount() + 1);
+  const int64_t num_tasks = CeilOfRatio(num_elements, kElementsPerTask);
+  ShapeUtil::ForEachIndexParallel(
+      ShapeUtil::MakeShape(S64, {num_tasks}),
+      [&](absl::Span<const int64_t> task,
+          int thread_id) -> absl::StatusOr<bool> {
+        std::unique_ptr<Evaluation>& evaluation = evaluations[thread_id + 1];
+        if (evaluation == nullptr) {
+          evaluation = std::make_unique<Evaluation>(*this, leaves);
+        }
+        int64_t start = task[0] * kElementsPerTask;
+        evaluate(*evaluation, start,
+                 std::min(kElementsPerTask, num_elements - start));
+        return true;
+      });
+  return ToInstructionLayout(std::move(result));
+}
+
+Literal ElementwiseProgram::ToInstructionLayout(Literal result) const {
+  if (!LayoutUtil::HasLayout(shape_) ||
+      LayoutUtil::Equal(shape_.layout(), result.shape().layout())) {
+    return result;
+  }
+  return result.Relayout(shape_.layout());
+}
+
+}  // namespace xla
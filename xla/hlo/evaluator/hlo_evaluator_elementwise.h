@@ -0,0 +1,85 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_HLO_EVALUATOR_HLO_EVALUATOR_ELEMENTWISE_H_
+#define XLA_HLO_EVALUATOR_HLO_EVALUATOR_ELEMENTWISE_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/literal.h"
+#include "xla/shape.h"
+
+namespace xla {
+
+// An elementwise instruction, or a fusion of elementwise instructions,
+// broadcasts, reshapes and transposes, compiled for evaluation without
+// materializing the intermediate results.
+//
+// The program walks the logical linear indices of the result in chunks. Every
+// instruction evaluates a chunk of indices into a small buffer; broadcasts and
+// transposes translate the indices of a chunk to the index space of their
+// operand, keeping contiguous ranges contiguous where possible so that operand
+// data is read in place. The element semantics mirror the typed visitors of
+// HloEvaluator, including the precision narrow floating point types are
+// computed in, so both produce the same results.
+class ElementwiseProgram {
+ public:
+  // Returns the program for `instruction`, or nullopt if it (or, for a fusion,
+  // one of the fused instructions) is not supported.
+  static std::optional<ElementwiseProgram> Build(
+      const HloInstruction* instruction);
+
+  ElementwiseProgram(ElementwiseProgram&&);
+  ElementwiseProgram& operator=(ElementwiseProgram&&);
+  ~ElementwiseProgram();
+
+  // Evaluates the program given the literals of the operands of the
+  // instruction it was built for. The result has the layout of the instruction,
+  // or the default layout if the instruction has none.
+  absl::StatusOr<Literal> Evaluate(
+      absl::Span<const Literal* const> operands) const;
+
+ private:
+  struct Node;
+  class Evaluation;
+
+  ElementwiseProgram();
+
+  // Appends a node for `instruction` computed from the nodes `operands`.
+  // Returns false if the instruction is not supported.
+  bool AddInstruction(const HloInstruction* instruction,
+                      absl::Span<const int64_t> operands);
+  // Appends a node reading the operand `input_index` of the instruction the
+  // program is built for.
+  bool AddInput(int64_t input_index, const Shape& shape);
+
+  // Returns `result`, which has the default layout, in the layout of shape_.
+  Literal ToInstructionLayout(Literal result) const;
+
+  // The shape of the instruction the program is built for.
+  Shape shape_;
+
+  // In post order, the root is the last node.
+  std::vector<Node> nodes_;
+};
+
+}  // namespace xla
+
+#endif  // XLA_HLO_EVALUATOR_HLO_EVALUATOR_ELEMENTWISE_H_
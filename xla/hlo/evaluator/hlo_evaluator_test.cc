@@ -17,12 +17,14 @@ limitations under the License.
 #include <array>
 #include <complex>
 #include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <limits>
 #include <memory>
 #include <numeric>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -47,6 +49,7 @@ limitations under the License.
 #include "xla/permutation_util.h"
 #include "xla/primitive_util.h"
 #include "xla/service/dynamic_dimension_inference.h"
+#include "xla/service/hlo_parser.h"
 #include "xla/service/hlo_element_type_converter.h"
 #include "xla/service/hlo_module_config.h"
 #include "xla/service/shape_inference.h"
@@ -72,10 +75,11 @@ static std::array<bool, 2> use_bf16_params{true, false};
 
 // Test fixture for the HloEvaluator.
 //
-// In bf16 mode, all f32 shapes are converted to bf16 before running.
-class HloEvaluatorTest : public HloTestBase {
+// In bf16 mode, all f32 shapes are converted to bf16 before running. With the
+// fast elementwise path, elementwise instructions are evaluated by an
+// ElementwiseProgram, which has to agree with the typed visitors.
+class HloEvaluatorTestBase : public HloTestBase {
  public:
-  HloEvaluatorTest() : use_bfloat16_(false) { InitializeFftData(); }
 
   absl::StatusOr<Literal> Evaluate(
       absl::Span<const Literal* const> arg_literals = {}) {
@@ -232,7 +236,9 @@ class HloEvaluatorTest : public HloTestBase {
   }
 
  protected:
-  explicit HloEvaluatorTest(bool use_bfloat16) : use_bfloat16_(use_bfloat16) {
+  HloEvaluatorTestBase(bool use_bfloat16, bool use_fast_elementwise_path)
+      : use_bfloat16_(use_bfloat16) {
+    evaluator_.set_use_fast_elementwise_path(use_fast_elementwise_path);
     InitializeFftData();
   }
 
@@ -252,15 +258,33 @@ class HloEvaluatorTest : public HloTestBase {
   Literal fft_c64x2x4x8_3d_;
 };
 
-// Lets you write TEST_Ps that run twice, once with and once without bf16.
-class HloEvaluatorBf16Test : public ::testing::WithParamInterface<bool>,
-                             public HloEvaluatorTest {
+// Runs every test with and without the fast elementwise path.
+class HloEvaluatorTest : public ::testing::WithParamInterface<bool>,
+                         public HloEvaluatorTestBase {
  protected:
-  HloEvaluatorBf16Test() : HloEvaluatorTest(/*use_bfloat16=*/GetParam()) {}
+  HloEvaluatorTest()
+      : HloEvaluatorTestBase(/*use_bfloat16=*/false,
+                             /*use_fast_elementwise_path=*/GetParam()) {}
 };
 
-INSTANTIATE_TEST_SUITE_P(HloEvaluatorTest_Instantiation, HloEvaluatorBf16Test,
-                         ::testing::ValuesIn(use_bf16_params));
+INSTANTIATE_TEST_SUITE_P(HloEvaluatorTest_Instantiation, HloEvaluatorTest,
+                         ::testing::Bool());
+
+// Lets you write TEST_Ps that run with and without bf16, and with and without
+// the fast elementwise path.
+class HloEvaluatorBf16Test
+    : public ::testing::WithParamInterface<std::tuple<bool, bool>>,
+      public HloEvaluatorTestBase {
+ protected:
+  HloEvaluatorBf16Test()
+      : HloEvaluatorTestBase(
+            /*use_bfloat16=*/std::get<0>(GetParam()),
+            /*use_fast_elementwise_path=*/std::get<1>(GetParam())) {}
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    HloEvaluatorTest_Instantiation, HloEvaluatorBf16Test,
+    ::testing::Combine(::testing::ValuesIn(use_bf16_params), ::testing::Bool()));
 
 // Verifies that HloEvaluator evaluates a HLO instruction that performs clamp
 // with 3 operands.
@@ -360,7 +384,7 @@ TEST_P(HloEvaluatorBf16Test, DoesSelect) {
 
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise addition with 2 operands.
-TEST_F(HloEvaluatorTest, DoesAdd) {
+TEST_P(HloEvaluatorTest, DoesAdd) {
   auto lhs = LiteralUtil::CreateR2<int64_t>({{1, 0}, {-100, 4}});
   auto rhs = LiteralUtil::CreateR2<int64_t>({{2, 4}, {4, 4}});
   auto expected = LiteralUtil::CreateR2<int64_t>({{3, 4}, {-96, 8}});
@@ -378,7 +402,7 @@ TEST_P(HloEvaluatorBf16Test, DoesAnd) {
 }
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise or with 2 operands.
-TEST_F(HloEvaluatorTest, DoesOr) {
+TEST_P(HloEvaluatorTest, DoesOr) {
   auto lhs = LiteralUtil::CreateR2<int64_t>({{1, 0}, {-100, 4}});
   auto rhs = LiteralUtil::CreateR2<int64_t>({{2, 4}, {4, 4}});
   auto expected = LiteralUtil::CreateR2<int64_t>({{3, 4}, {-100, 4}});
@@ -387,7 +411,7 @@ TEST_F(HloEvaluatorTest, DoesOr) {
 }
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise or with 2 operands.
-TEST_F(HloEvaluatorTest, DoesXor) {
+TEST_P(HloEvaluatorTest, DoesXor) {
   auto lhs = LiteralUtil::CreateR2<int64_t>({{1, 0}, {-100, 4}});
   auto rhs = LiteralUtil::CreateR2<int64_t>({{2, 4}, {4, 4}});
   auto expected = LiteralUtil::CreateR2<int64_t>({{3, 4}, {-104, 0}});
@@ -396,7 +420,7 @@ TEST_F(HloEvaluatorTest, DoesXor) {
 }
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise multiply with 2 operands.
-TEST_F(HloEvaluatorTest, DoesMultiply) {
+TEST_P(HloEvaluatorTest, DoesMultiply) {
   auto lhs = LiteralUtil::CreateR2<int32_t>({{-1, 0}, {-100, 4}});
   auto rhs = LiteralUtil::CreateR2<int32_t>(
       {{std::numeric_limits<int32_t>::min(), 4}, {4, 4}});
@@ -407,7 +431,7 @@ TEST_F(HloEvaluatorTest, DoesMultiply) {
 }
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise divide with 2 operands.
-TEST_F(HloEvaluatorTest, DoesDivideInt64) {
+TEST_P(HloEvaluatorTest, DoesDivideInt64) {
   auto lhs = LiteralUtil::CreateR2<int64_t>({{1, 0}, {-100, 4}});
   auto rhs = LiteralUtil::CreateR2<int64_t>({{2, 4}, {4, 4}});
   auto expected = LiteralUtil::CreateR2<int64_t>({{0, 0}, {-25, 1}});
@@ -415,7 +439,7 @@ TEST_F(HloEvaluatorTest, DoesDivideInt64) {
                std::move(rhs));
 }
 
-TEST_F(HloEvaluatorTest, DoesClampS64) {
+TEST_P(HloEvaluatorTest, DoesClampS64) {
   auto low = LiteralUtil::CreateR1<int64_t>(
       {-8616761059752331528LL, 6780561065411491190LL, -8616761059752331528LL});
   auto value = LiteralUtil::CreateR1<int64_t>(
@@ -439,7 +463,7 @@ TEST_P(HloEvaluatorBf16Test, DoesDivideDouble) {
 
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise abs op with 1 operand.
-TEST_F(HloEvaluatorTest, DoesAbsR2) {
+TEST_P(HloEvaluatorTest, DoesAbsR2) {
   auto operand = LiteralUtil::CreateR2<int64_t>({{1, -20}, {-100, 4}});
   auto expected = LiteralUtil::CreateR2<int64_t>({{1, 20}, {100, 4}});
   TestUnaryOp(HloOpcode::kAbs, std::move(expected), std::move(operand));
@@ -455,13 +479,13 @@ TEST_P(HloEvaluatorBf16Test, DoesAbsR1WithZeroSize) {
   TestUnaryOp(HloOpcode::kAbs, std::move(expected), std::move(operand));
 }
 
-TEST_F(HloEvaluatorTest, DoesAbsC128) {
+TEST_P(HloEvaluatorTest, DoesAbsC128) {
   auto x = LiteralUtil::CreateR0<complex128>({1, 2});
   auto expected_real = LiteralUtil::CreateR0<double>(2.23607);
   TestUnaryOp(HloOpcode::kAbs, std::move(expected_real), std::move(x), 3e-06);
 }
 
-TEST_F(HloEvaluatorTest, DoesNegateR2) {
+TEST_P(HloEvaluatorTest, DoesNegateR2) {
   auto operand = LiteralUtil::CreateR2<int32_t>(
       {{0, std::numeric_limits<int32_t>::min()}, {-1, 4}});
   auto expected = LiteralUtil::CreateR2<int32_t>(
@@ -486,7 +510,7 @@ TEST_P(HloEvaluatorBf16Test, DoesTanR2) {
   TestUnaryOp(HloOpcode::kTan, std::move(expected), std::move(operand),
               use_bfloat16_ ? 0.031250 : 9.5367431640625E-7);
 }
-TEST_F(HloEvaluatorTest, DoesNotR2) {
+TEST_P(HloEvaluatorTest, DoesNotR2) {
   auto operand =
       LiteralUtil::CreateR2<int32_t>({{0, std::numeric_limits<int>::min()},
                                       {-1, std::numeric_limits<int>::max()}});
@@ -496,13 +520,13 @@ TEST_F(HloEvaluatorTest, DoesNotR2) {
   TestUnaryOp(HloOpcode::kNot, std::move(expected), std::move(operand));
 }
 
-TEST_F(HloEvaluatorTest, DoesRealC128) {
+TEST_P(HloEvaluatorTest, DoesRealC128) {
   auto x = LiteralUtil::CreateR1<complex128>({{1, 0}, {-100, 4}});
   auto expected_real = LiteralUtil::CreateR1<double>({1, -100});
   TestUnaryOp(HloOpcode::kReal, std::move(expected_real), std::move(x));
 }
 
-TEST_F(HloEvaluatorTest, DoesImagC128) {
+TEST_P(HloEvaluatorTest, DoesImagC128) {
   auto x = LiteralUtil::CreateR1<complex128>({{1, 0}, {-100, 4}});
   auto expected_imag = LiteralUtil::CreateR1<double>({0, 4});
   TestUnaryOp(HloOpcode::kImag, std::move(expected_imag), std::move(x));
@@ -514,7 +538,7 @@ TEST_P(HloEvaluatorBf16Test, DoesImagF32AndBf16) {
   TestUnaryOp(HloOpcode::kImag, std::move(expected_imag), std::move(x));
 }
 
-TEST_F(HloEvaluatorTest, DoesImagF64) {
+TEST_P(HloEvaluatorTest, DoesImagF64) {
   auto x = LiteralUtil::CreateR1<double>({1, -100});
   auto expected_imag = LiteralUtil::CreateR1<double>({0, 0});
   TestUnaryOp(HloOpcode::kImag, std::move(expected_imag), std::move(x));
@@ -522,7 +546,7 @@ TEST_F(HloEvaluatorTest, DoesImagF64) {
 
 // Verifies that HloEvaluator evaluates a HLO Computation with non-parameter nor
 // constant operands.
-TEST_F(HloEvaluatorTest, DoesTraverseInstructions) {
+TEST_P(HloEvaluatorTest, DoesTraverseInstructions) {
   auto lhs = LiteralUtil::CreateR2<int64_t>({{1, 0}, {-100, 4}});
   auto rhs = LiteralUtil::CreateR2<int64_t>({{2, 4}, {4, 4}});
   auto rhs2 = LiteralUtil::CreateR2<int64_t>({{1, -20}, {-100, 4}});
@@ -552,7 +576,7 @@ TEST_F(HloEvaluatorTest, DoesTraverseInstructions) {
 }
 
 // Verifies Reshape operation is correctly evaluated.
-TEST_F(HloEvaluatorTest, DoesReshape) {
+TEST_P(HloEvaluatorTest, DoesReshape) {
   HloComputation::Builder b(TestName());
   const int64_t dimensions[] = {11, 8, 7, 5, 9};
   TF_ASSERT_OK_AND_ASSIGN(auto literal,
@@ -579,7 +603,7 @@ TEST_F(HloEvaluatorTest, DoesReshape) {
 }
 
 // Verifies Broadcast operation is correctly evaluated.
-TEST_F(HloEvaluatorTest, DoesBroadcast) {
+TEST_P(HloEvaluatorTest, DoesBroadcast) {
   HloComputation::Builder b(TestName());
   auto input_literal = LiteralUtil::CreateR2<int32_t>({{1, 2}, {3, 4}, {5, 6}});
   auto output_literal = LiteralUtil::CreateR3<int32_t>(
@@ -595,7 +619,7 @@ TEST_F(HloEvaluatorTest, DoesBroadcast) {
   EXPECT_TRUE(LiteralTestUtil::Equal(result, output_literal));
 }
 
-TEST_F(HloEvaluatorTest, DoesBroadcastScalar) {
+TEST_P(HloEvaluatorTest, DoesBroadcastScalar) {
   HloComputation::Builder b(TestName());
   auto input_literal = LiteralUtil::CreateR0<int32_t>(111);
   auto output_literal = LiteralUtil::CreateR2<int32_t>(
@@ -614,7 +638,7 @@ TEST_F(HloEvaluatorTest, DoesBroadcastScalar) {
   EXPECT_TRUE(LiteralTestUtil::Equal(result, output_literal));
 }
 
-TEST_F(HloEvaluatorTest, DoesConcatenateSimple) {
+TEST_P(HloEvaluatorTest, DoesConcatenateSimple) {
   HloComputation::Builder b(TestName());
 
   HloInstruction* operand1 = b.AddInstruction(HloInstruction::CreateConstant(
@@ -636,7 +660,7 @@ TEST_F(HloEvaluatorTest, DoesConcatenateSimple) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, ConcatenateHandlesShapeWithZeroElement) {
+TEST_P(HloEvaluatorTest, ConcatenateHandlesShapeWithZeroElement) {
   HloComputation::Builder b(TestName());
 
   HloInstruction* operand1 = b.AddInstruction(HloInstruction::CreateConstant(
@@ -709,7 +733,7 @@ PaddingConfig CreatePaddingConfig(
   return padding_config;
 }
 
-TEST_F(HloEvaluatorTest, Pad2DIntegerArrayWithZeroDimension) {
+TEST_P(HloEvaluatorTest, Pad2DIntegerArrayWithZeroDimension) {
   auto operand = LiteralUtil::CreateR2<int32_t>({{}, {}});
   HloComputation::Builder b(TestName());
   auto operand_instruction =
@@ -1566,7 +1590,7 @@ TEST_P(HloEvaluatorBf16Test, Conv2DGroupedConvolution) {
 
 // Initialization of data sets for FFT tests:
 
-void HloEvaluatorTest::InitializeFftData() {
+void HloEvaluatorTestBase::InitializeFftData() {
   // clang-format off
   fft_c64x2x4x8_ = LiteralUtil::CreateR3<complex64>({
     {{{0.0, 0.0}, {1.0, 0.0}, {2.0, 0.0}, {3.0, 0.0},
@@ -1645,7 +1669,7 @@ void HloEvaluatorTest::InitializeFftData() {
 
 // Simple FFT tests:
 
-TEST_F(HloEvaluatorTest, 1D_FFT_4_on_c64x4) {
+TEST_P(HloEvaluatorTest, 1D_FFT_4_on_c64x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1664,7 +1688,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_IFFT_4_on_c64x4) {
+TEST_P(HloEvaluatorTest, 1D_IFFT_4_on_c64x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1683,7 +1707,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_RFFT_4_on_f32x4) {
+TEST_P(HloEvaluatorTest, 1D_RFFT_4_on_f32x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1701,7 +1725,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_IRFFT_4_on_c64x3) {
+TEST_P(HloEvaluatorTest, 1D_IRFFT_4_on_c64x3) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1721,7 +1745,7 @@ ENTRY main {
 
 // 1D FFT tests:
 
-TEST_F(HloEvaluatorTest, 1D_FFT_8_on_c64x2x4x8) {
+TEST_P(HloEvaluatorTest, 1D_FFT_8_on_c64x2x4x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1736,7 +1760,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_1d_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_IFFT_8_on_c64x2x4x8) {
+TEST_P(HloEvaluatorTest, 1D_IFFT_8_on_c64x2x4x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1751,7 +1775,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_RFFT_8_on_f32x8) {
+TEST_P(HloEvaluatorTest, 1D_RFFT_8_on_f32x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1773,7 +1797,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_IRFFT_8_on_c64x5) {
+TEST_P(HloEvaluatorTest, 1D_IRFFT_8_on_c64x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1795,7 +1819,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_RFFT_9_on_f32x9) {
+TEST_P(HloEvaluatorTest, 1D_RFFT_9_on_f32x9) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1817,7 +1841,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 1D_IRFFT_9_on_c64x5) {
+TEST_P(HloEvaluatorTest, 1D_IRFFT_9_on_c64x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1841,7 +1865,7 @@ ENTRY main {
 
 // 2D FFT tests:
 
-TEST_F(HloEvaluatorTest, 2D_FFT_4x8_on_c64x2x4x8) {
+TEST_P(HloEvaluatorTest, 2D_FFT_4x8_on_c64x2x4x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1856,7 +1880,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_2d_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 2D_IFFT_4x8_on_c64x2x4x8) {
+TEST_P(HloEvaluatorTest, 2D_IFFT_4x8_on_c64x2x4x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1871,7 +1895,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 2D_RFFT_3x8_on_f32x3x8) {
+TEST_P(HloEvaluatorTest, 2D_RFFT_3x8_on_f32x3x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1905,7 +1929,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 2D_IRFFT_3x8_on_c64x3x5) {
+TEST_P(HloEvaluatorTest, 2D_IRFFT_3x8_on_c64x3x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1939,7 +1963,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 2D_RFFT_3x9_on_f32x3x9) {
+TEST_P(HloEvaluatorTest, 2D_RFFT_3x9_on_f32x3x9) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -1973,7 +1997,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 2D_IRFFT_3x9_on_c64x3x5) {
+TEST_P(HloEvaluatorTest, 2D_IRFFT_3x9_on_c64x3x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2009,7 +2033,7 @@ ENTRY main {
 
 // 3D FFT tests:
 
-TEST_F(HloEvaluatorTest, 3D_FFT_2x4x8_on_c64x2x4x8) {
+TEST_P(HloEvaluatorTest, 3D_FFT_2x4x8_on_c64x2x4x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2024,7 +2048,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_3d_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 3D_IFFT_2x4x8_on_c64x2x4x8) {
+TEST_P(HloEvaluatorTest, 3D_IFFT_2x4x8_on_c64x2x4x8) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2039,7 +2063,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 3D_RFFT_3x3x4_on_f32x3x3x4) {
+TEST_P(HloEvaluatorTest, 3D_RFFT_3x3x4_on_f32x3x3x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2070,7 +2094,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 3D_IRFFT_3x3x4_on_c64x3x3x3) {
+TEST_P(HloEvaluatorTest, 3D_IRFFT_3x3x4_on_c64x3x3x3) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2101,7 +2125,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 3D_RFFT_3x3x5_on_f32x3x3x5) {
+TEST_P(HloEvaluatorTest, 3D_RFFT_3x3x5_on_f32x3x3x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2135,7 +2159,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(expected, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 3D_IRFFT_3x3x5_on_c64x3x3x3) {
+TEST_P(HloEvaluatorTest, 3D_IRFFT_3x3x5_on_c64x3x3x3) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2171,7 +2195,7 @@ ENTRY main {
 
 // FFT tests with non-default data layout:
 
-TEST_F(HloEvaluatorTest, 1D_FFT_8_on_c64x2x4x8_with_layout) {
+TEST_P(HloEvaluatorTest, 1D_FFT_8_on_c64x2x4x8_with_layout) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2187,7 +2211,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_1d_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 2D_FFT_4x8_on_c64x2x4x8_with_layout) {
+TEST_P(HloEvaluatorTest, 2D_FFT_4x8_on_c64x2x4x8_with_layout) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2203,7 +2227,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Near(fft_c64x2x4x8_2d_, result, fft_error_));
 }
 
-TEST_F(HloEvaluatorTest, 3D_FFT_2x4x8_on_c64x2x4x8_with_layout) {
+TEST_P(HloEvaluatorTest, 3D_FFT_2x4x8_on_c64x2x4x8_with_layout) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2223,7 +2247,7 @@ ENTRY main {
 // FFT tests with unusual parameters:
 
 // Zero-length transform.
-TEST_F(HloEvaluatorTest, 1D_FFT_0_on_c64x1x1x1x1) {
+TEST_P(HloEvaluatorTest, 1D_FFT_0_on_c64x1x1x1x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2241,7 +2265,7 @@ ENTRY main {
 }
 
 // Zero-length axis.
-TEST_F(HloEvaluatorTest, 1D_FFT_1_on_c64x1x1x1x0) {
+TEST_P(HloEvaluatorTest, 1D_FFT_1_on_c64x1x1x1x0) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2260,7 +2284,7 @@ ENTRY main {
 }
 
 // Some/all dimensions have length 1.
-TEST_F(HloEvaluatorTest, 1D_FFT_1_on_c64x1x1x1x1) {
+TEST_P(HloEvaluatorTest, 1D_FFT_1_on_c64x1x1x1x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2277,7 +2301,7 @@ ENTRY main {
 }
 
 // Zero-length transform.
-TEST_F(HloEvaluatorTest, 3D_FFT_1x0x1_on_c64x1x1x1x1) {
+TEST_P(HloEvaluatorTest, 3D_FFT_1x0x1_on_c64x1x1x1x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2295,7 +2319,7 @@ ENTRY main {
 }
 
 // Zero-length axis.
-TEST_F(HloEvaluatorTest, 3D_FFT_1x1x1_on_c64x0x1x0x1) {
+TEST_P(HloEvaluatorTest, 3D_FFT_1x1x1_on_c64x0x1x0x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2314,7 +2338,7 @@ ENTRY main {
 }
 
 // Some/all dimensions have length 1.
-TEST_F(HloEvaluatorTest, 3D_FFT_1x1x1_on_c64x1x1x1x1) {
+TEST_P(HloEvaluatorTest, 3D_FFT_1x1x1_on_c64x1x1x1x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2331,7 +2355,7 @@ ENTRY main {
 }
 
 // Some/all dimensions have length 1.
-TEST_F(HloEvaluatorTest, 3D_FFT_3x1x1_on_c64x1x3x1x1) {
+TEST_P(HloEvaluatorTest, 3D_FFT_3x1x1_on_c64x1x3x1x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2353,7 +2377,7 @@ ENTRY main {
 }
 
 // Some/all dimensions have length 1.
-TEST_F(HloEvaluatorTest, 3D_IFFT_3x1x1_on_c64x1x3x1x1) {
+TEST_P(HloEvaluatorTest, 3D_IFFT_3x1x1_on_c64x1x3x1x1) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2374,7 +2398,7 @@ ENTRY main {
 }
 
 // Odd transform length.
-TEST_F(HloEvaluatorTest, 1D_FFT_5_on_c64x5) {
+TEST_P(HloEvaluatorTest, 1D_FFT_5_on_c64x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2397,7 +2421,7 @@ ENTRY main {
 }
 
 // Odd transform length.
-TEST_F(HloEvaluatorTest, 1D_IFFT_5_on_c64x5) {
+TEST_P(HloEvaluatorTest, 1D_IFFT_5_on_c64x5) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2420,7 +2444,7 @@ ENTRY main {
 }
 
 // All input values are zero.
-TEST_F(HloEvaluatorTest, 1D_FFT_4_on_zero_c64x4) {
+TEST_P(HloEvaluatorTest, 1D_FFT_4_on_zero_c64x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2438,7 +2462,7 @@ ENTRY main {
 }
 
 // All input values are zero.
-TEST_F(HloEvaluatorTest, 3D_FFT_3x3x4_on_zero_c64x3x3x4) {
+TEST_P(HloEvaluatorTest, 3D_FFT_3x3x4_on_zero_c64x3x3x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2464,7 +2488,7 @@ ENTRY main {
 }
 
 // All input values are zero.
-TEST_F(HloEvaluatorTest, 3D_IFFT_3x3x4_on_zero_c64x3x3x4) {
+TEST_P(HloEvaluatorTest, 3D_IFFT_3x3x4_on_zero_c64x3x3x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2490,7 +2514,7 @@ ENTRY main {
 }
 
 // All input values are zero.
-TEST_F(HloEvaluatorTest, 3D_RFFT_3x3x4_on_zero_f32x3x3x4) {
+TEST_P(HloEvaluatorTest, 3D_RFFT_3x3x4_on_zero_f32x3x3x4) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2520,7 +2544,7 @@ ENTRY main {
 }
 
 // All input values are zero.
-TEST_F(HloEvaluatorTest, 3D_IRFFT_3x3x4_on_zero_c64x3x3x3) {
+TEST_P(HloEvaluatorTest, 3D_IRFFT_3x3x4_on_zero_c64x3x3x3) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2550,7 +2574,7 @@ ENTRY main {
 }
 
 // Input values, for which IRFFT discards non-zero imaginary parts.
-TEST_F(HloEvaluatorTest, 2D_IRFFT_3x4_on_c64x3x3) {
+TEST_P(HloEvaluatorTest, 2D_IRFFT_3x4_on_c64x3x3) {
   const char* hlo_text = R"(
 HloModule Fft
 
@@ -2647,6 +2671,121 @@ void BM_ReducePrecisely(::testing::benchmark::State& state) {
 
 BENCHMARK(BM_ReducePrecisely);
 
+// Evaluates a fusion of elementwise instructions, with and without the fast
+// elementwise path.
+void BM_ElementwiseFusion(::testing::benchmark::State& state) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule BM_ElementwiseFusion
+    fused_computation {
+      p0 = f32[512,512] parameter(0)
+      p1 = f32[512] parameter(1)
+      broadcast = f32[512,512] broadcast(p1), dimensions={0}
+      mul = f32[512,512] multiply(p0, broadcast)
+      exp = f32[512,512] exponential(mul)
+      transpose = f32[512,512] transpose(exp), dimensions={1,0}
+      ROOT add = f32[512,512] add(transpose, p0)
+    }
+    ENTRY main {
+      p0 = f32[512,512] parameter(0)
+      p1 = f32[512] parameter(1)
+      ROOT fusion = f32[512,512] fusion(p0, p1), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+  std::unique_ptr<HloModule> module =
+      ParseAndReturnUnverifiedModule(kHloModule).value();
+  std::vector<Literal> args = MakeFakeArguments(module.get()).value();
+  std::vector<const Literal*> arg_pointers;
+  for (const Literal& arg : args) {
+    arg_pointers.push_back(&arg);
+  }
+
+  for (auto s : state) {
+    HloEvaluator evaluator;
+    evaluator.set_use_fast_elementwise_path(state.range(0));
+    evaluator.Evaluate(*module, arg_pointers).value();
+  }
+}
+
+BENCHMARK(BM_ElementwiseFusion)->Arg(0)->Arg(1);
+
+// Evaluates a module with the slow path and with the fast path, which
+// evaluates `kHloModule` with the blocked dot and convolution kernels.
+void RunContractionBenchmark(::testing::benchmark::State& state,
+                             absl::string_view hlo_module) {
+  std::unique_ptr<HloModule> module =
+      ParseAndReturnUnverifiedModule(hlo_module).value();
+  std::vector<Literal> args = MakeFakeArguments(module.get()).value();
+  std::vector<const Literal*> arg_pointers;
+  for (const Literal& arg : args) {
+    arg_pointers.push_back(&arg);
+  }
+
+  for (auto s : state) {
+    HloEvaluator evaluator;
+    evaluator.set_use_fast_path(state.range(0));
+    evaluator.Evaluate(*module, arg_pointers).value();
+  }
+}
+
+void BM_BatchDot(::testing::benchmark::State& state) {
+  RunContractionBenchmark(state, R"(
+    HloModule BM_BatchDot
+    ENTRY main {
+      p0 = f32[8,128,128] parameter(0)
+      p1 = f32[8,128,128] parameter(1)
+      ROOT dot = f32[8,128,128] dot(p0, p1), lhs_batch_dims={0},
+        rhs_batch_dims={0}, lhs_contracting_dims={2},
+        rhs_contracting_dims={1}
+    }
+  )");
+}
+
+BENCHMARK(BM_BatchDot)->Arg(0)->Arg(1);
+
+void BM_IntegerDot(::testing::benchmark::State& state) {
+  RunContractionBenchmark(state, R"(
+    HloModule BM_IntegerDot
+    ENTRY main {
+      p0 = s8[256,256] parameter(0)
+      p1 = s8[256,256] parameter(1)
+      ROOT dot = s32[256,256] dot(p0, p1), lhs_contracting_dims={1},
+        rhs_contracting_dims={0}
+    }
+  )");
+}
+
+BENCHMARK(BM_IntegerDot)->Arg(0)->Arg(1);
+
+void BM_Convolution(::testing::benchmark::State& state) {
+  RunContractionBenchmark(state, R"(
+    HloModule BM_Convolution
+    ENTRY main {
+      p0 = f32[4,28,28,16] parameter(0)
+      p1 = f32[3,3,16,32] parameter(1)
+      ROOT conv = f32[4,28,28,32] convolution(p0, p1),
+        window={size=3x3 pad=1_1x1_1}, dim_labels=b01f_01io->b01f
+    }
+  )");
+}
+
+BENCHMARK(BM_Convolution)->Arg(0)->Arg(1);
+
+void BM_DepthwiseConvolution(::testing::benchmark::State& state) {
+  RunContractionBenchmark(state, R"(
+    HloModule BM_DepthwiseConvolution
+    ENTRY main {
+      p0 = f32[4,56,56,32] parameter(0)
+      p1 = f32[3,3,1,32] parameter(1)
+      ROOT conv = f32[4,56,56,32] convolution(p0, p1),
+        window={size=3x3 pad=1_1x1_1}, dim_labels=b01f_01io->b01f,
+        feature_group_count=32
+    }
+  )");
+}
+
+BENCHMARK(BM_DepthwiseConvolution)->Arg(0)->Arg(1);
+
 TEST_P(HloEvaluatorBf16Test, ReduceAdd) {
   HloComputation::Builder b(TestName());
 
@@ -3352,7 +3491,7 @@ TEST_P(HloEvaluatorBf16Test, EvaluateWithSubstitutionsWithConstantOperand) {
       LiteralUtil::CreateR1<float>({11, 22, 33, 44}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_TensorFlowGatherV1) {
+TEST_P(HloEvaluatorTest, EvaluateGather_TensorFlowGatherV1) {
   const char* hlo_text = R"(
 HloModule TensorFlowGatherV1
 
@@ -3376,7 +3515,7 @@ ENTRY main {
       LiteralUtil::CreateR2<int32_t>({{1, 2, 3}, {7, 8, 9}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_TensorFlowGatherV2) {
+TEST_P(HloEvaluatorTest, EvaluateGather_TensorFlowGatherV2) {
   const char* hlo_text = R"(
 HloModule TensorFlowGatherV2
 
@@ -3400,7 +3539,7 @@ ENTRY main {
       LiteralUtil::CreateR2<int32_t>({{1, 3}, {4, 6}, {7, 9}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_TensorFlowGatherMultipleBatchDims) {
+TEST_P(HloEvaluatorTest, EvaluateGather_TensorFlowGatherMultipleBatchDims) {
   const char* hlo_text = R"(
 HloModule TensorFlowGatherMultipleBatchDims
 
@@ -3426,7 +3565,7 @@ ENTRY main {
       result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_TensorFlowGatherNd) {
+TEST_P(HloEvaluatorTest, EvaluateGather_TensorFlowGatherNd) {
   const char* hlo_text = R"(
 HloModule TensorFlowGatherNd
 
@@ -3452,7 +3591,7 @@ ENTRY main {
       LiteralUtil::CreateR2<int32_t>({{-1, 1}, {-4, 4}}), result));
 }
 
-TEST_F(HloEvaluatorTest,
+TEST_P(HloEvaluatorTest,
        EvaluateGather_TensorFlowGatherNdNonDefaultIndexVectorDim) {
   const char* hlo_text = R"(
 HloModule TensorFlowGatherNd
@@ -3479,7 +3618,7 @@ ENTRY main {
       LiteralUtil::CreateR2<int32_t>({{-2, 2}, {-1, 1}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_DynamicSlice) {
+TEST_P(HloEvaluatorTest, EvaluateGather_DynamicSlice) {
   const char* hlo_text = R"(
 HloModule DynamicSlice
 
@@ -3503,7 +3642,7 @@ ENTRY main {
       LiteralTestUtil::Equal(LiteralUtil::CreateR2<int32_t>({{5}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_BatchDynamicSlice) {
+TEST_P(HloEvaluatorTest, EvaluateGather_BatchDynamicSlice) {
   const char* hlo_text = R"(
 HloModule BatchDynamicSlice
 
@@ -3527,7 +3666,7 @@ ENTRY main {
       LiteralUtil::CreateR3<int32_t>({{{8}}, {{5}}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_ZeroDimBounds) {
+TEST_P(HloEvaluatorTest, EvaluateGather_ZeroDimBounds) {
   const char* hlo_text = R"(
 HloModule TensorFlowGatherV1
 
@@ -3550,7 +3689,7 @@ ENTRY main {
       LiteralTestUtil::Equal(LiteralUtil::CreateR2<int32_t>({{}, {}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateGather_NoOutputWindowDims) {
+TEST_P(HloEvaluatorTest, EvaluateGather_NoOutputWindowDims) {
   const std::string hlo_text = R"(
 HloModule GatherXd
 
@@ -3575,7 +3714,7 @@ ENTRY main {
       LiteralUtil::CreateR2<int32_t>({{0, 1}, {2, 1}}), result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatterV1_Update) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatterV1_Update) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatterV1
 
@@ -3609,7 +3748,7 @@ ENTRY main {
       result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatterV2_Update) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatterV2_Update) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatterV2
 
@@ -3643,7 +3782,7 @@ ENTRY main {
       result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_Add) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_Add) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatter
 
@@ -3678,7 +3817,7 @@ ENTRY main {
       result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_Mul) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_Mul) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatter
 
@@ -3750,7 +3889,7 @@ ENTRY main {
       result, ErrorSpec{0.1, 0.01}));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_RepeatedIndices) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_RepeatedIndices) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatter
 
@@ -3785,7 +3924,7 @@ ENTRY main {
       result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_MultipleBatchDims) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatter_MultipleBatchDims) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatterMultipleBatchDims
 
@@ -3821,7 +3960,7 @@ ENTRY main {
                              result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_TensorFlowScatterNd) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_TensorFlowScatterNd) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatterNd
 
@@ -3858,7 +3997,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest,
+TEST_P(HloEvaluatorTest,
        EvaluateScatter_TensorFlowScatterNd_NonDefaultIndexVectorDim) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatterNdNonDefaultIndexVectorDim
@@ -3896,7 +4035,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_DynamicUpdateSlice) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_DynamicUpdateSlice) {
   const char* hlo_text = R"(
 HloModule DynamicUpdateSlice
 
@@ -3929,7 +4068,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_BatchDynamicUpdateSlice) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_BatchDynamicUpdateSlice) {
   const char* hlo_text = R"(
 HloModule BatchDynamicUpdateSlice
 
@@ -3962,7 +4101,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_ZeroDimBounds) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_ZeroDimBounds) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatter_ZeroDimBounds
 
@@ -3992,7 +4131,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(operand, result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_NoUpdateWindowDims) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_NoUpdateWindowDims) {
   const std::string hlo_text = R"(
 HloModule Scatter_NoUpdateWindowDims
 
@@ -4026,7 +4165,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_NegativeIndices) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_NegativeIndices) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatter_NegativeIndices
 
@@ -4062,7 +4201,7 @@ ENTRY main {
                          {&operand, &scatter_indices, &updates})));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_OobIndices) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_OobIndices) {
   const std::string hlo_text = R"(
 HloModule BatchDynamicUpdateSlice
 
@@ -4098,7 +4237,7 @@ ENTRY main {
                          {&operand, &scatter_indices, &updates})));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_OobUpdateWindow) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_OobUpdateWindow) {
   const char* hlo_text = R"(
 HloModule TensorFlowScatterNd_OobUpdateWindow
 
@@ -4135,7 +4274,7 @@ ENTRY main {
                                    {&operand, &scatter_indices, &updates})));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateScatter_Multioutput) {
+TEST_P(HloEvaluatorTest, EvaluateScatter_Multioutput) {
   const char* hlo_text = R"(
 HloModule MultioutputScatter
 
@@ -4188,7 +4327,7 @@ ENTRY main {
 
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise comparison with 2 bfloat16 operands.
-TEST_F(HloEvaluatorTest, DoesCompareBF16) {
+TEST_P(HloEvaluatorTest, DoesCompareBF16) {
   // lhs >= rhs
   auto lhs = LiteralUtil::CreateR2<bfloat16>(
       {{bfloat16(0.25), bfloat16(0.35), bfloat16(0.125)},
@@ -4235,7 +4374,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, MixedPrecisionReduction) {
+TEST_P(HloEvaluatorTest, MixedPrecisionReduction) {
   const std::string hlo_text = R"(
 HloModule MixedPrecisionReduction
 
@@ -4259,7 +4398,7 @@ ENTRY main {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, DontFailOnCallUnimplementedOps) {
+TEST_P(HloEvaluatorTest, DontFailOnCallUnimplementedOps) {
   // Outfeed triggers unimplemented error within HandleCall, and we verify that
   // the Evaluator does fail in such case.
   const std::string hlo_text = R"(
@@ -4280,7 +4419,7 @@ ENTRY main {
   EXPECT_FALSE(statusor.status().ok());
 }
 
-TEST_F(HloEvaluatorTest, DontFailOnFusionWithUnimplementedOps) {
+TEST_P(HloEvaluatorTest, DontFailOnFusionWithUnimplementedOps) {
   // Outfeed triggers unimplemented error within HandleFusion, and we verify
   // that the Evaluator does fail in such case.
   const std::string hlo_text = R"(
@@ -4348,7 +4487,7 @@ ENTRY main {
 }
 
 // Check that s32 under/overflow doesn't trigger a ubsan failure.
-TEST_F(HloEvaluatorTest, Int32Overflow) {
+TEST_P(HloEvaluatorTest, Int32Overflow) {
   const absl::string_view hlo_text = R"(
 HloModule Test
 
@@ -4383,7 +4522,7 @@ ENTRY main {
   EXPECT_EQ(actual[3].GetFirstElement<uint32_t>(), uint32_t{4294967295});
 }
 
-TEST_F(HloEvaluatorTest, GetDimensionSize) {
+TEST_P(HloEvaluatorTest, GetDimensionSize) {
   const absl::string_view hlo_text = R"(
 HloModule Test
 
@@ -4414,7 +4553,7 @@ ENTRY main {
 }
 
 // Check that we get a useful error if we pass inputs of the wrong shape.
-TEST_F(HloEvaluatorTest, EvaluateWithWrongInputShapes) {
+TEST_P(HloEvaluatorTest, EvaluateWithWrongInputShapes) {
   const absl::string_view hlo_text = R"(
 HloModule Test
 
@@ -4439,7 +4578,7 @@ ENTRY main {
 }
 
 // Check that we get a useful error if we pass too many or too few inputs.
-TEST_F(HloEvaluatorTest, EvaluateWithWrongNumberOfInputs) {
+TEST_P(HloEvaluatorTest, EvaluateWithWrongNumberOfInputs) {
   const absl::string_view hlo_text = R"(
 HloModule Test
 
@@ -4460,7 +4599,7 @@ ENTRY main {
             "Expected 1 argument, but got 2.");
 }
 
-TEST_F(HloEvaluatorTest, PreserveFusionInputLayout) {
+TEST_P(HloEvaluatorTest, PreserveFusionInputLayout) {
   const absl::string_view hlo_text = R"(
     HloModule FusionInputLayout
 
@@ -4482,7 +4621,7 @@ TEST_F(HloEvaluatorTest, PreserveFusionInputLayout) {
   EXPECT_TRUE(absl::c_equal(args[0].data<float>(), actual.data<float>()));
 }
 
-TEST_F(HloEvaluatorTest, PreserveFusionOutputLayout) {
+TEST_P(HloEvaluatorTest, PreserveFusionOutputLayout) {
   const absl::string_view hlo_text = R"(
     HloModule FusionOutputLayout
 
@@ -4503,7 +4642,7 @@ TEST_F(HloEvaluatorTest, PreserveFusionOutputLayout) {
   EXPECT_TRUE(absl::c_equal(args[0].data<float>(), actual.data<float>()));
 }
 
-TEST_F(HloEvaluatorTest, PreserveMOFusionOutputLayout) {
+TEST_P(HloEvaluatorTest, PreserveMOFusionOutputLayout) {
   const absl::string_view hlo_text = R"(
     HloModule MOFusionOutputLayout
 
@@ -4528,7 +4667,7 @@ TEST_F(HloEvaluatorTest, PreserveMOFusionOutputLayout) {
 }
 
 // Tests that custom_calls fail to evaluate when no handler is specified.
-TEST_F(HloEvaluatorTest, EvaluateCustomCall_NoHandler) {
+TEST_P(HloEvaluatorTest, EvaluateCustomCall_NoHandler) {
   const absl::string_view hlo_text = R"(
     HloModule EvaluateCustomCall_NoHandler
     ENTRY kernel_entry {
@@ -4545,7 +4684,7 @@ TEST_F(HloEvaluatorTest, EvaluateCustomCall_NoHandler) {
 }
 
 // Tests when a custom_call handler returns an error.
-TEST_F(HloEvaluatorTest, EvaluateCustomCall_HandlerError) {
+TEST_P(HloEvaluatorTest, EvaluateCustomCall_HandlerError) {
   const absl::string_view hlo_text = R"(
     HloModule EvaluateCustomCall_HandlerError
     ENTRY kernel_entry {
@@ -4569,7 +4708,7 @@ TEST_F(HloEvaluatorTest, EvaluateCustomCall_HandlerError) {
 // Tests the custom_call handler on calls with many inputs.
 // We sum the operands so that we can verify the operand and output literals
 // are properly mapped for access.
-TEST_F(HloEvaluatorTest, EvaluateCustomCall_ManyInputs) {
+TEST_P(HloEvaluatorTest, EvaluateCustomCall_ManyInputs) {
   const absl::string_view hlo_text = R"(
     HloModule EvaluateCustomCall_ManyInputs
     ENTRY kernel_entry {
@@ -4605,7 +4744,7 @@ TEST_F(HloEvaluatorTest, EvaluateCustomCall_ManyInputs) {
   EXPECT_TRUE(absl::c_equal(expected_data, actual_literal.data<uint32_t>()));
 }
 
-TEST_F(HloEvaluatorTest, EvaluateCustomCallInFusion) {
+TEST_P(HloEvaluatorTest, EvaluateCustomCallInFusion) {
   const absl::string_view hlo_text = R"(
 fusion1 {
   p = f32[] parameter(0)
@@ -4629,7 +4768,7 @@ ENTRY e {
   EXPECT_EQ(output, LiteralUtil::CreateR0<float>(1));
 }
 
-TEST_F(HloEvaluatorTest, IsFiniteF16) {
+TEST_P(HloEvaluatorTest, IsFiniteF16) {
   const absl::string_view hlo_text = R"(
   HloModule test
 
@@ -4646,7 +4785,7 @@ TEST_F(HloEvaluatorTest, IsFiniteF16) {
               ::testing::ElementsAre(false, true, false, true, false, false));
 }
 
-TEST_F(HloEvaluatorTest, IsFiniteBf16) {
+TEST_P(HloEvaluatorTest, IsFiniteBf16) {
   const absl::string_view hlo_text = R"(
   HloModule test
 
@@ -4665,7 +4804,7 @@ TEST_F(HloEvaluatorTest, IsFiniteBf16) {
 
 // Check that evaluating `f32[<huge>, 0] iota` doesn't oom (it's an empty
 // array!).
-TEST_F(HloEvaluatorTest, ZeroSizedIotaWithHugeDimension) {
+TEST_P(HloEvaluatorTest, ZeroSizedIotaWithHugeDimension) {
   const absl::string_view hlo_text = R"(
   HloModule test
   ENTRY t {
@@ -4678,7 +4817,7 @@ TEST_F(HloEvaluatorTest, ZeroSizedIotaWithHugeDimension) {
   EXPECT_THAT(actual_literal.data<float>(), ::testing::IsEmpty());
 }
 
-TEST_F(HloEvaluatorTest, CopyStartCopyDone) {
+TEST_P(HloEvaluatorTest, CopyStartCopyDone) {
   const absl::string_view hlo_text = R"(
   HloModule test
   ENTRY CopyStartCopyDone {
@@ -4694,7 +4833,7 @@ TEST_F(HloEvaluatorTest, CopyStartCopyDone) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, AsyncOps) {
+TEST_P(HloEvaluatorTest, AsyncOps) {
   const absl::string_view hlo_text = R"(
   HloModule test
   ENTRY AsyncOps {
@@ -4711,7 +4850,7 @@ TEST_F(HloEvaluatorTest, AsyncOps) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, MapBF16) {
+TEST_P(HloEvaluatorTest, MapBF16) {
   const absl::string_view hlo_text = R"(
   HloModule test
 
@@ -4733,7 +4872,7 @@ TEST_F(HloEvaluatorTest, MapBF16) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, MapS16) {
+TEST_P(HloEvaluatorTest, MapS16) {
   const absl::string_view hlo_text = R"(
   HloModule test
 
@@ -4755,7 +4894,7 @@ TEST_F(HloEvaluatorTest, MapS16) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, MapU16) {
+TEST_P(HloEvaluatorTest, MapU16) {
   const absl::string_view hlo_text = R"(
   HloModule test
 
@@ -4777,7 +4916,7 @@ TEST_F(HloEvaluatorTest, MapU16) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, MapMixed) {
+TEST_P(HloEvaluatorTest, MapMixed) {
   const absl::string_view hlo_text = R"(
   HloModule test
 
@@ -4801,7 +4940,7 @@ TEST_F(HloEvaluatorTest, MapMixed) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, DotUpcast) {
+TEST_P(HloEvaluatorTest, DotUpcast) {
   const absl::string_view hlo_text = R"(
   HloModule test
   ENTRY DotUpcast {
@@ -4842,7 +4981,7 @@ TEST_F(HloEvaluatorTest, DotUpcast) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, SortC64) {
+TEST_P(HloEvaluatorTest, SortC64) {
   const absl::string_view hlo_text = R"(
   HloModule m
 
@@ -4867,7 +5006,7 @@ TEST_F(HloEvaluatorTest, SortC64) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
-TEST_F(HloEvaluatorTest, ConvertC128ToC64) {
+TEST_P(HloEvaluatorTest, ConvertC128ToC64) {
   const absl::string_view hlo_text = R"(
   HloModule m
 
@@ -4886,7 +5025,7 @@ TEST_F(HloEvaluatorTest, ConvertC128ToC64) {
 
 // Tests that HloEvaluator can evaluate an instruction even when its operands
 // are not constant.
-TEST_F(HloEvaluatorTest, RecursivelyEvaluateNonConstantOperands) {
+TEST_P(HloEvaluatorTest, RecursivelyEvaluateNonConstantOperands) {
   Literal c0_literal = LiteralUtil::CreateR2<float>({{0.f, 2.f}, {2.f, 4.f}});
   Literal c1_literal = LiteralUtil::CreateR2<float>({{0.f, 5.f}, {0.f, 4.f}});
   Literal c2_literal = LiteralUtil::CreateR2<float>({{2.f, 4.f}, {4.f, 4.f}});
@@ -4915,7 +5054,7 @@ TEST_F(HloEvaluatorTest, RecursivelyEvaluateNonConstantOperands) {
 // Tests that HloEvaluator can evaluate a GetTupleElement even when its operand
 // Tuple instruction cannot be fully evaluated. Note that this requires that the
 //  tuple element at the given tuple index can be evaluated.
-TEST_F(HloEvaluatorTest, GetTupleElementOnPartiallyKnownTupleSucceeds) {
+TEST_P(HloEvaluatorTest, GetTupleElementOnPartiallyKnownTupleSucceeds) {
   Literal c0_literal = LiteralUtil::CreateR2<float>({{0.f, 2.f}, {2.f, 4.f}});
 
   Shape shape = c0_literal.shape();
@@ -4938,7 +5077,7 @@ TEST_F(HloEvaluatorTest, GetTupleElementOnPartiallyKnownTupleSucceeds) {
 }
 
 // Tests that Infeed cannot be evaluated.
-TEST_F(HloEvaluatorTest, InfeedFailure) {
+TEST_P(HloEvaluatorTest, InfeedFailure) {
   HloComputation::Builder b(TestName());
   HloInstruction* token = b.AddInstruction(HloInstruction::CreateToken());
   HloInstruction* infeed = b.AddInstruction(HloInstruction::CreateInfeed(
@@ -4950,7 +5089,7 @@ TEST_F(HloEvaluatorTest, InfeedFailure) {
 
 // Tests that GetTupleElement cannot be evaluated if the corresponding tuple
 // element cannot be evaluated.
-TEST_F(HloEvaluatorTest, GetUnknownTupleElementFails) {
+TEST_P(HloEvaluatorTest, GetUnknownTupleElementFails) {
   Literal c0_literal = LiteralUtil::CreateR2<float>({{0.f, 2.f}, {2.f, 4.f}});
 
   Shape shape = c0_literal.shape();
@@ -4972,7 +5111,7 @@ TEST_F(HloEvaluatorTest, GetUnknownTupleElementFails) {
 }
 
 // Tests that partial evaluation works for nested tuples.
-TEST_F(HloEvaluatorTest, GetTupleElementFromNestedTupleSucceeds) {
+TEST_P(HloEvaluatorTest, GetTupleElementFromNestedTupleSucceeds) {
   Literal c0_literal = LiteralUtil::CreateR2<float>({{0.f, 2.f}, {2.f, 4.f}});
 
   Shape shape = c0_literal.shape();
@@ -5000,7 +5139,7 @@ TEST_F(HloEvaluatorTest, GetTupleElementFromNestedTupleSucceeds) {
 
 // Tests that partial evaluation works when the GetTupleElement is interleaved
 // with other Tuple instructions.
-TEST_F(HloEvaluatorTest, GetTupleElementInterleavedWithTupleSucceeds) {
+TEST_P(HloEvaluatorTest, GetTupleElementInterleavedWithTupleSucceeds) {
   Literal c0_literal = LiteralUtil::CreateR2<float>({{0.f, 2.f}, {2.f, 4.f}});
 
   Shape shape = c0_literal.shape();
@@ -5032,7 +5171,7 @@ TEST_F(HloEvaluatorTest, GetTupleElementInterleavedWithTupleSucceeds) {
   TestRecursivelyEvaluateInstruction(gte2, expected);
 }
 
-TEST_F(HloEvaluatorTest, SlowReduceWindow) {
+TEST_P(HloEvaluatorTest, SlowReduceWindow) {
 #ifdef THREAD_SANITIZER
   GTEST_SKIP();
 #endif
@@ -5064,6 +5203,394 @@ TEST_F(HloEvaluatorTest, SlowReduceWindow) {
               ::testing::ElementsAreArray(expected));
 }
 
+// Evaluates modules with a default evaluator and with one that has a fast path
+// enabled, and compares the results.
+class HloEvaluatorFastPathTest : public HloTestBase {
+ protected:
+  // `enable_fast_path` enables the fast path under test. Results have to be
+  // identical, or within `error` for floating point results if it is set.
+  explicit HloEvaluatorFastPathTest(
+      std::function<void(HloEvaluator&)> enable_fast_path,
+      std::optional<ErrorSpec> error = std::nullopt)
+      : enable_fast_path_(std::move(enable_fast_path)), error_(error) {}
+
+  void ExpectSameResults(absl::string_view hlo_text,
+                         std::vector<Literal> args = {}) {
+    ExpectSameResults(hlo_text, error_, std::move(args));
+  }
+
+  void ExpectSameResults(absl::string_view hlo_text,
+                         std::optional<ErrorSpec> error,
+                         std::vector<Literal> args = {}) {
+    TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> module,
+                            ParseAndReturnVerifiedModule(hlo_text));
+    if (args.empty()) {
+      TF_ASSERT_OK_AND_ASSIGN(args, MakeFakeArguments(module.get()));
+    }
+    std::vector<const Literal*> arg_pointers;
+    for (const Literal& arg : args) {
+      arg_pointers.push_back(&arg);
+    }
+
+    HloEvaluator evaluator;
+    TF_ASSERT_OK_AND_ASSIGN(Literal expected,
+                            evaluator.Evaluate(*module, arg_pointers));
+    HloEvaluator fast_evaluator;
+    enable_fast_path_(fast_evaluator);
+    TF_ASSERT_OK_AND_ASSIGN(Literal actual,
+                            fast_evaluator.Evaluate(*module, arg_pointers));
+    // LiteralTestUtil::Equal does not compare layouts.
+    EXPECT_EQ(expected.shape(), actual.shape());
+    if (error.has_value() &&
+        !primitive_util::IsIntegralType(expected.shape().element_type())) {
+      EXPECT_TRUE(LiteralTestUtil::Near(expected, actual, *error));
+    } else {
+      EXPECT_TRUE(LiteralTestUtil::Equal(expected, actual));
+    }
+  }
+
+ private:
+  std::function<void(HloEvaluator&)> enable_fast_path_;
+  std::optional<ErrorSpec> error_;
+};
+
+// The fast elementwise path has to produce bitwise identical results.
+class HloEvaluatorFastElementwiseTest : public HloEvaluatorFastPathTest {
+ protected:
+  HloEvaluatorFastElementwiseTest()
+      : HloEvaluatorFastPathTest([](HloEvaluator& evaluator) {
+          evaluator.set_use_fast_elementwise_path(true);
+        }) {}
+};
+
+TEST_F(HloEvaluatorFastElementwiseTest, BroadcastTransposeChain) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule BroadcastTransposeChain
+    fused_computation {
+      p0 = f32[16,48] parameter(0)
+      p1 = f32[16] parameter(1)
+      half = f32[] constant(0.5)
+      halves = f32[16,48] broadcast(half), dimensions={}
+      row = f32[16,48] broadcast(p1), dimensions={0}
+      scaled = f32[16,48] multiply(p0, halves)
+      exp = f32[16,48] exponential(scaled)
+      max = f32[16,48] maximum(exp, row)
+      transpose = f32[48,16] transpose(max), dimensions={1,0}
+      reshape = f32[6,8,16] reshape(transpose)
+      tanh = f32[6,8,16] tanh(reshape)
+      lt = pred[6,8,16] compare(tanh, reshape), direction=LT
+      ROOT select = f32[6,8,16] select(lt, tanh, reshape)
+    }
+    ENTRY main {
+      p0 = f32[16,48] parameter(0)
+      p1 = f32[16] parameter(1)
+      ROOT fusion = f32[6,8,16] fusion(p0, p1), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, NarrowFloatsAndConvert) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule NarrowFloatsAndConvert
+    fused_computation {
+      p0 = bf16[64] parameter(0)
+      p1 = f16[64] parameter(1)
+      rsqrt = bf16[64] rsqrt(p0)
+      logistic = bf16[64] logistic(rsqrt)
+      converted = f16[64] convert(logistic)
+      add = f16[64] add(converted, p1)
+      floor = f16[64] floor(add)
+      ROOT f32 = f32[64] convert(floor)
+    }
+    ENTRY main {
+      p0 = bf16[64] parameter(0)
+      p1 = f16[64] parameter(1)
+      ROOT fusion = f32[64] fusion(p0, p1), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, IntegerSemantics) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule IntegerSemantics
+    fused_computation {
+      p0 = s32[6] parameter(0)
+      p1 = s32[6] parameter(1)
+      div = s32[6] divide(p0, p1)
+      negate = s32[6] negate(div)
+      abs = s32[6] abs(p0)
+      xor = s32[6] xor(negate, abs)
+      not = s32[6] not(xor)
+      mul = s32[6] multiply(not, p0)
+      narrow = u8[6] convert(mul)
+      sum = u8[6] add(narrow, narrow)
+      ROOT widened = s64[6] convert(sum)
+    }
+    ENTRY main {
+      p0 = s32[6] parameter(0)
+      p1 = s32[6] parameter(1)
+      ROOT fusion = s64[6] fusion(p0, p1), kind=kLoop, calls=fused_computation
+    }
+  )";
+  std::vector<Literal> args;
+  args.push_back(LiteralUtil::CreateR1<int32_t>(
+      {std::numeric_limits<int32_t>::min(), 7, -7, 200, 5, 0}));
+  args.push_back(LiteralUtil::CreateR1<int32_t>({-1, 0, 2, -3, 0, 4}));
+  ExpectSameResults(kHloModule, std::move(args));
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, SaturatingConvert) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule SaturatingConvert
+    fused_computation {
+      p0 = f32[6] parameter(0)
+      s8 = s8[6] convert(p0)
+      u16 = u16[6] convert(p0)
+      pred = pred[6] convert(p0)
+      wide = u16[6] convert(s8)
+      or = u16[6] or(u16, wide)
+      ROOT select = u16[6] select(pred, or, u16)
+    }
+    ENTRY main {
+      p0 = f32[6] parameter(0)
+      ROOT fusion = u16[6] fusion(p0), kind=kLoop, calls=fused_computation
+    }
+  )";
+  std::vector<Literal> args;
+  args.push_back(LiteralUtil::CreateR1<float>(
+      {std::numeric_limits<float>::quiet_NaN(),
+       std::numeric_limits<float>::infinity(), -1e10f, 300.5f, -2.5f, 0.f}));
+  ExpectSameResults(kHloModule, std::move(args));
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, NonDefaultLayouts) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule NonDefaultLayouts
+    fused_computation {
+      p0 = f32[8,12]{0,1} parameter(0)
+      p1 = f32[12,8]{1,0} parameter(1)
+      transpose = f32[8,12]{0,1} transpose(p1), dimensions={1,0}
+      ROOT sub = f32[8,12]{0,1} subtract(p0, transpose)
+    }
+    ENTRY main {
+      p0 = f32[8,12]{0,1} parameter(0)
+      p1 = f32[12,8]{1,0} parameter(1)
+      ROOT fusion = f32[8,12]{0,1} fusion(p0, p1), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, NonDefaultLayoutIntoBitcast) {
+  // The bitcast reinterprets the physical layout of `add`, so the fast path
+  // must produce it in the layout of the instruction.
+  constexpr absl::string_view kHloModule = R"(
+    HloModule NonDefaultLayoutIntoBitcast
+    ENTRY main {
+      p0 = f32[4,8]{0,1} parameter(0)
+      p1 = f32[4,8]{0,1} parameter(1)
+      add = f32[4,8]{0,1} add(p0, p1)
+      ROOT bitcast = f32[8,4]{1,0} bitcast(add)
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, SharedOperands) {
+  // `sqrt` is used twice and `p0` four times, both in their own index space
+  // and through a transpose.
+  constexpr absl::string_view kHloModule = R"(
+    HloModule SharedOperands
+    fused_computation {
+      p0 = f64[32,32] parameter(0)
+      abs = f64[32,32] abs(p0)
+      sqrt = f64[32,32] sqrt(abs)
+      transpose = f64[32,32] transpose(p0), dimensions={1,0}
+      mul = f64[32,32] multiply(sqrt, transpose)
+      div = f64[32,32] divide(mul, sqrt)
+      ROOT min = f64[32,32] minimum(div, p0)
+    }
+    ENTRY main {
+      p0 = f64[32,32] parameter(0)
+      ROOT fusion = f64[32,32] fusion(p0), kind=kLoop, calls=fused_computation
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, UnfusedInstructions) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule UnfusedInstructions
+    ENTRY main {
+      p0 = f32[100000] parameter(0)
+      p1 = f32[100000] parameter(1)
+      log = f32[100000] log(p0)
+      add = f32[100000] add(log, p1)
+      ROOT ceil = f32[100000] ceil(add)
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, LargeFusion) {
+  // Large enough to be evaluated in parallel.
+  constexpr absl::string_view kHloModule = R"(
+    HloModule LargeFusion
+    fused_computation {
+      p0 = f32[300,257] parameter(0)
+      p1 = f32[257] parameter(1)
+      broadcast = f32[300,257] broadcast(p1), dimensions={1}
+      ROOT add = f32[300,257] add(p0, broadcast)
+    }
+    ENTRY main {
+      p0 = f32[300,257] parameter(0)
+      p1 = f32[257] parameter(1)
+      ROOT fusion = f32[300,257] fusion(p0, p1), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorFastElementwiseTest, UnsupportedFusionFallsBack) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule UnsupportedFusionFallsBack
+    add {
+      lhs = f32[] parameter(0)
+      rhs = f32[] parameter(1)
+      ROOT add = f32[] add(lhs, rhs)
+    }
+    fused_computation {
+      p0 = f32[8,16] parameter(0)
+      zero = f32[] constant(0)
+      reduce = f32[8] reduce(p0, zero), dimensions={1}, to_apply=add
+      exp = f32[8] exponential(reduce)
+      ROOT broadcast = f32[8,16] broadcast(exp), dimensions={0}
+    }
+    ENTRY main {
+      p0 = f32[8,16] parameter(0)
+      ROOT fusion = f32[8,16] fusion(p0), kind=kInput, calls=fused_computation
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+// The fast path evaluates dots and convolutions with the blocked kernels
+// unless they are rank-2 F32 dots. The kernels accumulate in the same order as
+// the slow path, so results only differ where the compiler fuses a
+// multiply-add.
+class HloEvaluatorBlockedContractionTest : public HloEvaluatorFastPathTest {
+ protected:
+  HloEvaluatorBlockedContractionTest()
+      : HloEvaluatorFastPathTest(
+            [](HloEvaluator& evaluator) { evaluator.set_use_fast_path(true); },
+            ErrorSpec{1e-5, 1e-5}) {}
+};
+
+TEST_F(HloEvaluatorBlockedContractionTest, BatchDotWithContractingDims) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule BatchDotWithContractingDims
+    ENTRY main {
+      p0 = f32[2,3,4,5] parameter(0)
+      p1 = f32[5,2,4,6] parameter(1)
+      ROOT dot = f32[2,3,6] dot(p0, p1), lhs_batch_dims={0},
+        rhs_batch_dims={1}, lhs_contracting_dims={3,2},
+        rhs_contracting_dims={0,2}
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorBlockedContractionTest, WideningIntegerDot) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule WideningIntegerDot
+    ENTRY main {
+      p0 = s8[17,33] parameter(0)
+      p1 = s8[33,9] parameter(1)
+      ROOT dot = s16[17,9] dot(p0, p1), lhs_contracting_dims={1},
+        rhs_contracting_dims={0}
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorBlockedContractionTest, LargeDotWithLayouts) {
+  // Large enough to be evaluated in parallel.
+  constexpr absl::string_view kHloModule = R"(
+    HloModule LargeDotWithLayouts
+    ENTRY main {
+      p0 = f32[2,130,150]{0,1,2} parameter(0)
+      p1 = f64[2,150,300]{1,2,0} parameter(1)
+      c0 = f64[2,130,150]{0,1,2} convert(p0)
+      ROOT dot = f64[2,130,300]{1,0,2} dot(c0, p1), lhs_batch_dims={0},
+        rhs_batch_dims={0}, lhs_contracting_dims={2},
+        rhs_contracting_dims={1}
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorBlockedContractionTest, ConvolutionWindowAttributes) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule ConvolutionWindowAttributes
+    ENTRY main {
+      p0 = f32[2,9,9,3] parameter(0)
+      p1 = f32[3,3,3,4] parameter(1)
+      ROOT conv = f32[2,9,6,4] convolution(p0, p1),
+        window={size=3x3 stride=2x1 pad=1_2x0_1 lhs_dilate=2x1 rhs_dilate=1x2
+                rhs_reversal=1x0},
+        dim_labels=b01f_01io->b01f
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorBlockedContractionTest, FeatureGroupConvolution) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule FeatureGroupConvolution
+    ENTRY main {
+      p0 = s32[2,4,7,7] parameter(0)
+      p1 = s32[6,2,3,3] parameter(1)
+      ROOT conv = s32[2,6,7,7] convolution(p0, p1),
+        window={size=3x3 pad=1_1x1_1}, dim_labels=bf01_oi01->bf01,
+        feature_group_count=2
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorBlockedContractionTest, BatchGroupConvolution) {
+  constexpr absl::string_view kHloModule = R"(
+    HloModule BatchGroupConvolution
+    ENTRY main {
+      p0 = s8[4,7,7,3] parameter(0)
+      p1 = s8[3,3,3,4] parameter(1)
+      ROOT conv = s8[2,5,5,4] convolution(p0, p1), window={size=3x3},
+        dim_labels=b01f_01io->b01f, batch_group_count=2
+    }
+  )";
+  ExpectSameResults(kHloModule);
+}
+
+TEST_F(HloEvaluatorBlockedContractionTest, LargeConvolution) {
+  // Large enough to be evaluated in parallel.
+  constexpr absl::string_view kHloModule = R"(
+    HloModule LargeConvolution
+    ENTRY main {
+      p0 = bf16[2,24,24,8] parameter(0)
+      p1 = bf16[3,3,8,16] parameter(1)
+      ROOT conv = bf16[2,24,24,16] convolution(p0, p1),
+        window={size=3x3 pad=1_1x1_1}, dim_labels=b01f_01io->b01f
+    }
+  )";
+  ExpectSameResults(kHloModule, ErrorSpec{1e-2, 1e-2});
+}
+
 class PatternMatchParseWhileLoopTest : public HloTestBase {};
 
 TEST_F(PatternMatchParseWhileLoopTest, LoopBoundDefinedInsideOfCond) {
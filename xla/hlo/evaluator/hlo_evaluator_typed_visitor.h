@@ -37,6 +37,7 @@ limitations under the License.
 #include "absl/types/span.h"
 #include "xla/array2d.h"
 #include "xla/hlo/evaluator/hlo_evaluator.h"
+#include "xla/hlo/evaluator/hlo_evaluator_contraction.h"
 #include "xla/hlo/ir/hlo_casting_utils.h"
 #include "xla/hlo/ir/hlo_instructions.h"
 #include "xla/literal.h"
@@ -787,6 +788,12 @@ class HloEvaluatorTypedVisitor : public ConstDfsHloVisitorWithDefault {
     CHECK_GE(num_spatial_dims, 0);
     CHECK_EQ(window.dimensions_size(), num_spatial_dims);
 
+    if constexpr (!std::is_same_v<ElementwiseT, bool>) {
+      if (parent_->use_fast_path_ && !is_packed_nibble) {
+        return HandleConvolutionBlocked(conv, lhs_literal, rhs_literal);
+      }
+    }
+
     std::vector<int64_t> window_dimension_sizes;
     for (auto i : dnums.kernel_spatial_dimensions()) {
       window_dimension_sizes.push_back(ShapeUtil::GetDimension(rhs_shape, i));
@@ -961,6 +968,45 @@ class HloEvaluatorTypedVisitor : public ConstDfsHloVisitorWithDefault {
     return OkStatus();
   }
 
+  // Evaluates `conv` with BlockedConvolution. The results are the ones of the
+  // slow path, which visits the window positions and input features of every
+  // output element in the same order. A template, so that it is not
+  // instantiated for PRED.
+  template <typename T = ElementwiseT>
+  Status HandleConvolutionBlocked(const HloInstruction* conv,
+                                  const Literal& lhs_literal,
+                                  const Literal& rhs_literal) {
+    const auto& dnums = conv->convolution_dimension_numbers();
+    DimensionVector lhs_dims = {dnums.input_batch_dimension()};
+    DimensionVector rhs_dims;
+    DimensionVector result_dims = {dnums.output_batch_dimension()};
+    for (int64_t i = 0; i < dnums.input_spatial_dimensions_size(); ++i) {
+      lhs_dims.push_back(dnums.input_spatial_dimensions(i));
+      rhs_dims.push_back(dnums.kernel_spatial_dimensions(i));
+      result_dims.push_back(dnums.output_spatial_dimensions(i));
+    }
+    lhs_dims.push_back(dnums.input_feature_dimension());
+    rhs_dims.push_back(dnums.kernel_input_feature_dimension());
+    rhs_dims.push_back(dnums.kernel_output_feature_dimension());
+    result_dims.push_back(dnums.output_feature_dimension());
+
+    std::vector<T> lhs = TransposeToArray<ReturnT, T>(lhs_literal, lhs_dims);
+    std::vector<T> rhs = TransposeToArray<ReturnT, T>(rhs_literal, rhs_dims);
+    std::vector<T> result(ShapeUtil::ElementsIn(conv->shape()));
+    BlockedConvolution(conv, lhs.data(), rhs.data(), result.data());
+
+    if constexpr (std::is_integral_v<ReturnT>) {
+      auto l = static_cast<T>(std::numeric_limits<ReturnT>::min());
+      auto h = static_cast<T>(std::numeric_limits<ReturnT>::max());
+      for (T& value : result) {
+        value = std::max(l, std::min(h, value));
+      }
+    }
+    parent_->evaluated_[conv] = TransposeFromArray<ReturnT, T>(
+        absl::MakeConstSpan(result), conv->shape(), result_dims);
+    return OkStatus();
+  }
+
   Status HandleConvolution(const HloInstruction* conv) override {
     auto lhs = conv->operand(0);
     auto rhs = conv->operand(1);
@@ -1027,6 +1073,9 @@ class HloEvaluatorTypedVisitor : public ConstDfsHloVisitorWithDefault {
         ShapeUtil::SameElementType(dot->operand(1)->shape(), dot->shape())) {
       return HandleDot<ElementwiseT>(dot);
     }
+    if (parent_->use_fast_path_) {
+      return HandleDotBlocked(dot);
+    }
     return HandleDotSlowPath(dot);
   }
 
@@ -1069,7 +1118,7 @@ class HloEvaluatorTypedVisitor : public ConstDfsHloVisitorWithDefault {
                            LayoutUtil::GetDefaultLayoutForR2()) ||
         !LayoutUtil::Equal(dot->shape().layout(),
                            LayoutUtil::GetDefaultLayoutForR2())) {
-      return HandleDotSlowPath(dot);
+      return HandleDotBlocked(dot);
     }
 
     const PrimitiveType native_ty =
@@ -1098,7 +1147,92 @@ class HloEvaluatorTypedVisitor : public ConstDfsHloVisitorWithDefault {
   template <typename NativeT, typename std::enable_if_t<
                                   !std::is_same_v<NativeT, float>>* = nullptr>
   Status HandleDot(const HloInstruction* dot) {
-    return HandleDotSlowPath(dot);
+    return HandleDotBlocked(dot);
+  }
+
+  // Evaluates `dot` with BlockedBatchMatmul, after transposing the operands to
+  // [batch, lhs non-contracting, contracting] and [batch, contracting, rhs
+  // non-contracting] arrays. The results are the ones of the slow path, which
+  // accumulates the products of every output element in the same order.
+  Status HandleDotBlocked(const HloInstruction* dot) {
+    const bool is_packed_nibble =
+        absl::c_count(dot->precision_config().operand_precision(),
+                      PrecisionConfig::PACKED_NIBBLE) > 0;
+    if (std::is_same_v<ElementwiseT, bool> || is_packed_nibble) {
+      return HandleDotSlowPath(dot);
+    }
+    if constexpr (!std::is_same_v<ElementwiseT, bool>) {
+      const HloInstruction* lhs = dot->operand(0);
+      const HloInstruction* rhs = dot->operand(1);
+      CHECK(dot->shape().IsArray());
+      CHECK(lhs->shape().IsArray());
+      CHECK(rhs->shape().IsArray());
+      const auto& dnums = dot->dot_dimension_numbers();
+      CHECK_EQ(dnums.lhs_batch_dimensions_size(),
+               dnums.rhs_batch_dimensions_size());
+
+      // Like the slow path, multiply the operands converted to the result
+      // type.
+      const PrimitiveType result_type = dot->shape().element_type();
+      const Literal* lhs_literal = &parent_->GetEvaluatedLiteralFor(lhs);
+      const Literal* rhs_literal = &parent_->GetEvaluatedLiteralFor(rhs);
+      std::optional<Literal> converted_lhs;
+      std::optional<Literal> converted_rhs;
+      if (lhs->shape().element_type() != result_type) {
+        TF_ASSIGN_OR_RETURN(converted_lhs, lhs_literal->Convert(result_type));
+        lhs_literal = &*converted_lhs;
+      }
+      if (rhs->shape().element_type() != result_type) {
+        TF_ASSIGN_OR_RETURN(converted_rhs, rhs_literal->Convert(result_type));
+        rhs_literal = &*converted_rhs;
+      }
+
+      int64_t batch = 1;
+      DimensionVector lhs_dims;
+      DimensionVector rhs_dims;
+      for (int64_t i = 0; i < dnums.lhs_batch_dimensions_size(); ++i) {
+        lhs_dims.push_back(dnums.lhs_batch_dimensions(i));
+        rhs_dims.push_back(dnums.rhs_batch_dimensions(i));
+        batch *= lhs->shape().dimensions(dnums.lhs_batch_dimensions(i));
+      }
+      int64_t m = 1;
+      for (int64_t i = 0; i < lhs->shape().rank(); ++i) {
+        if (!absl::c_linear_search(dnums.lhs_contracting_dimensions(), i) &&
+            !absl::c_linear_search(dnums.lhs_batch_dimensions(), i)) {
+          lhs_dims.push_back(i);
+          m *= lhs->shape().dimensions(i);
+        }
+      }
+      int64_t k = 1;
+      for (int64_t i = 0; i < dnums.lhs_contracting_dimensions_size(); ++i) {
+        lhs_dims.push_back(dnums.lhs_contracting_dimensions(i));
+        rhs_dims.push_back(dnums.rhs_contracting_dimensions(i));
+        k *= lhs->shape().dimensions(dnums.lhs_contracting_dimensions(i));
+      }
+      int64_t n = 1;
+      for (int64_t i = 0; i < rhs->shape().rank(); ++i) {
+        if (!absl::c_linear_search(dnums.rhs_contracting_dimensions(), i) &&
+            !absl::c_linear_search(dnums.rhs_batch_dimensions(), i)) {
+          rhs_dims.push_back(i);
+          n *= rhs->shape().dimensions(i);
+        }
+      }
+
+      std::vector<ElementwiseT> lhs_array =
+          TransposeToArray<ReturnT, ElementwiseT>(*lhs_literal, lhs_dims);
+      std::vector<ElementwiseT> rhs_array =
+          TransposeToArray<ReturnT, ElementwiseT>(*rhs_literal, rhs_dims);
+      std::vector<ElementwiseT> result(batch * m * n);
+      BlockedBatchMatmul(batch, m, n, k, lhs_array.data(), rhs_array.data(),
+                         result.data());
+      // The dimensions of the result are batch, lhs non-contracting and rhs
+      // non-contracting, which is the order of the array.
+      DimensionVector result_dims(dot->shape().rank());
+      absl::c_iota(result_dims, 0);
+      parent_->evaluated_[dot] = TransposeFromArray<ReturnT, ElementwiseT>(
+          result, dot->shape(), result_dims);
+    }
+    return OkStatus();
   }
 
   Status HandleDotSlowPathWithLiterals(const HloInstruction* dot,
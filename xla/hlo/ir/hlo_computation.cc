@@ -16,9 +16,11 @@ limitations under the License.
 #include "xla/hlo/ir/hlo_computation.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <ostream>
@@ -131,6 +133,16 @@ std::unique_ptr<HloComputation> HloComputation::Builder::Build(
       new HloComputation(name_, parameter_count, &instructions_, root));
 }
 
+namespace {
+
+// Returns a mutation generation that no computation had before.
+int64_t NextMutationGeneration() {
+  static std::atomic<int64_t> last_generation = 0;
+  return last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace
+
 HloComputation::HloComputation(
     const std::string& name, int parameter_count,
     std::vector<std::unique_ptr<HloInstruction>>* instructions,
@@ -158,6 +170,7 @@ HloComputation::HloComputation(
   CHECK(root_found)
       << "\nERROR: root instruction is not present in computation.";
   root_instruction_->MarkAsRoot();
+  MarkMutated();
 }
 
 HloComputation::~HloComputation() {
@@ -230,11 +243,18 @@ HloInstruction* HloComputation::AddInstruction(
 
 HloInstruction* HloComputation::AddInstructionInternal(
     std::unique_ptr<HloInstruction> instruction) {
-  if (parent() != nullptr) {
-    instruction->UniquifyName(&parent()->instruction_name_uniquer());
-    instruction->SetUniqueId(parent()->NewUniqueInstructionId());
+  if (deferred_id_stride_ != 0) {
+    CHECK_GE(next_deferred_id_,
+             std::numeric_limits<int>::min() + deferred_id_stride_)
+        << "Out of temporary instruction ids in computation " << name();
+    instruction->SetTemporaryUniqueIdInternal(next_deferred_id_);
+    next_deferred_id_ -= deferred_id_stride_;
+    ++deferred_instruction_count_;
+  } else if (parent() != nullptr) {
+    parent()->AssignUniqueIdentifiers(instruction.get());
   }
   instruction->set_parent(this);
+  MarkMutated();
   HloInstruction* pinst = instruction.release();  // Take ownership
   HloInstructionInfo info;
   info.opcode_ = pinst->opcode();
@@ -497,6 +517,7 @@ Status HloComputation::RemoveInstructionImpl(HloInstruction* instruction,
       << "instruction " << instruction->name()
       << " has control successors and cannot be removed";
 
+  MarkMutated();
   HloInstructionInfo* info = &instructions_[instruction->index_in_parent_];
   DCHECK_EQ(info->inst(), instruction);
   info->inst()->set_parent(nullptr);
@@ -589,6 +610,39 @@ void HloComputation::set_root_instruction(HloInstruction* new_root_instruction,
   root_instruction_->MarkAsNonRoot();
   new_root_instruction->MarkAsRoot();
   root_instruction_ = new_root_instruction;
+  MarkMutated();
+}
+
+int64_t HloComputation::mutation_generation() const {
+  if (mutated_.exchange(false, std::memory_order_relaxed)) {
+    mutation_generation_.store(NextMutationGeneration(),
+                               std::memory_order_relaxed);
+  }
+  return mutation_generation_.load(std::memory_order_relaxed);
+}
+
+void HloComputation::DeferUniqueIdentifiersInternal(int first_id, int stride) {
+  CHECK_LT(first_id, -1);
+  CHECK_GT(stride, 0);
+  next_deferred_id_ = first_id;
+  deferred_id_stride_ = stride;
+  deferred_instruction_count_ = 0;
+}
+
+std::vector<HloInstruction*>
+HloComputation::StopDeferringUniqueIdentifiersInternal() {
+  std::vector<HloInstruction*> deferred;
+  if (deferred_instruction_count_ > 0) {
+    for (HloInstruction* instruction : instructions()) {
+      if (instruction->unique_id() < -1) {
+        deferred.push_back(instruction);
+      }
+    }
+  }
+  next_deferred_id_ = 0;
+  deferred_id_stride_ = 0;
+  deferred_instruction_count_ = 0;
+  return deferred;
 }
 
 void HloComputation::ComputeInstructionPostOrder(
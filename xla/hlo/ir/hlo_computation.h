@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef XLA_HLO_IR_HLO_COMPUTATION_H_
 #define XLA_HLO_IR_HLO_COMPUTATION_H_
 
+#include <atomic>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -835,6 +836,39 @@ class HloComputation {
 
   int64_t unique_id() const { return unique_id_; }
 
+  // Returns the mutation generation of this computation. It is a value that no
+  // computation had before when the computation is created, and changes to a
+  // new such value after an instruction is added to or removed from it, its
+  // root changes, or one of its instructions has its operands, users, control
+  // dependencies, called computations, opcode, shape, dimensions, tuple index,
+  // sharding, backend config, literal, slice bounds, padding config, precision
+  // config, dot dimension numbers or outfeed shape changed. Passes use it to
+  // tell whether a computation was mutated since they last ran on it (see
+  // HloComputationPass). Other changes to the attributes of instructions, such
+  // as names and metadata, are not tracked.
+  //
+  // The mutable_* accessors of instructions mark the computation as mutated
+  // when they are called, so an edit through a pointer that was returned
+  // before the generation was last read is not tracked.
+  //
+  // Must not be called concurrently with mutations of the computation.
+  int64_t mutation_generation() const;
+
+  // Makes the next call to mutation_generation() return a new generation.
+  // Cheap enough to call on every mutation: the new generation is only taken
+  // from the global counter when it is asked for.
+  void MarkMutated() { mutated_.store(true, std::memory_order_relaxed); }
+
+  // While the unique identifiers of this computation are deferred (see
+  // HloModule::DeferUniqueIdentifiers), the instructions added to it get the
+  // temporary ids `first_id`, `first_id - stride`, `first_id - 2 * stride`...
+  void DeferUniqueIdentifiersInternal(int first_id, int stride);
+
+  // Stops deferring the unique identifiers of this computation. Returns the
+  // instructions which were added to it meanwhile and were not removed, in the
+  // order in which they were added.
+  std::vector<HloInstruction*> StopDeferringUniqueIdentifiersInternal();
+
   void SetExecutionThread(absl::string_view execution_thread) {
     execution_thread_ = std::string(execution_thread);
   }
@@ -947,9 +981,21 @@ class HloComputation {
   int64_t unique_id_;
   HloInstruction* root_instruction_;
 
+  // See mutation_generation(). `mutated_` is set if the computation was
+  // mutated after `mutation_generation_` was taken.
+  mutable std::atomic<int64_t> mutation_generation_ = 0;
+  mutable std::atomic<bool> mutated_ = true;
+
   // Module containing this computation.
   HloModule* parent_ = nullptr;
 
+  // The next temporary id and the distance between temporary ids while the
+  // unique identifiers of this computation are deferred. The stride is 0 when
+  // they are not deferred.
+  int next_deferred_id_ = 0;
+  int deferred_id_stride_ = 0;
+  int64_t deferred_instruction_count_ = 0;
+
   // Contains HloInstruction* and its type.
   // The respective type in the least significant three bits.
   uintptr_t instruction_and_type_ = 0;
@@ -219,6 +219,13 @@ void HloInstruction::AppendComputation(HloComputation* computation) {
   // In .cc file since PtrVec<T*>::push_back() wants to check the alignment
   // of T and hlo_instruction.h does not include hlo_computation.h.
   mutable_rare()->called_computations.push_back(computation);
+  MarkParentMutated();
+}
+
+void HloInstruction::MarkParentMutated() {
+  if (parent_ != nullptr) {
+    parent_->MarkMutated();
+  }
 }
 
 HloInstruction* HloInstruction::AddInstruction(
@@ -2714,6 +2721,7 @@ Status HloInstruction::AddControlDependencyTo(HloInstruction* instruction) {
     TF_RET_CHECK(!absl::c_linear_search(
         instruction->rare()->control_predecessors, this));
     instruction->mutable_rare()->control_predecessors.push_back(this);
+    MarkParentMutated();
   }
   return OkStatus();
 }
@@ -2728,6 +2736,7 @@ Status HloInstruction::RemoveControlDependencyTo(HloInstruction* instruction) {
     TF_RETURN_IF_ERROR(EraseElementFromVector(
         &instruction->mutable_rare()->control_predecessors, this));
   }
+  MarkParentMutated();
   return OkStatus();
 }
 
@@ -2744,6 +2753,7 @@ Status HloInstruction::DropAllControlDeps() {
     Rare* r = mutable_rare();
     r->control_successors.clear();
     r->control_predecessors.clear();
+    MarkParentMutated();
   }
   return OkStatus();
 }
@@ -2849,6 +2859,7 @@ void HloInstruction::AppendOperand(HloInstruction* operand) {
   }
   operands_.push_back(operand);
   operand->AddUser(this);
+  MarkParentMutated();
 }
 
 void HloInstruction::RemoveOperandsAtAscendingIndices(
@@ -2873,6 +2884,7 @@ void HloInstruction::RemoveOperandsAtAscendingIndices(
   }
   CHECK_EQ(removed_count, ascending_indices.size());
   operands_.resize(operands_.size() - removed_count);
+  MarkParentMutated();
 }
 
 bool HloInstruction::HasConstantOperand() const {
@@ -3059,6 +3071,7 @@ Status HloInstruction::ReplaceUseWithDifferentShape(
   std::replace(user->operands_.begin(), user->operands_.end(), this,
                new_producer);
   new_producer->AddUser(user);
+  user->MarkParentMutated();
   // Custom fusions may not be able to handle deduplicated operands.
   if (user->opcode() == HloOpcode::kFusion) {
     TF_RETURN_IF_ERROR(
@@ -3091,6 +3104,7 @@ Status HloInstruction::ReplaceUseWithDifferentShape(
       << " to be equal to " << ToString();
   user->operands_[operand_number] = new_producer;
   new_producer->AddUser(user);
+  user->MarkParentMutated();
   return OkStatus();
 }
 
@@ -3122,6 +3136,7 @@ Status HloInstruction::ReplaceOperandWithDifferentShape(
     old_operand->RemoveUser(this);
   }
   new_operand->AddUser(this);
+  MarkParentMutated();
   return OkStatus();
 }
 
@@ -3226,6 +3241,7 @@ Status HloInstruction::ReplaceAllUsesWithDifferentShape(
       std::replace(user->operands_.begin(), user->operands_.end(), this,
                    new_producer);
       new_producer->AddUser(user);
+      user->MarkParentMutated();
       if (user->opcode() == HloOpcode::kFusion) {
         TF_RETURN_IF_ERROR(
             Cast<HloFusionInstruction>(user)->DeduplicateFusionOperands());
@@ -3265,6 +3281,7 @@ void HloInstruction::set_to_apply(HloComputation* computation) {
     CHECK_EQ(called_computations().size(), 1)
         << "Expected a to_apply computation for " << opcode();
     rare_->called_computations[0] = computation;
+    MarkParentMutated();
     return;
   }
   LOG(FATAL) << "Invalid opcode for to_apply(): " << opcode();
@@ -3304,11 +3321,13 @@ HloComputation* HloInstruction::while_body() const {
 void HloInstruction::set_while_condition(HloComputation* computation) {
   CHECK_EQ(HloOpcode::kWhile, opcode_);
   rare_->called_computations[kConditionComputationIndex] = computation;
+  MarkParentMutated();
 }
 
 void HloInstruction::set_while_body(HloComputation* computation) {
   CHECK_EQ(HloOpcode::kWhile, opcode_);
   rare_->called_computations[kBodyComputationIndex] = computation;
+  MarkParentMutated();
 }
 
 HloInstruction* HloInstruction::while_init() const {
@@ -3349,6 +3368,7 @@ void HloInstruction::set_branch_computation(int b,
                                             HloComputation* computation) {
   CHECK_EQ(HloOpcode::kConditional, opcode_);
   rare_->called_computations[b] = computation;
+  MarkParentMutated();
 }
 
 std::string HloInstruction::SignatureString() const {
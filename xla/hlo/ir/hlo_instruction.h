@@ -51,6 +51,7 @@ limitations under the License.
 #include "xla/hlo/ir/dfs_hlo_visitor.h"
 #include "xla/hlo/ir/hlo_clone_context.h"
 #include "xla/hlo/ir/hlo_domain_metadata.h"
+#include "xla/hlo/ir/hlo_instruction_arena.h"
 #include "xla/hlo/ir/hlo_opcode.h"
 #include "xla/hlo/ir/hlo_sharding.h"
 #include "xla/hlo/ir/ptrvec.h"
@@ -679,6 +680,16 @@ class HloInstruction {
 
   virtual ~HloInstruction() { DetachFromOperandsAndUsers(); }
 
+  // Instructions are allocated from the arena of the innermost
+  // HloInstructionArena::Scope of the thread creating them, and from the heap
+  // outside of one.
+  static void* operator new(size_t size) {
+    return HloInstructionArena::Allocate(size);
+  }
+  static void operator delete(void* ptr) {
+    HloInstructionArena::Deallocate(ptr);
+  }
+
   // Detaches an instruction from its operands and users. That is, remove the
   // instruction from each operand's user set and user's operand set.
   void DetachFromOperandsAndUsers();
@@ -1428,7 +1439,10 @@ class HloInstruction {
 
   // Returns the opcode for this instruction.
   HloOpcode opcode() const { return opcode_; }
-  HloOpcode* mutable_opcode() { return &opcode_; }
+  HloOpcode* mutable_opcode() {
+    MarkParentMutated();
+    return &opcode_;
+  }
 
   // Returns whether this instruction is the root of its parent computation.
   bool IsRoot() const { return is_root_; }
@@ -1451,7 +1465,10 @@ class HloInstruction {
   const Shape& shape() const;
 
   // Returns the (mutable) result shape of this instruction.
-  Shape* mutable_shape() { return &shape_; }
+  Shape* mutable_shape() {
+    MarkParentMutated();
+    return &shape_;
+  }
 
   // Returns the ith operand to this instruction.
   const HloInstruction* operand(int64_t i) const;
@@ -1894,6 +1911,7 @@ class HloInstruction {
   }
   void set_sharding(std::shared_ptr<const HloSharding> sharding) {
     sharding_ = std::move(sharding);
+    MarkParentMutated();
   }
   // Copies the sharding of another instruction, this is more efficient than
   // set_sharding(hlo->sharding()) because it avoids a deep copy and shares the
@@ -1908,7 +1926,10 @@ class HloInstruction {
     set_single_sharding(HloSharding::AssignDevice(device));
   }
   // Remove any sharding from this operator.
-  void clear_sharding() { sharding_ = nullptr; }
+  void clear_sharding() {
+    sharding_ = nullptr;
+    MarkParentMutated();
+  }
   // Return true if this operator has a sharding assigned.
   bool has_sharding() const { return sharding_ != nullptr; }
   // Checks whether the instruction has compatible sharding with the other
@@ -1972,6 +1993,7 @@ class HloInstruction {
       mutable_rare()->called_computations[i] =
           map_function(rare()->called_computations[i]);
     }
+    MarkParentMutated();
   }
 
   // Clears out the called computations.
@@ -2060,6 +2082,15 @@ class HloInstruction {
     unique_id_ = id;
   }
 
+  // Set the temporary id of an instruction added to a computation whose
+  // unique identifiers are deferred, see HloModule::DeferUniqueIdentifiers.
+  // Temporary ids are below -1.
+  void SetTemporaryUniqueIdInternal(int id) {
+    CHECK_EQ(unique_id_, -1);  // Should not be assigned already
+    CHECK_LT(id, -1);
+    unique_id_ = id;
+  }
+
   // Return the unique ID assigned to this node via SetUniqueId (or -1
   // if no id has been assigned yet).
   int unique_id() const { return unique_id_; }
@@ -2085,6 +2116,7 @@ class HloInstruction {
 
   Status set_backend_config(const tsl::protobuf::Message& proto) {
     backend_config_ = proto;
+    MarkParentMutated();
     return OkStatus();
   }
 
@@ -2092,10 +2124,14 @@ class HloInstruction {
 
   bool has_backend_config() const { return !backend_config_.empty(); }
 
-  void clear_backend_config() { backend_config_.clear(); }
+  void clear_backend_config() {
+    backend_config_.clear();
+    MarkParentMutated();
+  }
 
   void CopyBackendConfigFrom(const HloInstruction* other) {
     backend_config_ = other->backend_config_.Clone();
+    MarkParentMutated();
   }
 
   void set_frontend_attributes(FrontendAttributes frontend_attributes) {
@@ -2150,6 +2186,7 @@ class HloInstruction {
   }
   void set_raw_backend_config_string(std::string config_str) {
     backend_config_ = std::move(config_str);
+    MarkParentMutated();
   }
 
   bool is_default_config() const { return is_default_config_; }
@@ -2556,6 +2593,7 @@ class HloInstruction {
 
   void RemoveOperandAt(int index) {
     operands_.erase(operands_.begin() + index);
+    MarkParentMutated();
   }
 
   // Removes a list of operands with the given indices in ascending order.
@@ -2568,6 +2606,7 @@ class HloInstruction {
 
   void set_called_computation(int index, HloComputation* computation) {
     mutable_rare()->called_computations[index] = computation;
+    MarkParentMutated();
   }
   // Indices of computations in called_computations for instructions which call
   // multiple computations.
@@ -2588,6 +2627,10 @@ class HloInstruction {
   // Change instruction's name to have a given suffix.
   void AddSuffixToInstructionName(const absl::string_view suffix);
 
+  // Gives the computation containing this instruction, if any, a new mutation
+  // generation (see HloComputation::mutation_generation).
+  void MarkParentMutated();
+
  private:
   friend class HloComputation;
   // Wrapper class of string format and protobuf format of BackendConfig.
@@ -0,0 +1,138 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/hlo/ir/hlo_instruction_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include "absl/synchronization/mutex.h"
+
+namespace xla {
+namespace {
+
+// Precedes every allocation made by HloInstructionArena::Allocate.
+struct alignas(std::max_align_t) AllocationHeader {
+  // The arena of the allocation, nullptr if it is on the heap.
+  HloInstructionArena* arena;
+  // The size of the allocation, including the header.
+  size_t size;
+};
+
+constexpr size_t kAlignment = alignof(AllocationHeader);
+constexpr size_t kHeaderSize = sizeof(AllocationHeader);
+constexpr size_t kBlockSize = 256 * 1024;
+// Larger allocations are made on the heap, to not waste the end of a block.
+constexpr size_t kMaxArenaAllocationSize = kBlockSize / 16;
+
+thread_local HloInstructionArena* current_arena = nullptr;
+
+}  // namespace
+
+HloInstructionArena::HloInstructionArena()
+    : free_lists_(kMaxArenaAllocationSize / kAlignment + 1, nullptr) {}
+
+HloInstructionArena::~HloInstructionArena() = default;
+
+HloInstructionArena::Scope::Scope(HloInstructionArena* arena)
+    : previous_(current_arena) {
+  current_arena = arena;
+}
+
+HloInstructionArena::Scope::~Scope() { current_arena = previous_; }
+
+/*static*/ HloInstructionArena* HloInstructionArena::current() {
+  return current_arena;
+}
+
+/*static*/ void* HloInstructionArena::Allocate(size_t size) {
+  const size_t allocation_size =
+      (size + kHeaderSize + kAlignment - 1) / kAlignment * kAlignment;
+  HloInstructionArena* arena = current_arena;
+  void* allocation;
+  if (arena != nullptr && allocation_size <= kMaxArenaAllocationSize) {
+    allocation = arena->AllocateInArena(allocation_size);
+  } else {
+    arena = nullptr;
+    allocation = ::operator new(allocation_size);
+  }
+  auto* header = new (allocation) AllocationHeader{arena, allocation_size};
+  return header + 1;
+}
+
+/*static*/ void HloInstructionArena::Deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  AllocationHeader* header = static_cast<AllocationHeader*>(ptr) - 1;
+  if (header->arena == nullptr) {
+    ::operator delete(header);
+    return;
+  }
+  header->arena->DeallocateInArena(header, header->size);
+}
+
+/*static*/ HloInstructionArena* HloInstructionArena::ArenaOf(const void* ptr) {
+  return (static_cast<const AllocationHeader*>(ptr) - 1)->arena;
+}
+
+int64_t HloInstructionArena::allocated_bytes() const {
+  absl::MutexLock lock(&mu_);
+  return allocated_bytes_;
+}
+
+int64_t HloInstructionArena::reserved_bytes() const {
+  absl::MutexLock lock(&mu_);
+  return blocks_.size() * kBlockSize;
+}
+
+void* HloInstructionArena::AllocateInArena(size_t size) {
+  void* allocation;
+  {
+    absl::MutexLock lock(&mu_);
+    void*& free_list = free_lists_[size / kAlignment];
+    if (free_list != nullptr) {
+      allocation = free_list;
+      free_list = *static_cast<void**>(allocation);
+    } else {
+      if (static_cast<size_t>(end_ - next_) < size) {
+        blocks_.emplace_back(new char[kBlockSize]);
+        next_ = blocks_.back().get();
+        end_ = next_ + kBlockSize;
+      }
+      allocation = next_;
+      next_ += size;
+    }
+    allocated_bytes_ += size;
+  }
+  Ref();
+  return allocation;
+}
+
+void HloInstructionArena::DeallocateInArena(void* allocation, size_t size) {
+  {
+    absl::MutexLock lock(&mu_);
+    void*& free_list = free_lists_[size / kAlignment];
+    *static_cast<void**>(allocation) = free_list;
+    free_list = allocation;
+    allocated_bytes_ -= size;
+  }
+  // May destroy the arena, if the instruction outlived its module.
+  Unref();
+}
+
+}  // namespace xla
@@ -0,0 +1,97 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_HLO_IR_HLO_INSTRUCTION_ARENA_H_
+#define XLA_HLO_IR_HLO_INSTRUCTION_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tsl/platform/refcount.h"
+
+namespace xla {
+
+// An arena HloInstructions are allocated from instead of the heap. Allocating
+// from the arena is a pointer bump, and the instructions created together, e.g.
+// by parsing or cloning a module, end up next to each other in memory, which
+// makes walking the graph of a large module cheaper.
+//
+// The memory of a deleted instruction is reused for the next instruction of the
+// same size, and is only returned to the system when the arena is destroyed.
+// Every live instruction holds a reference to its arena, so the arena outlives
+// the instructions allocated from it, even when they are moved to another
+// module. The arena is thread-safe.
+class HloInstructionArena : public tsl::core::RefCounted {
+ public:
+  HloInstructionArena();
+  ~HloInstructionArena() override;
+
+  // Makes the instructions created on this thread be allocated from `arena`,
+  // or from the heap if `arena` is nullptr, until the scope is destroyed.
+  class Scope {
+   public:
+    explicit Scope(HloInstructionArena* arena);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    HloInstructionArena* previous_;
+  };
+
+  // Returns the arena of the innermost scope of this thread, or nullptr.
+  static HloInstructionArena* current();
+
+  // Allocates `size` bytes from the arena of the innermost scope of this
+  // thread, or from the heap outside of a scope. The memory is aligned like
+  // the memory of operator new.
+  static void* Allocate(size_t size);
+
+  // Frees memory returned by Allocate.
+  static void Deallocate(void* ptr);
+
+  // Returns the arena `ptr`, which was returned by Allocate, is allocated
+  // from, or nullptr if it is allocated from the heap.
+  static HloInstructionArena* ArenaOf(const void* ptr);
+
+  // Returns the number of bytes allocated from the arena which are not freed.
+  int64_t allocated_bytes() const;
+
+  // Returns the number of bytes the arena holds in its blocks.
+  int64_t reserved_bytes() const;
+
+ private:
+  void* AllocateInArena(size_t size);
+  void DeallocateInArena(void* allocation, size_t size);
+
+  mutable absl::Mutex mu_;
+  std::vector<std::unique_ptr<char[]>> blocks_ ABSL_GUARDED_BY(mu_);
+  // The free part of the last block.
+  char* next_ ABSL_GUARDED_BY(mu_) = nullptr;
+  char* end_ ABSL_GUARDED_BY(mu_) = nullptr;
+  // The freed allocations, linked through their first word, by size in units
+  // of the alignment.
+  std::vector<void*> free_lists_ ABSL_GUARDED_BY(mu_);
+  int64_t allocated_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace xla
+
+#endif  // XLA_HLO_IR_HLO_INSTRUCTION_ARENA_H_
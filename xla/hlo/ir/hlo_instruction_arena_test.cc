@@ -0,0 +1,167 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/hlo/ir/hlo_instruction_arena.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "xla/hlo/ir/hlo_computation.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_opcode.h"
+#include "xla/service/hlo_module_config.h"
+#include "xla/shape.h"
+#include "xla/shape_util.h"
+#include "xla/xla.pb.h"
+#include "xla/xla_data.pb.h"
+#include "tsl/platform/refcount.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace xla {
+namespace {
+
+std::unique_ptr<HloInstruction> CreateParameter() {
+  return HloInstruction::CreateParameter(0, ShapeUtil::MakeShape(F32, {}), "p");
+}
+
+// Returns a module whose entry computation is a chain of `num_instructions`
+// instructions, allocated from an arena if `use_arena`.
+std::unique_ptr<HloModule> CreateChainModule(bool use_arena,
+                                             int64_t num_instructions) {
+  DebugOptions debug_options;
+  debug_options.set_xla_hlo_instruction_arena(use_arena);
+  HloModuleConfig config;
+  config.set_debug_options(debug_options);
+  auto module = std::make_unique<HloModule>("chain", config);
+  HloInstructionArena::Scope arena_scope(module->instruction_arena());
+
+  const Shape shape = ShapeUtil::MakeShape(F32, {});
+  HloComputation::Builder builder("entry");
+  HloInstruction* lhs = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, shape, "p0"));
+  HloInstruction* rhs = builder.AddInstruction(
+      HloInstruction::CreateParameter(1, shape, "p1"));
+  for (int64_t i = 2; i < num_instructions; ++i) {
+    HloInstruction* add = builder.AddInstruction(
+        HloInstruction::CreateBinary(shape, HloOpcode::kAdd, lhs, rhs));
+    lhs = rhs;
+    rhs = add;
+  }
+  module->AddEntryComputation(builder.Build());
+  return module;
+}
+
+TEST(HloInstructionArenaTest, AllocatesInstructionsInScope) {
+  tsl::core::RefCountPtr<HloInstructionArena> arena(new HloInstructionArena());
+  std::unique_ptr<HloInstruction> heap_instruction = CreateParameter();
+  std::unique_ptr<HloInstruction> arena_instruction;
+  {
+    HloInstructionArena::Scope arena_scope(arena.get());
+    EXPECT_EQ(HloInstructionArena::current(), arena.get());
+    arena_instruction = CreateParameter();
+    {
+      HloInstructionArena::Scope heap_scope(nullptr);
+      EXPECT_EQ(HloInstructionArena::ArenaOf(CreateParameter().get()),
+                nullptr);
+    }
+  }
+  EXPECT_EQ(HloInstructionArena::current(), nullptr);
+  EXPECT_EQ(HloInstructionArena::ArenaOf(heap_instruction.get()), nullptr);
+  EXPECT_EQ(HloInstructionArena::ArenaOf(arena_instruction.get()), arena.get());
+  EXPECT_GT(arena->allocated_bytes(), 0);
+
+  arena_instruction.reset();
+  EXPECT_EQ(arena->allocated_bytes(), 0);
+}
+
+TEST(HloInstructionArenaTest, ReusesFreedMemory) {
+  tsl::core::RefCountPtr<HloInstructionArena> arena(new HloInstructionArena());
+  HloInstructionArena::Scope arena_scope(arena.get());
+  std::unique_ptr<HloInstruction> instruction = CreateParameter();
+  const HloInstruction* address = instruction.get();
+  const int64_t reserved_bytes = arena->reserved_bytes();
+  instruction.reset();
+  instruction = CreateParameter();
+  EXPECT_EQ(instruction.get(), address);
+  EXPECT_EQ(arena->reserved_bytes(), reserved_bytes);
+}
+
+TEST(HloInstructionArenaTest, InstructionsOutliveTheirModule) {
+  std::unique_ptr<HloModule> module =
+      CreateChainModule(/*use_arena=*/true, /*num_instructions=*/8);
+  ASSERT_NE(module->instruction_arena(), nullptr);
+  HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_EQ(HloInstructionArena::ArenaOf(root), module->instruction_arena());
+
+  // The clone has an arena of its own.
+  std::unique_ptr<HloModule> clone = module->Clone();
+  ASSERT_NE(clone->instruction_arena(), nullptr);
+  EXPECT_NE(clone->instruction_arena(), module->instruction_arena());
+  EXPECT_EQ(HloInstructionArena::ArenaOf(
+                clone->entry_computation()->root_instruction()),
+            clone->instruction_arena());
+  EXPECT_EQ(clone->ToString(), module->ToString());
+
+  // An instruction created in the scope of the module keeps its arena alive.
+  std::unique_ptr<HloInstruction> instruction;
+  {
+    HloInstructionArena::Scope arena_scope(module->instruction_arena());
+    instruction = CreateParameter();
+  }
+  module.reset();
+  EXPECT_NE(HloInstructionArena::ArenaOf(instruction.get()), nullptr);
+  EXPECT_EQ(instruction->opcode(), HloOpcode::kParameter);
+}
+
+TEST(HloInstructionArenaTest, ModulesWithoutArenaAllocateFromHeap) {
+  std::unique_ptr<HloModule> module =
+      CreateChainModule(/*use_arena=*/false, /*num_instructions=*/8);
+  EXPECT_EQ(module->instruction_arena(), nullptr);
+  EXPECT_EQ(HloInstructionArena::ArenaOf(
+                module->entry_computation()->root_instruction()),
+            nullptr);
+}
+
+void BM_PostOrder(::testing::benchmark::State& state) {
+  const bool use_arena = state.range(0);
+  std::unique_ptr<HloModule> module =
+      CreateChainModule(use_arena, /*num_instructions=*/state.range(1));
+  for (auto s : state) {
+    std::vector<HloInstruction*> post_order =
+        module->entry_computation()->MakeInstructionPostOrder();
+    tsl::testing::DoNotOptimize(post_order);
+  }
+}
+BENCHMARK(BM_PostOrder)->ArgPair(0, 1 << 10)->ArgPair(1, 1 << 10)
+    ->ArgPair(0, 1 << 16)->ArgPair(1, 1 << 16)
+    ->ArgPair(0, 1 << 20)->ArgPair(1, 1 << 20);
+
+void BM_CloneModule(::testing::benchmark::State& state) {
+  const bool use_arena = state.range(0);
+  std::unique_ptr<HloModule> module =
+      CreateChainModule(use_arena, /*num_instructions=*/state.range(1));
+  for (auto s : state) {
+    std::unique_ptr<HloModule> clone = module->Clone();
+    tsl::testing::DoNotOptimize(clone);
+  }
+}
+BENCHMARK(BM_CloneModule)->ArgPair(0, 1 << 10)->ArgPair(1, 1 << 10)
+    ->ArgPair(0, 1 << 16)->ArgPair(1, 1 << 16);
+
+}  // namespace
+}  // namespace xla
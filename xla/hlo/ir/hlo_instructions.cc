@@ -1719,6 +1719,14 @@ std::unique_ptr<HloInstruction> HloSliceInstruction::CloneWithNewOperandsImpl(
       shape, new_operands[0], slice_starts_, slice_limits_, slice_strides_);
 }
 
+const std::shared_ptr<Literal>& LazyLiteral::Get() {
+  absl::call_once(once_, [this] {
+    literal_ = std::make_shared<Literal>(loader_());
+    loader_ = nullptr;
+  });
+  return literal_;
+}
+
 HloConstantInstruction::HloConstantInstruction(Literal literal)
     : HloInstruction(HloOpcode::kConstant, literal.shape()),
       literal_(new Literal(std::move(literal))) {}
@@ -1732,13 +1740,18 @@ HloConstantInstruction::HloConstantInstruction(std::shared_ptr<Literal> literal,
                                                const Shape& shape)
     : HloInstruction(HloOpcode::kConstant, shape), literal_(literal) {}
 
+HloConstantInstruction::HloConstantInstruction(
+    std::shared_ptr<LazyLiteral> literal, const Shape& shape)
+    : HloInstruction(HloOpcode::kConstant, shape),
+      lazy_literal_(std::move(literal)) {}
+
 HloConstantInstruction::HloConstantInstruction(const Shape& shape)
     : HloInstruction(HloOpcode::kConstant, shape) {}
 
 HloInstructionProto HloConstantInstruction::ToProto() const {
   HloInstructionProto proto = HloInstruction::ToProto();
-  if (literal_) {
-    *proto.mutable_literal() = literal_->ToProto();
+  if (HasLiteral()) {
+    *proto.mutable_literal() = literal().ToProto();
   }
   return proto;
 }
@@ -1765,7 +1778,7 @@ void HloConstantInstruction::RelayoutConstant(const Layout& new_layout,
             new_layout,
             ShapeUtil::GetSubshape(literal().shape(), shape_index).layout())) {
       // Only relayout literals if that's really necessary.
-      Literal new_literal = literal_->Relayout(new_layout, shape_index);
+      Literal new_literal = literal().Relayout(new_layout, shape_index);
       *mutable_literal() = std::move(new_literal);
     }
     *mutable_array_subshape->mutable_layout() = new_layout;
@@ -1784,6 +1797,10 @@ std::unique_ptr<HloInstruction>
 HloConstantInstruction::CloneWithNewOperandsImpl(
     const Shape& shape, absl::Span<HloInstruction* const> new_operands,
     HloCloneContext* context) const {
+  if (lazy_literal_) {
+    return std::make_unique<HloConstantInstruction>(lazy_literal_,
+                                                    this->shape());
+  }
   if (!literal_) {
     return std::make_unique<HloConstantInstruction>(this->shape());
   }
@@ -1798,7 +1815,7 @@ void HloConstantInstruction::PrintOperandsWithCanonicalNameMap(
     Printer* printer, const HloPrintOptions& options,
     CanonicalNameMap* canonical_name_map) const {
   if (options.print_only_essential_constants()) {
-    if (!literal_) {
+    if (!HasLiteral()) {
       printer->Append("{...}");
       return;
     }
@@ -1818,7 +1835,7 @@ void HloConstantInstruction::PrintOperandsWithCanonicalNameMap(
       if (auto num_constants =
               absl::c_accumulate(shape().dimensions(), 1, std::multiplies<>());
           num_constants <= 500'000) {
-        literal_->PrintWithoutShapeOneline(printer);
+        literal().PrintWithoutShapeOneline(printer);
         return;
       }
     }
@@ -1827,12 +1844,12 @@ void HloConstantInstruction::PrintOperandsWithCanonicalNameMap(
   }
 
   // For constants, show the actual value in place of an empty operand list.
-  if (literal_ &&
+  if (HasLiteral() &&
       ((shape().IsArray() && ShapeUtil::ElementsIn(shape()) <= 10) ||
        options.print_large_constants())) {
     // Literal::ToString emits multidimensional arrays over multiple
     // lines. Compact this into one line by stripping out white space.
-    literal_->PrintWithoutShapeOneline(printer);
+    literal().PrintWithoutShapeOneline(printer);
   } else {
     // Do not show large constants or tuples.
     printer->Append("{...}");
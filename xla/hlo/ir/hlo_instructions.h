@@ -19,6 +19,7 @@ limitations under the License.
 #define XLA_HLO_IR_HLO_INSTRUCTIONS_H_
 
 #include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
 #include <optional>
@@ -26,6 +27,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
@@ -57,7 +59,10 @@ class HloDimensionsInstruction : public HloInstruction {
  public:
   absl::Span<const int64_t> dimensions() const override { return dimensions_; }
 
-  std::vector<int64_t>* mutable_dimensions() override { return &dimensions_; }
+  std::vector<int64_t>* mutable_dimensions() override {
+    MarkParentMutated();
+    return &dimensions_;
+  }
 
   HloInstructionProto ToProto() const override;
 
@@ -1189,7 +1194,10 @@ class HloMapInstruction : public HloInstruction {
   // Returns the dimension sizes or numbers associated with this instruction.
   absl::Span<const int64_t> dimensions() const override { return dimensions_; }
 
-  std::vector<int64_t>* mutable_dimensions() override { return &dimensions_; }
+  std::vector<int64_t>* mutable_dimensions() override {
+    MarkParentMutated();
+    return &dimensions_;
+  }
   // Returns a serialized representation of this instruction.
   HloInstructionProto ToProto() const override;
 
@@ -1228,7 +1236,10 @@ class HloSliceInstruction : public HloInstruction {
     return slice_starts_[dimension];
   }
   const std::vector<int64_t>& slice_starts() const { return slice_starts_; }
-  std::vector<int64_t>* mutable_slice_starts() { return &slice_starts_; }
+  std::vector<int64_t>* mutable_slice_starts() {
+    MarkParentMutated();
+    return &slice_starts_;
+  }
 
   // Returns the (exclusive) limit index in the given dimension for a slice
   // node.
@@ -1236,14 +1247,20 @@ class HloSliceInstruction : public HloInstruction {
     return slice_limits_[dimension];
   }
   const std::vector<int64_t>& slice_limits() const { return slice_limits_; }
-  std::vector<int64_t>* mutable_slice_limits() { return &slice_limits_; }
+  std::vector<int64_t>* mutable_slice_limits() {
+    MarkParentMutated();
+    return &slice_limits_;
+  }
 
   // Returns the stride in the given dimension for a slice node.
   int64_t slice_strides(int64_t dimension) const {
     return slice_strides_[dimension];
   }
   const std::vector<int64_t>& slice_strides() const { return slice_strides_; }
-  std::vector<int64_t>* mutable_slice_strides() { return &slice_strides_; }
+  std::vector<int64_t>* mutable_slice_strides() {
+    MarkParentMutated();
+    return &slice_strides_;
+  }
 
   static bool ClassOf(const HloInstruction* hlo) {
     return hlo->opcode() == HloOpcode::kSlice;
@@ -1267,25 +1284,60 @@ class HloSliceInstruction : public HloInstruction {
   std::vector<int64_t> slice_strides_;
 };
 
+// The literal of a constant that is loaded the first time it is accessed, e.g.
+// from the memory-mapped sections of a binary HLO snapshot. Clones of the
+// constant share the LazyLiteral and thus the loaded literal. Thread-safe.
+class LazyLiteral {
+ public:
+  explicit LazyLiteral(std::function<Literal()> loader)
+      : loader_(std::move(loader)) {}
+
+  // Returns the literal, loading it on the first call.
+  const std::shared_ptr<Literal>& Get();
+
+ private:
+  absl::once_flag once_;
+  std::function<Literal()> loader_;
+  std::shared_ptr<Literal> literal_;
+};
+
 class HloConstantInstruction : public HloInstruction {
  public:
   explicit HloConstantInstruction(Literal literal);
   HloConstantInstruction(Literal literal, const Shape& shape);
   HloConstantInstruction(std::shared_ptr<Literal> literal, const Shape& shape);
+  HloConstantInstruction(std::shared_ptr<LazyLiteral> literal,
+                         const Shape& shape);
   // Used when the literal is too large and dropped.
   explicit HloConstantInstruction(const Shape& shape);
   // Returns the literal associated with this instruction.
-  const Literal& literal() const { return *literal_; }
+  const Literal& literal() const {
+    return lazy_literal_ ? *lazy_literal_->Get() : *literal_;
+  }
   // Returns the (mutable) literal associated with this instruction.
   // Clone the literal if necessary (do not modify the shared instance).
   Literal* mutable_literal() {
+    MarkParentMutated();
+    if (lazy_literal_) {
+      literal_ = lazy_literal_->Get();
+      lazy_literal_.reset();
+    }
     if (literal_.use_count() > 1) {
       literal_.reset(new Literal(literal_->Clone()));
     }
     return literal_.get();
   }
   // Returns whether there is literal associated with this instruction.
-  bool HasLiteral() const { return static_cast<bool>(literal_); }
+  bool HasLiteral() const {
+    return static_cast<bool>(literal_) || static_cast<bool>(lazy_literal_);
+  }
+  // Returns whether the literal is loaded lazily on its first access.
+  bool HasLazyLiteral() const { return static_cast<bool>(lazy_literal_); }
+  // Sets the literal of a constant that has none to one that is loaded lazily.
+  void set_lazy_literal(std::shared_ptr<LazyLiteral> literal) {
+    CHECK(!HasLiteral());
+    lazy_literal_ = std::move(literal);
+  }
   // Returns a serialized representation of this instruction.
   HloInstructionProto ToProto() const override;
 
@@ -1314,6 +1366,8 @@ class HloConstantInstruction : public HloInstruction {
       const Shape& shape, absl::Span<HloInstruction* const> new_operands,
       HloCloneContext* context) const override;
   std::shared_ptr<Literal> literal_;
+  // Set instead of `literal_` for a literal that is not loaded yet.
+  std::shared_ptr<LazyLiteral> lazy_literal_;
 };
 
 // Abstract class that represents an HLO instruction that "calls" a computation.
@@ -1655,6 +1709,7 @@ class HloGetTupleElementInstruction : public HloInstruction {
   // Sets the tuple index associated with this instruction.
   void set_tuple_index(int64_t new_tuple_index) {
     tuple_index_ = new_tuple_index;
+    MarkParentMutated();
   }
   // Returns a serialized representation of this instruction.
   HloInstructionProto ToProto() const override;
@@ -1760,7 +1815,10 @@ class HloOutfeedInstruction : public HloInstruction {
   // Returns the shape for the Outfeed instruction.
   const Shape& outfeed_shape() const { return outfeed_shape_; }
   // Returns the mutable shape for the Outfeed instruction.
-  Shape* mutable_outfeed_shape() { return &outfeed_shape_; }
+  Shape* mutable_outfeed_shape() {
+    MarkParentMutated();
+    return &outfeed_shape_;
+  }
   // Returns the config for the Outfeed instruction.
   const std::string& outfeed_config() const { return outfeed_config_; }
   void set_outfeed_config(const std::string& config) {
@@ -1828,7 +1886,10 @@ class HloConvolutionInstruction : public HloInstruction {
   // information but it is presumed that the alternate lowering is strictly
   // superior.
   const PrecisionConfig& precision_config() const { return precision_config_; }
-  PrecisionConfig* mutable_precision_config() { return &precision_config_; }
+  PrecisionConfig* mutable_precision_config() {
+    MarkParentMutated();
+    return &precision_config_;
+  }
 
   std::string ToCategory() const override;
   // Returns a serialized representation of this instruction.
@@ -2071,7 +2132,10 @@ class HloCustomCallInstruction : public HloCallableInstruction {
   bool HasLiteral() const { return literal_.has_value(); }
 
   const PrecisionConfig& precision_config() const { return precision_config_; }
-  PrecisionConfig* mutable_precision_config() { return &precision_config_; }
+  PrecisionConfig* mutable_precision_config() {
+    MarkParentMutated();
+    return &precision_config_;
+  }
 
   // Returns a serialized representation of this instruction.
   HloInstructionProto ToProto() const override;
@@ -2153,7 +2217,10 @@ class HloPadInstruction : public HloInstruction {
                              const PaddingConfig& padding_config);
   // Returns the padding configuration for a pad node.
   const PaddingConfig& padding_config() const { return padding_config_; }
-  PaddingConfig* mutable_padding_config() { return &padding_config_; }
+  PaddingConfig* mutable_padding_config() {
+    MarkParentMutated();
+    return &padding_config_;
+  }
   // Returns the operand being padded.
   const HloInstruction* padded_operand() const { return operand(0); }
   HloInstruction* mutable_padded_operand() { return mutable_operand(0); }
@@ -2445,6 +2512,7 @@ class HloDotInstruction : public HloInstruction {
 
   // Sets dimension numbers used for a dot operation.
   DotDimensionNumbers* mutable_dot_dimension_numbers() {
+    MarkParentMutated();
     return &dot_dimension_numbers_;
   }
 
@@ -2456,7 +2524,10 @@ class HloDotInstruction : public HloInstruction {
   // information but it is presumed that the alternate lowering is strictly
   // superior.
   const PrecisionConfig& precision_config() const { return precision_config_; }
-  PrecisionConfig* mutable_precision_config() { return &precision_config_; }
+  PrecisionConfig* mutable_precision_config() {
+    MarkParentMutated();
+    return &precision_config_;
+  }
 
   // Sparsity descriptors are optional. If present, additional operands define
   // how the data is read for the dot inputs.
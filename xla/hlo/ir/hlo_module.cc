@@ -77,6 +77,9 @@ HloModule::HloModule(const std::string& name,
       autofdo_fingerprint_(""),
       comp_envs_(std::move(comp_envs)) {
   metadata_.set_canonical_module_id(unique_id_);
+  if (this->config().debug_options().xla_hlo_instruction_arena()) {
+    instruction_arena_.reset(new HloInstructionArena());
+  }
 }
 
 Status HloModule::set_schedule(HloSchedule schedule) {
@@ -573,6 +576,9 @@ absl::StatusOr<std::unique_ptr<HloModule>> HloModule::CreateFromProto(
       << ShapeUtil::HumanStringWithLayout(expected_program_shape.result())
       << ", actual: " << ShapeUtil::HumanStringWithLayout(result_shape);
 
+  auto module = std::make_unique<HloModule>(proto.name(), module_config);
+  HloInstructionArena::Scope arena_scope(module->instruction_arena());
+
   absl::flat_hash_map<int64_t, HloComputation*> computation_map;
   absl::flat_hash_map<HloComputation*, int64_t> to_proto_id;
   std::vector<std::unique_ptr<HloComputation>> computations;
@@ -595,8 +601,6 @@ absl::StatusOr<std::unique_ptr<HloModule>> HloModule::CreateFromProto(
   }
   TF_RET_CHECK(entry != nullptr);
 
-  auto module = std::make_unique<HloModule>(proto.name(), module_config);
-
   // Sort the computations in the proto id's order.
   absl::c_sort(computations, [&](const std::unique_ptr<HloComputation>& a,
                                  const std::unique_ptr<HloComputation>& b) {
@@ -1067,6 +1071,7 @@ std::unique_ptr<HloModule> HloModule::Clone(
   auto module = std::make_unique<HloModule>(
       absl::StrCat(name_, suffix.empty() ? "" : "-", suffix), std::move(config),
       std::make_unique<CompilationEnvironments>(*comp_envs_));
+  HloInstructionArena::Scope arena_scope(module->instruction_arena());
 
   HloCloneContext context(module.get(), suffix);
   if (entry_computation_) {
@@ -1158,6 +1163,35 @@ uint64_t HloModule::RandomNew64() const {
   return rng_();
 }
 
+void HloModule::AssignUniqueIdentifiers(HloInstruction* instruction) {
+  absl::MutexLock lock(&identifiers_mutex_);
+  instruction->UniquifyName(&instruction_name_uniquer_);
+  instruction->SetUniqueId(next_unique_id_++);
+}
+
+void HloModule::DeferUniqueIdentifiers(
+    absl::Span<HloComputation* const> computations) {
+  // The computations take turns in the temporary ids below -1, so that they
+  // do not collide.
+  const int stride = computations.size();
+  for (int i = 0; i < stride; ++i) {
+    CHECK_EQ(computations[i]->parent(), this);
+    computations[i]->DeferUniqueIdentifiersInternal(/*first_id=*/-2 - i,
+                                                    stride);
+  }
+}
+
+void HloModule::AssignDeferredUniqueIdentifiers(
+    absl::Span<HloComputation* const> computations) {
+  for (HloComputation* computation : computations) {
+    for (HloInstruction* instruction :
+         computation->StopDeferringUniqueIdentifiersInternal()) {
+      instruction->ClearUniqueIdInternal();
+      AssignUniqueIdentifiers(instruction);
+    }
+  }
+}
+
 HloComputation* HloModule::GetComputationWithName(absl::string_view name) {
   auto computations_in_module = computations();
   auto it = absl::c_find_if(
@@ -30,12 +30,14 @@ limitations under the License.
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "xla/hlo/ir/dynamic_parameter_binding.h"
 #include "xla/hlo/ir/hlo_clone_context.h"
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_input_output_alias_config.h"
 #include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_instruction_arena.h"
 #include "xla/hlo/ir/hlo_module_metadata.h"
 #include "xla/hlo/ir/hlo_schedule.h"
 #include "xla/iterator_util.h"
@@ -47,6 +49,7 @@ limitations under the License.
 #include "xla/xla.pb.h"
 #include "tsl/lib/gtl/iterator_range.h"
 #include "tsl/platform/logging.h"
+#include "tsl/platform/refcount.h"
 
 namespace xla {
 
@@ -488,15 +491,35 @@ class HloModule {
   uint64_t RandomNew64() const;
 
   // Returns the NameUniquer for uniquing instruction names in this module.
+  // Unlike the methods below, using it is not thread-safe.
   NameUniquer& instruction_name_uniquer() { return instruction_name_uniquer_; }
 
-  // Assign a new unique dense id for an instruction
+  // Assign a new unique dense id for an instruction. Thread-safe.
   int NewUniqueInstructionId() {
+    absl::MutexLock lock(&identifiers_mutex_);
     int result = next_unique_id_;
     next_unique_id_++;
     return result;
   }
 
+  // Uniquifies the name of `instruction` and assigns it a new unique id.
+  // Thread-safe.
+  void AssignUniqueIdentifiers(HloInstruction* instruction);
+
+  // Defers giving unique names and ids to the instructions added to
+  // `computations` until AssignDeferredUniqueIdentifiers is called. Meanwhile
+  // new instructions keep the names they were created with and get temporary
+  // ids, which are unique within the module. This lets passes add instructions
+  // to different computations concurrently, while the names and ids the
+  // instructions end up with do not depend on how the threads interleave.
+  void DeferUniqueIdentifiers(absl::Span<HloComputation* const> computations);
+
+  // Gives unique names and ids to the instructions added to `computations`
+  // since DeferUniqueIdentifiers, in the order of `computations` and, within a
+  // computation, in the order in which they were added.
+  void AssignDeferredUniqueIdentifiers(
+      absl::Span<HloComputation* const> computations);
+
   // input_output_alias_config indicates the list of aliased buffers that are
   // expected from the module.
   HloInputOutputAliasConfig& input_output_alias_config() {
@@ -549,6 +572,7 @@ class HloModule {
 
   void SetAndUniquifyInstrName(HloInstruction* instr, absl::string_view name) {
     instr->SetAndSanitizeName(name);
+    absl::MutexLock lock(&identifiers_mutex_);
     instr->UniquifyName(&instruction_name_uniquer_);
   }
 
@@ -628,6 +652,14 @@ class HloModule {
   const HloModuleMetadata& metadata() const { return metadata_; }
   HloModuleMetadata* metadata() { return &metadata_; }
 
+  // Returns the arena the instructions of the module are allocated from while
+  // it is parsed, cloned or run through an HloPassPipeline, or nullptr if they
+  // are allocated from the heap. The module has an arena if it is created with
+  // the xla_hlo_instruction_arena debug option.
+  HloInstructionArena* instruction_arena() const {
+    return instruction_arena_.get();
+  }
+
   // Moves (not copies) metadata from this HloModule to `module`. To be used
   // in cases like HloModuleGroup::ReplaceModule when metadata should be
   // transferred out of a module before it's destroyed.
@@ -737,12 +769,17 @@ class HloModule {
   NameUniquer computation_name_uniquer_{/*separator=*/"."};
   NameUniquer instruction_name_uniquer_{/*separator=*/"."};
   int next_unique_id_ = 0;
+  // Guards instruction_name_uniquer_ and next_unique_id_ when instructions are
+  // added to different computations concurrently.
+  absl::Mutex identifiers_mutex_;
 
   // Used to keep track of the next unique module id that should be assigned.
   static std::atomic<int> next_unique_module_id_;
   // A unique id to label modules with.
   const int unique_id_;
 
+  tsl::core::RefCountPtr<HloInstructionArena> instruction_arena_;
+
   // The HloSchedule of the module. The schedule if it exists contains a
   // sequential order of instructions for each non-fusion computation in the
   // module.
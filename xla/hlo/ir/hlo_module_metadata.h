@@ -108,6 +108,34 @@ class HloModuleMetadata {
           pass_metadata->add_module_group_module_ids(module_id);
         });
   }
+  Status set_current_pass_computation_counts(int64_t processed,
+                                             int64_t skipped) {
+    return MutateCurrentHloPassMetadata(
+        [&](HloPassMetadata* pass_metadata) {
+          pass_metadata->set_computations_processed(processed);
+          pass_metadata->set_computations_skipped(skipped);
+        });
+  }
+  Status set_current_pass_instruction_counts(int64_t before, int64_t after) {
+    return MutateCurrentHloPassMetadata(
+        [&](HloPassMetadata* pass_metadata) {
+          pass_metadata->set_instruction_count_before(before);
+          pass_metadata->set_instruction_count_after(after);
+        });
+  }
+  Status set_current_pass_peak_memory_bytes(int64_t before, int64_t after) {
+    return MutateCurrentHloPassMetadata(
+        [&](HloPassMetadata* pass_metadata) {
+          pass_metadata->set_peak_memory_bytes_before(before);
+          pass_metadata->set_peak_memory_bytes_after(after);
+        });
+  }
+  Status set_current_pass_dataflow_analysis_usec(int64_t usec) {
+    return MutateCurrentHloPassMetadata(
+        [&](HloPassMetadata* pass_metadata) {
+          pass_metadata->set_dataflow_analysis_usec(usec);
+        });
+  }
 
  private:
   // Gets mutable metadata for the currently running pass. If passes are nested,
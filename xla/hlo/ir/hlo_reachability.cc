@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "xla/hlo/ir/hlo_reachability.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <queue>
 #include <vector>
@@ -26,7 +28,8 @@ namespace xla {
 
 HloReachabilityMap::HloReachabilityMap(
     absl::Span<const HloInstruction* const> instructions)
-    : bit_sets_(instructions.size(), BitSet(instructions.size())) {
+    : bit_sets_(instructions.size(), BitSet(instructions.size())),
+      bit_set_size_(instructions.size()) {
   indices_.reserve(instructions.size());
   for (size_t i = 0; i < instructions.size(); ++i) {
     bit_sets_[i].Set(i);  // Instructions are reachable from themselves.
@@ -88,6 +91,40 @@ void HloReachabilityMap::Replace(const HloInstruction* original,
   }
 }
 
+void HloReachabilityMap::Replace(Index index,
+                                 const HloInstruction* replacement) {
+  indices_[GetKey(replacement)] = index;
+}
+
+void HloReachabilityMap::AddEdge(Index a, Index b) {
+  if (IsReachable(a, b)) {
+    return;
+  }
+  DCHECK(!IsReachable(b, a)) << "Adding the edge creates a cycle";
+  // The bit-set of `a` does not change, as `a` is not reachable from `b`.
+  const BitSet& bit_set_a = bit_sets_[a];
+  for (BitSet& bit_set : bit_sets_) {
+    if (bit_set.Get(b)) {
+      bit_set |= bit_set_a;
+    }
+  }
+}
+
+HloReachabilityMap::Index HloReachabilityMap::AddInstruction(
+    const HloInstruction* instruction) {
+  Index index = bit_sets_.size();
+  if (index == bit_set_size_) {
+    bit_set_size_ = std::max<size_t>(2 * bit_set_size_, 64);
+    for (BitSet& bit_set : bit_sets_) {
+      bit_set.Resize(bit_set_size_);
+    }
+  }
+  bit_sets_.emplace_back(bit_set_size_);
+  bit_sets_.back().Set(index);
+  indices_[GetKey(instruction)] = index;
+  return index;
+}
+
 std::unique_ptr<HloReachabilityMap> HloReachabilityMap::BuildWithRestrictions(
     const HloComputation* computation,
     absl::FunctionRef<void(const HloInstruction*,
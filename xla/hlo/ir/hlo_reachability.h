@@ -105,9 +105,28 @@ class HloReachabilityMap {
   void SetReachable(Index a, Index b) { bit_sets_[b].Set(a); }
 
   // Updates the given reachability map after the immediate predecessor set
-  // (operands and control predecessors) of 'instruction' has changed.
+  // (operands and control predecessors) of 'instruction' has changed, e.g.
+  // after an edge into 'instruction' was removed. Only 'instruction' and the
+  // instructions whose reachability changes are visited.
   void UpdateReachabilityThroughInstruction(const HloInstruction* instruction);
 
+  // Updates the map after an edge (an operand or a control dependency) from
+  // 'a' to 'b' was added to the graph: everything 'a' is reachable from
+  // becomes reachable to everything reachable from 'b'. Unlike SetReachable,
+  // this keeps a transitive map transitive, at the cost of one union per
+  // instruction reachable from 'b' instead of a rebuild of the map.
+  void AddEdge(const HloInstruction* a, const HloInstruction* b) {
+    AddEdge(GetIndex(a), GetIndex(b));
+  }
+  void AddEdge(Index a, Index b);
+
+  // Adds 'instruction', e.g. one created by a pass after the map was built, to
+  // the map and returns its index. It is reachable only from itself; its
+  // edges are added with SetReachabilityToUnion and AddEdge. The bit-sets
+  // grow geometrically, so adding an instruction takes amortized time linear
+  // in the number of instructions.
+  Index AddInstruction(const HloInstruction* instruction);
+
   // Returns true if "b" is reachable from "a"
   //
   // Note that this function only correctly answers queries about reachability
@@ -138,6 +157,11 @@ class HloReachabilityMap {
   void Replace(const HloInstruction* original,
                const HloInstruction* replacement);
 
+  // As above, but replaces the instruction at 'index'. The original instruction
+  // may already be removed from its computation, in which case it must not be
+  // queried anymore.
+  void Replace(Index index, const HloInstruction* replacement);
+
  private:
   // A dynamically sized bit-set implementation specialized for this use case
   // providing fast bitwise OR (not available in tsl::gtl::BitMap).
@@ -159,6 +183,12 @@ class HloReachabilityMap {
       vector_[index / kBits] |= 1ull << (index % kBits);
     }
 
+    // Resizes the bit-set to `size` bits, keeping the bits that are set.
+    void Resize(size_t size) {
+      size_ = size;
+      vector_.resize((size + kBits - 1) / kBits, 0);
+    }
+
     // Sets this bit-set to union of this bit-set and `other`.
     void operator|=(const BitSet& other) {
       if (this == &other) return;
@@ -211,6 +241,10 @@ class HloReachabilityMap {
   // instruction X includes ones for each instruction which X is reachable from.
   std::vector<BitSet> bit_sets_;
 
+  // The number of bits in each of bit_sets_, which may be more than the number
+  // of bit-sets to leave room for added instructions.
+  size_t bit_set_size_;
+
   // A temporary used by SetReachabilityToUnion to avoid an allocation with each
   // call to the method.
   BitSet tmp_bit_set_;
@@ -471,7 +471,8 @@ AbstractTfrtCpuBuffer::CopyToDeviceAcrossClients(PjRtDevice* dst_device) {
 }
 
 absl::StatusOr<std::unique_ptr<TrackedTfrtCpuDeviceBuffer>>
-AbstractTfrtCpuBuffer::CopyToDeviceHelper(AsyncWorkRunner* async_work_runner) {
+AbstractTfrtCpuBuffer::CopyToDeviceHelper(AsyncWorkRunner* async_work_runner,
+                                          int numa_node) {
   // Copy each leaf buffer to a destination buffer.
   auto usage_event = tsl::MakeConstructedAsyncValueRef<CpuEvent>();
   auto* src_device_buffer = AcquireUsage(usage_event);
@@ -492,7 +493,7 @@ AbstractTfrtCpuBuffer::CopyToDeviceHelper(AsyncWorkRunner* async_work_runner) {
     auto src_buffer = src_device_buffer->Buffers()[i];
     TF_ASSIGN_OR_RETURN(
         std::shared_ptr<MaybeOwningCpuMemory> dst_buffer,
-        MaybeOwningCpuMemory::AllocateShared(src_buffer->size()));
+        MaybeOwningCpuMemory::AllocateShared(src_buffer->size(), numa_node));
     src_buffers.push_back(std::move(src_buffer));
     dst_buffers.push_back(std::move(dst_buffer));
     dst_definition_events.push_back(
@@ -629,12 +630,14 @@ void AbstractTfrtCpuBuffer::CopyFromLiteral(
 /*static*/ absl::StatusOr<std::unique_ptr<TrackedTfrtCpuDeviceBuffer>>
 AbstractTfrtCpuBuffer::AllocateTrackedDeviceBuffer(
     const Shape& on_device_shape,
-    absl::InlinedVector<tsl::AsyncValueRef<CpuEvent>, 4> definition_events) {
+    absl::InlinedVector<tsl::AsyncValueRef<CpuEvent>, 4> definition_events,
+    int numa_node) {
   absl::InlinedVector<std::shared_ptr<MaybeOwningCpuMemory>, 4> buffers;
   if (!on_device_shape.IsTuple()) {
     size_t byte_size = ShapeUtil::ByteSizeOf(on_device_shape);
     TF_ASSIGN_OR_RETURN(std::shared_ptr<MaybeOwningCpuMemory> device_buffer,
-                        MaybeOwningCpuMemory::AllocateShared(byte_size));
+                        MaybeOwningCpuMemory::AllocateShared(byte_size,
+                                                             numa_node));
     buffers.push_back(std::move(device_buffer));
     return std::make_unique<TrackedTfrtCpuDeviceBuffer>(
         /*is_tuple=*/false, std::move(buffers), std::move(definition_events));
@@ -644,7 +647,8 @@ AbstractTfrtCpuBuffer::AllocateTrackedDeviceBuffer(
   for (const auto& leaf_shape : on_device_shape.tuple_shapes()) {
     size_t byte_size = ShapeUtil::ByteSizeOf(leaf_shape);
     TF_ASSIGN_OR_RETURN(std::shared_ptr<MaybeOwningCpuMemory> device_buffer,
-                        MaybeOwningCpuMemory::AllocateShared(byte_size));
+                        MaybeOwningCpuMemory::AllocateShared(byte_size,
+                                                             numa_node));
     buffers.push_back(std::move(device_buffer));
   }
   return std::make_unique<TrackedTfrtCpuDeviceBuffer>(
@@ -673,7 +677,7 @@ AbstractTfrtCpuBuffer::BufferFromHostBufferHelper(
     PjRtClient::HostBufferSemantics host_buffer_semantics,
     absl::AnyInvocable<void() &&> on_done_with_host_buffer, const Shape& shape,
     AsyncWorkRunner* async_work_runner, absl::Mutex* transpose_mu,
-    TransposePlanCache* transpose_cache) {
+    TransposePlanCache* transpose_cache, int numa_node) {
   bool has_default_layout =
       !byte_strides || HasMajorToMinorLayout(type, dims, *byte_strides);
   const int bit_width = primitive_util::BitWidth(type);
@@ -723,7 +727,8 @@ AbstractTfrtCpuBuffer::BufferFromHostBufferHelper(
     size_t dst_byte_size =
         is_packed ? CeilOfRatio<size_t>(byte_size, 8 / bit_width) : byte_size;
     TF_ASSIGN_OR_RETURN(std::shared_ptr<MaybeOwningCpuMemory> device_buffer,
-                        MaybeOwningCpuMemory::AllocateShared(dst_byte_size));
+                        MaybeOwningCpuMemory::AllocateShared(dst_byte_size,
+                                                             numa_node));
     auto dst_data_ptr = device_buffer->data();
     buffers.push_back(device_buffer);
     if (!has_default_layout || is_packed) {
@@ -47,6 +47,7 @@ limitations under the License.
 #include "xla/tsl/concurrency/ref_count.h"
 #include "xla/util.h"
 #include "xla/xla_data.pb.h"
+#include "tsl/platform/numa.h"
 
 namespace xla {
 
@@ -214,12 +215,14 @@ class AbstractTfrtCpuBuffer : public PjRtBuffer {
       AsyncWorkRunner* async_work_runner);
 
   // Allocates a new `TrackedTfrtCpuDeviceBuffer` with the given shape and
-  // definition events.
+  // definition events. The memory is bound to `numa_node` unless it is
+  // tsl::port::kNUMANoAffinity.
   static absl::StatusOr<std::unique_ptr<TrackedTfrtCpuDeviceBuffer>>
   AllocateTrackedDeviceBuffer(
       const Shape& on_device_shape,
       absl::InlinedVector<tsl::AsyncValueRef<runtime::CpuEvent>, 4>
-          definition_events);
+          definition_events,
+      int numa_node = tsl::port::kNUMANoAffinity);
 
   // Allocates new cpu events to `avs` and `definition_events`. If `shape` is a
   // tuple, multiple events will be allocated. Otherwise, `avs` and
@@ -233,7 +236,7 @@ class AbstractTfrtCpuBuffer : public PjRtBuffer {
   // A helper function for PjRtClient::BufferFromHostBuffer. Creates a new cpu
   // device buffer from the host buffer (maybe zero-copy or async).
   // `transpose_mu` and `transpose_cache` are used to transpose the input
-  // layout.
+  // layout. Copies of the host buffer are bound to `numa_node`.
   static absl::StatusOr<std::unique_ptr<TrackedTfrtCpuDeviceBuffer>>
   BufferFromHostBufferHelper(
       const void* data, PrimitiveType type, absl::Span<int64_t const> dims,
@@ -241,7 +244,8 @@ class AbstractTfrtCpuBuffer : public PjRtBuffer {
       PjRtClient::HostBufferSemantics host_buffer_semantics,
       absl::AnyInvocable<void() &&> on_done_with_host_buffer,
       const Shape& shape, AsyncWorkRunner* async_work_runner,
-      absl::Mutex* transpose_mu, TransposePlanCache* transpose_cache);
+      absl::Mutex* transpose_mu, TransposePlanCache* transpose_cache,
+      int numa_node = tsl::port::kNUMANoAffinity);
 
  protected:
   virtual absl::string_view buffer_name() const = 0;
@@ -253,7 +257,8 @@ class AbstractTfrtCpuBuffer : public PjRtBuffer {
       PjRtDevice* dst_device);
 
   absl::StatusOr<std::unique_ptr<TrackedTfrtCpuDeviceBuffer>>
-  CopyToDeviceHelper(AsyncWorkRunner* async_work_runner);
+  CopyToDeviceHelper(AsyncWorkRunner* async_work_runner,
+                     int numa_node = tsl::port::kNUMANoAffinity);
 
   bool IsEmptyTuple() const {
     return on_device_shape_.IsTuple() &&
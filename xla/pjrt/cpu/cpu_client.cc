@@ -32,6 +32,7 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include "absl/algorithm/container.h"
 #include "absl/base/dynamic_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
@@ -42,15 +43,18 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "llvm/TargetParser/Host.h"  // from @llvm-project
 #include "mlir/IR/BuiltinOps.h"  // from @llvm-project
 #include "xla/array.h"
 #include "xla/client/executable_build_options.h"
 #include "xla/client/xla_computation.h"
+#include "xla/cpu_function_runtime.h"
 #include "xla/debug_options_flags.h"
 #include "xla/executable_run_options.h"
 #include "xla/hlo/ir/hlo_computation.h"
@@ -62,6 +66,7 @@ limitations under the License.
 #include "xla/literal_util.h"
 #include "xla/pjrt/compile_options.pb.h"
 #include "xla/pjrt/cpu/abstract_tfrt_cpu_buffer.h"
+#include "xla/pjrt/cpu/temp_arena_pool.h"
 #include "xla/pjrt/cpu/tracked_tfrt_cpu_device_buffer.h"
 #include "xla/pjrt/distributed/topology_util.h"
 #include "xla/pjrt/mlir_to_hlo.h"
@@ -101,9 +106,13 @@ limitations under the License.
 #include "xla/xla_data.pb.h"
 #include "tsl/lib/strings/proto_serialization.h"
 #include "tsl/platform/casts.h"
+#include "tsl/platform/cpu_info.h"
 #include "tsl/platform/denormal.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
+#include "tsl/platform/fingerprint.h"
+#include "tsl/platform/numa.h"
+#include "tsl/platform/path.h"
 #include "tsl/platform/setround.h"
 #include "tsl/platform/statusor.h"
 #include "tsl/platform/threadpool.h"
@@ -123,7 +132,7 @@ absl::StatusOr<std::unique_ptr<TfrtCpuBuffer>> AllocateDestinationBuffer(
   TF_ASSIGN_OR_RETURN(
       std::unique_ptr<TrackedTfrtCpuDeviceBuffer> tracked_device_buffer,
       AbstractTfrtCpuBuffer::AllocateTrackedDeviceBuffer(
-          on_device_shape, std::move(definition_events)));
+          on_device_shape, std::move(definition_events), device->numa_node()));
   return std::make_unique<TfrtCpuBuffer>(
       on_device_shape, std::move(tracked_device_buffer), client, device);
 }
@@ -247,12 +256,17 @@ class TfrtCpuAsyncHostToDeviceTransferManager
 }  // namespace
 
 TfrtCpuDeviceDescription::TfrtCpuDeviceDescription(int id, int process_index,
-                                                   int local_hardware_id)
+                                                   int local_hardware_id,
+                                                   int numa_node)
     : id_(id),
       process_index_(process_index),
-      local_hardware_id_(local_hardware_id) {
+      local_hardware_id_(local_hardware_id),
+      numa_node_(numa_node) {
   debug_string_ = absl::StrCat("TFRT_CPU_", id);
   to_string_ = absl::StrCat("CpuDevice(id=", id, ")");
+  if (numa_node != CpuTopology::kNoNumaNode) {
+    attributes_["numa_node"] = static_cast<int64_t>(numa_node);
+  }
 }
 
 absl::string_view TfrtCpuDeviceDescription::device_kind() const {
@@ -275,8 +289,8 @@ absl::string_view TfrtCpuDeviceDescription::ToString() const {
   std::vector<CpuTopology::CpuDevice> cpu_devices;
   cpu_devices.reserve(devices.size());
   for (auto& device : devices) {
-    cpu_devices.push_back(
-        {device->id(), device->process_index(), device->local_hardware_id()});
+    cpu_devices.push_back({device->id(), device->process_index(),
+                           device->local_hardware_id(), device->numa_node()});
   }
   return TfrtCpuTopologyDescription(platform_id, platform_name,
                                     platform_version, cpu_devices,
@@ -298,8 +312,8 @@ absl::StatusOr<std::string> TfrtCpuTopologyDescription::Serialize() const {
 }
 
 TfrtCpuDevice::TfrtCpuDevice(int id, int process_index, int local_hardware_id,
-                             int max_inflight_computations)
-    : description_(id, process_index, local_hardware_id),
+                             int max_inflight_computations, int numa_node)
+    : description_(id, process_index, local_hardware_id, numa_node),
       max_inflight_computations_semaphore_(
           /*capacity=*/max_inflight_computations) {}
 
@@ -354,20 +368,36 @@ absl::StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(
       absl::Minutes(5), options.kv_store.get(), local_topology,
       &global_topology));
 
+  int num_numa_nodes =
+      options.partition_devices_by_numa_node ? tsl::port::NUMANumNodes() : 1;
+  if (num_numa_nodes > 1) {
+    LOG(INFO) << "Partitioning " << cpu_device_count << " CPU devices across "
+              << num_numa_nodes << " NUMA nodes.";
+  }
+
   std::vector<std::unique_ptr<TfrtCpuDevice>> devices;
   for (const LocalTopologyProto& node : global_topology.nodes()) {
     for (const DeviceProto& device_proto : node.devices()) {
+      // Only the local devices are pinned; the NUMA layout of other processes
+      // is not exchanged.
+      int numa_node = CpuTopology::kNoNumaNode;
+      if (num_numa_nodes > 1 && node.node_id() == options.node_id) {
+        numa_node = device_proto.local_device_ordinal() * num_numa_nodes /
+                    cpu_device_count;
+      }
       auto device = std::make_unique<TfrtCpuDevice>(
           /*id=*/device_proto.global_device_id(), node.node_id(),
           device_proto.local_device_ordinal(),
-          options.max_inflight_computations_per_device);
+          options.max_inflight_computations_per_device, numa_node);
       devices.push_back(std::move(device));
     }
   }
 
   return std::unique_ptr<PjRtClient>(std::make_unique<TfrtCpuClient>(
       /*process_index=*/options.node_id, std::move(devices),
-      std::move(options.collectives), num_threads, options.asynchronous));
+      std::move(options.collectives), num_threads, options.asynchronous,
+      options.compilation_cache_dir,
+      options.max_cached_temp_arenas_per_executable));
 }
 
 static tsl::ThreadOptions GetThreadOptions() {
@@ -381,7 +411,8 @@ static tsl::ThreadOptions GetThreadOptions() {
 TfrtCpuClient::TfrtCpuClient(
     int process_index, std::vector<std::unique_ptr<TfrtCpuDevice>> devices,
     std::shared_ptr<cpu::CollectivesInterface> collectives, size_t num_threads,
-    bool asynchronous)
+    bool asynchronous, std::optional<std::string> compilation_cache_dir,
+    int max_cached_temp_arenas)
     : process_index_(process_index),
       owned_devices_(std::move(devices)),
       computation_placer_(std::make_unique<ComputationPlacer>()),
@@ -402,7 +433,9 @@ TfrtCpuClient::TfrtCpuClient(
       topology_(TfrtCpuTopologyDescription::Create(
           platform_id(), platform_name(), platform_version(), owned_devices_,
           cpu::DetectMachineAttributes())),
-      asynchronous_(asynchronous) {
+      asynchronous_(asynchronous),
+      compilation_cache_dir_(std::move(compilation_cache_dir)),
+      max_cached_temp_arenas_(max_cached_temp_arenas) {
   for (const std::unique_ptr<TfrtCpuDevice>& device : owned_devices_) {
     devices_.push_back(device.get());
     CHECK(id_to_device_.insert({device->id(), device.get()}).second)
@@ -421,11 +454,36 @@ TfrtCpuClient::TfrtCpuClient(
   for (int idx = 0; idx < addressable_devices_.size(); ++idx) {
     CHECK(addressable_devices_[idx] != nullptr) << idx;
   }
+  for (PjRtDevice* device : addressable_devices_) {
+    int numa_node = tensorflow::down_cast<TfrtCpuDevice*>(device)->numa_node();
+    if (numa_node == CpuTopology::kNoNumaNode ||
+        numa_intraop_pools_.contains(numa_node)) {
+      continue;
+    }
+    tsl::ThreadOptions thread_options = GetThreadOptions();
+    thread_options.numa_node = numa_node;
+    NumaIntraOpPool& numa_pool = numa_intraop_pools_[numa_node];
+    numa_pool.pool = std::make_unique<tsl::thread::ThreadPool>(
+        tsl::Env::Default(), thread_options,
+        absl::StrCat("XLAEigenNuma", numa_node),
+        std::max(1, tsl::port::MaxParallelism(numa_node)));
+    numa_pool.device = std::make_unique<Eigen::ThreadPoolDevice>(
+        numa_pool.pool->AsEigenThreadPool(), numa_pool.pool->NumThreads());
+  }
   LOG(INFO) << "TfrtCpuClient created.";
 }
 
 TfrtCpuClient::~TfrtCpuClient() { LOG(INFO) << "TfrtCpuClient destroyed."; }
 
+Eigen::ThreadPoolDevice* TfrtCpuClient::eigen_intraop_device(
+    const TfrtCpuDevice* device) const {
+  auto it = numa_intraop_pools_.find(device->numa_node());
+  if (it != numa_intraop_pools_.end()) {
+    return it->second.device.get();
+  }
+  return eigen_intraop_device_.get();
+}
+
 absl::StatusOr<PjRtDevice*> TfrtCpuClient::LookupDevice(int device_id) const {
   return LookupDevice(PjRtGlobalDeviceId(device_id));
 }
@@ -661,12 +719,85 @@ TfrtCpuClient::DeserializeExecutable(absl::string_view serialized,
   return std::unique_ptr<PjRtLoadedExecutable>(std::move(tfrt_cpu_executable));
 }
 
+// Version of the compilation cache entries. Must be bumped whenever the
+// serialized format or the code generated for a given key changes, so that
+// stale entries are never loaded.
+static constexpr int kCompilationCacheVersion = 2;
+
+// Returns the name of the compilation cache entry for the optimized 'module'.
+// The object code depends on the module itself, on its config (which carries
+// the DebugOptions) and on the target triple and CPU features the JIT
+// generates code for. The module is keyed on its full canonical text rather
+// than HloModule::GetFingerprint128, which leaves out the values of large
+// constants that the object code embeds.
+static absl::StatusOr<std::string> CompilationCacheKey(
+    const HloModule& module) {
+  const std::string module_text =
+      module.ToString(HloPrintOptions::Canonical()
+                          .set_print_large_constants(true)
+                          .set_print_infeed_outfeed_config(true)
+                          .set_print_backend_config(true));
+  TF_ASSIGN_OR_RETURN(HloModuleConfigProto config_proto,
+                      module.config().ToProto());
+  std::string serialized_config;
+  if (!tsl::SerializeToStringDeterministic(config_proto, &serialized_config)) {
+    return Internal("Failed to serialize the HloModuleConfig of %s.",
+                    module.name());
+  }
+  std::string key = absl::StrCat(
+      kCompilationCacheVersion, ";", module_text, ";",
+      llvm::sys::getProcessTriple(), ";",
+      llvm::sys::getHostCPUName().str(), ";",
+      absl::StrJoin(cpu::DetectMachineAttributes(), ","), ";",
+      serialized_config);
+  tsl::Fprint128 fingerprint = tsl::Fingerprint128(key);
+  return absl::StrFormat("%016x%016x.xla_cpu", fingerprint.high64,
+                         fingerprint.low64);
+}
+
+// Loads the executable stored at 'path' into a new JIT. Returns NotFound if
+// there is no such entry.
+static absl::StatusOr<std::unique_ptr<Executable>> LoadFromCompilationCache(
+    cpu::CpuCompiler& compiler, const std::string& path) {
+  tsl::profiler::TraceMe traceme("LoadFromCompilationCache");
+  tsl::Env* env = tsl::Env::Default();
+  TF_RETURN_IF_ERROR(env->FileExists(path));
+  std::string serialized;
+  TF_RETURN_IF_ERROR(tsl::ReadFileToString(env, path, &serialized));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<AotCompilationResult> aot_result,
+                      compiler.LoadAotCompilationResult(serialized));
+  return aot_result->LoadExecutable(&compiler, /*stream_exec=*/nullptr);
+}
+
+// Stores the object code of 'executable' at 'path'. The entry is written to a
+// temporary file first and then renamed, so that concurrent readers never see
+// a partially written entry.
+static absl::Status StoreInCompilationCache(cpu::CpuCompiler& compiler,
+                                            Executable* executable,
+                                            const std::string& dir,
+                                            const std::string& path) {
+  tsl::profiler::TraceMe traceme("StoreInCompilationCache");
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<AotCompilationResult> aot_result,
+                      compiler.Export(executable));
+  TF_ASSIGN_OR_RETURN(std::string serialized, aot_result->SerializeAsString());
+
+  tsl::Env* env = tsl::Env::Default();
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(dir));
+  std::string tmp_path = path;
+  if (!env->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return Internal("Failed to create a temporary file name for %s.", path);
+  }
+  TF_RETURN_IF_ERROR(tsl::WriteStringToFile(env, tmp_path, serialized));
+  return env->RenameFile(tmp_path, path);
+}
+
 static absl::StatusOr<std::unique_ptr<xla::Executable>> JitCompile(
     const XlaComputation& computation,
     const absl::Span<const Shape* const> argument_layouts,
     const ExecutableBuildOptions& build_options,
     const ExecutionOptions& execution_options,
-    const xla::Compiler::CompileOptions& compile_options, int num_threads) {
+    const xla::Compiler::CompileOptions& compile_options, int num_threads,
+    const std::optional<std::string>& compilation_cache_dir) {
   TF_ASSIGN_OR_RETURN(ProgramShape program_shape,
                       computation.GetProgramShape());
   // Unoptimized HloModuleConfig.
@@ -691,9 +822,42 @@ static absl::StatusOr<std::unique_ptr<xla::Executable>> JitCompile(
                                                         /*stream_exec=*/nullptr,
                                                         compile_options));
 
+  // Look the optimized module up in the compilation cache. Executables with
+  // HLO profiling are never cached because the profile printer data is not
+  // part of the serialized entry.
+  std::string cache_path;
+  if (compilation_cache_dir.has_value() &&
+      !hlo_module->config().hlo_profiling_enabled()) {
+    TF_ASSIGN_OR_RETURN(std::string key, CompilationCacheKey(*hlo_module));
+    cache_path = tsl::io::JoinPath(*compilation_cache_dir, key);
+    absl::StatusOr<std::unique_ptr<Executable>> cached =
+        LoadFromCompilationCache(compiler, cache_path);
+    if (cached.ok()) {
+      VLOG(1) << "Compilation cache hit for " << hlo_module->name() << ": "
+              << cache_path;
+      return cached;
+    }
+    if (!absl::IsNotFound(cached.status())) {
+      LOG(WARNING) << "Failed to load compilation cache entry " << cache_path
+                   << ", recompiling: " << cached.status();
+    }
+  }
+
   // Run backend.
-  return compiler.RunBackend(std::move(hlo_module), /*stream_exec=*/nullptr,
-                             compile_options);
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<Executable> executable,
+                      compiler.RunBackend(std::move(hlo_module),
+                                          /*stream_exec=*/nullptr,
+                                          compile_options));
+
+  if (!cache_path.empty()) {
+    absl::Status status = StoreInCompilationCache(
+        compiler, executable.get(), *compilation_cache_dir, cache_path);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to write compilation cache entry " << cache_path
+                   << ": " << status;
+    }
+  }
+  return executable;
 }
 
 absl::StatusOr<std::unique_ptr<PjRtLoadedExecutable>> TfrtCpuClient::Compile(
@@ -782,7 +946,8 @@ absl::StatusOr<std::unique_ptr<PjRtLoadedExecutable>> TfrtCpuClient::Compile(
       std::unique_ptr<Executable> cpu_executable,
       JitCompile(computation, argument_layout_pointers, build_options,
                  execution_options, compile_options,
-                 eigen_intraop_device()->getPool()->NumThreads()));
+                 eigen_intraop_device()->getPool()->NumThreads(),
+                 compilation_cache_dir_));
   auto cpu_executable_ptr =
       tensorflow::down_cast<cpu::CpuExecutable*>(cpu_executable.get());
 
@@ -907,7 +1072,8 @@ absl::StatusOr<std::unique_ptr<PjRtBuffer>> TfrtCpuClient::BufferFromHostBuffer(
       AbstractTfrtCpuBuffer::BufferFromHostBufferHelper(
           data, type, dims, byte_strides, host_buffer_semantics,
           std::move(on_done_with_host_buffer), shape, async_work_runner(),
-          &transpose_mu_, &transpose_cache_));
+          &transpose_mu_, &transpose_cache_,
+          tensorflow::down_cast<TfrtCpuDevice*>(device)->numa_node()));
 
   return std::unique_ptr<PjRtBuffer>(std::make_unique<TfrtCpuBuffer>(
       shape, std::move(tracked_device_buffer), this,
@@ -990,7 +1156,9 @@ absl::StatusOr<std::unique_ptr<PjRtBuffer>> TfrtCpuBuffer::CopyToDevice(
 
   TF_ASSIGN_OR_RETURN(
       std::unique_ptr<TrackedTfrtCpuDeviceBuffer> tracked_device_buffer,
-      CopyToDeviceHelper(client()->async_work_runner()));
+      CopyToDeviceHelper(
+          client()->async_work_runner(),
+          tensorflow::down_cast<TfrtCpuDevice*>(dst_device)->numa_node()));
 
   return std::unique_ptr<PjRtBuffer>(std::make_unique<TfrtCpuBuffer>(
       on_device_shape_, std::move(tracked_device_buffer), client(),
@@ -1028,6 +1196,43 @@ TfrtCpuExecutable::TfrtCpuExecutable(
   // switch time (~5us).
   cheap_computation_ = hlo_cost_analysis->flop_count() < 1000;
 
+  // Lay out all temporary buffers in a single arena. Live-out buffers are
+  // handed to the caller as result buffers and are allocated separately.
+  if (client_->max_cached_temp_arenas_ > 0) {
+    const BufferAssignment& assignment =
+        tensorflow::down_cast<cpu::CpuExecutable*>(cpu_executable_.get())
+            ->buffer_assignment();
+    temp_arena_offsets_.assign(assignment.Allocations().size(), -1);
+    int64_t arena_size = 0;
+    for (const BufferAllocation& allocation : assignment.Allocations()) {
+      if (allocation.is_entry_computation_parameter() ||
+          allocation.is_constant() || allocation.is_thread_local() ||
+          allocation.maybe_live_out() ||
+          allocation.index() == result_buffer_index_ ||
+          absl::c_linear_search(result_buffer_indices_, allocation.index())) {
+        continue;
+      }
+      temp_arena_offsets_[allocation.index()] = arena_size;
+      arena_size += RoundUpTo<int64_t>(allocation.size(),
+                                       cpu_function_runtime::MinAlign());
+    }
+    if (arena_size > 0) {
+      // One pool per NUMA node, so that the temporaries of an execution live
+      // on the node of the device it runs on.
+      for (PjRtDevice* device : client_->addressable_devices()) {
+        int numa_node =
+            tensorflow::down_cast<TfrtCpuDevice*>(device)->numa_node();
+        std::unique_ptr<TempArenaPool>& pool = temp_arena_pools_[numa_node];
+        if (pool == nullptr) {
+          pool = std::make_unique<TempArenaPool>(
+              arena_size, client_->max_cached_temp_arenas_, numa_node);
+        }
+      }
+    } else {
+      temp_arena_offsets_.clear();
+    }
+  }
+
   const auto& computation_layout =
       cpu_executable_->module().entry_computation_layout();
   if (computation_layout.parameter_count() == 0) {
@@ -1062,6 +1267,37 @@ absl::StatusOr<std::optional<std::string>> TfrtCpuExecutable::Fingerprint()
   return std::optional<std::string>();
 }
 
+absl::StatusOr<CompiledMemoryStats> TfrtCpuExecutable::GetCompiledMemoryStats()
+    const {
+  CompiledMemoryStats memory_stats = CompiledMemoryStats();
+  memory_stats.generated_code_size_in_bytes = SizeOfGeneratedCodeInBytes();
+  const HloProto* proto = cpu_executable_->hlo_proto();
+  if (!proto) {
+    return tsl::errors::FailedPrecondition(
+        "cpu_executable_ has no hlo_proto.");
+  }
+  memory_stats.serialized_hlo_proto = proto->SerializeAsString();
+
+  const BufferAssignment& assignment =
+      tensorflow::down_cast<cpu::CpuExecutable*>(cpu_executable_.get())
+          ->buffer_assignment();
+  for (const BufferAllocation& allocation : assignment.Allocations()) {
+    if (allocation.is_entry_computation_parameter()) {
+      memory_stats.argument_size_in_bytes += allocation.size();
+      if (allocation.maybe_live_out()) {
+        memory_stats.alias_size_in_bytes += allocation.size();
+      }
+    }
+    if (allocation.maybe_live_out()) {
+      memory_stats.output_size_in_bytes += allocation.size();
+    }
+    if (allocation.IsPreallocatedTempBuffer()) {
+      memory_stats.temp_size_in_bytes += allocation.size();
+    }
+  }
+  return memory_stats;
+}
+
 Status TfrtCpuExecutable::SetUpDonation(bool tuple_inputs) {
   TF_ASSIGN_OR_RETURN(parameters_that_must_be_donated_,
                       ComputeParametersThatMustBeDonated(
@@ -1074,7 +1310,9 @@ Status TfrtCpuExecutable::SetUpDonation(bool tuple_inputs) {
 static absl::StatusOr<std::shared_ptr<MaybeOwningCpuMemory>>
 MemoryForAllocation(
     const BufferAllocation& allocation,
-    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments) {
+    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments,
+    const std::shared_ptr<TempArena>& temp_arena, int64_t temp_arena_offset,
+    int numa_node) {
   if (allocation.is_entry_computation_parameter()) {
     auto [can_donate, arg] = arguments[allocation.parameter_number()];
     std::shared_ptr<MaybeOwningCpuMemory> out =
@@ -1087,8 +1325,8 @@ MemoryForAllocation(
     // example we might be pointing to a buffer owned by the client whose
     // lifetime will not extend past the lifetime of the donated input buffer.
     if ((!can_donate || !out->owns_data()) && !allocation.is_readonly()) {
-      TF_ASSIGN_OR_RETURN(
-          auto copy, MaybeOwningCpuMemory::AllocateShared(allocation.size()));
+      TF_ASSIGN_OR_RETURN(auto copy, MaybeOwningCpuMemory::AllocateShared(
+                                         allocation.size(), numa_node));
       std::memcpy(copy->data(), out->data(), allocation.size());
       return copy;
     }
@@ -1099,9 +1337,19 @@ MemoryForAllocation(
     return std::make_shared<MaybeOwningCpuMemory>();
   }
 
+  // Temporary buffer carved out of the temp arena. The buffer keeps the arena
+  // alive, so the arena goes back to the pool once the execution that uses it
+  // drops its buffer table.
+  if (temp_arena_offset >= 0) {
+    return std::shared_ptr<MaybeOwningCpuMemory>(
+        new MaybeOwningCpuMemory(temp_arena->data() + temp_arena_offset,
+                                 allocation.size()),
+        [temp_arena](MaybeOwningCpuMemory* buffer) { delete buffer; });
+  }
+
   // Output and temporary buffer.
-  TF_ASSIGN_OR_RETURN(auto out,
-                      MaybeOwningCpuMemory::AllocateShared(allocation.size()));
+  TF_ASSIGN_OR_RETURN(auto out, MaybeOwningCpuMemory::AllocateShared(
+                                     allocation.size(), numa_node));
 
   // Since the output buffer and all the temporary buffers were written into
   // by the JITed code, msan has no way of knowing their memory was
@@ -1114,13 +1362,18 @@ MemoryForAllocation(
 static absl::StatusOr<std::vector<std::shared_ptr<MaybeOwningCpuMemory>>>
 CreateBufferTable(
     const BufferAssignment& assignment,
-    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments) {
+    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments,
+    const std::shared_ptr<TempArena>& temp_arena,
+    absl::Span<const int64_t> temp_arena_offsets, int numa_node) {
   std::vector<std::shared_ptr<MaybeOwningCpuMemory>> buffers(
       assignment.Allocations().size());
   for (BufferAllocation::Index i = 0; i < assignment.Allocations().size();
        ++i) {
     const BufferAllocation& allocation = assignment.GetAllocation(i);
-    TF_ASSIGN_OR_RETURN(buffers[i], MemoryForAllocation(allocation, arguments));
+    int64_t temp_arena_offset = temp_arena ? temp_arena_offsets[i] : -1;
+    TF_ASSIGN_OR_RETURN(buffers[i],
+                        MemoryForAllocation(allocation, arguments, temp_arena,
+                                            temp_arena_offset, numa_node));
   }
   return std::move(buffers);
 }
@@ -1303,9 +1556,16 @@ absl::StatusOr<PjRtLoadedExecutable::Result> TfrtCpuExecutable::ExecuteHelper(
 
   auto* cpu_executable =
       tensorflow::down_cast<cpu::CpuExecutable*>(cpu_executable_.get());
+  std::shared_ptr<TempArena> temp_arena;
+  if (auto it = temp_arena_pools_.find(device->numa_node());
+      it != temp_arena_pools_.end()) {
+    TF_ASSIGN_OR_RETURN(temp_arena, it->second->Acquire());
+  }
   TF_ASSIGN_OR_RETURN(
       std::vector<std::shared_ptr<MaybeOwningCpuMemory>> buffer_table,
-      CreateBufferTable(cpu_executable->buffer_assignment(), tracked_buffers));
+      CreateBufferTable(cpu_executable->buffer_assignment(), tracked_buffers,
+                        temp_arena, temp_arena_offsets_, device->numa_node()));
+  temp_arena.reset();
   auto result_buffers =
       CreateResultShapedBuffer(result_buffer_indices_, buffer_table);
 
@@ -1330,7 +1590,7 @@ absl::StatusOr<PjRtLoadedExecutable::Result> TfrtCpuExecutable::ExecuteHelper(
   run_options.set_device_ordinal(device->id());
   // Need to keep device_assignment alive until execution completes.
   run_options.set_device_assignment(device_assignment.get());
-  run_options.set_intra_op_thread_pool(client_->eigen_intraop_device());
+  run_options.set_intra_op_thread_pool(client_->eigen_intraop_device(device));
 
   auto cpu_run_options = std::make_shared<cpu::CpuExecutableRunOptions>();
   cpu_run_options->set_collectives(client_->collectives_.get());
@@ -1363,9 +1623,9 @@ absl::StatusOr<PjRtLoadedExecutable::Result> TfrtCpuExecutable::ExecuteHelper(
     XlaCustomCallStatus status;
 
     // Call generated function.
-    cpu_executable->compute_function()(result_buffer, &run_options, nullptr,
-                                       buffer_pointers.data(), &status,
-                                       nullptr);
+    cpu_executable->CallComputeFunction(result_buffer, &run_options,
+                                        buffer_pointers.data(), &status,
+                                        nullptr);
 
     for (auto& donation_transaction : donation_transactions) {
       std::move(donation_transaction).Commit();
@@ -1430,9 +1690,9 @@ absl::StatusOr<PjRtLoadedExecutable::Result> TfrtCpuExecutable::ExecuteHelper(
           // Call generated function.
           std::optional<absl::string_view> error_message;
           XlaCustomCallStatus status;
-          cpu_executable->compute_function()(result_buffer, &run_options,
-                                             nullptr, buffer_pointers.data(),
-                                             &status, nullptr);
+          cpu_executable->CallComputeFunction(result_buffer, &run_options,
+                                              buffer_pointers.data(), &status,
+                                              nullptr);
           error_message = xla::CustomCallStatusGetMessage(&status);
 
           if (error_message) {
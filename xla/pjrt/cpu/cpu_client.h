@@ -42,6 +42,7 @@ limitations under the License.
 #include "xla/literal.h"
 #include "xla/pjrt/cpu/abstract_tfrt_cpu_buffer.h"
 #include "xla/pjrt/cpu/cpu_topology.h"
+#include "xla/pjrt/cpu/temp_arena_pool.h"
 #include "xla/pjrt/cpu/tracked_tfrt_cpu_device_buffer.h"
 #include "xla/pjrt/distributed/key_value_store_interface.h"
 #include "xla/pjrt/pjrt_client.h"
@@ -75,7 +76,8 @@ class TfrtCpuDevice;  // forward declare
 
 class TfrtCpuDeviceDescription final : public PjRtDeviceDescription {
  public:
-  TfrtCpuDeviceDescription(int id, int process_index, int local_hardware_id);
+  TfrtCpuDeviceDescription(int id, int process_index, int local_hardware_id,
+                           int numa_node = CpuTopology::kNoNumaNode);
 
   int id() const override { return id_; }
 
@@ -83,6 +85,10 @@ class TfrtCpuDeviceDescription final : public PjRtDeviceDescription {
 
   int local_hardware_id() const { return local_hardware_id_; }
 
+  // NUMA node the device is pinned to, or CpuTopology::kNoNumaNode. Pinned
+  // devices also report it as the "numa_node" attribute.
+  int numa_node() const { return numa_node_; }
+
   absl::string_view device_kind() const override;
 
   absl::string_view DebugString() const override;
@@ -98,6 +104,7 @@ class TfrtCpuDeviceDescription final : public PjRtDeviceDescription {
   int id_;
   int process_index_;
   int local_hardware_id_;
+  int numa_node_;
   std::string debug_string_;
   std::string to_string_;
   absl::flat_hash_map<std::string, PjRtDeviceAttribute> attributes_ = {};
@@ -146,7 +153,8 @@ class TfrtCpuTopologyDescription : public PjRtTopologyDescription {
     devices.reserve(cpu_topology_.number_of_devices());
     for (const CpuTopology::CpuDevice& device : cpu_topology_.devices()) {
       devices.push_back(std::make_unique<TfrtCpuDeviceDescription>(
-          device.id, device.process_index, device.local_hardware_id));
+          device.id, device.process_index, device.local_hardware_id,
+          device.numa_node));
     }
     return devices;
   }
@@ -200,7 +208,8 @@ class TfrtCpuTopologyDescription : public PjRtTopologyDescription {
 class TfrtCpuDevice final : public PjRtDevice {
  public:
   explicit TfrtCpuDevice(int id, int process_index, int local_hardware_id,
-                         int max_inflight_computations = 32);
+                         int max_inflight_computations = 32,
+                         int numa_node = CpuTopology::kNoNumaNode);
 
   const TfrtCpuDeviceDescription& description() const override {
     return description_;
@@ -229,6 +238,11 @@ class TfrtCpuDevice final : public PjRtDevice {
     return PjRtLocalHardwareId(description_.local_hardware_id());
   }
 
+  // NUMA node whose cores run the computations of this device and whose
+  // memory holds its buffers, or CpuTopology::kNoNumaNode if the device is not
+  // pinned.
+  int numa_node() const { return description_.numa_node(); }
+
   Status TransferToInfeed(const LiteralSlice& literal) override;
 
   Status TransferFromOutfeed(MutableBorrowingLiteral literal) override;
@@ -262,7 +276,9 @@ class TfrtCpuClient final : public PjRtClient {
   TfrtCpuClient(int process_index,
                 std::vector<std::unique_ptr<TfrtCpuDevice>> devices,
                 std::shared_ptr<cpu::CollectivesInterface> collectives,
-                size_t num_threads, bool asynchronous);
+                size_t num_threads, bool asynchronous,
+                std::optional<std::string> compilation_cache_dir,
+                int max_cached_temp_arenas);
   ~TfrtCpuClient() override;
 
   int process_index() const override { return process_index_; }
@@ -397,6 +413,12 @@ class TfrtCpuClient final : public PjRtClient {
     return eigen_intraop_device_.get();
   }
 
+  // Returns the intra-op thread pool for computations on `device`: the pool
+  // pinned to the NUMA node of the device, or the client-wide pool if the
+  // device is not pinned.
+  Eigen::ThreadPoolDevice* eigen_intraop_device(
+      const TfrtCpuDevice* device) const;
+
   tsl::AsyncValueRef<runtime::CpuEvent> GetLastCollectiveLaunchEvent() {
     absl::MutexLock lock(&mu_);
     return last_collective_launch_event_.CopyRef();
@@ -435,6 +457,14 @@ class TfrtCpuClient final : public PjRtClient {
   std::unique_ptr<tsl::thread::ThreadPool> eigen_intraop_pool_;
   std::unique_ptr<Eigen::ThreadPoolDevice> eigen_intraop_device_;
 
+  // Intra-op thread pools whose threads are pinned to one NUMA node, keyed by
+  // the node. Shared by the addressable devices pinned to that node.
+  struct NumaIntraOpPool {
+    std::unique_ptr<tsl::thread::ThreadPool> pool;
+    std::unique_ptr<Eigen::ThreadPoolDevice> device;
+  };
+  absl::flat_hash_map<int, NumaIntraOpPool> numa_intraop_pools_;
+
   // Launching collectives are prone to deadlock when we use fixed-sized
   // threadpools since ExecuteHelper will block until all replicas reach the
   // barrier. We ensure that
@@ -462,6 +492,12 @@ class TfrtCpuClient final : public PjRtClient {
   // Used to control whether asynchronous computation dispatch is available for
   // this client. Only applies to non-parallel computations.
   bool asynchronous_;
+
+  // Directory of the persistent compilation cache, if enabled.
+  std::optional<std::string> compilation_cache_dir_;
+
+  // Maximum number of temp arenas each executable keeps for reuse.
+  int max_cached_temp_arenas_;
 };
 
 class TfrtCpuBuffer final : public AbstractTfrtCpuBuffer {
@@ -548,17 +584,9 @@ class TfrtCpuExecutable final : public PjRtLoadedExecutable {
     return Unimplemented("GetOutputMemoryKinds is not supported.");
   }
 
-  absl::StatusOr<CompiledMemoryStats> GetCompiledMemoryStats() const override {
-    CompiledMemoryStats memory_stats = CompiledMemoryStats();
-    memory_stats.generated_code_size_in_bytes = SizeOfGeneratedCodeInBytes();
-    const HloProto* proto = cpu_executable_->hlo_proto();
-    if (!proto) {
-      return tsl::errors::FailedPrecondition(
-          "cpu_executable_ has no hlo_proto.");
-    }
-    memory_stats.serialized_hlo_proto = proto->SerializeAsString();
-    return memory_stats;
-  }
+  // The temp size is the peak memory of the temporary buffers, as achieved by
+  // the schedule and rematerialization of the executable.
+  absl::StatusOr<CompiledMemoryStats> GetCompiledMemoryStats() const override;
 
   using PjRtLoadedExecutable::Execute;
   absl::StatusOr<std::vector<std::vector<std::unique_ptr<PjRtBuffer>>>> Execute(
@@ -657,6 +685,16 @@ class TfrtCpuExecutable final : public PjRtLoadedExecutable {
   // Cached result of comparing HloCostAnalysis FLOP estimate for execute
   // critical path.
   bool cheap_computation_;
+
+  // Offset of each temporary buffer allocation in the temp arena, or -1 for
+  // allocations that are not carved out of the arena (parameters, constants,
+  // thread-local and live-out buffers). Indexed by allocation index.
+  std::vector<int64_t> temp_arena_offsets_;
+
+  // Pools of arenas backing the temporary buffers, reused across executions,
+  // keyed by the NUMA node of the devices. Empty if the executable has no
+  // temporary buffers or arena reuse is disabled.
+  absl::flat_hash_map<int, std::unique_ptr<TempArenaPool>> temp_arena_pools_;
 };
 
 struct CpuClientOptions {
@@ -686,6 +724,29 @@ struct CpuClientOptions {
   // Distributed collectives implementation. Optional. If not provided, an
   // in-process collectives implementation will be used.
   std::shared_ptr<cpu::CollectivesInterface> collectives;
+
+  // Directory of a persistent cache for compiled executables. If set, the
+  // object code of every compiled executable is stored there, keyed by the
+  // fingerprint of the optimized HLO module, its config (including the
+  // DebugOptions) and the host target triple and CPU features. Later
+  // compilations of the same module, also from other processes, load the
+  // object code from the cache instead of running the LLVM pipeline again.
+  std::optional<std::string> compilation_cache_dir = std::nullopt;
+
+  // Maximum number of temp arenas cached per executable. All temporary
+  // buffers of an execution are carved out of one arena that is returned to
+  // the executable's pool afterwards, so that back-to-back executions skip
+  // the allocator. Concurrent executions beyond this bound allocate arenas
+  // that are freed on completion. 0 disables arena reuse.
+  int max_cached_temp_arenas_per_executable = 4;
+
+  // If true and the host has more than one NUMA node, the local devices are
+  // partitioned into contiguous blocks, one per NUMA node. Computations of a
+  // device run on an intra-op thread pool pinned to its node, and its buffers
+  // are allocated from the node's memory. The assignment is reported by the
+  // topology description. Has no effect on single-node hosts or builds
+  // without NUMA support.
+  bool partition_devices_by_numa_node = false;
 };
 absl::StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(
     const CpuClientOptions& options);
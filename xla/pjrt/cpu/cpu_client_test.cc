@@ -26,6 +26,8 @@ limitations under the License.
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "absl/synchronization/notification.h"
 #include "xla/literal.h"
 #include "xla/literal_util.h"
@@ -41,6 +43,8 @@ limitations under the License.
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/file_system.h"
+#include "tsl/platform/numa.h"
+#include "tsl/platform/path.h"
 #include "tsl/platform/status_matchers.h"
 #include "tsl/platform/statusor.h"
 #include "tsl/platform/test.h"
@@ -166,6 +170,294 @@ TEST(TfrtCpuClientTest, HloSnapshot) {
       LiteralUtil::CreateR2<float>({{11.0, 22.0}, {33.0, 44.0}, {55.0, 66.0}}));
 }
 
+TEST(TfrtCpuClientTest, CompilationCache) {
+  constexpr char kProgram[] = R"(
+    HloModule add
+    ENTRY add {
+      x = f32[3,2] parameter(0)
+      y = f32[3,2] parameter(1)
+      ROOT add = f32[3,2] add(x, y)
+    })";
+
+  std::string dir =
+      tsl::io::JoinPath(tsl::testing::TmpDir(), "compilation_cache");
+  CpuClientOptions cpu_options;
+  cpu_options.cpu_device_count = 1;
+  cpu_options.compilation_cache_dir = dir;
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module,
+                          ParseAndReturnUnverifiedModule(kProgram, {}));
+  XlaComputation xla_computation(hlo_module->ToProto());
+
+  // The first client populates the cache, the second one loads from it.
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(cpu_options));
+    TF_ASSERT_OK_AND_ASSIGN(auto pjrt_executable,
+                            client->Compile(xla_computation, {}));
+
+    std::vector<std::string> entries;
+    TF_ASSERT_OK(tsl::Env::Default()->GetChildren(dir, &entries));
+    EXPECT_EQ(entries.size(), 1);
+
+    std::vector<float> data1{1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+    std::vector<float> data2{10.0, 20.0, 30.0, 40.0, 50.0, 60.0};
+    Shape shape = ShapeUtil::MakeShape(F32, {3, 2});
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto buffer1,
+        client->BufferFromHostBuffer(
+            data1.data(), shape.element_type(), shape.dimensions(),
+            /*byte_strides=*/std::nullopt,
+            PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall,
+            nullptr, client->addressable_devices()[0]));
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto buffer2,
+        client->BufferFromHostBuffer(
+            data2.data(), shape.element_type(), shape.dimensions(),
+            /*byte_strides=*/std::nullopt,
+            PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall,
+            nullptr, client->addressable_devices()[0]));
+
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto result,
+        pjrt_executable->Execute(
+            /*argument_handles=*/{{buffer1.get(), buffer2.get()}},
+            /*options=*/{}));
+    TF_ASSERT_OK_AND_ASSIGN(auto literal, result[0][0]->ToLiteralSync());
+    EXPECT_EQ(*literal, LiteralUtil::CreateR2<float>(
+                            {{11.0, 22.0}, {33.0, 44.0}, {55.0, 66.0}}));
+  }
+}
+
+TEST(TfrtCpuClientTest, CompilationCacheKeysOnConstants) {
+  // The two programs only differ in the values of a large constant, which the
+  // object code embeds.
+  auto make_program = [](float value) {
+    std::vector<float> values(16, value);
+    return absl::StrFormat(R"(
+    HloModule add_constant
+    ENTRY add_constant {
+      x = f32[16] parameter(0)
+      c = f32[16] constant({%s})
+      ROOT add = f32[16] add(x, c)
+    })",
+                           absl::StrJoin(values, ","));
+  };
+
+  std::string dir = tsl::io::JoinPath(tsl::testing::TmpDir(),
+                                      "compilation_cache_constants");
+  CpuClientOptions cpu_options;
+  cpu_options.cpu_device_count = 1;
+  cpu_options.compilation_cache_dir = dir;
+  TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(cpu_options));
+  std::vector<float> data(16, 1.0);
+  Shape shape = ShapeUtil::MakeShape(F32, {16});
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto buffer,
+      client->BufferFromHostBuffer(
+          data.data(), shape.element_type(), shape.dimensions(),
+          /*byte_strides=*/std::nullopt,
+          PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, nullptr,
+          client->addressable_devices()[0]));
+
+  for (float value : {2.0f, 3.0f}) {
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto hlo_module,
+        ParseAndReturnUnverifiedModule(make_program(value), {}));
+    XlaComputation xla_computation(hlo_module->ToProto());
+    TF_ASSERT_OK_AND_ASSIGN(auto pjrt_executable,
+                            client->Compile(xla_computation, {}));
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto result,
+        pjrt_executable->Execute(/*argument_handles=*/{{buffer.get()}},
+                                 /*options=*/{}));
+    TF_ASSERT_OK_AND_ASSIGN(auto literal, result[0][0]->ToLiteralSync());
+    EXPECT_EQ(*literal, LiteralUtil::CreateR1<float>(
+                            std::vector<float>(16, 1.0f + value)));
+  }
+
+  std::vector<std::string> entries;
+  TF_ASSERT_OK(tsl::Env::Default()->GetChildren(dir, &entries));
+  EXPECT_EQ(entries.size(), 2);
+}
+
+TEST(TfrtCpuClientTest, TempArenaReuseWithConcurrentExecutions) {
+  // `dot.0` is a temporary buffer that lives in the executable's temp arena.
+  constexpr char kProgram[] = R"(
+    HloModule dots
+    ENTRY dots {
+      x = f32[2,2] parameter(0)
+      y = f32[2,2] parameter(1)
+      dot.0 = f32[2,2] dot(x, y), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+      ROOT dot.1 = f32[2,2] dot(dot.0, y), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+    })";
+
+  CpuClientOptions cpu_options;
+  cpu_options.cpu_device_count = 1;
+  cpu_options.max_cached_temp_arenas_per_executable = 2;
+  TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(cpu_options));
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module,
+                          ParseAndReturnUnverifiedModule(kProgram, {}));
+  XlaComputation xla_computation(hlo_module->ToProto());
+  TF_ASSERT_OK_AND_ASSIGN(auto pjrt_executable,
+                          client->Compile(xla_computation, {}));
+
+  Shape shape = ShapeUtil::MakeShape(F32, {2, 2});
+  std::vector<float> x{1.0, 2.0, 3.0, 4.0};
+  std::vector<float> y{1.0, 1.0, 0.0, 1.0};
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto x_buffer,
+      client->BufferFromHostBuffer(
+          x.data(), shape.element_type(), shape.dimensions(),
+          /*byte_strides=*/std::nullopt,
+          PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, nullptr,
+          client->addressable_devices()[0]));
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto y_buffer,
+      client->BufferFromHostBuffer(
+          y.data(), shape.element_type(), shape.dimensions(),
+          /*byte_strides=*/std::nullopt,
+          PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, nullptr,
+          client->addressable_devices()[0]));
+
+  // Keep more executions in flight than there are cached arenas.
+  ExecuteOptions options;
+  options.execution_mode = ExecuteOptions::ExecutionMode::kAsynchronous;
+  std::vector<std::unique_ptr<PjRtBuffer>> results;
+  for (int i = 0; i < 8; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto result,
+        pjrt_executable->Execute({{x_buffer.get(), y_buffer.get()}}, options));
+    results.push_back(std::move(result[0][0]));
+  }
+  for (const auto& result : results) {
+    TF_ASSERT_OK_AND_ASSIGN(auto literal, result->ToLiteralSync());
+    EXPECT_EQ(*literal,
+              LiteralUtil::CreateR2<float>({{1.0, 4.0}, {3.0, 10.0}}));
+  }
+}
+
+TEST(TfrtCpuClientTest, CompiledMemoryStats) {
+  // `dot.0` is the only temporary buffer, and `dot.1` is the output.
+  constexpr char kProgram[] = R"(
+    HloModule dots
+    ENTRY dots {
+      x = f32[64,64] parameter(0)
+      dot.0 = f32[64,64] dot(x, x), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+      ROOT dot.1 = f32[64,64] dot(dot.0, x), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+    })";
+
+  CpuClientOptions cpu_options;
+  cpu_options.cpu_device_count = 1;
+  TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(cpu_options));
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module,
+                          ParseAndReturnUnverifiedModule(kProgram, {}));
+  XlaComputation xla_computation(hlo_module->ToProto());
+  TF_ASSERT_OK_AND_ASSIGN(auto executable,
+                          client->Compile(xla_computation, {}));
+  TF_ASSERT_OK_AND_ASSIGN(CompiledMemoryStats stats,
+                          executable->GetCompiledMemoryStats());
+  EXPECT_EQ(stats.argument_size_in_bytes, 64 * 64 * sizeof(float));
+  EXPECT_EQ(stats.output_size_in_bytes, 64 * 64 * sizeof(float));
+  EXPECT_EQ(stats.alias_size_in_bytes, 0);
+  EXPECT_EQ(stats.temp_size_in_bytes, 64 * 64 * sizeof(float));
+}
+
+TEST(TfrtCpuClientTest, CompiledMemoryStatsWithMemoryLimit) {
+  // `exp` is used by the root only, so rematerializing it right before the
+  // root shortens its live range past the large `dot`.
+  constexpr char kProgram[] = R"(
+    HloModule remat
+    ENTRY remat {
+      x = f32[64,64] parameter(0)
+      exp = f32[64,64] exponential(x)
+      dot = f32[64,64] dot(x, x), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+      neg = f32[64,64] negate(dot)
+      ROOT add = f32[64,64] add(neg, exp)
+    })";
+
+  CpuClientOptions cpu_options;
+  cpu_options.cpu_device_count = 1;
+  TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(cpu_options));
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module,
+                          ParseAndReturnUnverifiedModule(kProgram, {}));
+  XlaComputation xla_computation(hlo_module->ToProto());
+
+  TF_ASSERT_OK_AND_ASSIGN(auto executable,
+                          client->Compile(xla_computation, {}));
+  TF_ASSERT_OK_AND_ASSIGN(CompiledMemoryStats stats,
+                          executable->GetCompiledMemoryStats());
+  EXPECT_EQ(stats.argument_size_in_bytes, 64 * 64 * sizeof(float));
+  EXPECT_GE(stats.output_size_in_bytes, 64 * 64 * sizeof(float));
+  EXPECT_GT(stats.temp_size_in_bytes, 0);
+
+  CompileOptions options;
+  options.executable_build_options.mutable_debug_options()
+      ->set_xla_cpu_memory_limit_bytes(1);
+  TF_ASSERT_OK_AND_ASSIGN(auto limited_executable,
+                          client->Compile(xla_computation, options));
+  TF_ASSERT_OK_AND_ASSIGN(CompiledMemoryStats limited_stats,
+                          limited_executable->GetCompiledMemoryStats());
+  EXPECT_EQ(limited_stats.argument_size_in_bytes,
+            stats.argument_size_in_bytes);
+  EXPECT_GT(limited_stats.temp_size_in_bytes, 0);
+  EXPECT_LE(limited_stats.temp_size_in_bytes, stats.temp_size_in_bytes);
+}
+
+TEST(TfrtCpuClientTest, PartitionDevicesByNumaNode) {
+  constexpr char kProgram[] = R"(
+    HloModule negate
+    ENTRY negate {
+      x = f32[4] parameter(0)
+      ROOT negate = f32[4] negate(x)
+    })";
+
+  constexpr int kNumDevices = 4;
+  CpuClientOptions cpu_options;
+  cpu_options.cpu_device_count = kNumDevices;
+  cpu_options.partition_devices_by_numa_node = true;
+  TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(cpu_options));
+
+  // On single-node hosts the devices are not pinned.
+  const int num_numa_nodes = tsl::port::NUMANumNodes();
+  TF_ASSERT_OK_AND_ASSIGN(const PjRtTopologyDescription* topology,
+                          client->GetTopologyDescription());
+  const CpuTopology& cpu_topology =
+      static_cast<const TfrtCpuTopologyDescription*>(topology)->cpu_topology();
+  ASSERT_EQ(cpu_topology.number_of_devices(), kNumDevices);
+  for (int i = 0; i < kNumDevices; ++i) {
+    int expected_numa_node = num_numa_nodes > 1
+                                 ? i * num_numa_nodes / kNumDevices
+                                 : CpuTopology::kNoNumaNode;
+    auto* device =
+        static_cast<TfrtCpuDevice*>(client->addressable_devices()[i]);
+    EXPECT_EQ(device->numa_node(), expected_numa_node);
+    EXPECT_EQ(cpu_topology.devices()[i].numa_node, expected_numa_node);
+    EXPECT_EQ(device->description().Attributes().contains("numa_node"),
+              num_numa_nodes > 1);
+  }
+
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module,
+                          ParseAndReturnUnverifiedModule(kProgram, {}));
+  XlaComputation xla_computation(hlo_module->ToProto());
+  TF_ASSERT_OK_AND_ASSIGN(auto pjrt_executable,
+                          client->Compile(xla_computation, {}));
+
+  std::vector<float> x{1.0, 2.0, 3.0, 4.0};
+  Shape shape = ShapeUtil::MakeShape(F32, {4});
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto x_buffer,
+      client->BufferFromHostBuffer(
+          x.data(), shape.element_type(), shape.dimensions(),
+          /*byte_strides=*/std::nullopt,
+          PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, nullptr,
+          client->addressable_devices()[0]));
+  TF_ASSERT_OK_AND_ASSIGN(auto result,
+                          pjrt_executable->Execute({{x_buffer.get()}}, {}));
+  PjRtDevice* last_device = client->addressable_devices()[kNumDevices - 1];
+  TF_ASSERT_OK_AND_ASSIGN(auto copy, result[0][0]->CopyToDevice(last_device));
+  TF_ASSERT_OK_AND_ASSIGN(auto literal, copy->ToLiteralSync());
+  EXPECT_EQ(*literal, LiteralUtil::CreateR1<float>({-1.0, -2.0, -3.0, -4.0}));
+}
+
 TEST(TfrtCpuClientTest, AsyncTransferRawData) {
   TF_ASSERT_OK_AND_ASSIGN(auto client, GetTfrtCpuClient(CpuClientOptions()));
   xla::Shape shape = ShapeUtil::MakeShape(U32, {3, 2});
@@ -31,7 +31,10 @@ std::unique_ptr<const CpuTopology> CpuTopology::FromProto(
   for (size_t i = 0; i < cpu_topology_proto.cpu_devices_size(); ++i) {
     auto& cpu_device_proto = cpu_topology_proto.cpu_devices(i);
     devices.push_back({cpu_device_proto.id(), cpu_device_proto.process_index(),
-                       cpu_device_proto.local_hardware_id()});
+                       cpu_device_proto.local_hardware_id(),
+                       cpu_device_proto.has_numa_node()
+                           ? cpu_device_proto.numa_node()
+                           : kNoNumaNode});
   }
 
   std::vector<std::string> machine_attributes;
@@ -51,6 +54,9 @@ CpuTopologyProto CpuTopology::ToProto() const {
     cpu_device_proto->set_id(cpu_device.id);
     cpu_device_proto->set_process_index(cpu_device.process_index);
     cpu_device_proto->set_local_hardware_id(cpu_device.local_hardware_id);
+    if (cpu_device.numa_node != kNoNumaNode) {
+      cpu_device_proto->set_numa_node(cpu_device.numa_node);
+    }
   }
   for (const std::string& machine_attribute : machine_attributes_) {
     proto.add_machine_attributes(machine_attribute);
@@ -27,14 +27,21 @@ limitations under the License.
 namespace xla {
 class CpuTopology {
  public:
+  // Same value as tsl::port::kNUMANoAffinity.
+  static constexpr int kNoNumaNode = -1;
+
   struct CpuDevice {
     int id;
     int process_index;
     int local_hardware_id;
+    // NUMA node whose cores run the device's computations and whose memory
+    // holds its buffers, or kNoNumaNode if the device is not pinned.
+    int numa_node = kNoNumaNode;
 
     bool operator==(const CpuDevice& other) const {
       return id == other.id && process_index == other.process_index &&
-             local_hardware_id == other.local_hardware_id;
+             local_hardware_id == other.local_hardware_id &&
+             numa_node == other.numa_node;
     }
   };
 
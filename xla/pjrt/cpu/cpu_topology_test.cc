@@ -38,6 +38,7 @@ TEST(CpuTopology, FromProto) {
   EXPECT_EQ(cpu_topology->devices()[0].id, 1);
   EXPECT_EQ(cpu_topology->devices()[0].process_index, 2);
   EXPECT_EQ(cpu_topology->devices()[0].local_hardware_id, 3);
+  EXPECT_EQ(cpu_topology->devices()[0].numa_node, CpuTopology::kNoNumaNode);
   EXPECT_EQ(cpu_topology->machine_attributes().size(), 2);
   EXPECT_EQ(cpu_topology->machine_attributes()[0], "x86_64");
   EXPECT_EQ(cpu_topology->machine_attributes()[1], "Intel");
@@ -50,10 +51,24 @@ TEST(CpuTopology, ToProto) {
   EXPECT_EQ(msg.cpu_devices(0).id(), 1);
   EXPECT_EQ(msg.cpu_devices(0).process_index(), 2);
   EXPECT_EQ(msg.cpu_devices(0).local_hardware_id(), 3);
+  EXPECT_FALSE(msg.cpu_devices(0).has_numa_node());
   EXPECT_EQ(msg.machine_attributes_size(), 2);
   EXPECT_EQ(msg.machine_attributes(0), "ab");
   EXPECT_EQ(msg.machine_attributes(1), "cd");
 }
 
+TEST(CpuTopology, NumaNodeRoundTrip) {
+  CpuTopology cpu_topology({{0, 0, 0, /*numa_node=*/0}, {1, 0, 1, 1}}, {});
+  CpuTopologyProto msg = cpu_topology.ToProto();
+  ASSERT_EQ(msg.cpu_devices_size(), 2);
+  EXPECT_TRUE(msg.cpu_devices(0).has_numa_node());
+  EXPECT_EQ(msg.cpu_devices(0).numa_node(), 0);
+  EXPECT_EQ(msg.cpu_devices(1).numa_node(), 1);
+
+  std::unique_ptr<const CpuTopology> round_trip = CpuTopology::FromProto(msg);
+  EXPECT_EQ(round_trip->devices()[0], cpu_topology.devices()[0]);
+  EXPECT_EQ(round_trip->devices()[1], cpu_topology.devices()[1]);
+}
+
 }  // namespace
 }  // namespace xla
@@ -31,6 +31,7 @@ limitations under the License.
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -38,6 +39,7 @@ limitations under the License.
 #include "gloo/algorithm.h"  // from @gloo
 #include "gloo/allgather.h"  // from @gloo
 #include "gloo/allreduce.h"  // from @gloo
+#include "gloo/allreduce_halving_doubling.h"  // from @gloo
 #include "gloo/context.h"  // from @gloo
 #include "gloo/math.h"  // from @gloo
 #include "gloo/reduce_scatter.h"  // from @gloo
@@ -47,6 +49,7 @@ limitations under the License.
 #include "gloo/transport/device.h"  // from @gloo
 #include "gloo/transport/unbound_buffer.h"  // from @gloo
 #include "gloo/types.h"  // from @gloo
+#include "xla/pjrt/metrics.h"
 #include "xla/primitive_util.h"
 #include "xla/service/collective_ops_utils.h"
 #include "xla/service/cpu/collectives_interface.h"
@@ -56,14 +59,73 @@ limitations under the License.
 #include "xla/xla_data.pb.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/logging.h"
+#include "tsl/platform/statusor.h"
 
 namespace xla::cpu {
 
 GlooCollectivesCommunicator::GlooCollectivesCommunicator(
-    std::shared_ptr<gloo::Context> context)
-    : context_(std::move(context)) {}
+    std::shared_ptr<gloo::Context> context, GlooCollectivesOptions options)
+    : context_(std::move(context)), options_(options) {}
 GlooCollectivesCommunicator::~GlooCollectivesCommunicator() = default;
 
+namespace {
+
+// Reports the number of bytes and the time spent in a collective to the CPU
+// collective metrics when it goes out of scope.
+class ScopedCollectiveMetrics {
+ public:
+  ScopedCollectiveMetrics(absl::string_view op, size_t num_bytes)
+      : op_(op), num_bytes_(num_bytes), start_(absl::Now()) {}
+  ~ScopedCollectiveMetrics() {
+    metrics::RecordCpuCollective(
+        op_, num_bytes_, absl::ToInt64Microseconds(absl::Now() - start_));
+  }
+
+ private:
+  absl::string_view op_;
+  size_t num_bytes_;
+  absl::Time start_;
+};
+
+using AllReduceAlgorithm = GlooCollectivesOptions::AllReduceAlgorithm;
+
+absl::string_view AllReduceMetricName(AllReduceAlgorithm algorithm) {
+  switch (algorithm) {
+    case AllReduceAlgorithm::kAuto:
+    case AllReduceAlgorithm::kRing:
+      return "all-reduce/ring";
+    case AllReduceAlgorithm::kHalvingDoubling:
+      return "all-reduce/halving-doubling";
+    case AllReduceAlgorithm::kBcube:
+      return "all-reduce/bcube";
+  }
+}
+
+}  // namespace
+
+template <typename T>
+static absl::StatusOr<const gloo::ReductionFunction<T>*> GetReductionFunction(
+    ReductionKind reduction_kind) {
+  switch (reduction_kind) {
+    case ReductionKind::SUM:
+      return gloo::ReductionFunction<T>::sum;
+    case ReductionKind::PRODUCT:
+      return gloo::ReductionFunction<T>::product;
+    case ReductionKind::MAX:
+      if constexpr (!is_complex_v<T>) {
+        return gloo::ReductionFunction<T>::max;
+      }
+      break;
+    case ReductionKind::MIN:
+      if constexpr (!is_complex_v<T>) {
+        return gloo::ReductionFunction<T>::min;
+      }
+      break;
+  }
+  return absl::InvalidArgumentError(absl::StrCat(
+      "Unsupported reduction kind: ", static_cast<int>(reduction_kind)));
+}
+
 template <typename T>
 static absl::Status SetAllReduceOptions(ReductionKind reduction_kind,
                                         const void* input_buffer,
@@ -104,84 +166,142 @@ static absl::Status SetAllReduceOptions(ReductionKind reduction_kind,
   return absl::OkStatus();
 }
 
+template <typename T>
+absl::Status GlooCollectivesCommunicator::RunHalvingDoublingAllReduce(
+    ReductionKind reduction_kind, PrimitiveType element_type,
+    size_t num_elements, const void* input_buffer, void* output_buffer) {
+  const size_t num_bytes = num_elements * sizeof(T);
+  HalvingDoublingAllReduce* all_reduce;
+  {
+    absl::MutexLock lock(&mu_);
+    auto key = std::make_tuple(element_type, num_elements, reduction_kind);
+    auto it = halving_doubling_all_reduces_.find(key);
+    if (it == halving_doubling_all_reduces_.end()) {
+      // Halving-doubling is only available as an in-place algorithm.
+      TF_ASSIGN_OR_RETURN(const gloo::ReductionFunction<T>* reduction_function,
+                          GetReductionFunction<T>(reduction_kind));
+      auto new_all_reduce = std::make_unique<HalvingDoublingAllReduce>();
+      absl::MutexLock all_reduce_lock(&new_all_reduce->mu);
+      new_all_reduce->buffer.resize(num_bytes);
+      try {
+        new_all_reduce->algorithm =
+            std::make_unique<gloo::AllreduceHalvingDoubling<T>>(
+                context_,
+                std::vector<T*>{
+                    reinterpret_cast<T*>(new_all_reduce->buffer.data())},
+                num_elements, reduction_function);
+      } catch (std::exception& e) {
+        return absl::UnknownError(
+            absl::StrCat("Gloo all-reduce failed: ", e.what()));
+      }
+      it = halving_doubling_all_reduces_
+               .emplace(key, std::move(new_all_reduce))
+               .first;
+    }
+    all_reduce = it->second.get();
+  }
+
+  absl::MutexLock lock(&all_reduce->mu);
+  std::memcpy(all_reduce->buffer.data(), input_buffer, num_bytes);
+  try {
+    all_reduce->algorithm->run();
+  } catch (std::exception& e) {
+    return absl::UnknownError(
+        absl::StrCat("Gloo all-reduce failed: ", e.what()));
+  }
+  std::memcpy(output_buffer, all_reduce->buffer.data(), num_bytes);
+  return absl::OkStatus();
+}
+
+template <typename T>
+static absl::Status AllReduceHelper(
+    const std::shared_ptr<gloo::Context>& context, AllReduceAlgorithm algorithm,
+    size_t max_segment_bytes, ReductionKind reduction_kind,
+    const void* input_buffer, void* output_buffer, size_t num_elements,
+    absl::Duration timeout) {
+  gloo::AllreduceOptions options(context);
+  // TODO(phawkins): how to do tags?
+  // options.setTag(tag);
+  TF_RETURN_IF_ERROR(SetAllReduceOptions<T>(
+      reduction_kind, input_buffer, output_buffer, num_elements, options));
+  options.setAlgorithm(algorithm == AllReduceAlgorithm::kBcube
+                           ? gloo::AllreduceOptions::Algorithm::BCUBE
+                           : gloo::AllreduceOptions::Algorithm::RING);
+  if (max_segment_bytes > 0) {
+    options.setMaxSegmentSize(max_segment_bytes);
+  }
+  options.setTimeout(absl::ToChronoMilliseconds(timeout));
+
+  try {
+    gloo::allreduce(options);
+  } catch (std::exception& e) {
+    return absl::UnknownError(
+        absl::StrCat("Gloo all-reduce failed: ", e.what()));
+  }
+  return absl::OkStatus();
+}
+
 absl::Status GlooCollectivesCommunicator::AllReduce(
     const RendezvousKey& key, ReductionKind reduction_kind,
     PrimitiveType element_type, size_t num_elements, const void* input_buffer,
     void* output_buffer, absl::Duration timeout) {
-  gloo::AllreduceOptions options(context_);
-  // TODO(phawkins): how to do tags?
-  // options.setTag(tag);
+  size_t num_bytes = num_elements * primitive_util::ByteWidth(element_type);
+  AllReduceAlgorithm algorithm = options_.all_reduce_algorithm;
+  if (algorithm == AllReduceAlgorithm::kAuto) {
+    algorithm = options_.halving_doubling_max_bytes > 0 &&
+                        num_bytes <= options_.halving_doubling_max_bytes
+                    ? AllReduceAlgorithm::kHalvingDoubling
+                    : AllReduceAlgorithm::kRing;
+  }
+  VLOG(3) << "All-reduce of " << num_bytes << " bytes using "
+          << AllReduceMetricName(algorithm);
+  ScopedCollectiveMetrics scoped_metrics(AllReduceMetricName(algorithm),
+                                         num_bytes);
+
+  auto all_reduce = [&](auto type_tag) {
+    using T = decltype(type_tag);
+    if (algorithm == AllReduceAlgorithm::kHalvingDoubling) {
+      return RunHalvingDoublingAllReduce<T>(reduction_kind, element_type,
+                                            num_elements, input_buffer,
+                                            output_buffer);
+    }
+    return AllReduceHelper<T>(context_, algorithm, options_.max_segment_bytes,
+                              reduction_kind, input_buffer, output_buffer,
+                              num_elements, timeout);
+  };
   switch (element_type) {
     case S8:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<int8_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(int8_t{});
     case PRED:
     case U8:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<uint8_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(uint8_t{});
     case S16:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<int16_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(int16_t{});
     case U16:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<uint16_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(uint16_t{});
     case S32:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<int32_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(int32_t{});
     case U32:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<uint32_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(uint32_t{});
     case S64:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<int64_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(int64_t{});
     case U64:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<uint64_t>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(uint64_t{});
     case F16:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<gloo::float16>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(gloo::float16{});
     case BF16:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<bfloat16>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(bfloat16{});
     case F32:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<float>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(float{});
     case F64:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<double>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(double{});
     case C64:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<std::complex<float>>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(std::complex<float>{});
     case C128:
-      TF_RETURN_IF_ERROR(SetAllReduceOptions<std::complex<double>>(
-          reduction_kind, input_buffer, output_buffer, num_elements, options));
-      break;
+      return all_reduce(std::complex<double>{});
     default:
       return absl::InvalidArgumentError("Unknown datatype in allreduce");
   }
-  options.setAlgorithm(gloo::AllreduceOptions::Algorithm::RING);
-  options.setTimeout(absl::ToChronoMilliseconds(timeout));
-
-  try {
-    gloo::allreduce(options);
-  } catch (std::exception& e) {
-    return absl::UnknownError(
-        absl::StrCat("Gloo all-reduce failed: ", e.what()));
-  }
-  return absl::OkStatus();
 }
 
 static constexpr uint8_t kCollectivePermuteSlotPrefix = 0x40;
@@ -190,6 +310,7 @@ absl::Status GlooCollectivesCommunicator::CollectivePermute(
     const RendezvousKey& key, size_t num_bytes, std::optional<int> source_rank,
     absl::Span<int const> target_ranks, const void* input_buffer,
     void* output_buffer, absl::Duration timeout) {
+  ScopedCollectiveMetrics scoped_metrics("collective-permute", num_bytes);
   uint32_t tag = 0;  // TODO(phawkins): come up with better tags.
   const auto slot = gloo::Slot::build(kCollectivePermuteSlotPrefix, tag);
   try {
@@ -237,6 +358,8 @@ absl::Status GlooCollectivesCommunicator::AllToAll(
     const RendezvousKey& key, size_t chunk_bytes,
     absl::Span<const void* const> input_buffers,
     absl::Span<void* const> output_buffers, absl::Duration timeout) {
+  ScopedCollectiveMetrics scoped_metrics("all-to-all",
+                                         chunk_bytes * input_buffers.size());
   // We can't use Gloo's all-to-all implementation directly because it assumes
   // that the inputs and outputs are contiguous. No big deal; it's just built
   // on top of send/recv and we can do the same as it.
@@ -289,6 +412,8 @@ absl::Status GlooCollectivesCommunicator::AllGather(const RendezvousKey& key,
                                                     const void* input_buffer,
                                                     void* output_buffer,
                                                     absl::Duration timeout) {
+  ScopedCollectiveMetrics scoped_metrics("all-gather",
+                                         chunk_bytes * context_->size);
   uint32_t tag = 0;  // TODO(phawkins): use better tags.
 
   gloo::AllgatherOptions options(context_);
@@ -312,38 +437,8 @@ template <typename T>
 absl::Status ReduceScatterHelper(std::shared_ptr<gloo::Context> context,
                                  ReductionKind reduction_kind, void* buffer,
                                  size_t chunk_elems) {
-  const gloo::ReductionFunction<T>* reduction_function = nullptr;
-  if constexpr (is_complex_v<T>) {
-    switch (reduction_kind) {
-      case ReductionKind::SUM:
-        reduction_function = gloo::ReductionFunction<T>::sum;
-        break;
-      case ReductionKind::PRODUCT:
-        reduction_function = gloo::ReductionFunction<T>::product;
-        break;
-      default:
-        return absl::InvalidArgumentError(absl::StrCat(
-            "Unsupported reduction kind: ", static_cast<int>(reduction_kind)));
-    }
-  } else {
-    switch (reduction_kind) {
-      case ReductionKind::SUM:
-        reduction_function = gloo::ReductionFunction<T>::sum;
-        break;
-      case ReductionKind::PRODUCT:
-        reduction_function = gloo::ReductionFunction<T>::product;
-        break;
-      case ReductionKind::MAX:
-        reduction_function = gloo::ReductionFunction<T>::max;
-        break;
-      case ReductionKind::MIN:
-        reduction_function = gloo::ReductionFunction<T>::min;
-        break;
-      default:
-        return absl::InvalidArgumentError(absl::StrCat(
-            "Unsupported reduction kind: ", static_cast<int>(reduction_kind)));
-    }
-  }
+  TF_ASSIGN_OR_RETURN(const gloo::ReductionFunction<T>* reduction_function,
+                      GetReductionFunction<T>(reduction_kind));
   try {
     std::vector<int> recv_elems(context->size, chunk_elems);
     gloo::ReduceScatterHalvingDoubling<T> algorithm(
@@ -362,6 +457,8 @@ absl::Status GlooCollectivesCommunicator::ReduceScatter(
     PrimitiveType element_type, size_t chunk_elems, const void* input_buffer,
     void* output_buffer, absl::Duration timeout) {
   size_t chunk_bytes = chunk_elems * primitive_util::ByteWidth(element_type);
+  ScopedCollectiveMetrics scoped_metrics("reduce-scatter",
+                                         chunk_bytes * context_->size);
   std::unique_ptr<char[]> temp(new char[chunk_bytes * context_->size]);
   std::memcpy(temp.get(), input_buffer, chunk_bytes * context_->size);
   switch (element_type) {
@@ -431,8 +528,11 @@ absl::Status GlooCollectivesCommunicator::ReduceScatter(
 
 GlooCollectives::GlooCollectives(
     std::unique_ptr<gloo::rendezvous::Store> store,
-    std::shared_ptr<gloo::transport::Device> device)
-    : store_(std::move(store)), device_(std::move(device)) {}
+    std::shared_ptr<gloo::transport::Device> device,
+    GlooCollectivesOptions options)
+    : store_(std::move(store)),
+      device_(std::move(device)),
+      options_(std::move(options)) {}
 
 GlooCollectives::~GlooCollectives() = default;
 
@@ -461,8 +561,8 @@ GlooCollectives::GetCommunicator(
     return absl::UnknownError(
         absl::StrCat("Gloo context initialization failed: ", e.what()));
   }
-  context =
-      std::make_shared<GlooCollectivesCommunicator>(std::move(gloo_context));
+  context = std::make_shared<GlooCollectivesCommunicator>(
+      std::move(gloo_context), options_);
   return context;
 }
 
@@ -29,6 +29,7 @@ limitations under the License.
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "gloo/algorithm.h"  // from @gloo
 #include "gloo/context.h"  // from @gloo
 #include "gloo/rendezvous/store.h"  // from @gloo
 #include "gloo/transport/device.h"  // from @gloo
@@ -39,9 +40,40 @@ limitations under the License.
 
 namespace xla::cpu {
 
+struct GlooCollectivesOptions {
+  enum class AllReduceAlgorithm {
+    // Halving-doubling for messages of at most `halving_doubling_max_bytes`,
+    // ring for larger ones.
+    kAuto,
+    // Bandwidth-optimal: every rank sends and receives 2 * (n - 1) / n of the
+    // message, but in 2 * (n - 1) sequential steps.
+    kRing,
+    // Latency-optimal: 2 * log2(n) steps, at the cost of some extra traffic on
+    // non-power-of-two world sizes. Waits for the other ranks for as long as
+    // the timeout of the Gloo context, rather than the timeout of the op.
+    kHalvingDoubling,
+    // Hierarchical all-reduce over groups of ranks. Useful when the world size
+    // is large and messages are of medium size.
+    kBcube,
+  };
+
+  AllReduceAlgorithm all_reduce_algorithm = AllReduceAlgorithm::kAuto;
+
+  // Largest all-reduce, in bytes, that uses halving-doubling under kAuto. 0 by
+  // default, so that every all-reduce honors the timeout of the op unless
+  // halving-doubling is asked for.
+  size_t halving_doubling_max_bytes = 0;
+
+  // Ring all-reduces are pipelined in segments of at most this many bytes, so
+  // that reducing one segment overlaps with transferring the next. 0 uses
+  // Gloo's default.
+  size_t max_segment_bytes = 1024 * 1024;
+};
+
 class GlooCollectivesCommunicator : public CollectivesCommunicator {
  public:
-  explicit GlooCollectivesCommunicator(std::shared_ptr<gloo::Context> context);
+  explicit GlooCollectivesCommunicator(std::shared_ptr<gloo::Context> context,
+                                       GlooCollectivesOptions options = {});
   ~GlooCollectivesCommunicator() override;
 
   absl::Status AllReduce(const RendezvousKey& key, ReductionKind reduction_kind,
@@ -67,13 +99,36 @@ class GlooCollectivesCommunicator : public CollectivesCommunicator {
                              absl::Duration timeout) override;
 
  private:
+  // A halving-doubling all-reduce over a buffer of its own. Setting one up
+  // allocates its buffers and slots, so it is reused by all the all-reduces of
+  // the same element type, size and reduction kind. Every rank runs the same
+  // all-reduces in the same order, so they set up the same ones.
+  struct HalvingDoublingAllReduce {
+    absl::Mutex mu;
+    std::vector<char> buffer ABSL_GUARDED_BY(mu);
+    std::unique_ptr<gloo::Algorithm> algorithm ABSL_GUARDED_BY(mu);
+  };
+
+  template <typename T>
+  absl::Status RunHalvingDoublingAllReduce(ReductionKind reduction_kind,
+                                           PrimitiveType element_type,
+                                           size_t num_elements,
+                                           const void* input_buffer,
+                                           void* output_buffer);
+
   std::shared_ptr<gloo::Context> context_;
+  GlooCollectivesOptions options_;
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::tuple<PrimitiveType, size_t, ReductionKind>,
+                      std::unique_ptr<HalvingDoublingAllReduce>>
+      halving_doubling_all_reduces_ ABSL_GUARDED_BY(mu_);
 };
 
 class GlooCollectives : public CollectivesInterface {
  public:
   GlooCollectives(std::unique_ptr<gloo::rendezvous::Store> store,
-                  std::shared_ptr<gloo::transport::Device> device);
+                  std::shared_ptr<gloo::transport::Device> device,
+                  GlooCollectivesOptions options = {});
   ~GlooCollectives() override;
 
   // Thread-safe.
@@ -83,6 +138,7 @@ class GlooCollectives : public CollectivesInterface {
  private:
   std::unique_ptr<gloo::rendezvous::Store> store_;
   std::shared_ptr<gloo::transport::Device> device_;
+  GlooCollectivesOptions options_;
   absl::Mutex mu_;
   absl::flat_hash_map<std::tuple<std::vector<GlobalDeviceId>, int>,
                       std::shared_ptr<GlooCollectivesCommunicator>>
@@ -22,6 +22,7 @@ limitations under the License.
 #include <memory>
 #include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
@@ -124,5 +125,99 @@ TEST(GlooCollectives, AllReduce) {
                 Each(Eq(kNumParticipants * (kNumParticipants + 1) / 2)));
   }
 }
+
+using AllReduceAlgorithm = GlooCollectivesOptions::AllReduceAlgorithm;
+
+struct AllReduceAlgorithmTestCase {
+  AllReduceAlgorithm algorithm;
+  int num_participants;
+  size_t num_elements;
+};
+
+class GlooAllReduceAlgorithmTest
+    : public ::testing::TestWithParam<AllReduceAlgorithmTestCase> {};
+
+TEST_P(GlooAllReduceAlgorithmTest, SumF32) {
+  const AllReduceAlgorithmTestCase& test_case = GetParam();
+  const int num_participants = test_case.num_participants;
+  const size_t num_elements = test_case.num_elements;
+
+  GlooCollectivesOptions options;
+  options.all_reduce_algorithm = test_case.algorithm;
+  // Small segments so that ring all-reduces of the larger test sizes are
+  // pipelined, and kAuto picks halving-doubling for the smaller ones.
+  options.max_segment_bytes = 4096;
+  options.halving_doubling_max_bytes = 4096;
+  // Every rank runs the all-reduce more than once, to reuse the algorithms
+  // which are set up once per communicator.
+  constexpr int kNumRuns = 2;
+
+  std::vector<GlobalDeviceId> global_devices;
+  for (int rank = 0; rank < num_participants; ++rank) {
+    global_devices.push_back(GlobalDeviceId(rank));
+  }
+  auto kv_store = std::make_shared<xla::InMemoryKeyValueStore>();
+
+  std::vector<std::vector<std::vector<float>>> outputs(
+      kNumRuns, std::vector<std::vector<float>>(
+                    num_participants, std::vector<float>(num_elements)));
+  std::vector<absl::Status> statuses(num_participants);
+  {
+    tsl::thread::ThreadPool thread_pool(
+        tsl::Env::Default(), "AllReduceParticipants", num_participants);
+    for (int rank = 0; rank < num_participants; ++rank) {
+      thread_pool.Schedule([&, rank]() {
+        statuses[rank] = [&]() -> absl::Status {
+          auto collectives = std::make_shared<cpu::GlooCollectives>(
+              std::make_unique<cpu::GlooKeyValueStore>(kv_store),
+              gloo::transport::tcp::CreateDevice(gloo::transport::tcp::attr()),
+              options);
+          TF_ASSIGN_OR_RETURN(
+              auto communicator,
+              collectives->GetCommunicator(global_devices, rank));
+          for (int run = 0; run < kNumRuns; ++run) {
+            std::vector<float> input(num_elements);
+            for (size_t i = 0; i < num_elements; ++i) {
+              input[i] = rank + run + i % 7;
+            }
+            RendezvousKey key(RunId(run), global_devices, num_participants,
+                              RendezvousKey::CollectiveOpKind::kCrossModule,
+                              /*op_id=*/0);
+            TF_RETURN_IF_ERROR(communicator->AllReduce(
+                key, xla::ReductionKind::SUM, xla::PrimitiveType::F32,
+                num_elements, input.data(), outputs[run][rank].data(),
+                kTimeout));
+          }
+          return absl::OkStatus();
+        }();
+      });
+    }
+  }
+
+  for (int rank = 0; rank < num_participants; ++rank) {
+    TF_ASSERT_OK(statuses[rank]);
+    for (int run = 0; run < kNumRuns; ++run) {
+      for (size_t i = 0; i < num_elements; ++i) {
+        float expected = num_participants * (num_participants - 1) / 2 +
+                         num_participants * static_cast<float>(run + i % 7);
+        ASSERT_EQ(outputs[run][rank][i], expected)
+            << "run=" << run << " rank=" << rank << " i=" << i;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    GlooAllReduceAlgorithmTestInstantiation, GlooAllReduceAlgorithmTest,
+    ::testing::ValuesIn<AllReduceAlgorithmTestCase>({
+        {AllReduceAlgorithm::kAuto, 3, 100},
+        {AllReduceAlgorithm::kAuto, 3, 100000},
+        {AllReduceAlgorithm::kRing, 2, 1},
+        {AllReduceAlgorithm::kRing, 3, 100000},
+        {AllReduceAlgorithm::kHalvingDoubling, 3, 1000},
+        {AllReduceAlgorithm::kHalvingDoubling, 4, 100000},
+        {AllReduceAlgorithm::kBcube, 4, 1000},
+    }));
+
 }  // namespace
 }  // namespace xla::cpu
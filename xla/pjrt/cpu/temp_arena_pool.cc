@@ -0,0 +1,123 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/pjrt/cpu/temp_arena_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/base/dynamic_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "xla/cpu_function_runtime.h"
+#include "xla/pjrt/metrics.h"
+#include "xla/util.h"
+#include "tsl/platform/mem.h"
+#include "tsl/platform/numa.h"
+
+namespace xla {
+namespace {
+
+uint8_t* AllocateArena(size_t size, int numa_node) {
+  if (numa_node != tsl::port::kNUMANoAffinity) {
+    return static_cast<uint8_t*>(tsl::port::NUMAMalloc(
+        numa_node, size, cpu_function_runtime::MinAlign()));
+  }
+  return static_cast<uint8_t*>(
+      tsl::port::AlignedMalloc(size, cpu_function_runtime::MinAlign()));
+}
+
+void FreeArena(uint8_t* data, size_t size, int numa_node) {
+  if (numa_node != tsl::port::kNUMANoAffinity) {
+    tsl::port::NUMAFree(data, size);
+  } else {
+    tsl::port::AlignedFree(data);
+  }
+}
+
+}  // namespace
+
+TempArena::~TempArena() {
+  if (data_ != nullptr) {
+    FreeArena(data_, size_, numa_node_);
+  }
+}
+
+TempArenaPool::TempArenaPool(size_t arena_size, int max_cached_arenas,
+                             int numa_node)
+    : state_(
+          std::make_shared<State>(arena_size, max_cached_arenas, numa_node)) {}
+
+TempArenaPool::~TempArenaPool() {
+  absl::MutexLock lock(&state_->mu);
+  state_->closed = true;
+  for (uint8_t* data : state_->free_arenas) {
+    FreeArena(data, state_->arena_size, state_->numa_node);
+  }
+  state_->free_arenas.clear();
+}
+
+absl::StatusOr<std::shared_ptr<TempArena>> TempArenaPool::Acquire() {
+  uint8_t* data = nullptr;
+  {
+    absl::MutexLock lock(&state_->mu);
+    if (!state_->free_arenas.empty()) {
+      data = state_->free_arenas.back();
+      state_->free_arenas.pop_back();
+      ++state_->stats.hits;
+    } else {
+      ++state_->stats.misses;
+    }
+  }
+  metrics::RecordCpuTempArenaAcquire(/*reused=*/data != nullptr);
+
+  if (data == nullptr) {
+    data = AllocateArena(state_->arena_size, state_->numa_node);
+    if (data == nullptr) {
+      return ResourceExhausted(
+          "Out of memory allocating %d bytes on NUMA node %d.",
+          state_->arena_size, state_->numa_node);
+    }
+  }
+
+  // The temporary buffers are written by the JITed code, so msan has no way of
+  // knowing that their memory is initialized.
+  ABSL_ANNOTATE_MEMORY_IS_INITIALIZED(data, state_->arena_size);
+
+  return std::shared_ptr<TempArena>(
+      new TempArena(data, state_->arena_size, state_->numa_node),
+      [state = state_](TempArena* arena) { Release(state, arena); });
+}
+
+/*static*/ void TempArenaPool::Release(const std::shared_ptr<State>& state,
+                                       TempArena* arena) {
+  {
+    absl::MutexLock lock(&state->mu);
+    if (!state->closed && state->free_arenas.size() <
+                              static_cast<size_t>(state->max_cached_arenas)) {
+      state->free_arenas.push_back(arena->data_);
+      arena->data_ = nullptr;
+    }
+  }
+  delete arena;
+}
+
+TempArenaPool::Stats TempArenaPool::stats() const {
+  absl::MutexLock lock(&state_->mu);
+  return state_->stats;
+}
+
+}  // namespace xla
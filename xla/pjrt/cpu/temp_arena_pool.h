@@ -0,0 +1,112 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_PJRT_CPU_TEMP_ARENA_POOL_H_
+#define XLA_PJRT_CPU_TEMP_ARENA_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "tsl/platform/numa.h"
+
+namespace xla {
+
+// A single allocation that backs all temporary buffers of one execution.
+// Returned to the pool it was acquired from when the last reference goes away.
+class TempArena {
+ public:
+  TempArena(const TempArena&) = delete;
+  TempArena& operator=(const TempArena&) = delete;
+  ~TempArena();
+
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  friend class TempArenaPool;
+  TempArena(uint8_t* data, size_t size, int numa_node)
+      : data_(data), size_(size), numa_node_(numa_node) {}
+
+  uint8_t* data_;
+  size_t size_;
+  int numa_node_;
+};
+
+// A bounded pool of equally sized, aligned temp arenas. An executable owns one
+// pool so that back-to-back executions reuse the same memory instead of going
+// through the allocator for every temporary buffer. Arenas are handed out
+// exclusively, so concurrent executions of the same executable never share an
+// arena; when more than `max_cached_arenas` are in flight, the extra arenas
+// are freed on release instead of being cached. Executables keep one pool per
+// NUMA node of their devices. This class is thread-safe.
+class TempArenaPool {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+  };
+
+  // Creates a pool of arenas of `arena_size` bytes. A pool with
+  // `max_cached_arenas` == 0 never caches and allocates on every Acquire().
+  // If `numa_node` is not tsl::port::kNUMANoAffinity, the arenas are bound to
+  // that NUMA node.
+  TempArenaPool(size_t arena_size, int max_cached_arenas,
+                int numa_node = tsl::port::kNUMANoAffinity);
+  ~TempArenaPool();
+
+  TempArenaPool(const TempArenaPool&) = delete;
+  TempArenaPool& operator=(const TempArenaPool&) = delete;
+
+  // Returns a cached arena if one is free, and allocates a new one otherwise.
+  // The arena goes back to the pool when the returned pointer is destroyed,
+  // which may happen after the pool itself has been destroyed.
+  absl::StatusOr<std::shared_ptr<TempArena>> Acquire();
+
+  size_t arena_size() const { return state_->arena_size; }
+  int numa_node() const { return state_->numa_node; }
+  Stats stats() const;
+
+ private:
+  // Shared with the deleters of the arenas handed out, so that arenas released
+  // after the executable is gone are simply freed.
+  struct State {
+    State(size_t arena_size, int max_cached_arenas, int numa_node)
+        : arena_size(arena_size),
+          max_cached_arenas(max_cached_arenas),
+          numa_node(numa_node) {}
+
+    const size_t arena_size;
+    const int max_cached_arenas;
+    const int numa_node;
+
+    mutable absl::Mutex mu;
+    bool closed ABSL_GUARDED_BY(mu) = false;
+    absl::InlinedVector<uint8_t*, 4> free_arenas ABSL_GUARDED_BY(mu);
+    Stats stats ABSL_GUARDED_BY(mu);
+  };
+
+  static void Release(const std::shared_ptr<State>& state, TempArena* arena);
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace xla
+
+#endif  // XLA_PJRT_CPU_TEMP_ARENA_POOL_H_
@@ -0,0 +1,138 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/pjrt/cpu/temp_arena_pool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+#include "xla/cpu_function_runtime.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/numa.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/threadpool.h"
+
+namespace xla {
+namespace {
+
+TEST(TempArenaPoolTest, ReusesReleasedArena) {
+  TempArenaPool pool(/*arena_size=*/1024, /*max_cached_arenas=*/2);
+
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<TempArena> arena, pool.Acquire());
+  EXPECT_EQ(arena->size(), 1024);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(arena->data()) %
+                cpu_function_runtime::MinAlign(),
+            0);
+  uint8_t* data = arena->data();
+  arena.reset();
+
+  TF_ASSERT_OK_AND_ASSIGN(arena, pool.Acquire());
+  EXPECT_EQ(arena->data(), data);
+  EXPECT_EQ(pool.stats().hits, 1);
+  EXPECT_EQ(pool.stats().misses, 1);
+}
+
+TEST(TempArenaPoolTest, ConcurrentAcquiresGetDistinctArenas) {
+  TempArenaPool pool(/*arena_size=*/64, /*max_cached_arenas=*/1);
+
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<TempArena> a, pool.Acquire());
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<TempArena> b, pool.Acquire());
+  EXPECT_NE(a->data(), b->data());
+
+  // Only one of the two arenas fits in the pool; the other one is freed.
+  a.reset();
+  b.reset();
+  TF_ASSERT_OK_AND_ASSIGN(a, pool.Acquire());
+  TF_ASSERT_OK_AND_ASSIGN(b, pool.Acquire());
+  EXPECT_EQ(pool.stats().hits, 1);
+  EXPECT_EQ(pool.stats().misses, 3);
+}
+
+TEST(TempArenaPoolTest, ZeroCachedArenasNeverReuses) {
+  TempArenaPool pool(/*arena_size=*/64, /*max_cached_arenas=*/0);
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<TempArena> arena, pool.Acquire());
+  }
+  EXPECT_EQ(pool.stats().hits, 0);
+  EXPECT_EQ(pool.stats().misses, 3);
+}
+
+TEST(TempArenaPoolTest, ArenaOutlivesPool) {
+  auto pool = std::make_unique<TempArenaPool>(/*arena_size=*/64,
+                                              /*max_cached_arenas=*/4);
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<TempArena> arena, pool->Acquire());
+  pool.reset();
+  std::memset(arena->data(), 0, arena->size());
+  arena.reset();
+}
+
+TEST(TempArenaPoolTest, AllocatesOnNumaNode) {
+  TempArenaPool pool(/*arena_size=*/4096, /*max_cached_arenas=*/1,
+                     /*numa_node=*/0);
+  EXPECT_EQ(pool.numa_node(), 0);
+
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<TempArena> arena, pool.Acquire());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(arena->data()) %
+                cpu_function_runtime::MinAlign(),
+            0);
+  std::memset(arena->data(), 0, arena->size());
+  if (tsl::port::NUMAEnabled()) {
+    EXPECT_EQ(tsl::port::NUMAGetMemAffinity(arena->data()), 0);
+  }
+  uint8_t* data = arena->data();
+  arena.reset();
+
+  TF_ASSERT_OK_AND_ASSIGN(arena, pool.Acquire());
+  EXPECT_EQ(arena->data(), data);
+}
+
+TEST(TempArenaPoolTest, ConcurrentUse) {
+  constexpr int kNumThreads = 8;
+  constexpr int kIterations = 1000;
+  TempArenaPool pool(/*arena_size=*/256, /*max_cached_arenas=*/4);
+
+  // Every thread writes its id into the whole arena and checks that nobody
+  // else wrote to it while it was held.
+  absl::Mutex mu;
+  bool ok = true;
+  {
+    tsl::thread::ThreadPool threads(tsl::Env::Default(), "temp_arena_test",
+                                    kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      threads.Schedule([&, t] {
+        for (int i = 0; i < kIterations; ++i) {
+          std::shared_ptr<TempArena> arena = pool.Acquire().value();
+          std::memset(arena->data(), t, arena->size());
+          std::vector<uint8_t> expected(arena->size(), t);
+          if (std::memcmp(arena->data(), expected.data(), arena->size()) !=
+              0) {
+            absl::MutexLock lock(&mu);
+            ok = false;
+          }
+        }
+      });
+    }
+  }
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(pool.stats().hits + pool.stats().misses, kNumThreads * kIterations);
+  EXPECT_GT(pool.stats().hits, 0);
+}
+
+}  // namespace
+}  // namespace xla
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <utility>
 
@@ -31,12 +32,13 @@ limitations under the License.
 #include "xla/tsl/concurrency/async_value_ref.h"
 #include "xla/util.h"
 #include "tsl/platform/mem.h"
+#include "tsl/platform/numa.h"
 
 namespace xla {
 
 class MaybeOwningCpuMemory {
  public:
-  using OwnedDataPtr = std::unique_ptr<uint8_t[], void (*)(void*)>;
+  using OwnedDataPtr = std::unique_ptr<uint8_t[], std::function<void(void*)>>;
 
   MaybeOwningCpuMemory() = default;
 
@@ -53,9 +55,23 @@ class MaybeOwningCpuMemory {
   MaybeOwningCpuMemory(const MaybeOwningCpuMemory&) = delete;
   MaybeOwningCpuMemory& operator=(const MaybeOwningCpuMemory&) = delete;
 
-  // Owning.
+  // Owning. If `numa_node` is not tsl::port::kNUMANoAffinity, the memory is
+  // bound to that NUMA node.
   static absl::StatusOr<std::shared_ptr<MaybeOwningCpuMemory>> AllocateShared(
-      size_t size) {
+      size_t size, int numa_node = tsl::port::kNUMANoAffinity) {
+    if (numa_node != tsl::port::kNUMANoAffinity) {
+      uint8_t* data = static_cast<uint8_t*>(tsl::port::NUMAMalloc(
+          numa_node, size, cpu_function_runtime::MinAlign()));
+      if (!data) {
+        return ResourceExhausted(
+            "Out of memory allocating %d bytes on NUMA node %d.", size,
+            numa_node);
+      }
+      return std::make_shared<MaybeOwningCpuMemory>(
+          OwnedDataPtr{data,
+                       [size](void* ptr) { tsl::port::NUMAFree(ptr, size); }},
+          size);
+    }
     uint8_t* data = static_cast<uint8_t*>(
         tsl::port::AlignedMalloc(size, cpu_function_runtime::MinAlign()));
     if (!data) {
@@ -16,7 +16,9 @@ limitations under the License.
 #include "xla/pjrt/metrics.h"
 
 #include <cstdint>
+#include <string>
 
+#include "absl/strings/string_view.h"
 #include "tsl/lib/monitoring/counter.h"
 #include "tsl/lib/monitoring/gauge.h"
 
@@ -41,6 +43,32 @@ auto* pjrt_compiler_is_compiling_module = tsl::monitoring::Gauge<bool, 0>::New(
     metrics::kPjrtCompilerCompileModuleMetricName,
     "Whether the PjRT compiler is compiling modules.");
 
+auto* pjrt_cpu_temp_arena_hits = tsl::monitoring::Counter<0>::New(
+    "/jax/pjrt/cpu_temp_arena_hits",
+    "The number of CPU executions that reused a cached temp arena.");
+
+auto* pjrt_cpu_temp_arena_misses = tsl::monitoring::Counter<0>::New(
+    "/jax/pjrt/cpu_temp_arena_misses",
+    "The number of CPU executions that allocated a new temp arena.");
+
+auto* pjrt_cpu_collective_ops = tsl::monitoring::Counter<1>::New(
+    "/jax/pjrt/cpu_collective_ops",
+    "The number of cross-process CPU collectives, by collective and "
+    "algorithm.",
+    "op");
+
+auto* pjrt_cpu_collective_bytes = tsl::monitoring::Counter<1>::New(
+    "/jax/pjrt/cpu_collective_bytes",
+    "The number of bytes moved by cross-process CPU collectives, by "
+    "collective and algorithm.",
+    "op");
+
+auto* pjrt_cpu_collective_time_usecs = tsl::monitoring::Counter<1>::New(
+    "/jax/pjrt/cpu_collective_time_usecs",
+    "The total time spent in cross-process CPU collectives in microseconds, "
+    "by collective and algorithm.",
+    "op");
+
 }  // namespace
 
 namespace metrics {
@@ -64,5 +92,20 @@ void RecordPjrtCompilerCompileModuleStatus(bool is_compiling) {
   pjrt_compiler_is_compiling_module->GetCell()->Set(is_compiling);
 }
 
+void RecordCpuTempArenaAcquire(bool reused) {
+  static auto* hits_cell = pjrt_cpu_temp_arena_hits->GetCell();
+  static auto* misses_cell = pjrt_cpu_temp_arena_misses->GetCell();
+  (reused ? hits_cell : misses_cell)->IncrementBy(1);
+}
+
+void RecordCpuCollective(absl::string_view op, uint64_t num_bytes,
+                         uint64_t running_time_usecs) {
+  std::string label(op);
+  pjrt_cpu_collective_ops->GetCell(label)->IncrementBy(1);
+  pjrt_cpu_collective_bytes->GetCell(label)->IncrementBy(num_bytes);
+  pjrt_cpu_collective_time_usecs->GetCell(label)->IncrementBy(
+      running_time_usecs);
+}
+
 }  // namespace metrics
 }  // namespace xla
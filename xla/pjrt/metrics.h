@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef XLA_PJRT_METRICS_H_
 #define XLA_PJRT_METRICS_H_
 
+#include <cstdint>
+
 #include "absl/base/attributes.h"
 #include "absl/strings/string_view.h"
 #include "tsl/lib/monitoring/counter.h"
@@ -36,6 +38,16 @@ void RecordPjrtCompilerCompileComputationStatus(bool is_compiling);
 
 void RecordPjrtCompilerCompileModuleStatus(bool is_compiling);
 
+// Records whether a CPU executable reused a cached temp arena (`reused`) or
+// had to allocate a new one.
+void RecordCpuTempArenaAcquire(bool reused);
+
+// Records one cross-process CPU collective of kind `op`, e.g.
+// "all-reduce/ring", that moved `num_bytes` bytes and took
+// `running_time_usecs`.
+void RecordCpuCollective(absl::string_view op, uint64_t num_bytes,
+                         uint64_t running_time_usecs);
+
 }  // namespace metrics
 }  // namespace xla
 
@@ -18,11 +18,13 @@ limitations under the License.
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/base/casts.h"
 #include "absl/strings/substitute.h"
 #include "xla/hlo/ir/hlo_module.h"
 #include "xla/pjrt/utils.h"
+#include "xla/service/compile_stats.h"
 #include "xla/util.h"
 #include "tsl/platform/errors.h"
 
@@ -95,4 +97,15 @@ PjRtLoadedExecutable::GetCostAnalysis() const {
   return PjRtExecutableUtil::RunHloCostAnalysis(*this, hlo_cost_analysis.get());
 }
 
+absl::StatusOr<CompileStats> PjRtLoadedExecutable::GetCompileStats() const {
+  TF_ASSIGN_OR_RETURN(std::vector<std::shared_ptr<HloModule>> hlo_modules,
+                      GetHloModules());
+  std::vector<const HloModule*> modules;
+  modules.reserve(hlo_modules.size());
+  for (const std::shared_ptr<HloModule>& module : hlo_modules) {
+    modules.push_back(module.get());
+  }
+  return CompileStats::FromModules(modules);
+}
+
 }  // namespace xla
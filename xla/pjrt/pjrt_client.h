@@ -46,6 +46,7 @@ limitations under the License.
 #include "xla/pjrt/pjrt_executable.h"
 #include "xla/pjrt/pjrt_future.h"
 #include "xla/pjrt/pjrt_layout.h"
+#include "xla/service/compile_stats.h"
 #include "xla/service/computation_placer.h"
 #include "xla/service/hlo_cost_analysis.h"
 #include "xla/shape.h"
@@ -1430,6 +1431,11 @@ class PjRtLoadedExecutable : public PjRtExecutable {
   StatusOr<absl::flat_hash_map<std::string, PjRtValueType>> GetCostAnalysis()
       const override;
 
+  // Returns the compile time statistics of the HLO passes which produced this
+  // executable: the time, instruction count change and peak memory of every
+  // pass, aggregated from the metadata of the modules of GetHloModules().
+  virtual absl::StatusOr<CompileStats> GetCompileStats() const;
+
   // The replica and partition indices of device_assignment to be run by this
   // client. On single-host platforms without partitioning, this is all replicas
   // (i.e. addressable_device_logical_ids_[i] = (i, 0)), but this may not be the
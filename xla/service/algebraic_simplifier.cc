@@ -8994,17 +8994,10 @@ Status AlgebraicSimplifierVisitor::HandleMap(HloInstruction* map) {
   return ReplaceWithNewInstruction(map, std::move(clone));
 }
 
-absl::StatusOr<bool> AlgebraicSimplifier::Run(
-    HloModule* module,
-    const absl::flat_hash_set<absl::string_view>& execution_threads) {
-  bool changed = false;
+absl::StatusOr<bool> AlgebraicSimplifier::RunOnComputation(
+    HloComputation* computation) {
   AlgebraicSimplifierVisitor visitor(options_, this);
-  for (auto* comp : module->MakeNonfusionComputations(execution_threads)) {
-    if (visitor.Run(comp, options_, this)) {
-      changed = true;
-    }
-  }
-  return changed;
+  return visitor.Run(computation, options_, this);
 }
 
 }  // namespace xla
@@ -1085,9 +1085,11 @@ absl::StatusOr<std::unique_ptr<BufferAssignment>> BufferAssigner::Run(
     const PrivateStacks& private_stacks,
     GlobalDecreasingSizeBestFitHeap<HloValue>::BufferIntervalCompare
         heap_buffer_interval_compare,
-    std::optional<BufferAssignment::BufferIsolationOptions> isolation_options) {
+    std::optional<BufferAssignment::BufferIsolationOptions> isolation_options,
+    tsl::thread::ThreadPool* thread_pool) {
   BufferAssigner assigner(allocate_buffers_for_constants, std::move(colorer),
-                          must_not_live_out, std::move(preset_assignments));
+                          must_not_live_out, std::move(preset_assignments),
+                          thread_pool);
   return assigner.CreateAssignment(
       module, std::move(hlo_ordering), std::move(buffer_size),
       std::move(color_alignment), std::move(can_share_buffer), private_stacks,
@@ -1649,8 +1651,16 @@ Status BufferAssigner::AssignBuffersWithSequentialOrdering(
         std::make_unique<ConstrainedGlobalDecreasingSizeBestFitHeap>(
             assignment->multiheap_size_constraint_per_heap(), alignment,
             GlobalDecreasingSizeBestFitHeap<HloValue>::kTemporal));
+    // The extra candidate only pays off when the candidates run concurrently;
+    // without a thread pool it would add a third sequential simulation.
+    if (thread_pool_ != nullptr) {
+      algorithms->push_back(
+          std::make_unique<ConstrainedGlobalDecreasingSizeBestFitHeap>(
+              assignment->multiheap_size_constraint_per_heap(), alignment,
+              GlobalDecreasingSizeBestFitHeap<HloValue>::kSpatioTemporal));
+    }
     return std::make_unique<ChooseBestHeapAlgorithm<HloValue>>(
-        std::move(algorithms));
+        std::move(algorithms), thread_pool_);
   };
 
   if (run_whole_module_heap_simulation) {
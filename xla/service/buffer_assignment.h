@@ -40,6 +40,7 @@ limitations under the License.
 #include "xla/statusor.h"
 #include "xla/types.h"
 #include "tsl/platform/logging.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 
@@ -635,7 +636,10 @@ class BufferAssigner {
   // color_alignment are functions which returns the size and alignment of a
   // LogicalBuffer. If preset_assignments is provided, those pre-set assignment
   // offsets will be used. The caller guarantees that those assignments are
-  // valid and they do not overwrite each other.
+  // valid and they do not overwrite each other. If thread_pool is not null, the
+  // heap simulations of the candidate heap algorithms run concurrently on it,
+  // and a spatio-temporal ordering is tried in addition to the spatial and
+  // temporal ones.
   static absl::StatusOr<std::unique_ptr<BufferAssignment>> Run(
       const HloModule* module, std::unique_ptr<HloOrdering> hlo_ordering,
       BufferValue::SizeFunction buffer_size,
@@ -650,17 +654,20 @@ class BufferAssigner {
       GlobalDecreasingSizeBestFitHeap<HloValue>::BufferIntervalCompare
           heap_buffer_interval_compare = nullptr,
       std::optional<BufferAssignment::BufferIsolationOptions>
-          isolation_options = std::nullopt);
+          isolation_options = std::nullopt,
+      tsl::thread::ThreadPool* thread_pool = nullptr);
 
  private:
   BufferAssigner(bool allocate_buffers_for_constants, Colorer colorer,
                  std::optional<MustNotLiveOut> must_not_live_out,
                  std::unique_ptr<memory_space_assignment::PresetAssignments>
-                     preset_assignments)
+                     preset_assignments,
+                 tsl::thread::ThreadPool* thread_pool)
       : allocate_buffers_for_constants_(allocate_buffers_for_constants),
         colorer_(colorer),
         must_not_live_out_(must_not_live_out),
-        preset_assignments_(std::move(preset_assignments)) {}
+        preset_assignments_(std::move(preset_assignments)),
+        thread_pool_(thread_pool) {}
   virtual ~BufferAssigner() = default;
 
   // Create a buffer assignment.
@@ -775,6 +782,9 @@ class BufferAssigner {
   std::unique_ptr<memory_space_assignment::PresetAssignments>
       preset_assignments_;
 
+  // The pool the candidate heap algorithms run on concurrently, if not null.
+  tsl::thread::ThreadPool* thread_pool_;
+
   BufferAssigner(const BufferAssigner&) = delete;
   BufferAssigner& operator=(const BufferAssigner&) = delete;
 };
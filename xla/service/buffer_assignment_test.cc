@@ -48,7 +48,9 @@ limitations under the License.
 #include "xla/types.h"
 #include "xla/xla_data.pb.h"
 #include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/env.h"
 #include "tsl/platform/statusor.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 namespace {
@@ -118,7 +120,8 @@ class BufferAssignmentTest : public HloTestBase {
       BufferAssigner::Colorer colorer = BufferAssigner::DefaultColorer(),
       const BufferAssigner::PrivateStacks& private_stacks = {},
       std::optional<BufferAssignment::BufferIsolationOptions>
-          isolation_options = std::nullopt) {
+          isolation_options = std::nullopt,
+      tsl::thread::ThreadPool* thread_pool = nullptr) {
     return BufferAssigner::Run(
                module,
                std::make_unique<SequentialHloOrdering>(module->schedule()),
@@ -127,7 +130,8 @@ class BufferAssignmentTest : public HloTestBase {
                /*allocate_buffers_for_constants=*/true, colorer,
                /*must_not_live_out=*/std::nullopt, /*can_share_buffer=*/nullptr,
                /*preset_assignments=*/{}, private_stacks,
-               /*heap_buffer_interval_compare=*/nullptr, isolation_options)
+               /*heap_buffer_interval_compare=*/nullptr, isolation_options,
+               thread_pool)
         .value();
   }
 
@@ -3368,5 +3372,40 @@ ENTRY entry_computation {
   EXPECT_EQ(dus9_alloc_slice.allocation(), dus5_alloc_slice.allocation());
   EXPECT_EQ(dus9_alloc_slice, dus5_alloc_slice);
 }
+
+TEST_F(BufferAssignmentTest, ThreadPoolDoesNotIncreaseHeapSize) {
+  // With a thread pool, a spatio-temporal candidate is tried in addition to
+  // the spatial and temporal ones, so the heap can only get smaller.
+  const char* const hlo_text = R"(
+HloModule test_module, is_scheduled=true
+
+ENTRY main {
+  p0 = f32[16] parameter(0)
+  negate = f32[16] negate(p0)
+  broadcast = f32[4,16] broadcast(negate), dimensions={1}
+  exponential = f32[4,16] exponential(broadcast)
+  slice = f32[1,16] slice(exponential), slice={[0:1], [0:16]}
+  reshape = f32[16] reshape(slice)
+  sine = f32[16] sine(negate)
+  ROOT add = f32[16] add(reshape, sine)
+})";
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(hlo_text));
+  auto total_size = [](const BufferAssignment& assignment) {
+    int64_t size = 0;
+    for (const BufferAllocation& allocation : assignment.Allocations()) {
+      size += allocation.size();
+    }
+    return size;
+  };
+
+  auto assignment = RunBufferAssignmentWithSequentialOrdering(module.get());
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(),
+                                      "buffer_assignment_test",
+                                      /*num_threads=*/2);
+  auto parallel_assignment = RunBufferAssignmentWithSequentialOrdering(
+      module.get(), /*alignment=*/1, BufferAssigner::DefaultColorer(),
+      /*private_stacks=*/{}, /*isolation_options=*/std::nullopt, &thread_pool);
+  EXPECT_LE(total_size(*parallel_assignment), total_size(*assignment));
+}
 }  // namespace
 }  // namespace xla
@@ -40,6 +40,9 @@ class NoopStats : public CompilationStats {
 
   void RecordPassError(absl::string_view pass_name,
                        absl::string_view err) override{};
+
+  void RecordPassSavings(absl::string_view pass_name,
+                         double saved_ms) override {}
 };
 
 class Stats : public CompilationStats {
@@ -57,6 +60,9 @@ class Stats : public CompilationStats {
   void RecordPassError(absl::string_view pass_name,
                        absl::string_view err) override{};
 
+  void RecordPassSavings(absl::string_view pass_name,
+                         double saved_ms) override;
+
  private:
   struct PassInfo {
     PassInfo(absl::string_view name, double duration)
@@ -74,6 +80,8 @@ class Stats : public CompilationStats {
   std::string current_pass_;
   // The start time of the currently running pass.
   uint64_t start_micros_;
+  // The compile time each pass saved by reusing results of earlier runs.
+  absl::flat_hash_map<std::string, double> savings_ms_;
 };
 
 /* static */
@@ -103,6 +111,10 @@ void Stats::EndPass(absl::string_view pass_name) {
   passes_.push_back(PassInfo(current_pass_, duration_ms));
 }
 
+void Stats::RecordPassSavings(absl::string_view pass_name, double saved_ms) {
+  savings_ms_[std::string(pass_name)] += saved_ms;
+}
+
 void Stats::CompilationReport() {
   CHECK(!pass_running_) << "EndPass never called for " << current_pass_;
   absl::flat_hash_map<std::string, PassInfo> summary;
@@ -136,6 +148,12 @@ void Stats::CompilationReport() {
     LOG(INFO) << pass_info.name << ", " << pass_info.num_runs << ", "
               << pass_info.duration_ms;
   }
+  if (!savings_ms_.empty()) {
+    LOG(INFO) << "Pass name, time saved by reusing results (ms)";
+    for (const auto& [pass_name, saved_ms] : savings_ms_) {
+      LOG(INFO) << pass_name << ", " << saved_ms;
+    }
+  }
 }
 
 int Stats::GetPassesSize() { return passes_.size(); }
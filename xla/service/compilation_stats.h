@@ -47,6 +47,11 @@ class CompilationStats {
 
   virtual void RecordPassError(absl::string_view pass_name,
                                absl::string_view err) = 0;
+
+  // Records that a run of a pass saved `saved_ms` of compile time by reusing
+  // results of earlier runs, e.g. through a cache shared between them.
+  virtual void RecordPassSavings(absl::string_view pass_name,
+                                 double saved_ms) = 0;
 };
 
 }  // namespace xla
@@ -0,0 +1,140 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/compile_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/service/hlo.pb.h"
+
+namespace xla {
+namespace {
+
+// The name HloPassPipeline records its invariant checks before the first pass
+// under.
+constexpr absl::string_view kPipelineStart = "pipeline-start";
+
+constexpr double kBytesPerMiB = 1024.0 * 1024.0;
+
+}  // namespace
+
+/*static*/ CompileStats CompileStats::FromMetadata(
+    absl::Span<const HloModuleMetadataProto* const> metadata) {
+  // The passes of a nested pipeline record the pipeline as their pipeline, and
+  // the pipeline itself is recorded as a pass of the enclosing pipeline.
+  absl::flat_hash_set<absl::string_view> pipeline_names;
+  for (const HloModuleMetadataProto* module_metadata : metadata) {
+    for (const HloPassMetadata& pass : module_metadata->pass_metadata()) {
+      pipeline_names.insert(pass.pipeline_name());
+    }
+  }
+
+  CompileStats stats;
+  absl::flat_hash_map<absl::string_view, int64_t> pass_indices;
+  for (const HloModuleMetadataProto* module_metadata : metadata) {
+    for (const HloPassMetadata& pass : module_metadata->pass_metadata()) {
+      if (pass.pass_name() == kPipelineStart ||
+          pipeline_names.contains(pass.pass_name())) {
+        continue;
+      }
+      auto [it, inserted] =
+          pass_indices.emplace(pass.pass_name(), stats.passes.size());
+      if (inserted) {
+        stats.passes.emplace_back().pass_name = pass.pass_name();
+      }
+      PassStats& pass_stats = stats.passes[it->second];
+      const double ms =
+          (pass.end_timestamp_usec() - pass.start_timestamp_usec()) / 1000.0;
+      const double dataflow_analysis_ms =
+          pass.dataflow_analysis_usec() / 1000.0;
+      ++pass_stats.num_runs;
+      pass_stats.num_changed_runs += pass.module_changed() ? 1 : 0;
+      pass_stats.total_ms += ms;
+      pass_stats.max_ms = std::max(pass_stats.max_ms, ms);
+      pass_stats.dataflow_analysis_ms += dataflow_analysis_ms;
+      pass_stats.instruction_count_delta +=
+          pass.instruction_count_after() - pass.instruction_count_before();
+      if (pass.peak_memory_bytes_before() > 0) {
+        pass_stats.peak_memory_increase_bytes += std::max<int64_t>(
+            pass.peak_memory_bytes_after() - pass.peak_memory_bytes_before(),
+            0);
+      }
+      stats.total_ms += ms;
+      stats.dataflow_analysis_ms += dataflow_analysis_ms;
+      stats.peak_memory_bytes =
+          std::max(stats.peak_memory_bytes, pass.peak_memory_bytes_after());
+    }
+  }
+  std::stable_sort(stats.passes.begin(), stats.passes.end(),
+                   [](const PassStats& a, const PassStats& b) {
+                     return a.total_ms > b.total_ms;
+                   });
+  return stats;
+}
+
+/*static*/ CompileStats CompileStats::FromModules(
+    absl::Span<const HloModule* const> modules) {
+  std::vector<const HloModuleMetadataProto*> metadata;
+  for (const HloModule* module : modules) {
+    if (module->metadata().prepartitioning_metadata().has_value()) {
+      metadata.push_back(&*module->metadata().prepartitioning_metadata());
+    }
+    metadata.push_back(&module->metadata().proto());
+  }
+  return FromMetadata(metadata);
+}
+
+std::string CompileStats::ToTable(int64_t max_passes) const {
+  const int64_t num_rows =
+      max_passes < 0 ? passes.size()
+                     : std::min<int64_t>(max_passes, passes.size());
+  int name_width = 5;
+  for (int64_t i = 0; i < num_rows; ++i) {
+    name_width = std::max<int>(name_width, passes[i].pass_name.size());
+  }
+
+  std::string table = absl::StrFormat(
+      "%-*s %6s %8s %11s %10s %12s %13s %13s\n", name_width, "Pass", "Runs",
+      "Changed", "Total ms", "Max ms", "Dataflow ms", "Instructions",
+      "Peak rise MiB");
+  for (int64_t i = 0; i < num_rows; ++i) {
+    const PassStats& pass = passes[i];
+    absl::StrAppendFormat(
+        &table, "%-*s %6d %8d %11.2f %10.2f %12.2f %+13d %13.1f\n",
+        name_width, pass.pass_name, pass.num_runs, pass.num_changed_runs,
+        pass.total_ms, pass.max_ms, pass.dataflow_analysis_ms,
+        pass.instruction_count_delta,
+        pass.peak_memory_increase_bytes / kBytesPerMiB);
+  }
+  absl::StrAppendFormat(&table, "%-*s %6s %8s %11.2f %10s %12.2f\n",
+                        name_width, "Total", "", "", total_ms, "",
+                        dataflow_analysis_ms);
+  if (peak_memory_bytes > 0) {
+    absl::StrAppendFormat(&table, "Peak memory: %.1f MiB\n",
+                          peak_memory_bytes / kBytesPerMiB);
+  }
+  return table;
+}
+
+}  // namespace xla
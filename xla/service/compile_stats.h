@@ -0,0 +1,73 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_SERVICE_COMPILE_STATS_H_
+#define XLA_SERVICE_COMPILE_STATS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/service/hlo.pb.h"
+
+namespace xla {
+
+// The compile time statistics of the HLO passes that ran on some modules,
+// aggregated from the pass metadata HloPassPipeline records in the modules.
+struct CompileStats {
+  // The statistics of all the runs of one pass.
+  struct PassStats {
+    std::string pass_name;
+    int64_t num_runs = 0;
+    // The number of runs which changed the module.
+    int64_t num_changed_runs = 0;
+    double total_ms = 0;
+    double max_ms = 0;
+    // The part of total_ms the runs spent in dataflow analysis.
+    double dataflow_analysis_ms = 0;
+    // The number of instructions the runs added, negative if they removed
+    // more than they added.
+    int64_t instruction_count_delta = 0;
+    // How far the runs raised the peak memory of the process.
+    int64_t peak_memory_increase_bytes = 0;
+  };
+
+  // The passes, slowest first. The pipelines themselves are left out, so that
+  // the time of a pass is not counted again in the pipelines it is nested in.
+  std::vector<PassStats> passes;
+  double total_ms = 0;
+  double dataflow_analysis_ms = 0;
+  // The peak memory of the process over all the passes, zero if it is not
+  // known.
+  int64_t peak_memory_bytes = 0;
+
+  // Aggregates the pass metadata in `metadata`.
+  static CompileStats FromMetadata(
+      absl::Span<const HloModuleMetadataProto* const> metadata);
+
+  // Aggregates the pass metadata of `modules`, including the metadata of the
+  // passes which ran before they were partitioned.
+  static CompileStats FromModules(absl::Span<const HloModule* const> modules);
+
+  // Returns a table of the `max_passes` slowest passes, and of all the passes
+  // if `max_passes` is negative.
+  std::string ToTable(int64_t max_passes = -1) const;
+};
+
+}  // namespace xla
+
+#endif  // XLA_SERVICE_COMPILE_STATS_H_
@@ -0,0 +1,94 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/compile_stats.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "xla/service/hlo.pb.h"
+
+namespace xla {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+void AddPass(HloModuleMetadataProto& metadata, absl::string_view pass_name,
+             absl::string_view pipeline_name, int64_t start_usec,
+             int64_t end_usec, int64_t instructions_before,
+             int64_t instructions_after, int64_t peak_memory_before,
+             int64_t peak_memory_after, int64_t dataflow_analysis_usec = 0) {
+  HloPassMetadata* pass = metadata.add_pass_metadata();
+  pass->set_pass_id(metadata.pass_metadata_size());
+  pass->set_pass_name(std::string(pass_name));
+  pass->set_pipeline_name(std::string(pipeline_name));
+  pass->set_start_timestamp_usec(start_usec);
+  pass->set_end_timestamp_usec(end_usec);
+  pass->set_module_changed(instructions_before != instructions_after);
+  pass->set_instruction_count_before(instructions_before);
+  pass->set_instruction_count_after(instructions_after);
+  pass->set_peak_memory_bytes_before(peak_memory_before);
+  pass->set_peak_memory_bytes_after(peak_memory_after);
+  pass->set_dataflow_analysis_usec(dataflow_analysis_usec);
+}
+
+TEST(CompileStatsTest, AggregatesPassesSlowestFirst) {
+  constexpr int64_t kMiB = 1024 * 1024;
+  HloModuleMetadataProto metadata;
+  AddPass(metadata, "pipeline-start", "opt", 0, 0, 10, 10, kMiB, kMiB);
+  AddPass(metadata, "cse", "opt", 0, 1000, 10, 8, kMiB, kMiB);
+  // A nested pipeline is recorded after its passes, and spans them.
+  AddPass(metadata, "dce", "simplification", 1000, 4000, 8, 6, kMiB, 3 * kMiB,
+          /*dataflow_analysis_usec=*/500);
+  AddPass(metadata, "dce", "simplification", 4000, 6000, 6, 6, 3 * kMiB,
+          3 * kMiB, /*dataflow_analysis_usec=*/250);
+  AddPass(metadata, "simplification", "opt", 1000, 6000, 8, 6, kMiB, 3 * kMiB,
+          /*dataflow_analysis_usec=*/750);
+  AddPass(metadata, "layout", "opt", 6000, 6500, 6, 7, 3 * kMiB, 4 * kMiB);
+
+  CompileStats stats = CompileStats::FromMetadata({&metadata});
+  ASSERT_EQ(stats.passes.size(), 3);
+  EXPECT_DOUBLE_EQ(stats.total_ms, 6.5);
+  EXPECT_EQ(stats.peak_memory_bytes, 4 * kMiB);
+  EXPECT_DOUBLE_EQ(stats.dataflow_analysis_ms, 0.75);
+
+  const CompileStats::PassStats& dce = stats.passes[0];
+  EXPECT_EQ(dce.pass_name, "dce");
+  EXPECT_EQ(dce.num_runs, 2);
+  EXPECT_EQ(dce.num_changed_runs, 1);
+  EXPECT_DOUBLE_EQ(dce.total_ms, 5);
+  EXPECT_DOUBLE_EQ(dce.max_ms, 3);
+  EXPECT_DOUBLE_EQ(dce.dataflow_analysis_ms, 0.75);
+  EXPECT_EQ(dce.instruction_count_delta, -2);
+  EXPECT_EQ(dce.peak_memory_increase_bytes, 2 * kMiB);
+
+  EXPECT_EQ(stats.passes[1].pass_name, "cse");
+  EXPECT_EQ(stats.passes[2].pass_name, "layout");
+  EXPECT_EQ(stats.passes[2].instruction_count_delta, 1);
+
+  std::string table = stats.ToTable(/*max_passes=*/2);
+  EXPECT_THAT(table, HasSubstr("dce"));
+  EXPECT_THAT(table, HasSubstr("cse"));
+  EXPECT_THAT(table, Not(HasSubstr("layout")));
+  EXPECT_THAT(table, Not(HasSubstr("simplification")));
+  EXPECT_THAT(table, HasSubstr("Peak memory: 4.0 MiB"));
+}
+
+}  // namespace
+}  // namespace xla
@@ -31,6 +31,7 @@ limitations under the License.
 // IWYU pragma: no_include "llvm/Config/Disassemblers.def.inc"
 // IWYU pragma: no_include "llvm/Config/Targets.def.inc"
 
+#include "absl/algorithm/container.h"
 #include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -41,11 +42,15 @@ limitations under the License.
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
@@ -57,12 +62,14 @@ limitations under the License.
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/TargetParser/Host.h"
 #include "llvm/TargetParser/Triple.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #ifdef TF_LLVM_X86_AVAILABLE
 #include "llvm/TargetParser/X86TargetParser.h"
 #endif
@@ -156,6 +163,8 @@ limitations under the License.
 #include "xla/service/cpu/runtime/xfeed.h"
 #include "xla/service/cpu/simple_orc_jit.h"
 #include "xla/service/cpu/target_machine_features.h"
+#include "xla/service/cpu/thunk_executor.h"
+#include "xla/service/cpu/thunk_outliner.h"
 #include "xla/service/cpu_gpu_shape_verifier.h"
 #include "xla/service/dot_decomposer.h"
 #include "xla/service/dump.h"
@@ -181,6 +190,7 @@ limitations under the License.
 #include "xla/service/hlo_pass_fix.h"
 #include "xla/service/hlo_pass_pipeline.h"
 #include "xla/service/hlo_profile_printer_data.pb.h"
+#include "xla/service/hlo_rematerialization.h"
 #include "xla/service/hlo_verifier.h"
 #include "xla/service/indexed_array_analysis.h"
 #include "xla/service/layout_assignment.h"
@@ -231,12 +241,15 @@ limitations under the License.
 #include "xla/util.h"
 #include "xla/xla.pb.h"
 #include "xla/xla_data.pb.h"
+#include "tsl/platform/blocking_counter.h"
 #include "tsl/platform/casts.h"
 #include "tsl/platform/cpu_info.h"
+#include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/logging.h"  // IWYU pragma: keep
 #include "tsl/platform/status.h"
 #include "tsl/platform/statusor.h"
+#include "tsl/platform/threadpool.h"
 
 #if defined(INTEL_MKL) && defined(ENABLE_ONEDNN_V3)
 #include "xla/service/cpu/cpu_float_support.h"
@@ -825,7 +838,7 @@ Status CpuCompiler::RunHloPassesThroughLayoutAssn(
 
     pipeline.AddPass<HloDCE>();
     pipeline.AddPass<ReshapeMover>();
-    pipeline.AddPass<HloConstantFolding>();
+    pipeline.AddPass<HloConstantFolding>(constant_folding_cache_);
     pipeline.AddPass<ConditionalSimplifier>();
   }();
   pipeline.AddPass<BitcastDtypesExpander>();
@@ -834,7 +847,15 @@ Status CpuCompiler::RunHloPassesThroughLayoutAssn(
   // support libcalls. Disable this for now.
   if (!is_mlir_compile) {
     pipeline.AddPass<TopkRewriter>([](const HloSortInstruction* sort, int64_t) {
-      return sort->operand(0)->shape().element_type() == F32;
+      switch (sort->operand(0)->shape().element_type()) {
+        case F32:
+        case BF16:
+        case F16:
+        case S32:
+          return true;
+        default:
+          return false;
+      }
     });
   }
   pipeline.AddPass<IndexedArrayAnalysisPrinterPass>();
@@ -996,6 +1017,50 @@ int64_t memory_alignment(LogicalBuffer::Color) {
   return cpu_function_runtime::MinAlign();
 }
 
+// Schedules `module` with `algorithm`. If the module has a memory limit, the
+// module is instead scheduled with the algorithm of the lowest peak memory out
+// of the list, DFS and post-order schedulers, and instructions are
+// rematerialized until the peak memory fits in the limit, if possible.
+absl::StatusOr<HloSchedule> ScheduleModuleWithMemoryLimit(
+    HloModule* module, const HloCostAnalysis::ShapeSizeFunction& shape_size,
+    const LogicalBuffer::SizeFunction& buffer_size,
+    const ModuleSchedulerAlgorithm& algorithm) {
+  const int64_t memory_limit_bytes =
+      module->config().debug_options().xla_cpu_memory_limit_bytes();
+  if (memory_limit_bytes <= 0) {
+    return ScheduleModule(module, buffer_size, algorithm);
+  }
+
+  HloPassPipeline pipeline("cpu-memory-limit");
+  // Without an algorithm, the scheduler picks the schedule of the lowest peak
+  // memory.
+  pipeline.AddPass<HloMemoryScheduler>(buffer_size);
+
+  HloCostAnalysis hlo_cost_analysis(shape_size);
+  // CPU layouts are dense, so there is no compact form to compress buffers to.
+  HloRematerialization::RematerializationModeConfig
+      rematerialization_mode_config(/*recompute=*/true, /*compress=*/false,
+                                    /*host_offload=*/false);
+  HloRematerialization::Options options(
+      hlo_cost_analysis, rematerialization_mode_config, memory_limit_bytes,
+      /*block_size_limit=*/1, /*block_rematerialization_factor=*/1,
+      /*min_remat_size=*/0, /*compact_shape_function=*/nullptr,
+      /*host_memory_offload_config=*/std::nullopt);
+  HloRematerialization::RematerializationSizes sizes;
+  pipeline.AddPass<HloRematerialization>(options, sizes);
+  TF_RETURN_IF_ERROR(pipeline.Run(module).status());
+
+  VLOG(1) << "HloRematerialization reduced the peak memory of "
+          << module->name() << " from " << sizes.before_bytes << " to "
+          << sizes.after_bytes << " bytes";
+  if (sizes.after_bytes > memory_limit_bytes) {
+    LOG(WARNING) << "Can't fit " << module->name() << " in "
+                 << memory_limit_bytes << " bytes, its peak memory is "
+                 << sizes.after_bytes << " bytes";
+  }
+  return module->schedule();
+}
+
 llvm::TargetOptions CompilerTargetOptions(
     const HloModuleConfig& module_config) {
   llvm::TargetOptions target_options;
@@ -1022,7 +1087,8 @@ llvm::CodeGenOptLevel CodeGenOptLevel(const HloModuleConfig& module_config) {
 std::pair<LLVMCompiler::ModuleHook, LLVMCompiler::ModuleHook> GetIRModuleHooks(
     const HloModule& hlo_module,
     const LLVMCompiler::ModuleHook& user_pre_optimization_hook,
-    const LLVMCompiler::ModuleHook& user_post_optimization_hook) {
+    const LLVMCompiler::ModuleHook& user_post_optimization_hook,
+    absl::string_view filename_suffix = "") {
   // Create the IR hooks. If applicable, each IR hook does the following:
   //
   //  * Calls the user supplied module hook.
@@ -1030,14 +1096,15 @@ std::pair<LLVMCompiler::ModuleHook, LLVMCompiler::ModuleHook> GetIRModuleHooks(
   //    --xla_dump_to
   const HloModule* hlo_module_ptr = &hlo_module;
   auto hook = [user_pre_optimization_hook, user_post_optimization_hook,
-               hlo_module_ptr](bool optimized,
-                               const llvm::Module& llvm_module) {
+               hlo_module_ptr, filename_suffix = std::string(filename_suffix)](
+                  bool optimized, const llvm::Module& llvm_module) {
     const auto& user_hook =
         !optimized ? user_pre_optimization_hook : user_post_optimization_hook;
     if (user_hook) {
       user_hook(llvm_module);
     }
-    llvm_ir::DumpIrIfEnabled(*hlo_module_ptr, llvm_module, optimized);
+    llvm_ir::DumpIrIfEnabled(*hlo_module_ptr, llvm_module, optimized,
+                             filename_suffix);
   };
   return {[hook](const llvm::Module& llvm_module) {
             return hook(/*optimized=*/false, llvm_module);
@@ -1062,6 +1129,117 @@ Status VerifyLlvmModule(const llvm::Module& llvm_module) {
   return absl::OkStatus();
 }
 
+// Optimizes and compiles one part of a split LLVM module, given as bitcode, to
+// object code. The part is parsed into its own LLVMContext and compiled with
+// its own TargetMachine, as neither is safe to share between threads.
+absl::StatusOr<std::unique_ptr<llvm::MemoryBuffer>> CompileModulePart(
+    llvm::StringRef bitcode, int part_index, const HloModule& hlo_module,
+    LLVMCompiler::ModuleHook pre_optimization_hook,
+    LLVMCompiler::ModuleHook post_optimization_hook) {
+  const HloModuleConfig& config = hlo_module.config();
+  llvm::LLVMContext context;
+  llvm::Expected<std::unique_ptr<llvm::Module>> part = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, "split_module"), context);
+  if (!part) {
+    return Internal("Failed to parse part %d of the LLVM module: %s",
+                    part_index, llvm::toString(part.takeError()));
+  }
+
+  llvm::CodeGenOptLevel opt_level = CodeGenOptLevel(config);
+  std::unique_ptr<llvm::TargetMachine> target_machine =
+      SimpleOrcJIT::InferTargetMachineForJIT(CompilerTargetOptions(config),
+                                             opt_level);
+  CompilerFunctor compiler_functor(
+      target_machine.get(), static_cast<int>(opt_level),
+      options::OptimizeForSizeRequested(config),
+      config.debug_options().xla_llvm_disable_expensive_passes(),
+      options::SlpVectorizerDisabled(config),
+      llvm_ir::GetCpuFastMathFlags(config), std::move(pre_optimization_hook),
+      std::move(post_optimization_hook));
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> obj_file =
+      compiler_functor(**part);
+  if (!obj_file) {
+    return Internal("Failed to compile part %d of the LLVM module: %s",
+                    part_index, llvm::toString(obj_file.takeError()));
+  }
+  return std::move(*obj_file);
+}
+
+// Splits `llvm_module` into at most `num_parts` parts and compiles them to
+// object code in parallel on `thread_pool`, or on a thread pool owned by this
+// function if `thread_pool` is null. Functions are distributed round-robin by
+// size. Internal symbols that are referenced across parts are externalized
+// with hidden visibility, so the object files link against each other once
+// they are added to the same JIT. IR hooks are invoked once per part and never
+// concurrently. Returns the object files in part order.
+absl::StatusOr<std::vector<std::unique_ptr<llvm::MemoryBuffer>>>
+CompileModuleInParallel(
+    std::unique_ptr<llvm::Module> llvm_module, int num_parts,
+    const HloModule& hlo_module,
+    const LLVMCompiler::ModuleHook& user_pre_optimization_hook,
+    const LLVMCompiler::ModuleHook& user_post_optimization_hook,
+    tsl::thread::ThreadPool* thread_pool) {
+  XLA_SCOPED_LOGGING_TIMER("CpuCompiler - Compiling LLVM module in parallel");
+
+  // All parts produced by SplitModule live in the context of `llvm_module`, so
+  // they are handed over to the compile threads as bitcode.
+  std::vector<llvm::SmallString<0>> bitcode_parts;
+  llvm::SplitModule(
+      *llvm_module, num_parts,
+      [&](std::unique_ptr<llvm::Module> part) {
+        llvm::raw_svector_ostream ostream(bitcode_parts.emplace_back());
+        llvm::WriteBitcodeToFile(*part, ostream);
+      },
+      /*PreserveLocals=*/false, /*RoundRobin=*/true);
+  llvm_module.reset();
+  VLOG(1) << "Split LLVM module of " << hlo_module.name() << " into "
+          << bitcode_parts.size() << " parts";
+
+  std::optional<tsl::thread::ThreadPool> owned_thread_pool;
+  if (thread_pool == nullptr) {
+    owned_thread_pool.emplace(tsl::Env::Default(), "xla_cpu_codegen",
+                              bitcode_parts.size());
+    thread_pool = &*owned_thread_pool;
+  }
+
+  absl::Mutex hooks_mu;
+  auto serialize_hook = [&hooks_mu](LLVMCompiler::ModuleHook hook) {
+    return [&hooks_mu, hook = std::move(hook)](const llvm::Module& module) {
+      absl::MutexLock lock(&hooks_mu);
+      hook(module);
+    };
+  };
+
+  std::vector<absl::StatusOr<std::unique_ptr<llvm::MemoryBuffer>>> results(
+      bitcode_parts.size());
+  tsl::BlockingCounter counter(bitcode_parts.size());
+  for (int i = 0; i < bitcode_parts.size(); ++i) {
+    auto [pre_optimization_hook, post_optimization_hook] =
+        GetIRModuleHooks(hlo_module, user_pre_optimization_hook,
+                         user_post_optimization_hook, absl::StrCat("part", i));
+    thread_pool->Schedule([&, i,
+                           pre_optimization_hook =
+                               serialize_hook(std::move(pre_optimization_hook)),
+                           post_optimization_hook = serialize_hook(
+                               std::move(post_optimization_hook))] {
+      results[i] =
+          CompileModulePart(bitcode_parts[i].str(), i, hlo_module,
+                            pre_optimization_hook, post_optimization_hook);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> obj_files;
+  obj_files.reserve(results.size());
+  for (absl::StatusOr<std::unique_ptr<llvm::MemoryBuffer>>& result : results) {
+    TF_ASSIGN_OR_RETURN(std::unique_ptr<llvm::MemoryBuffer> obj_file,
+                        std::move(result));
+    obj_files.push_back(std::move(obj_file));
+  }
+  return obj_files;
+}
+
 Status CreateHloProfilingArtifacts(
     const HloModule& module,
     absl::flat_hash_map<const HloInstruction*, int64_t>*
@@ -1326,7 +1504,8 @@ std::vector<ComputationToEmit> SubcomputationEmissionOrder(
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<CpuExecutable>>
-CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module) {
+CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module,
+                                        tsl::thread::ThreadPool* thread_pool) {
   ModuleHook pre_optimization_ir_hook;
   ModuleHook post_optimization_ir_hook;
   std::tie(pre_optimization_ir_hook, post_optimization_ir_hook) =
@@ -1359,6 +1538,33 @@ CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module) {
   llvm_module->setDataLayout((*jit)->data_layout());
   llvm_module->setTargetTriple((*jit)->target_triple().getTriple());
 
+  // The thunk runtime needs every instruction of the entry computation in a
+  // function of its own. Profile counters are updated without synchronization,
+  // so profiled executables always run the entry function.
+  const bool use_thunk_runtime =
+      module->config().debug_options().xla_cpu_use_thunk_runtime() &&
+      !module->config().hlo_profiling_enabled();
+
+  // Select an order for emitting the HLO instructions for each
+  // computation. Using this sequence enables tighter buffer liveness analysis
+  // and reduced memory usage (as compared to using DependencyHloOrdering).
+  // Rematerialization may add instructions, so this runs before the profile
+  // indices are assigned.
+  TF_ASSIGN_OR_RETURN(
+      HloSchedule schedule,
+      ScheduleModuleWithMemoryLimit(
+          module.get(), ShapeSizeBytesFunction(), BufferSizeBytesFunction(),
+          ComputationSchedulerToModuleScheduler(DFSMemoryScheduler)));
+
+  // Outline the thunks after scheduling, so that rematerialization sees the
+  // instructions of the entry computation rather than opaque calls, and the
+  // instructions it adds are outlined as well.
+  if (use_thunk_runtime) {
+    TF_RETURN_IF_ERROR(module->set_schedule(std::move(schedule)));
+    TF_RETURN_IF_ERROR(ThunkOutliner().Run(module.get()).status());
+    schedule = module->schedule();
+  }
+
   HloComputation* entry_computation = module->entry_computation();
   absl::flat_hash_map<const HloInstruction*, int64_t>
       instruction_to_profile_idx;
@@ -1377,24 +1583,32 @@ CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module) {
   const bool embed_ir_in_executable =
       module->config().debug_options().xla_embed_ir_in_executable();
 
-  // Select an order for emitting the HLO instructions for each
-  // computation. Using this sequence enables tighter buffer liveness analysis
-  // and reduced memory usage (as compared to using DependencyHloOrdering).
-  TF_ASSIGN_OR_RETURN(HloSchedule schedule,
-                      ScheduleModule(module.get(), BufferSizeBytesFunction(),
-                                     ComputationSchedulerToModuleScheduler(
-                                         DFSMemoryScheduler)));
-
   // Run buffer allocation on the HLO graph.
   TF_ASSIGN_OR_RETURN(
       std::unique_ptr<BufferAssignment> assignment,
-      BufferAssigner::Run(module.get(),
-                          std::make_unique<SequentialHloOrdering>(schedule),
-                          BufferSizeBytesFunction(), memory_alignment,
-                          /*allocate_buffers_for_constants=*/true));
+      BufferAssigner::Run(
+          module.get(), std::make_unique<SequentialHloOrdering>(schedule),
+          BufferSizeBytesFunction(), memory_alignment,
+          /*allocate_buffers_for_constants=*/true,
+          BufferAssigner::DefaultColorer(),
+          /*must_not_live_out=*/std::nullopt, /*can_share_buffer=*/nullptr,
+          /*preset_assignments=*/{}, /*private_stacks=*/{},
+          /*heap_buffer_interval_compare=*/nullptr,
+          /*isolation_options=*/std::nullopt, thread_pool));
   DumpHloModuleIfEnabled(*module, *assignment,
                          absl::StrCat("cpu_", kAfterOptimizationsDumpName));
 
+  std::vector<ThunkInfo> thunk_infos;
+  absl::flat_hash_map<const HloComputation*, llvm::Function*> thunk_functions;
+  if (use_thunk_runtime) {
+    TF_ASSIGN_OR_RETURN(
+        thunk_infos,
+        AnalyzeThunks(schedule.sequence(entry_computation), *assignment));
+    for (const ThunkInfo& thunk_info : thunk_infos) {
+      thunk_functions[thunk_info.call->to_apply()] = nullptr;
+    }
+  }
+
   // Each computation is a single function.  Emit all embedded computations
   // before the entry computation. The order of computations returned from
   // GetEmbeddedComputations guarantees that a called computation occurs
@@ -1421,14 +1635,20 @@ CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module) {
     if (subcomputation.computation->IsFusionComputation()) {
       continue;
     }
-    TF_RETURN_IF_ERROR(
-        ir_emitter
-            .EmitComputation(
-                subcomputation.computation, subcomputation.computation->name(),
-                /*is_top_level_computation=*/false,
-                schedule.sequence(subcomputation.computation).instructions(),
-                subcomputation.allow_reassociation)
-            .status());
+    TF_ASSIGN_OR_RETURN(
+        llvm::Function * function,
+        ir_emitter.EmitComputation(
+            subcomputation.computation, subcomputation.computation->name(),
+            /*is_top_level_computation=*/false,
+            schedule.sequence(subcomputation.computation).instructions(),
+            subcomputation.allow_reassociation));
+    auto thunk_function = thunk_functions.find(subcomputation.computation);
+    if (thunk_function != thunk_functions.end() &&
+        !subcomputation.allow_reassociation) {
+      // Thunks are called by the runtime rather than by the entry function.
+      function->setLinkage(llvm::GlobalValue::ExternalLinkage);
+      thunk_function->second = function;
+    }
   }
   absl::string_view function_name_prefix = entry_computation->name().empty()
                                                ? "__compute"
@@ -1440,13 +1660,27 @@ CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module) {
                           schedule.sequence(entry_computation).instructions(),
                           /*allow_reassociation=*/false));
 
-  function_name = [&]() {
+  auto mangled_name = [&](const llvm::Function* function) {
     llvm::SmallVector<char, 40> function_name_vector;
     llvm::Mangler::getNameWithPrefix(
-        function_name_vector, entry_function->getName(), (*jit)->data_layout());
+        function_name_vector, function->getName(), (*jit)->data_layout());
     return std::string(function_name_vector.begin(),
                        function_name_vector.end());
-  }();
+  };
+  function_name = mangled_name(entry_function);
+
+  std::vector<ThunkExecutor::Thunk> thunks;
+  thunks.reserve(thunk_infos.size());
+  for (ThunkInfo& thunk_info : thunk_infos) {
+    const llvm::Function* function =
+        thunk_functions.at(thunk_info.call->to_apply());
+    TF_RET_CHECK(function != nullptr)
+        << "No function emitted for thunk " << thunk_info.call->name();
+    ThunkExecutor::Thunk& thunk = thunks.emplace_back();
+    thunk.name = mangled_name(function);
+    thunk.dependencies = std::move(thunk_info.dependencies);
+    thunk.has_side_effects = thunk_info.has_side_effects;
+  }
 
   std::string ir_module_string;
   if (embed_ir_in_executable) {
@@ -1455,17 +1689,44 @@ CpuCompiler::CompileLegacyCpuExecutable(std::unique_ptr<HloModule> module) {
 
   TF_RETURN_IF_ERROR(VerifyLlvmModule(*llvm_module));
 
-  // JIT compile the LLVM IR module to in-memory machine code.
-  llvm::orc::ThreadSafeModule thread_safe_module(std::move(llvm_module),
-                                                 std::move(llvm_context));
-  cantFail((*jit)->AddModule(std::move(thread_safe_module)));
+  // Split the module into parts that are compiled in parallel if requested
+  // and if there are enough functions to split.
+  int num_parts = std::min<int64_t>(
+      module->config().debug_options().xla_cpu_parallel_codegen_split_count(),
+      absl::c_count_if(llvm_module->functions(), [](const llvm::Function& f) {
+        return !f.isDeclaration();
+      }));
+
+  if (num_parts > 1) {
+    TF_ASSIGN_OR_RETURN(
+        std::vector<std::unique_ptr<llvm::MemoryBuffer>> obj_buffers,
+        CompileModuleInParallel(std::move(llvm_module), num_parts, *module,
+                                user_pre_optimization_hook_,
+                                user_post_optimization_hook_, thread_pool));
+    for (int i = 0; i < obj_buffers.size(); ++i) {
+      llvm::StringRef obj_file = obj_buffers[i]->getBuffer();
+      obj_files.push_back(obj_file.str());
+      if (DumpingEnabledForHloModule(*module)) {
+        DumpToFileInDir(*module, /*file_prefix=*/"",
+                        /*file_suffix=*/absl::StrCat("part", i, ".o"),
+                        absl::string_view(obj_file.data(), obj_file.size()));
+      }
+      cantFail((*jit)->AddObjFile(std::move(obj_buffers[i])));
+    }
+  } else {
+    // JIT compile the LLVM IR module to in-memory machine code.
+    llvm::orc::ThreadSafeModule thread_safe_module(std::move(llvm_module),
+                                                   std::move(llvm_context));
+    cantFail((*jit)->AddModule(std::move(thread_safe_module)));
+  }
 
   TF_ASSIGN_OR_RETURN(
       auto cpu_executable,
       CpuExecutable::Create(std::move(*jit), std::move(assignment),
                             std::move(module), function_name,
                             std::move(hlo_profile_printer_data),
-                            std::move(hlo_profile_index_map)));
+                            std::move(hlo_profile_index_map),
+                            std::move(thunks)));
 
   cpu_executable->set_obj_files(std::move(obj_files));
 
@@ -1517,8 +1778,8 @@ CpuCompiler::CompileXlaRuntimeCpuExecutable(
   // and reduced memory usage (as compared to using DependencyHloOrdering).
   TF_ASSIGN_OR_RETURN(
       HloSchedule schedule,
-      ScheduleModule(
-          hlo_module.get(), BufferSizeBytesFunction(),
+      ScheduleModuleWithMemoryLimit(
+          hlo_module.get(), ShapeSizeBytesFunction(), BufferSizeBytesFunction(),
           ComputationSchedulerToModuleScheduler(DFSMemoryScheduler)));
 
   // Run buffer allocation on the HLO graph.
@@ -1590,7 +1851,8 @@ absl::StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
 
   std::unique_ptr<CpuExecutable> cpu_executable;
   TF_ASSIGN_OR_RETURN(cpu_executable,
-                      CompileLegacyCpuExecutable(std::move(module)));
+                      CompileLegacyCpuExecutable(std::move(module),
+                                                 options.thread_pool));
 
   cpu_executable->set_debug_info(
       cpu_executable->buffer_assignment().GetStats().ToString());
@@ -1703,8 +1965,11 @@ CpuCompiler::CompileAheadOfTime(std::unique_ptr<HloModuleGroup> module_group,
                        /*dummy*/ CompileOptions{},
                        /*is_mlir_compile=*/options.use_mlir_hlo_lowering()));
 
-      TF_ASSIGN_OR_RETURN(HloSchedule schedule,
-                          ScheduleModule(module, BufferSizeBytesFunction()));
+      TF_ASSIGN_OR_RETURN(
+          HloSchedule schedule,
+          ScheduleModuleWithMemoryLimit(module, ShapeSizeBytesFunction(),
+                                        BufferSizeBytesFunction(),
+                                        /*algorithm=*/{}));
 
       // Run buffer analysis on the HLO graph. This analysis figures out which
       // temporary buffers are required to run the computation.
@@ -1888,14 +2153,24 @@ namespace {
 // result that can be saved on disk and shipped over the wire.
 class CpuExecutableAotCompilationResult : public AotCompilationResult {
  public:
-  CpuExecutableAotCompilationResult(const HloModule* hlo_module,
-                                    const BufferAssignment* buffer_assignment,
-                                    std::string_view function_name,
-                                    std::string_view obj_file) {
+  CpuExecutableAotCompilationResult(
+      const HloModule* hlo_module, const BufferAssignment* buffer_assignment,
+      std::string_view function_name, absl::Span<const std::string> obj_files,
+      absl::Span<const ThunkExecutor::Thunk> thunks) {
     *proto_.mutable_hlo_module()->mutable_hlo_module() = hlo_module->ToProto();
     *proto_.mutable_buffer_assignment() = buffer_assignment->ToProto();
     proto_.set_entry_function_name(std::string(function_name));
-    proto_.set_obj_file(std::string(obj_file));
+    proto_.set_obj_file(obj_files.front());
+    for (const std::string& obj_file : obj_files.subspan(1)) {
+      proto_.add_additional_obj_files(obj_file);
+    }
+    for (const ThunkExecutor::Thunk& thunk : thunks) {
+      ThunkProto* thunk_proto = proto_.add_thunks();
+      thunk_proto->set_name(thunk.name);
+      thunk_proto->mutable_dependencies()->Add(thunk.dependencies.begin(),
+                                               thunk.dependencies.end());
+      thunk_proto->set_has_side_effects(thunk.has_side_effects);
+    }
     *proto_.mutable_hlo_module()->mutable_config() =
         *hlo_module->config().ToProto();
     module_ = hlo_module->Clone();
@@ -1969,18 +2244,33 @@ CpuExecutableAotCompilationResult::LoadExecutable(
     return Internal("Creating JIT failed: %s", llvm::toString(jit.takeError()));
   }
 
-  // Create a named buffer from compiled object file.
-  llvm::StringRef data(proto_.obj_file().data(), proto_.obj_file().size());
-  auto obj_file =
-      llvm::MemoryBuffer::getMemBuffer(data, proto_.entry_function_name());
+  // Create named buffers from compiled object files.
+  auto add_obj_file = [&](const std::string& obj_file) {
+    llvm::StringRef data(obj_file.data(), obj_file.size());
+    cantFail((*jit)->AddObjFile(
+        llvm::MemoryBuffer::getMemBuffer(data, proto_.entry_function_name())));
+  };
+  add_obj_file(proto_.obj_file());
+  for (const std::string& obj_file : proto_.additional_obj_files()) {
+    add_obj_file(obj_file);
+  }
 
-  cantFail((*jit)->AddObjFile(std::move(obj_file)));
+  // The thunk functions are resolved by name in the JIT, like at compile time.
+  std::vector<ThunkExecutor::Thunk> thunks;
+  thunks.reserve(proto_.thunks_size());
+  for (const ThunkProto& thunk_proto : proto_.thunks()) {
+    ThunkExecutor::Thunk& thunk = thunks.emplace_back();
+    thunk.name = thunk_proto.name();
+    thunk.dependencies.assign(thunk_proto.dependencies().begin(),
+                              thunk_proto.dependencies().end());
+    thunk.has_side_effects = thunk_proto.has_side_effects();
+  }
 
   TF_ASSIGN_OR_RETURN(
       auto cpu_executable,
       CpuExecutable::Create(std::move(*jit), std::move(buffer_assignment),
                             std::move(module), proto_.entry_function_name(),
-                            nullptr, nullptr));
+                            nullptr, nullptr, std::move(thunks)));
 
   // Dump computation proto state and buffer assignment for
   // GetCompiledMemoryStats results.
@@ -1999,16 +2289,16 @@ absl::StatusOr<std::unique_ptr<AotCompilationResult>> CpuCompiler::Export(
   if (!cpu_executable)
     return Internal("Could not downcast Executable to CpuExecutable");
 
-  if (cpu_executable->obj_files().size() != 1) {
+  if (cpu_executable->obj_files().empty()) {
     return absl::InternalError(
-        absl::StrCat("Can't export CPU execuable, expected exactly one object "
-                     "file but got: ",
-                     cpu_executable->obj_files().size()));
+        "Can't export CPU execuable, expected at least one object file but got "
+        "none");
   }
 
   return {std::make_unique<CpuExecutableAotCompilationResult>(
       &cpu_executable->module(), &cpu_executable->buffer_assignment(),
-      cpu_executable->module_name(), cpu_executable->obj_files()[0])};
+      cpu_executable->module_name(), cpu_executable->obj_files(),
+      cpu_executable->thunks())};
 }
 
 absl::StatusOr<std::unique_ptr<AotCompilationResult>>
@@ -33,6 +33,7 @@ limitations under the License.
 #include "xla/service/cpu/xla_framework.h"
 #include "xla/service/executable.h"
 #include "xla/service/hlo.pb.h"
+#include "xla/service/hlo_constant_folding.h"
 #include "xla/service/hlo_cost_analysis.h"
 #include "xla/service/hlo_profile_printer_data.pb.h"
 #include "xla/service/llvm_compiler.h"
@@ -40,6 +41,7 @@ limitations under the License.
 #include "xla/statusor.h"
 #include "xla/stream_executor/stream_executor.h"
 #include "xla/util.h"
+#include "tsl/platform/threadpool.h"
 
 namespace mlir {
 class DialectRegistry;
@@ -212,8 +214,16 @@ class CpuCompiler : public LLVMCompiler {
       LLVMTargetMachineFeatures* target_machine_features,
       const CompileOptions& compile_options, bool is_mlir_compile);
 
+  // Compiles `module` with the LLVM IR emitter. If the LLVM module is split
+  // for parallel codegen, the parts are compiled on `thread_pool` (which may be
+  // null).
   absl::StatusOr<std::unique_ptr<CpuExecutable>> CompileLegacyCpuExecutable(
-      std::unique_ptr<HloModule> module);
+      std::unique_ptr<HloModule> module, tsl::thread::ThreadPool* thread_pool);
+
+  // Memoizes constant folding across the pipelines and compilations of this
+  // compiler.
+  std::shared_ptr<ConstantFoldingCache> constant_folding_cache_ =
+      std::make_shared<ConstantFoldingCache>();
 
   CpuCompiler(const CpuCompiler&) = delete;
   CpuCompiler& operator=(const CpuCompiler&) = delete;
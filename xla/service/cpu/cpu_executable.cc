@@ -64,7 +64,8 @@ absl::StatusOr<std::unique_ptr<CpuExecutable>> CpuExecutable::Create(
     std::unique_ptr<HloModule> hlo_module,
     const std::string& entry_function_name,
     std::unique_ptr<HloProfilePrinterData> hlo_profile_printer_data,
-    std::unique_ptr<HloProfileIndexMap> hlo_profile_index_map) {
+    std::unique_ptr<HloProfileIndexMap> hlo_profile_index_map,
+    std::vector<ThunkExecutor::Thunk> thunks) {
   std::unique_ptr<CpuExecutable> executable(new CpuExecutable(
       std::move(hlo_module), std::move(hlo_profile_printer_data),
       std::move(hlo_profile_index_map), std::move(assignment)));
@@ -87,6 +88,24 @@ absl::StatusOr<std::unique_ptr<CpuExecutable>> CpuExecutable::Create(
       reinterpret_cast<ComputeFunctionType>(sym->getAddress().getValue());
   VLOG(1) << "compute_function_ at address "
           << reinterpret_cast<void*>(executable->compute_function_);
+
+  if (!thunks.empty()) {
+    for (ThunkExecutor::Thunk& thunk : thunks) {
+      llvm::Expected<llvm::orc::ExecutorSymbolDef> thunk_sym =
+          executable->jit_->FindCompiledSymbol(thunk.name);
+      if (!thunk_sym) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Symbol ", thunk.name, " not found."));
+      }
+      thunk.function = reinterpret_cast<ThunkExecutor::ThunkFunction>(
+          thunk_sym->getAddress().getValue());
+    }
+    TF_ASSIGN_OR_RETURN(ThunkExecutor thunk_executor,
+                        ThunkExecutor::Create(std::move(thunks)));
+    VLOG(1) << "Executing " << thunk_executor.thunks().size()
+            << " thunks, sequential: " << thunk_executor.is_sequential();
+    executable->thunk_executor_ = std::move(thunk_executor);
+  }
   executable->jit_->DoneCompiling();
   return executable;
 }
@@ -256,8 +275,8 @@ Status CpuExecutable::ExecuteComputeFunction(
     // For the entry computation (like all global computations), all inputs and
     // outputs are in the buffer table, and both the result pointer and args
     // array pointers are unused (so we set them to 'nullptr').
-    compute_function_(nullptr, run_options, nullptr, buffer_pointers.data(),
-                      &status, profile_counters);
+    CallComputeFunction(nullptr, run_options, buffer_pointers.data(), &status,
+                        profile_counters);
     record_profile();
     std::optional<absl::string_view> error_message =
         CustomCallStatusGetMessage(&status);
@@ -269,6 +288,19 @@ Status CpuExecutable::ExecuteComputeFunction(
   return OkStatus();
 }
 
+void CpuExecutable::CallComputeFunction(void* result_buffer,
+                                        const ExecutableRunOptions* run_options,
+                                        void** buffer_table,
+                                        XlaCustomCallStatus* status,
+                                        int64_t* profile_counters) const {
+  if (thunk_executor_.has_value()) {
+    thunk_executor_->Execute(run_options, buffer_table, status);
+  } else {
+    compute_function_(result_buffer, run_options, nullptr, buffer_table,
+                      status, profile_counters);
+  }
+}
+
 absl::StatusOr<ExecutionOutput> CpuExecutable::CreateResultShapedBuffer(
     const ServiceExecutableRunOptions* run_options,
     absl::Span<MaybeOwningDeviceMemory> buffers,
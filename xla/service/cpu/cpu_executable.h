@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -32,6 +33,7 @@ limitations under the License.
 #include "xla/service/buffer_assignment.h"
 #include "xla/service/cpu/buffer_desc.h"
 #include "xla/service/cpu/simple_orc_jit.h"
+#include "xla/service/cpu/thunk_executor.h"
 #include "xla/service/cpu/xla_framework.h"
 #include "xla/service/custom_call_status_internal.h"
 #include "xla/service/executable.h"
@@ -111,13 +113,16 @@ class XlaRuntimeCpuExecutable {
 // architecture, so JIT-ed code and host code share the same ABI.
 class CpuExecutable : public Executable {
  public:
+  // If `thunks` is not empty, the executable runs the thunks of the entry
+  // computation (resolved by name in `jit`) instead of the entry function.
   static absl::StatusOr<std::unique_ptr<CpuExecutable>> Create(
       std::unique_ptr<SimpleOrcJIT> jit,
       std::unique_ptr<const BufferAssignment> assignment,
       std::unique_ptr<HloModule> hlo_module,
       const std::string& entry_function_name,
       std::unique_ptr<HloProfilePrinterData> hlo_profile_printer_data,
-      std::unique_ptr<HloProfileIndexMap> hlo_profile_index_map);
+      std::unique_ptr<HloProfileIndexMap> hlo_profile_index_map,
+      std::vector<ThunkExecutor::Thunk> thunks = {});
   // XLA Runtime factory method.
   static absl::StatusOr<std::unique_ptr<CpuExecutable>> Create(
       std::unique_ptr<HloModule> hlo_module,
@@ -175,6 +180,23 @@ class CpuExecutable : public Executable {
     return compute_function_;
   }
 
+  // Runs the compiled computation on `buffer_table`, either by calling the
+  // entry function or by executing the thunks of the entry computation.
+  // Failures are reported in `status`.
+  void CallComputeFunction(void* result_buffer,
+                           const ExecutableRunOptions* run_options,
+                           void** buffer_table, XlaCustomCallStatus* status,
+                           int64_t* profile_counters) const;
+
+  bool uses_thunks() const { return thunk_executor_.has_value(); }
+
+  // Returns the thunks of the entry computation, empty if the executable does
+  // not use the thunk runtime.
+  absl::Span<const ThunkExecutor::Thunk> thunks() const {
+    if (!thunk_executor_.has_value()) return {};
+    return thunk_executor_->thunks();
+  }
+
   const BufferAssignment& buffer_assignment() const { return *assignment_; }
 
   int64_t SizeOfGeneratedCodeInBytes() const override;
@@ -236,6 +258,9 @@ class CpuExecutable : public Executable {
 
   ComputeFunctionType compute_function_;
 
+  // Set if the executable was compiled for the thunk runtime.
+  std::optional<ThunkExecutor> thunk_executor_;
+
   // Entry function name for the computation.
   const std::string entry_function_name_;
 
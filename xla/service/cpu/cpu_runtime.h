@@ -77,6 +77,9 @@ extern const char* const kPrintfToStderrSymbolName;
 extern const char* const kStatusIsSuccessSymbolName;
 extern const char* const kKeyValueSortSymbolName;
 extern const char* const kTopKF32SymbolName;
+extern const char* const kTopKBF16SymbolName;
+extern const char* const kTopKF16SymbolName;
+extern const char* const kTopKS32SymbolName;
 extern const char* const kAllReduceSymbolName;
 extern const char* const kCollectivePermuteSymbolName;
 extern const char* const kPartitionIdSymbolName;
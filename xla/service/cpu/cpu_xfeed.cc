@@ -57,6 +57,26 @@ class CpuInfeedBuffer : public cpu::runtime::XfeedBuffer {
   char* buffer_;
 };
 
+// Infeed buffer that borrows host memory of the client.
+class CpuHostInfeedBuffer : public cpu::runtime::XfeedBuffer {
+ public:
+  CpuHostInfeedBuffer(const void* data, int32_t length,
+                      absl::AnyInvocable<void() &&> on_done)
+      : data_(data), length_(length), on_done_(std::move(on_done)) {}
+
+  int32_t length() override { return length_; }
+  void* data() override { return const_cast<void*>(data_); }
+  void Done(absl::StatusOr<Shape> /*shape*/) override {
+    std::move(on_done_)();
+    delete this;
+  }
+
+ private:
+  const void* data_;
+  int32_t length_;
+  absl::AnyInvocable<void() &&> on_done_;
+};
+
 class CpuOutfeedBuffer : public cpu::runtime::XfeedBuffer {
  public:
   CpuOutfeedBuffer(void* destination, int32_t length)
@@ -81,10 +101,7 @@ class CpuOutfeedBuffer : public cpu::runtime::XfeedBuffer {
   tsl::Notification done_;
 };
 
-// Transfers infeed data to device. InfeedBuffer->Done() must be called to
-// clean up the memory allocated for InfeedBuffer.
-absl::StatusOr<cpu::runtime::XfeedBuffer*> TransferBufferToInfeedInternal(
-    int64_t size, const void* source) {
+Status CheckInfeedSize(int64_t size) {
   if (size > std::numeric_limits<int32_t>::max()) {
     return InvalidArgument("CPU infeed of %d bytes exceeds maximum of %d bytes",
                            size, std::numeric_limits<int32_t>::max());
@@ -94,6 +111,14 @@ absl::StatusOr<cpu::runtime::XfeedBuffer*> TransferBufferToInfeedInternal(
     return InvalidArgument("Infeed shape must have positive size; got %d",
                            size);
   }
+  return OkStatus();
+}
+
+// Transfers infeed data to device. InfeedBuffer->Done() must be called to
+// clean up the memory allocated for InfeedBuffer.
+absl::StatusOr<cpu::runtime::XfeedBuffer*> TransferBufferToInfeedInternal(
+    int64_t size, const void* source) {
+  TF_RETURN_IF_ERROR(CheckInfeedSize(size));
 
   auto size_32 = static_cast<int32_t>(size);
   auto queued_buffer = new CpuInfeedBuffer(size_32);
@@ -221,6 +246,18 @@ Status TransferLiteralToInfeedOnCpu(int device_ordinal,
   return OkStatus();
 }
 
+Status TransferHostBufferToInfeedOnCpu(int device_ordinal, const void* data,
+                                       int64_t size,
+                                       absl::AnyInvocable<void() &&> on_done) {
+  TF_RETURN_IF_ERROR(CheckInfeedSize(size));
+  auto* buffer = new CpuHostInfeedBuffer(data, static_cast<int32_t>(size),
+                                         std::move(on_done));
+  cpu::runtime::XfeedManager* xfeed_manager =
+      cpu::runtime::GetXfeedManager(device_ordinal);
+  xfeed_manager->infeed()->EnqueueBuffersAtomically({buffer});
+  return OkStatus();
+}
+
 Status TransferLiteralFromOutfeedOnCpu(int device_ordinal,
                                        MutableBorrowingLiteral literal) {
   if (!literal.shape().IsTuple()) {
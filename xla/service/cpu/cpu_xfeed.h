@@ -16,8 +16,10 @@ limitations under the License.
 #ifndef XLA_SERVICE_CPU_CPU_XFEED_H_
 #define XLA_SERVICE_CPU_CPU_XFEED_H_
 
+#include <cstdint>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
 #include "xla/literal.h"
 #include "xla/service/hlo_cost_analysis.h"
 #include "xla/service/shaped_buffer.h"
@@ -33,6 +35,14 @@ namespace xla {
 Status TransferLiteralToInfeedOnCpu(int device_ordinal,
                                     const LiteralSlice& literal);
 
+// Enqueues the `size` bytes at `data` to the infeed on CPU without copying
+// them. `data` must stay valid and unmodified until `on_done` is called, which
+// happens once the computation consumed the buffer or the infeed queue was
+// reset.
+Status TransferHostBufferToInfeedOnCpu(int device_ordinal, const void* data,
+                                       int64_t size,
+                                       absl::AnyInvocable<void() &&> on_done);
+
 // Helper function to transfers from outfeed on CPU.
 Status TransferLiteralFromOutfeedOnCpu(int device_ordinal,
                                        MutableBorrowingLiteral literal);
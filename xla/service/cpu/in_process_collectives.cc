@@ -16,6 +16,7 @@ limitations under the License.
 #include "xla/service/cpu/in_process_collectives.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -23,8 +24,10 @@ limitations under the License.
 #include <memory>
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "absl/base/config.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
@@ -32,12 +35,14 @@ limitations under the License.
 #include "absl/strings/str_join.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "Eigen/Core"  // from @eigen_archive
 #include "xla/primitive_util.h"
 #include "xla/refcounting_hash_map.h"
 #include "xla/service/collective_ops_utils.h"
 #include "xla/service/cpu/collectives_interface.h"
 #include "xla/service/global_device_id.h"
 #include "xla/status_macros.h"
+#include "xla/types.h"
 #include "xla/util.h"
 #include "xla/xla_data.pb.h"
 #include "tsl/platform/errors.h"
@@ -72,19 +77,34 @@ struct AllReduceParticipantData : ParticipantData {
   }
 };
 
+// Number of bytes of accumulator that a chunk is reduced in at a time. All
+// inputs are folded into a block that stays in L1, and the block is then
+// written to every output, instead of streaming the whole chunk through the
+// cache once per input.
+constexpr int64_t kReduceBlockBytes = 8 * 1024;
+
+// Reductions that write at least this many bytes use non-temporal stores. The
+// collective never reads its outputs back, and writing them through the cache
+// would evict the inputs that the other participants are still reading.
+constexpr int64_t kNonTemporalStoreThresholdBytes = 4 * 1024 * 1024;
+
+// Type that elements of type T are accumulated in. Half-precision types are
+// accumulated in F32, which is more accurate and lets the reduction loops
+// vectorize; the values are converted back when they are stored.
 template <typename T>
-T GetInitialValue(ReductionKind reduction_kind) {
-  switch (reduction_kind) {
-    case ReductionKind::SUM:
-      return static_cast<T>(0);
-    case ReductionKind::PRODUCT:
-      return static_cast<T>(1);
-    case ReductionKind::MIN:
-      return std::numeric_limits<T>::max();
-    case ReductionKind::MAX:
-      return std::numeric_limits<T>::min();
-  }
-}
+struct ReduceAccumulator {
+  using Type = T;
+};
+
+template <>
+struct ReduceAccumulator<Eigen::half> {
+  using Type = float;
+};
+
+template <>
+struct ReduceAccumulator<Eigen::bfloat16> {
+  using Type = float;
+};
 
 // We cannot use static_assert(false), because the C++ standard (prior to
 // CWG2518) does not allow the statement discarded by a constexpr if to
@@ -93,63 +113,129 @@ T GetInitialValue(ReductionKind reduction_kind) {
 template <ReductionKind>
 constexpr bool always_false_v = false;
 
-template <ReductionKind reduction_kind, typename T>
-void ReduceHelper(absl::Span<T> acc, absl::Span<T const* const> inputs) {
-  // TODO(penporn): make sure this gets vectorized.
+template <ReductionKind reduction_kind, typename Acc>
+Acc Reduce(Acc a, Acc b) {
   if constexpr (reduction_kind == ReductionKind::SUM) {
-    for (size_t j = 0; j < inputs.size(); ++j) {
-      for (size_t i = 0; i < acc.size(); ++i) {
-        acc[i] += inputs[j][i];
-      }
-    }
+    return a + b;
   } else if constexpr (reduction_kind == ReductionKind::PRODUCT) {
-    for (size_t j = 0; j < inputs.size(); ++j) {
-      for (size_t i = 0; i < acc.size(); ++i) {
-        acc[i] *= inputs[j][i];
-      }
-    }
+    return a * b;
   } else if constexpr (reduction_kind == ReductionKind::MIN) {
-    for (size_t j = 0; j < inputs.size(); ++j) {
-      for (size_t i = 0; i < acc.size(); ++i) {
-        acc[i] = std::min(acc[i], inputs[j][i]);
-      }
-    }
+    return std::min(a, b);
   } else if constexpr (reduction_kind == ReductionKind::MAX) {
-    for (size_t j = 0; j < inputs.size(); ++j) {
-      for (size_t i = 0; i < acc.size(); ++i) {
-        acc[i] = std::max(acc[i], inputs[j][i]);
-      }
-    }
+    return std::max(a, b);
   } else {
     static_assert(always_false_v<reduction_kind>, "Unsupported reduction kind");
   }
 }
 
+// Reduces elements [offset, offset + n) of `inputs` into `acc`. The inputs are
+// folded in pairs so that every pass over the accumulator consumes two inputs;
+// the order of the reduction is the same as folding them one by one.
+template <ReductionKind reduction_kind, typename Acc, typename T>
+void ReduceBlock(Acc* acc, absl::Span<T const* const> inputs, int64_t offset,
+                 int64_t n) {
+  const T* first = inputs[0] + offset;
+  for (int64_t i = 0; i < n; ++i) {
+    acc[i] = static_cast<Acc>(first[i]);
+  }
+  size_t j = 1;
+  for (; j + 1 < inputs.size(); j += 2) {
+    const T* lhs = inputs[j] + offset;
+    const T* rhs = inputs[j + 1] + offset;
+    for (int64_t i = 0; i < n; ++i) {
+      acc[i] = Reduce<reduction_kind>(
+          Reduce<reduction_kind>(acc[i], static_cast<Acc>(lhs[i])),
+          static_cast<Acc>(rhs[i]));
+    }
+  }
+  for (; j < inputs.size(); ++j) {
+    const T* input = inputs[j] + offset;
+    for (int64_t i = 0; i < n; ++i) {
+      acc[i] = Reduce<reduction_kind>(acc[i], static_cast<Acc>(input[i]));
+    }
+  }
+}
+
+// Converts `n` accumulated values to T and stores them to `out`.
+template <typename T, typename Acc>
+void StoreBlock(T* out, const Acc* acc, int64_t n, bool non_temporal) {
+#if ABSL_HAVE_BUILTIN(__builtin_nontemporal_store)
+  if (non_temporal) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      for (int64_t i = 0; i < n; ++i) {
+        __builtin_nontemporal_store(static_cast<T>(acc[i]), out + i);
+      }
+      return;
+    } else if constexpr (sizeof(T) == sizeof(uint16_t) && !is_complex_v<T>) {
+      // Half-precision types are stored through their bit pattern.
+      uint16_t* out_bits = reinterpret_cast<uint16_t*>(out);
+      for (int64_t i = 0; i < n; ++i) {
+        __builtin_nontemporal_store(
+            Eigen::numext::bit_cast<uint16_t>(static_cast<T>(acc[i])),
+            out_bits + i);
+      }
+      return;
+    }
+  }
+#endif
+  for (int64_t i = 0; i < n; ++i) {
+    out[i] = static_cast<T>(acc[i]);
+  }
+}
+
+// Reduces the `num_elems` elements of `inputs` and writes the result to every
+// buffer in `outputs`, one cache-sized block at a time.
+template <ReductionKind reduction_kind, typename T>
+void ReduceHelper(absl::Span<T const* const> inputs,
+                  absl::Span<T* const> outputs, int64_t num_elems) {
+  using Acc = typename ReduceAccumulator<T>::Type;
+  constexpr int64_t kBlockElems =
+      std::max<int64_t>(kReduceBlockBytes / sizeof(Acc), 1);
+  alignas(64) Acc acc[kBlockElems];
+
+  bool non_temporal = num_elems * sizeof(T) * outputs.size() >=
+                      kNonTemporalStoreThresholdBytes;
+  for (int64_t start = 0; start < num_elems; start += kBlockElems) {
+    int64_t n = std::min(kBlockElems, num_elems - start);
+    ReduceBlock<reduction_kind>(acc, inputs, start, n);
+    for (T* output : outputs) {
+      StoreBlock(output + start, acc, n, non_temporal);
+    }
+  }
+
+  if (non_temporal) {
+    // Non-temporal stores are weakly ordered. Make them visible before the
+    // other participants are released from the rendezvous.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+// Reduces `num_elems` elements of `inputs` and writes the result to each of
+// `outputs`.
 template <PrimitiveType PT>
 absl::Status ReduceScatter(ReductionKind reduction_kind,
-                           absl::Span<const void* const> inputs, void* output,
+                           absl::Span<const void* const> inputs,
+                           absl::Span<void* const> outputs,
                            int64_t num_elems) {
   using T = typename primitive_util::PrimitiveTypeToNative<PT>::type;
-  T initial_value = GetInitialValue<T>(reduction_kind);
-
-  absl::Span<T> out_chunk =
-      absl::MakeSpan(reinterpret_cast<T*>(output), num_elems);
-  for (int64_t i = 0; i < num_elems; ++i) {
-    out_chunk[i] = initial_value;
-  }
 
   absl::Span<T const* const> input_chunks(
       reinterpret_cast<T const* const*>(inputs.data()), inputs.size());
+  absl::Span<T* const> output_chunks(
+      reinterpret_cast<T* const*>(outputs.data()), outputs.size());
   switch (reduction_kind) {
     case ReductionKind::SUM:
-      ReduceHelper<ReductionKind::SUM, T>(out_chunk, input_chunks);
+      ReduceHelper<ReductionKind::SUM, T>(input_chunks, output_chunks,
+                                          num_elems);
       break;
     case ReductionKind::PRODUCT:
-      ReduceHelper<ReductionKind::PRODUCT, T>(out_chunk, input_chunks);
+      ReduceHelper<ReductionKind::PRODUCT, T>(input_chunks, output_chunks,
+                                              num_elems);
       break;
     case ReductionKind::MIN:
       if constexpr (!is_complex_v<T>) {
-        ReduceHelper<ReductionKind::MIN, T>(out_chunk, input_chunks);
+        ReduceHelper<ReductionKind::MIN, T>(input_chunks, output_chunks,
+                                            num_elems);
       } else {
         return absl::InvalidArgumentError(
             "Min reductions not supported for complex types");
@@ -157,7 +243,8 @@ absl::Status ReduceScatter(ReductionKind reduction_kind,
       break;
     case ReductionKind::MAX:
       if constexpr (!is_complex_v<T>) {
-        ReduceHelper<ReductionKind::MAX, T>(out_chunk, input_chunks);
+        ReduceHelper<ReductionKind::MAX, T>(input_chunks, output_chunks,
+                                            num_elems);
       } else {
         return absl::InvalidArgumentError(
             "Max reductions not supported for complex types");
@@ -192,82 +279,82 @@ class CpuAllReduceRendezvous
 
     auto bytes_per_elem = primitive_util::ByteWidth(me.primitive_type);
     int64_t chunk_offset = start_elem * bytes_per_elem;
-    int64_t chunk_bytes = chunk_elems * bytes_per_elem;
-    void* reduce_output =
-        reinterpret_cast<char*>(me.destination_data) + chunk_offset;
 
+    // Rank r writes its reduced chunk straight into the destination buffers
+    // of all participants, which also performs the all-gather.
     std::vector<const void*> inputs;
+    std::vector<void*> outputs;
     inputs.reserve(world_size);
+    outputs.reserve(world_size);
     for (const auto& p : participants_) {
       inputs.push_back(reinterpret_cast<const char*>(p->source_data) +
                        chunk_offset);
+      outputs.push_back(reinterpret_cast<char*>(p->destination_data) +
+                        chunk_offset);
     }
 
     switch (me.primitive_type) {
       case S8:
         TF_RETURN_IF_ERROR(ReduceScatter<S8>(me.reduction_kind, inputs,
-                                             reduce_output, chunk_elems));
+                                             outputs, chunk_elems));
         break;
       case PRED:
       case U8:
         TF_RETURN_IF_ERROR(ReduceScatter<U8>(me.reduction_kind, inputs,
-                                             reduce_output, chunk_elems));
+                                             outputs, chunk_elems));
         break;
       case S16:
         TF_RETURN_IF_ERROR(ReduceScatter<S16>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case U16:
         TF_RETURN_IF_ERROR(ReduceScatter<U16>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case S32:
         TF_RETURN_IF_ERROR(ReduceScatter<S32>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case U32:
         TF_RETURN_IF_ERROR(ReduceScatter<U32>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case S64:
         TF_RETURN_IF_ERROR(ReduceScatter<S64>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case U64:
         TF_RETURN_IF_ERROR(ReduceScatter<U64>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case F16:
         TF_RETURN_IF_ERROR(ReduceScatter<F16>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
+        break;
+      case BF16:
+        TF_RETURN_IF_ERROR(ReduceScatter<BF16>(me.reduction_kind, inputs,
+                                               outputs, chunk_elems));
         break;
       case F32:
         TF_RETURN_IF_ERROR(ReduceScatter<F32>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case F64:
         TF_RETURN_IF_ERROR(ReduceScatter<F64>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case C64:
         TF_RETURN_IF_ERROR(ReduceScatter<C64>(me.reduction_kind, inputs,
-                                              reduce_output, chunk_elems));
+                                              outputs, chunk_elems));
         break;
       case C128:
         TF_RETURN_IF_ERROR(ReduceScatter<C128>(me.reduction_kind, inputs,
-                                               reduce_output, chunk_elems));
+                                               outputs, chunk_elems));
         break;
       default:
         return absl::UnimplementedError("Unexpected datatype");
     }
 
-    // All-gather the reduced chunks.
-    for (const auto& p : participants_) {
-      if (p->local_rank != me.local_rank) {
-        std::memcpy(reinterpret_cast<char*>(p->destination_data) + chunk_offset,
-                    reduce_output, chunk_bytes);
-      }
-    }
     return nullptr;
   }
 };
@@ -438,60 +525,65 @@ class CpuReduceScatterRendezvous
       inputs.push_back(reinterpret_cast<const char*>(p->source_buffer) +
                        chunk_offset);
     }
+    void* const outputs[] = {me.destination_buffer};
 
     switch (me.element_type) {
       case S8:
         TF_RETURN_IF_ERROR(ReduceScatter<S8>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case PRED:
       case U8:
         TF_RETURN_IF_ERROR(ReduceScatter<U8>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case S16:
         TF_RETURN_IF_ERROR(ReduceScatter<S16>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case U16:
         TF_RETURN_IF_ERROR(ReduceScatter<U16>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case S32:
         TF_RETURN_IF_ERROR(ReduceScatter<S32>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case U32:
         TF_RETURN_IF_ERROR(ReduceScatter<U32>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case S64:
         TF_RETURN_IF_ERROR(ReduceScatter<S64>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case U64:
         TF_RETURN_IF_ERROR(ReduceScatter<U64>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case F16:
         TF_RETURN_IF_ERROR(ReduceScatter<F16>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
+        break;
+      case BF16:
+        TF_RETURN_IF_ERROR(ReduceScatter<BF16>(
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case F32:
         TF_RETURN_IF_ERROR(ReduceScatter<F32>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case F64:
         TF_RETURN_IF_ERROR(ReduceScatter<F64>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case C64:
         TF_RETURN_IF_ERROR(ReduceScatter<C64>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       case C128:
         TF_RETURN_IF_ERROR(ReduceScatter<C128>(
-            me.reduction_kind, inputs, me.destination_buffer, me.chunk_elems));
+            me.reduction_kind, inputs, outputs, me.chunk_elems));
         break;
       default:
         return absl::UnimplementedError("Unexpected datatype");
@@ -0,0 +1,258 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/cpu/in_process_collectives.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xla/executable_run_options.h"
+#include "xla/primitive_util.h"
+#include "xla/service/collective_ops_utils.h"
+#include "xla/service/cpu/collectives_interface.h"
+#include "xla/service/global_device_id.h"
+#include "xla/types.h"
+#include "xla/xla_data.pb.h"
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+#include "tsl/platform/threadpool.h"
+
+namespace xla::cpu::runtime {
+namespace {
+
+RendezvousKey MakeRendezvousKey(const RunId& run_id, int num_participants,
+                                int64_t op_id) {
+  std::vector<GlobalDeviceId> devices;
+  for (int i = 0; i < num_participants; ++i) {
+    devices.push_back(GlobalDeviceId(i));
+  }
+  return RendezvousKey(run_id, devices, num_participants,
+                       RendezvousKey::kCrossReplica, op_id);
+}
+
+// Runs `fn(rank, communicator)` on one thread per participant and returns the
+// first error.
+template <typename Fn>
+absl::Status RunParticipants(InProcessCollectives& collectives,
+                             tsl::thread::ThreadPool& thread_pool,
+                             int num_participants, Fn fn) {
+  std::vector<GlobalDeviceId> devices;
+  for (int i = 0; i < num_participants; ++i) {
+    devices.push_back(GlobalDeviceId(i));
+  }
+  absl::Mutex mu;
+  absl::Status status;
+  {
+    tsl::BlockingCounter done(num_participants);
+    for (int rank = 0; rank < num_participants; ++rank) {
+      thread_pool.Schedule([&, rank] {
+        absl::Status s = [&]() -> absl::Status {
+          TF_ASSIGN_OR_RETURN(auto communicator,
+                              collectives.GetCommunicator(devices, rank));
+          return fn(rank, *communicator);
+        }();
+        if (!s.ok()) {
+          absl::MutexLock lock(&mu);
+          status.Update(s);
+        }
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+  return status;
+}
+
+template <typename T>
+class InProcessAllReduceTest : public ::testing::Test {};
+
+using AllReduceTypes =
+    ::testing::Types<float, Eigen::bfloat16, Eigen::half, int32_t>;
+TYPED_TEST_SUITE(InProcessAllReduceTest, AllReduceTypes);
+
+TYPED_TEST(InProcessAllReduceTest, SumAndMax) {
+  using T = TypeParam;
+  constexpr PrimitiveType kType = primitive_util::NativeToPrimitiveType<T>();
+  constexpr int kNumParticipants = 5;
+  // Large enough to span several reduction blocks per participant.
+  constexpr int64_t kNumElements = 20011;
+
+  InProcessCollectives collectives;
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test",
+                                      kNumParticipants);
+  RunId run_id;
+
+  std::vector<std::vector<T>> inputs(kNumParticipants);
+  for (int rank = 0; rank < kNumParticipants; ++rank) {
+    for (int64_t i = 0; i < kNumElements; ++i) {
+      inputs[rank].push_back(static_cast<T>((i * (rank + 1)) % 17));
+    }
+  }
+
+  int64_t op_id = 0;
+  for (ReductionKind kind : {ReductionKind::SUM, ReductionKind::MAX}) {
+    std::vector<std::vector<T>> outputs(kNumParticipants,
+                                        std::vector<T>(kNumElements));
+    RendezvousKey key = MakeRendezvousKey(run_id, kNumParticipants, op_id++);
+    TF_ASSERT_OK(RunParticipants(
+        collectives, thread_pool, kNumParticipants,
+        [&](int rank, CollectivesCommunicator& communicator) {
+          return communicator.AllReduce(
+              key, kind, kType, kNumElements, inputs[rank].data(),
+              outputs[rank].data(), absl::InfiniteDuration());
+        }));
+
+    for (int64_t i = 0; i < kNumElements; ++i) {
+      float expected = kind == ReductionKind::SUM ? 0 : -1;
+      for (int rank = 0; rank < kNumParticipants; ++rank) {
+        float value = static_cast<float>(inputs[rank][i]);
+        expected = kind == ReductionKind::SUM ? expected + value
+                                              : std::max(expected, value);
+      }
+      for (int rank = 0; rank < kNumParticipants; ++rank) {
+        ASSERT_EQ(static_cast<float>(outputs[rank][i]),
+                  static_cast<float>(static_cast<T>(expected)))
+            << "rank=" << rank << " i=" << i;
+      }
+    }
+  }
+}
+
+TEST(InProcessCollectivesTest, BF16AllReduceAccumulatesInF32) {
+  constexpr int kNumParticipants = 3;
+  InProcessCollectives collectives;
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test",
+                                      kNumParticipants);
+
+  // 256 + 1 is not representable in BF16 and rounds back to 256, but 258 is.
+  // Accumulating in BF16 would produce 256.
+  std::vector<std::vector<Eigen::bfloat16>> inputs = {
+      {Eigen::bfloat16(256.0f)},
+      {Eigen::bfloat16(1.0f)},
+      {Eigen::bfloat16(1.0f)}};
+  std::vector<std::vector<Eigen::bfloat16>> outputs(
+      kNumParticipants, std::vector<Eigen::bfloat16>(1));
+  RendezvousKey key = MakeRendezvousKey(RunId(), kNumParticipants, 0);
+  TF_ASSERT_OK(RunParticipants(
+      collectives, thread_pool, kNumParticipants,
+      [&](int rank, CollectivesCommunicator& communicator) {
+        return communicator.AllReduce(key, ReductionKind::SUM, BF16, 1,
+                                      inputs[rank].data(), outputs[rank].data(),
+                                      absl::InfiniteDuration());
+      }));
+  for (int rank = 0; rank < kNumParticipants; ++rank) {
+    EXPECT_EQ(static_cast<float>(outputs[rank][0]), 258.0f);
+  }
+}
+
+TEST(InProcessCollectivesTest, ReduceScatter) {
+  constexpr int kNumParticipants = 4;
+  constexpr int64_t kChunkElems = 1000;
+  InProcessCollectives collectives;
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test",
+                                      kNumParticipants);
+
+  std::vector<std::vector<float>> inputs(kNumParticipants);
+  for (int rank = 0; rank < kNumParticipants; ++rank) {
+    for (int64_t i = 0; i < kNumParticipants * kChunkElems; ++i) {
+      inputs[rank].push_back(rank * 1000 + i);
+    }
+  }
+  std::vector<std::vector<float>> outputs(kNumParticipants,
+                                          std::vector<float>(kChunkElems));
+  RendezvousKey key = MakeRendezvousKey(RunId(), kNumParticipants, 0);
+  TF_ASSERT_OK(RunParticipants(
+      collectives, thread_pool, kNumParticipants,
+      [&](int rank, CollectivesCommunicator& communicator) {
+        return communicator.ReduceScatter(
+            key, ReductionKind::SUM, F32, kChunkElems, inputs[rank].data(),
+            outputs[rank].data(), absl::InfiniteDuration());
+      }));
+  for (int rank = 0; rank < kNumParticipants; ++rank) {
+    for (int64_t i = 0; i < kChunkElems; ++i) {
+      float expected = 0;
+      for (int p = 0; p < kNumParticipants; ++p) {
+        expected += inputs[p][rank * kChunkElems + i];
+      }
+      ASSERT_EQ(outputs[rank][i], expected) << "rank=" << rank << " i=" << i;
+    }
+  }
+}
+
+// All-reduces `state.range(1)` elements across `state.range(0)` participant
+// threads.
+template <typename T>
+void BenchmarkAllReduce(::testing::benchmark::State& state) {
+  constexpr PrimitiveType kType = primitive_util::NativeToPrimitiveType<T>();
+  const int num_participants = state.range(0);
+  const int64_t num_elements = state.range(1);
+
+  InProcessCollectives collectives;
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "bench",
+                                      num_participants);
+  std::vector<std::vector<T>> inputs(num_participants,
+                                     std::vector<T>(num_elements, T(1)));
+  std::vector<std::vector<T>> outputs(num_participants,
+                                      std::vector<T>(num_elements));
+
+  RunId run_id;
+  int64_t op_id = 0;
+  for (auto s : state) {
+    RendezvousKey key = MakeRendezvousKey(run_id, num_participants, op_id++);
+    CHECK_OK(RunParticipants(
+        collectives, thread_pool, num_participants,
+        [&](int rank, CollectivesCommunicator& communicator) {
+          return communicator.AllReduce(
+              key, ReductionKind::SUM, kType, num_elements,
+              inputs[rank].data(), outputs[rank].data(),
+              absl::InfiniteDuration());
+        }));
+  }
+  state.SetBytesProcessed(state.iterations() * num_participants *
+                          num_elements * sizeof(T));
+}
+
+void BM_AllReduceF32(::testing::benchmark::State& state) {
+  BenchmarkAllReduce<float>(state);
+}
+
+void BM_AllReduceBF16(::testing::benchmark::State& state) {
+  BenchmarkAllReduce<Eigen::bfloat16>(state);
+}
+
+BENCHMARK(BM_AllReduceF32)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->ArgNames({"participants", "elements"})
+    ->ArgsProduct({{2, 4, 8, 16}, {1 << 10, 1 << 16, 1 << 20, 1 << 24}});
+
+BENCHMARK(BM_AllReduceBF16)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->ArgNames({"participants", "elements"})
+    ->ArgsProduct({{2, 4, 8, 16}, {1 << 10, 1 << 16, 1 << 20, 1 << 24}});
+
+}  // namespace
+}  // namespace xla::cpu::runtime
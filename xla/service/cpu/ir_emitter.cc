@@ -2482,7 +2482,25 @@ Status IrEmitter::HandleTopK(HloInstruction* hlo) {
   const HloInstruction* input = hlo->operand(0);
   const int64_t k = hlo->shape().tuple_shapes(0).dimensions().back();
   const bool has_batch = hlo->shape().tuple_shapes(0).dimensions_size() == 2;
-  TF_RET_CHECK(input->shape().element_type() == F32) << hlo->ToString();
+  const char* topk_symbol_name;
+  switch (input->shape().element_type()) {
+    case F32:
+      topk_symbol_name = runtime::kTopKF32SymbolName;
+      break;
+    case BF16:
+      topk_symbol_name = runtime::kTopKBF16SymbolName;
+      break;
+    case F16:
+      topk_symbol_name = runtime::kTopKF16SymbolName;
+      break;
+    case S32:
+      topk_symbol_name = runtime::kTopKS32SymbolName;
+      break;
+    default:
+      return Unimplemented("Element type %s not supported in TopK on CPU: %s",
+                           PrimitiveType_Name(input->shape().element_type()),
+                           hlo->ToString());
+  }
   TF_RET_CHECK(LayoutUtil::IsMonotonicWithDim0Major(
       hlo->shape().tuple_shapes(0).layout()))
       << hlo->ToString();
@@ -2505,8 +2523,9 @@ Status IrEmitter::HandleTopK(HloInstruction* hlo) {
       EmitBufferPointer(out_values_slice, hlo->shape().tuple_shapes(0));
   llvm::Value* out_indices_ptr =
       EmitBufferPointer(out_indices_slice, hlo->shape().tuple_shapes(1));
-  EmitCallToFunc(runtime::kTopKF32SymbolName,
-                 {b_.getInt64(has_batch ? input->shape().dimensions(0) : 1),
+  EmitCallToFunc(topk_symbol_name,
+                 {GetExecutableRunOptionsArgument(),
+                  b_.getInt64(has_batch ? input->shape().dimensions(0) : 1),
                   b_.getInt64(input->shape().dimensions().back()),
                   b_.getInt64(k), values_ptr, out_values_ptr, out_indices_ptr},
                  b_.getVoidTy());
@@ -12,16 +12,253 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#define EIGEN_USE_THREADS
+
 #include "xla/service/cpu/runtime_key_value_sort.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <numeric>
-#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/base/dynamic_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/types/span.h"
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "xla/executable_run_options.h"
+#include "tsl/platform/blocking_counter.h"
+
+namespace {
+
+using LessThanFn = void (*)(char*, char*, char**, char**, int64_t*);
+
+// Rows with fewer elements than this are never split across threads; the
+// overhead of the merge passes outweighs the gain.
+constexpr int64_t kMinElementsForParallelRowSort = 1 << 15;
+
+// Rough cost (in cycles) of a single call to the JIT-compiled comparator. It
+// is only used to let Eigen's cost model decide how to shard the rows.
+constexpr double kComparatorCostInCycles = 20.0;
+
+// Describes one of the a * c rows that are sorted independently.
+struct SortRow {
+  char** values;
+  int32_t values_count;
+  int32_t* values_primitive_type_size_in_bytes;
+  int64_t base_offset;
+  int64_t stride;
+  int64_t size;
+};
+
+// Compares two elements of a row through the JIT-compiled 'less_than'
+// function. Every thread that sorts needs its own instance because
+// 'comparison_values' is scratch space written on every call.
+class RowComparator {
+ public:
+  RowComparator(const SortRow& row, char* run_options, int64_t* prof_counters,
+                LessThanFn less_than)
+      : row_(row),
+        run_options_(run_options),
+        prof_counters_(prof_counters),
+        less_than_(less_than),
+        comparison_values_(2 * row.values_count) {}
+
+  bool operator()(int64_t a, int64_t b) {
+    for (int32_t i = 0; i < row_.values_count; ++i) {
+      int64_t memory_index_lhs = (row_.base_offset + a * row_.stride) *
+                                 row_.values_primitive_type_size_in_bytes[i];
+      int64_t memory_index_rhs = (row_.base_offset + b * row_.stride) *
+                                 row_.values_primitive_type_size_in_bytes[i];
+      comparison_values_[i * 2] = row_.values[i] + memory_index_lhs;
+      comparison_values_[i * 2 + 1] = row_.values[i] + memory_index_rhs;
+    }
+    char result = 0;  // Overwritten by less_than.
+    less_than_(&result, run_options_, comparison_values_.data(), nullptr,
+               prof_counters_);
+    return result != 0u;
+  }
+
+ private:
+  const SortRow& row_;
+  char* run_options_;
+  int64_t* prof_counters_;
+  LessThanFn less_than_;
+  std::vector<char*> comparison_values_;
+};
+
+// Scratch space owned by a single thread and reused for all rows it sorts.
+struct SortScratch {
+  explicit SortScratch(int64_t size) : indices(size), visited(size) {}
+
+  std::vector<int64_t> indices;
+  std::vector<bool> visited;
+};
+
+// Applies the permutation 'indices' (the element at position i moves from
+// position indices[i]) to a strided row of elements of type T in place by
+// following the cycles of the permutation.
+template <typename T>
+void PermuteInPlace(char* data, int64_t base_offset, int64_t stride,
+                    absl::Span<const int64_t> indices,
+                    std::vector<bool>& visited) {
+  T* elements = reinterpret_cast<T*>(data) + base_offset;
+  std::fill(visited.begin(), visited.end(), false);
+  for (int64_t start = 0; start < indices.size(); ++start) {
+    if (visited[start] || indices[start] == start) continue;
+    T tmp = elements[start * stride];
+    int64_t current = start;
+    while (indices[current] != start) {
+      int64_t next = indices[current];
+      elements[current * stride] = elements[next * stride];
+      visited[current] = true;
+      current = next;
+    }
+    elements[current * stride] = tmp;
+    visited[current] = true;
+  }
+}
+
+// Fallback for element sizes that have no matching fixed-width integer type
+// (e.g. complex128). Moves elements through a small byte buffer.
+void PermuteInPlaceBytes(char* data, int64_t base_offset, int64_t stride,
+                         int32_t size_in_bytes,
+                         absl::Span<const int64_t> indices,
+                         std::vector<bool>& visited) {
+  std::unique_ptr<char[]> tmp(new char[size_in_bytes]);
+  auto element = [&](int64_t i) {
+    return data + (base_offset + i * stride) * size_in_bytes;
+  };
+  std::fill(visited.begin(), visited.end(), false);
+  for (int64_t start = 0; start < indices.size(); ++start) {
+    if (visited[start] || indices[start] == start) continue;
+    std::memcpy(tmp.get(), element(start), size_in_bytes);
+    int64_t current = start;
+    while (indices[current] != start) {
+      int64_t next = indices[current];
+      std::memcpy(element(current), element(next), size_in_bytes);
+      visited[current] = true;
+      current = next;
+    }
+    std::memcpy(element(current), tmp.get(), size_in_bytes);
+    visited[current] = true;
+  }
+}
+
+// Reorders all values of 'row' according to the order defined by 'indices'.
+void ReorderRow(const SortRow& row, absl::Span<const int64_t> indices,
+                std::vector<bool>& visited) {
+  for (int32_t idx = 0; idx < row.values_count; ++idx) {
+    char* data = row.values[idx];
+    switch (row.values_primitive_type_size_in_bytes[idx]) {
+      case 1:
+        PermuteInPlace<uint8_t>(data, row.base_offset, row.stride, indices,
+                                visited);
+        break;
+      case 2:
+        PermuteInPlace<uint16_t>(data, row.base_offset, row.stride, indices,
+                                 visited);
+        break;
+      case 4:
+        PermuteInPlace<uint32_t>(data, row.base_offset, row.stride, indices,
+                                 visited);
+        break;
+      case 8:
+        PermuteInPlace<uint64_t>(data, row.base_offset, row.stride, indices,
+                                 visited);
+        break;
+      default:
+        PermuteInPlaceBytes(data, row.base_offset, row.stride,
+                            row.values_primitive_type_size_in_bytes[idx],
+                            indices, visited);
+        break;
+    }
+  }
+}
+
+// Calls 'fn(i)' for every i in [0, n) on the intra-op pool. The first call
+// runs inline on the calling thread, all others are dispatched to the pool.
+void ParallelForEach(const Eigen::ThreadPoolDevice& device, int64_t n,
+                     absl::FunctionRef<void(int64_t)> fn) {
+  tsl::BlockingCounter bc(n - 1);
+  for (int64_t i = 1; i < n; ++i) {
+    device.enqueueNoNotification([i, fn, &bc] {
+      fn(i);
+      bc.DecrementCount();
+    });
+  }
+  fn(0);
+  bc.Wait();
+}
+
+// Sorts a single row on the calling thread.
+void SortRowSequential(const SortRow& row, bool is_stable, char* run_options,
+                       int64_t* prof_counters, LessThanFn less_than,
+                       SortScratch& scratch) {
+  std::iota(scratch.indices.begin(), scratch.indices.end(), 0);
+  RowComparator compare(row, run_options, prof_counters, less_than);
+  auto compare_function = [&](int64_t a, int64_t b) { return compare(a, b); };
+  if (is_stable) {
+    std::stable_sort(scratch.indices.begin(), scratch.indices.end(),
+                     compare_function);
+  } else {
+    std::sort(scratch.indices.begin(), scratch.indices.end(),
+              compare_function);
+  }
+  ReorderRow(row, scratch.indices, scratch.visited);
+}
+
+// Sorts a single (large) row with a parallel merge sort: the index range is
+// split into one chunk per thread, the chunks are sorted concurrently and then
+// merged pairwise in log2(#chunks) parallel passes. std::merge takes elements
+// from the left range first on ties, so the result is stable whenever the
+// chunk sorts are.
+void SortRowParallel(const SortRow& row, bool is_stable, char* run_options,
+                     int64_t* prof_counters, LessThanFn less_than,
+                     const Eigen::ThreadPoolDevice& device,
+                     SortScratch& scratch) {
+  const int64_t n = row.size;
+  const int64_t num_chunks = std::min<int64_t>(
+      device.numThreads(), n / (kMinElementsForParallelRowSort / 4));
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+
+  std::vector<int64_t>& src = scratch.indices;
+  std::vector<int64_t> dst(n);
+  std::iota(src.begin(), src.end(), 0);
+
+  ParallelForEach(device, num_chunks, [&](int64_t chunk) {
+    int64_t lo = std::min(n, chunk * chunk_size);
+    int64_t hi = std::min(n, lo + chunk_size);
+    RowComparator compare(row, run_options, prof_counters, less_than);
+    auto compare_function = [&](int64_t a, int64_t b) { return compare(a, b); };
+    if (is_stable) {
+      std::stable_sort(src.begin() + lo, src.begin() + hi, compare_function);
+    } else {
+      std::sort(src.begin() + lo, src.begin() + hi, compare_function);
+    }
+  });
+
+  for (int64_t width = chunk_size; width < n; width *= 2) {
+    int64_t num_merges = (n + 2 * width - 1) / (2 * width);
+    ParallelForEach(device, num_merges, [&](int64_t merge) {
+      int64_t lo = merge * 2 * width;
+      int64_t mid = std::min(n, lo + width);
+      int64_t hi = std::min(n, lo + 2 * width);
+      RowComparator compare(row, run_options, prof_counters, less_than);
+      std::merge(src.begin() + lo, src.begin() + mid, src.begin() + mid,
+                 src.begin() + hi, dst.begin() + lo,
+                 [&](int64_t a, int64_t b) { return compare(a, b); });
+    });
+    std::swap(src, dst);
+  }
+
+  ReorderRow(row, src, scratch.visited);
+}
+
+}  // namespace
 
 ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_KeyValueSort(
     int64_t a, int64_t b, int64_t c, char** values, int32_t values_count,
@@ -47,65 +284,75 @@ ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_KeyValueSort(
   int64_t num_iteration_elements = a * c;
   int64_t sort_dimension_offset = c;
 
-  std::unique_ptr<int64_t[]> indices(new int64_t[sort_dimension_elements]);
-  std::unique_ptr<char*[]> comparison_values(new char*[2 * values_count]);
-  std::iota(indices.get(), indices.get() + sort_dimension_elements, 0);
-  std::unique_ptr<std::string[]> reordered_values(
-      new std::string[sort_dimension_elements]);
-  for (int64_t index = 0; index < num_iteration_elements; ++index) {
-    // If the sort should be stable, we have to reinitialize indices to iota to
-    // guarantee that we still keep the relative order in case of ties.
-    if (is_stable && index > 0) {
-      std::iota(indices.get(), indices.get() + sort_dimension_elements, 0);
-    }
-    // 'index' can be split into two values which index into the 'c' dimension
-    // and the 'a' dimension, respectively. 'index' % 'c' is the index into the
-    // 'c' dimension, 'index' / 'c' is the index into the 'a' dimension. When
-    // calculating the base offset, we need to multiply the index into the 'a'
-    // dimension with 'b' * 'c'.
-    // 'index' / 'c' * 'c' * 'b' = ('index' - 'index' % 'c') * 'b'.
+  // 'index' can be split into two values which index into the 'c' dimension
+  // and the 'a' dimension, respectively. 'index' % 'c' is the index into the
+  // 'c' dimension, 'index' / 'c' is the index into the 'a' dimension. When
+  // calculating the base offset, we need to multiply the index into the 'a'
+  // dimension with 'b' * 'c'.
+  // 'index' / 'c' * 'c' * 'b' = ('index' - 'index' % 'c') * 'b'.
+  auto make_row = [&](int64_t index) {
     int64_t base_offset =
         index % sort_dimension_offset +
         (index - index % sort_dimension_offset) * sort_dimension_elements;
-    auto compare_function = [&](int64_t a, int64_t b) -> bool {
-      for (int32_t i = 0; i < values_count; ++i) {
-        int64_t memory_index_lhs = (base_offset + a * sort_dimension_offset) *
-                                   values_primitive_type_size_in_bytes[i];
-        int64_t memory_index_rhs = (base_offset + b * sort_dimension_offset) *
-                                   values_primitive_type_size_in_bytes[i];
-        comparison_values[i * 2] = values[i] + memory_index_lhs;
-        comparison_values[i * 2 + 1] = values[i] + memory_index_rhs;
-      }
-      char result = 0;  // Overwritten by less_than.
-      less_than(&result, run_options, comparison_values.get(), nullptr,
-                prof_counters);
-      return result != 0u;
-    };
-    if (is_stable) {
-      std::stable_sort(indices.get(), indices.get() + sort_dimension_elements,
-                       compare_function);
-    } else {
-      std::sort(indices.get(), indices.get() + sort_dimension_elements,
-                compare_function);
+    return SortRow{values,
+                   values_count,
+                   values_primitive_type_size_in_bytes,
+                   base_offset,
+                   sort_dimension_offset,
+                   sort_dimension_elements};
+  };
+
+  const Eigen::ThreadPoolDevice* device = nullptr;
+  if (run_options != nullptr) {
+    device = reinterpret_cast<const xla::ExecutableRunOptions*>(run_options)
+                 ->intra_op_thread_pool();
+  }
+
+  // Sort on the calling thread if:
+  // - it is a thread of the intra-op pool itself, e.g. running a thunk of the
+  //   thunk executor: waiting for the pool from there can deadlock once every
+  //   pool thread waits.
+  // - the comparator updates HLO profile counters, which it does without
+  //   synchronization.
+  if (device == nullptr || device->numThreads() <= 1 ||
+      device->currentThreadId() != -1 || prof_counters != nullptr) {
+    SortScratch scratch(sort_dimension_elements);
+    for (int64_t index = 0; index < num_iteration_elements; ++index) {
+      SortRowSequential(make_row(index), is_stable, run_options, prof_counters,
+                        less_than, scratch);
     }
+    return;
+  }
 
-    // Reorder the values according to the order defined by 'indices'.
-    for (int32_t idx = 0; idx < values_count; ++idx) {
-      for (int64_t i = 0; i < sort_dimension_elements; ++i) {
-        int64_t memory_index =
-            (base_offset + indices[i] * sort_dimension_offset) *
-            values_primitive_type_size_in_bytes[idx];
-
-        reordered_values[i] =
-            std::string(values[idx] + memory_index,
-                        values_primitive_type_size_in_bytes[idx]);
-      }
-      for (int64_t i = 0; i < sort_dimension_elements; ++i) {
-        int64_t memory_index = (base_offset + i * sort_dimension_offset) *
-                               values_primitive_type_size_in_bytes[idx];
-        memcpy(values[idx] + memory_index, reordered_values[i].c_str(),
-               values_primitive_type_size_in_bytes[idx]);
-      }
+  // A few huge rows: sort each of them with the parallel merge sort.
+  if (num_iteration_elements < device->numThreads() &&
+      sort_dimension_elements >= kMinElementsForParallelRowSort) {
+    SortScratch scratch(sort_dimension_elements);
+    for (int64_t index = 0; index < num_iteration_elements; ++index) {
+      SortRowParallel(make_row(index), is_stable, run_options, prof_counters,
+                      less_than, *device, scratch);
     }
+    return;
+  }
+
+  // Many independent rows: shard them across the intra-op pool and sort each
+  // shard's rows sequentially.
+  double elements = static_cast<double>(sort_dimension_elements);
+  double compares = elements * std::max(1.0, std::log2(elements));
+  double row_bytes = 0;
+  for (int32_t i = 0; i < values_count; ++i) {
+    row_bytes += elements * values_primitive_type_size_in_bytes[i];
   }
+  Eigen::TensorOpCost cost(/*bytes_loaded=*/row_bytes,
+                           /*bytes_stored=*/row_bytes,
+                           /*compute_cycles=*/compares * values_count *
+                               kComparatorCostInCycles);
+  device->parallelFor(
+      num_iteration_elements, cost, [&](Eigen::Index first, Eigen::Index last) {
+        SortScratch scratch(sort_dimension_elements);
+        for (Eigen::Index index = first; index < last; ++index) {
+          SortRowSequential(make_row(index), is_stable, run_options,
+                            prof_counters, less_than, scratch);
+        }
+      });
 }
@@ -36,6 +36,9 @@ extern "C" {
 // - pointers to the parameter buffers (char**)
 // - pointers to the buffer tables = nullptr for thread local functions (char**)
 // - profile counters = 'prof_counters' (int64_t*)
+// If 'run_options' carries an intra-op thread pool, independent rows are
+// sorted concurrently on it and a single large row is sorted with a parallel
+// merge sort. Without a thread pool all rows are sorted on the calling thread.
 extern void __xla_cpu_runtime_KeyValueSort(
     int64_t a, int64_t b, int64_t c, char** values, int32_t values_count,
     int32_t* values_primitive_type_size_in_bytes, bool is_stable,
@@ -0,0 +1,216 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#define EIGEN_USE_THREADS
+
+#include "xla/service/cpu/runtime_key_value_sort.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "xla/executable_run_options.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace xla {
+namespace {
+
+// Comparator with the signature of a JIT-compiled less-than computation that
+// only looks at the F32 keys.
+void LessThanF32(char* result, char* run_options, char** values,
+                 char** buffer_table, int64_t* prof_counters) {
+  float lhs, rhs;
+  std::memcpy(&lhs, values[0], sizeof(float));
+  std::memcpy(&rhs, values[1], sizeof(float));
+  *result = lhs < rhs;
+}
+
+// Same as LessThanF32, but also counts its calls in the first profile counter,
+// like a comparator compiled with HLO profiling.
+void CountingLessThanF32(char* result, char* run_options, char** values,
+                         char** buffer_table, int64_t* prof_counters) {
+  ++prof_counters[0];
+  LessThanF32(result, run_options, values, buffer_table, prof_counters);
+}
+
+struct SortInputs {
+  std::vector<float> keys;
+  std::vector<int32_t> indices;
+  std::vector<double> payload;
+};
+
+// Builds keys with many duplicates so that stability is observable, an S32
+// value holding the original position and an F64 payload derived from the
+// key.
+SortInputs MakeInputs(int64_t num_elements) {
+  std::minstd_rand0 engine(42);
+  SortInputs inputs;
+  inputs.keys.resize(num_elements);
+  inputs.indices.resize(num_elements);
+  inputs.payload.resize(num_elements);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    inputs.keys[i] = static_cast<float>(engine() % 1000);
+    inputs.indices[i] = i;
+    inputs.payload[i] = 2.0 * inputs.keys[i];
+  }
+  return inputs;
+}
+
+void Sort(int64_t a, int64_t b, int64_t c, bool is_stable,
+          const ExecutableRunOptions* run_options, SortInputs& inputs,
+          int64_t* prof_counters = nullptr) {
+  char* values[] = {reinterpret_cast<char*>(inputs.keys.data()),
+                    reinterpret_cast<char*>(inputs.indices.data()),
+                    reinterpret_cast<char*>(inputs.payload.data())};
+  int32_t sizes[] = {sizeof(float), sizeof(int32_t), sizeof(double)};
+  __xla_cpu_runtime_KeyValueSort(
+      a, b, c, values, /*values_count=*/3, sizes, is_stable,
+      reinterpret_cast<char*>(const_cast<ExecutableRunOptions*>(run_options)),
+      prof_counters,
+      prof_counters == nullptr ? LessThanF32 : CountingLessThanF32);
+}
+
+struct SortTestParams {
+  int64_t a;
+  int64_t b;
+  int64_t c;
+  bool is_stable;
+};
+
+class KeyValueSortTest : public ::testing::TestWithParam<SortTestParams> {};
+
+TEST_P(KeyValueSortTest, ParallelMatchesSequential) {
+  SortTestParams params = GetParam();
+  int64_t num_elements = params.a * params.b * params.c;
+
+  Eigen::ThreadPool pool(8);
+  Eigen::ThreadPoolDevice device(&pool, pool.NumThreads());
+  ExecutableRunOptions run_options;
+  run_options.set_intra_op_thread_pool(&device);
+
+  SortInputs expected = MakeInputs(num_elements);
+  SortInputs actual = expected;
+  Sort(params.a, params.b, params.c, params.is_stable, /*run_options=*/nullptr,
+       expected);
+  Sort(params.a, params.b, params.c, params.is_stable, &run_options, actual);
+
+  EXPECT_EQ(actual.keys, expected.keys);
+  if (params.is_stable) {
+    EXPECT_EQ(actual.indices, expected.indices);
+  }
+  for (int64_t i = 0; i < num_elements; ++i) {
+    ASSERT_EQ(actual.payload[i], 2.0 * actual.keys[i]);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    KeyValueSortTestInstantiation, KeyValueSortTest,
+    ::testing::Values(SortTestParams{1, 5, 1, false},
+                      SortTestParams{1, 5, 1, true},
+                      SortTestParams{64, 1000, 3, false},
+                      SortTestParams{64, 1000, 3, true},
+                      SortTestParams{1, 100000, 1, false},
+                      SortTestParams{1, 100000, 1, true},
+                      SortTestParams{2, 70001, 2, true},
+                      SortTestParams{1, 0, 1, true}));
+
+TEST(KeyValueSortTest, SortsOnPoolThreads) {
+  // As many sorts as pool threads, each of which would wait for the pool if it
+  // fanned out.
+  constexpr int kNumThreads = 2;
+  Eigen::ThreadPool pool(kNumThreads);
+  Eigen::ThreadPoolDevice device(&pool, pool.NumThreads());
+  ExecutableRunOptions run_options;
+  run_options.set_intra_op_thread_pool(&device);
+
+  SortInputs expected = MakeInputs(100000);
+  Sort(1, 100000, 1, /*is_stable=*/true, /*run_options=*/nullptr, expected);
+  std::vector<SortInputs> actual(kNumThreads, MakeInputs(100000));
+  tsl::BlockingCounter counter(kNumThreads);
+  for (SortInputs& inputs : actual) {
+    pool.Schedule([&] {
+      Sort(1, 100000, 1, /*is_stable=*/true, &run_options, inputs);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  for (const SortInputs& inputs : actual) {
+    EXPECT_EQ(inputs.indices, expected.indices);
+  }
+}
+
+TEST(KeyValueSortTest, CountsComparisonsExactly) {
+  Eigen::ThreadPool pool(8);
+  Eigen::ThreadPoolDevice device(&pool, pool.NumThreads());
+  ExecutableRunOptions run_options;
+  run_options.set_intra_op_thread_pool(&device);
+
+  SortInputs expected = MakeInputs(100000);
+  SortInputs actual = expected;
+  int64_t expected_count = 0;
+  int64_t actual_count = 0;
+  Sort(1, 100000, 1, /*is_stable=*/true, /*run_options=*/nullptr, expected,
+       &expected_count);
+  Sort(1, 100000, 1, /*is_stable=*/true, &run_options, actual, &actual_count);
+  EXPECT_GT(expected_count, 0);
+  EXPECT_EQ(actual_count, expected_count);
+  EXPECT_EQ(actual.indices, expected.indices);
+}
+
+// Sorts 'num_rows' rows of 'row_size' elements. 'num_threads' == 0 runs the
+// single-threaded path without an intra-op thread pool.
+void BM_KeyValueSort(::testing::benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  const int64_t row_size = state.range(1);
+  const int num_threads = state.range(2);
+
+  std::unique_ptr<Eigen::ThreadPool> pool;
+  std::unique_ptr<Eigen::ThreadPoolDevice> device;
+  ExecutableRunOptions run_options;
+  if (num_threads > 0) {
+    pool = std::make_unique<Eigen::ThreadPool>(num_threads);
+    device =
+        std::make_unique<Eigen::ThreadPoolDevice>(pool.get(), num_threads);
+    run_options.set_intra_op_thread_pool(device.get());
+  }
+
+  SortInputs original = MakeInputs(num_rows * row_size);
+  for (auto s : state) {
+    state.PauseTiming();
+    SortInputs inputs = original;
+    state.ResumeTiming();
+    Sort(num_rows, row_size, /*c=*/1, /*is_stable=*/false, &run_options,
+         inputs);
+  }
+  state.SetItemsProcessed(state.iterations() * num_rows * row_size);
+}
+
+BENCHMARK(BM_KeyValueSort)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->ArgNames({"rows", "row_size", "threads"})
+    ->Args({256, 1024, 0})
+    ->Args({256, 1024, 8})
+    ->Args({4096, 128, 0})
+    ->Args({4096, 128, 8})
+    ->Args({1, 1 << 20, 0})
+    ->Args({1, 1 << 20, 8});
+
+}  // namespace
+}  // namespace xla
@@ -13,63 +13,285 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#define EIGEN_USE_THREADS
+
 #include "xla/service/cpu/runtime_topk.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstring>
-#include <limits>
-#include <memory>
-#include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/base/dynamic_annotations.h"
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "xla/executable_run_options.h"
+
+namespace {
+
+// Up to this k the top elements are kept in a binary heap; beyond it the k-th
+// largest key is found with a radix select.
+constexpr int64_t kMaxHeapSelectK = 128;
+
+// Number of elements whose maximum is compared against the heap threshold at
+// once. Blocks are scanned with a branch-free loop that the compiler
+// vectorizes, and only blocks that contain a candidate are inspected one by
+// one.
+constexpr int64_t kHeapSelectBlockSize = 16;
 
+// Rough cost (in cycles) of processing one input element, used by Eigen's
+// cost model to shard the batch.
+constexpr double kCyclesPerElement = 4.0;
+
+// Maps an element type to the unsigned integer type of the same width that is
+// used as its sort key.
+template <typename T>
+struct TopKKey {
+  using Type = std::conditional_t<sizeof(T) == 2, uint16_t, uint32_t>;
+  static constexpr bool kIsFloat = !std::is_integral_v<T>;
+};
+
+// Converts 'value' to an unsigned key whose natural order matches the order
+// of the values. For floating point types this is the total order
+// -NaN < -Inf < -0 < +0 < +Inf < +NaN: negative values have all bits flipped
+// and positive values only the sign bit.
 template <typename T>
-static void TopK(int64_t batch_size, int64_t input_size, int64_t k,
-                 const T* values, T* out_values, int32_t* out_indices) {
+typename TopKKey<T>::Type ToOrderedKey(T value) {
+  using Key = typename TopKKey<T>::Type;
+  constexpr int kBits = sizeof(Key) * 8;
+  constexpr Key kSignBit = static_cast<Key>(Key{1} << (kBits - 1));
+  Key bits;
+  std::memcpy(&bits, &value, sizeof(Key));
+  if constexpr (TopKKey<T>::kIsFloat) {
+    Key sign_mask = static_cast<Key>(-static_cast<Key>(bits >> (kBits - 1)));
+    return static_cast<Key>(bits ^ (sign_mask | kSignBit));
+  } else {
+    return static_cast<Key>(bits ^ kSignBit);
+  }
+}
+
+template <typename Key>
+struct Candidate {
+  Key key;
+  int32_t index;
+};
+
+// Returns true if 'a' ranks before 'b' in the output: larger keys first, and
+// the smaller index first among equal keys.
+template <typename Key>
+bool RanksBefore(const Candidate<Key>& a, const Candidate<Key>& b) {
+  return a.key > b.key || (a.key == b.key && a.index < b.index);
+}
+
+// Selects the top 'k' keys with a heap of size 'k' whose root is the worst
+// candidate seen so far. Elements are visited in increasing index order, so an
+// element only displaces the root if its key is strictly larger.
+template <typename Key>
+void HeapSelect(const Key* keys, int64_t input_size, int64_t k,
+                std::vector<Candidate<Key>>& heap) {
+  auto ranks_before = [](const Candidate<Key>& a, const Candidate<Key>& b) {
+    return RanksBefore(a, b);
+  };
+  heap.clear();
+  for (int64_t i = 0; i < k; ++i) {
+    heap.push_back({keys[i], static_cast<int32_t>(i)});
+  }
+  std::make_heap(heap.begin(), heap.end(), ranks_before);
+
+  auto offer = [&](int64_t i) {
+    if (keys[i] > heap.front().key) {
+      std::pop_heap(heap.begin(), heap.end(), ranks_before);
+      heap.back() = {keys[i], static_cast<int32_t>(i)};
+      std::push_heap(heap.begin(), heap.end(), ranks_before);
+    }
+  };
+
+  int64_t i = k;
+  for (; i + kHeapSelectBlockSize <= input_size; i += kHeapSelectBlockSize) {
+    Key block_max = keys[i];
+    for (int64_t j = 1; j < kHeapSelectBlockSize; ++j) {
+      block_max = std::max(block_max, keys[i + j]);
+    }
+    if (block_max <= heap.front().key) continue;
+    for (int64_t j = 0; j < kHeapSelectBlockSize; ++j) {
+      offer(i + j);
+    }
+  }
+  for (; i < input_size; ++i) {
+    offer(i);
+  }
+  std::sort_heap(heap.begin(), heap.end(), ranks_before);
+}
+
+// Selects the top 'k' keys by finding the k-th largest key with an MSB-first
+// radix select over 8-bit digits, then collecting everything above it plus
+// the first elements equal to it. After each digit only the keys that still
+// share the selected prefix are kept in 'pending', so later passes are cheap.
+// The loops are written without data-dependent branches: the histogram is
+// split four ways to avoid store-to-load stalls on repeated digits, and
+// filtering always writes and conditionally advances the output position.
+template <typename Key>
+void RadixSelect(const Key* keys, int64_t input_size, int64_t k,
+                 std::vector<Key>& pending,
+                 std::vector<Candidate<Key>>& selected) {
+  Key prefix = 0;
+  int64_t remaining = k;
+  pending.assign(keys, keys + input_size);
+  int64_t num_pending = input_size;
+  for (int shift = sizeof(Key) * 8 - 8; shift >= 0; shift -= 8) {
+    std::array<std::array<int64_t, 256>, 4> partial_histograms = {};
+    int64_t i = 0;
+    for (; i + 4 <= num_pending; i += 4) {
+      for (int j = 0; j < 4; ++j) {
+        ++partial_histograms[j][(pending[i + j] >> shift) & 0xFF];
+      }
+    }
+    for (; i < num_pending; ++i) {
+      ++partial_histograms[0][(pending[i] >> shift) & 0xFF];
+    }
+
+    int digit = 255;
+    for (; digit > 0; --digit) {
+      int64_t count = partial_histograms[0][digit] +
+                      partial_histograms[1][digit] +
+                      partial_histograms[2][digit] +
+                      partial_histograms[3][digit];
+      if (count >= remaining) break;
+      remaining -= count;
+    }
+    prefix |= static_cast<Key>(digit) << shift;
+
+    if (shift > 0) {
+      int64_t out = 0;
+      for (int64_t i = 0; i < num_pending; ++i) {
+        Key key = pending[i];
+        pending[out] = key;
+        out += ((key >> shift) & 0xFF) == digit;
+      }
+      num_pending = out;
+    }
+  }
+
+  // 'prefix' is now the k-th largest key and 'remaining' the number of
+  // elements equal to it that belong to the top k.
+  selected.resize(k + 1);
+  int64_t out = 0;
+  for (int64_t i = 0; i < input_size; ++i) {
+    Key key = keys[i];
+    bool take_equal = key == prefix && remaining > 0;
+    selected[out] = {key, static_cast<int32_t>(i)};
+    out += key > prefix || take_equal;
+    remaining -= take_equal;
+  }
+  selected.resize(out);
+  std::sort(selected.begin(), selected.end(),
+            [](const Candidate<Key>& a, const Candidate<Key>& b) {
+              return RanksBefore(a, b);
+            });
+}
+
+// Per-thread scratch space reused across the batch rows a thread processes.
+template <typename Key>
+struct TopKScratch {
+  std::vector<Key> keys;
+  std::vector<Key> pending;
+  std::vector<Candidate<Key>> candidates;
+};
+
+template <typename T>
+void TopKRow(int64_t input_size, int64_t k, const T* values, T* out_values,
+             int32_t* out_indices, TopKScratch<typename TopKKey<T>::Type>& s) {
+  using Key = typename TopKKey<T>::Type;
+  if (k == 0) return;
+  s.keys.resize(input_size);
+  Key* keys = s.keys.data();
+  for (int64_t i = 0; i < input_size; ++i) {
+    keys[i] = ToOrderedKey(values[i]);
+  }
+
+  if (k <= kMaxHeapSelectK) {
+    HeapSelect(keys, input_size, k, s.candidates);
+  } else {
+    RadixSelect(keys, input_size, k, s.pending, s.candidates);
+  }
+
+  for (int64_t i = 0; i < k; ++i) {
+    out_indices[i] = s.candidates[i].index;
+    out_values[i] = values[s.candidates[i].index];
+  }
+}
+
+template <typename T>
+void TopK(const void* run_options_ptr, int64_t batch_size, int64_t input_size,
+          int64_t k, const T* values, T* out_values, int32_t* out_indices) {
   // 'values' is managed by the JIT code, so msan can't tell they are
   // initialized.
   ABSL_ANNOTATE_MEMORY_IS_INITIALIZED(values,
                                       input_size * batch_size * sizeof(T));
+  using Key = typename TopKKey<T>::Type;
 
-  std::vector<int32_t> temp_indices(input_size);
-  for (int64_t batch = 0; batch != batch_size; ++batch) {
-    std::iota(temp_indices.begin(), temp_indices.end(), 0);
-
-    const T* values_batch = values + batch * input_size;
-
-    auto convert_to_int = [](T value) {
-      uint32_t x;
-      std::memcpy(&x, &value, sizeof(x));
-      return static_cast<int32_t>(x) < 0
-                 ? std::numeric_limits<int32_t>::max() - x
-                 : x;
-    };
-
-    auto kth_element = temp_indices.begin() + k;
-    std::partial_sort(temp_indices.begin(), kth_element, temp_indices.end(),
-                      [&](size_t i1, size_t i2) {
-                        // Do the comparison in integers to enforce a total
-                        // order of -NaN < -Inf < -0 < +0 < +Inf < +NaN.
-                        int32_t v1 = convert_to_int(values_batch[i1]);
-                        int32_t v2 = convert_to_int(values_batch[i2]);
-                        if (v1 == v2) {
-                          return i1 < i2;  // Stabilize sorting.
-                        }
-                        return v1 > v2;
-                      });
-
-    T* out_values_batch = out_values + batch * k;
-    int32_t* out_indices_batch = out_indices + batch * k;
-    std::copy(temp_indices.begin(), kth_element, out_indices_batch);
-    for (int64_t i = 0; i < k; i++) {
-      out_values_batch[i] = values_batch[temp_indices[i]];
+  auto process_rows = [&](int64_t first, int64_t last) {
+    TopKScratch<Key> scratch;
+    for (int64_t batch = first; batch < last; ++batch) {
+      TopKRow(input_size, k, values + batch * input_size,
+              out_values + batch * k, out_indices + batch * k, scratch);
     }
+  };
+
+  const Eigen::ThreadPoolDevice* device = nullptr;
+  if (run_options_ptr != nullptr) {
+    device = static_cast<const xla::ExecutableRunOptions*>(run_options_ptr)
+                 ->intra_op_thread_pool();
   }
+  // Waiting for the pool from one of its threads, e.g. when the thunk
+  // executor runs this on the intra-op pool, can deadlock.
+  if (device == nullptr || batch_size <= 1 ||
+      device->currentThreadId() != -1) {
+    process_rows(0, batch_size);
+    return;
+  }
+
+  Eigen::TensorOpCost cost(
+      /*bytes_loaded=*/input_size * sizeof(T),
+      /*bytes_stored=*/k * (sizeof(T) + sizeof(int32_t)),
+      /*compute_cycles=*/input_size * kCyclesPerElement);
+  device->parallelFor(batch_size, cost,
+                      [&](Eigen::Index first, Eigen::Index last) {
+                        process_rows(first, last);
+                      });
 }
 
+}  // namespace
+
 ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_TopKF32(
-    int64_t batch_size, int64_t input_size, int64_t k, const float* values,
-    float* out_values, int32_t* out_indices) {
-  TopK(batch_size, input_size, k, values, out_values, out_indices);
+    const void* run_options_ptr, int64_t batch_size, int64_t input_size,
+    int64_t k, const float* values, float* out_values, int32_t* out_indices) {
+  TopK(run_options_ptr, batch_size, input_size, k, values, out_values,
+       out_indices);
+}
+
+ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_TopKBF16(
+    const void* run_options_ptr, int64_t batch_size, int64_t input_size,
+    int64_t k, const Eigen::bfloat16* values, Eigen::bfloat16* out_values,
+    int32_t* out_indices) {
+  TopK(run_options_ptr, batch_size, input_size, k, values, out_values,
+       out_indices);
+}
+
+ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_TopKF16(
+    const void* run_options_ptr, int64_t batch_size, int64_t input_size,
+    int64_t k, const Eigen::half* values, Eigen::half* out_values,
+    int32_t* out_indices) {
+  TopK(run_options_ptr, batch_size, input_size, k, values, out_values,
+       out_indices);
+}
+
+ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_TopKS32(
+    const void* run_options_ptr, int64_t batch_size, int64_t input_size,
+    int64_t k, const int32_t* values, int32_t* out_values,
+    int32_t* out_indices) {
+  TopK(run_options_ptr, batch_size, input_size, k, values, out_values,
+       out_indices);
 }
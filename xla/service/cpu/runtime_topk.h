@@ -18,13 +18,36 @@ limitations under the License.
 
 #include <stdint.h>
 
+#include "Eigen/Core"  // from @eigen_archive
+
 extern "C" {
 
 // Calculates `batch_size` topk operations with `input_size` inputs each. The
-// outputs are written to `out_values` and `out_indices`.
-extern void __xla_cpu_runtime_TopKF32(int64_t batch_size, int64_t input_size,
-                                      int64_t k, const float* values,
-                                      float* out_values, int32_t* out_indices);
+// outputs are written to `out_values` and `out_indices`, sorted from largest to
+// smallest. Floating point values are ordered by the total order
+// -NaN < -Inf < -0 < +0 < +Inf < +NaN and ties are broken in favor of the
+// smaller index. If `run_options_ptr` carries an intra-op thread pool, the
+// batch rows are processed in parallel on it.
+extern void __xla_cpu_runtime_TopKF32(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    int64_t batch_size, int64_t input_size, int64_t k, const float* values,
+    float* out_values, int32_t* out_indices);
+
+extern void __xla_cpu_runtime_TopKBF16(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    int64_t batch_size, int64_t input_size, int64_t k,
+    const Eigen::bfloat16* values, Eigen::bfloat16* out_values,
+    int32_t* out_indices);
+
+extern void __xla_cpu_runtime_TopKF16(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    int64_t batch_size, int64_t input_size, int64_t k,
+    const Eigen::half* values, Eigen::half* out_values, int32_t* out_indices);
+
+extern void __xla_cpu_runtime_TopKS32(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    int64_t batch_size, int64_t input_size, int64_t k, const int32_t* values,
+    int32_t* out_values, int32_t* out_indices);
 }
 
 #endif  // XLA_SERVICE_CPU_RUNTIME_TOPK_H_
@@ -0,0 +1,226 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#define EIGEN_USE_THREADS
+
+#include "xla/service/cpu/runtime_topk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "xla/executable_run_options.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace xla {
+namespace {
+
+// Reference ordering: descending by value with the total order on floats
+// (NaNs with the sign bit set are smallest, positive NaNs largest) and ties
+// broken by the smaller index.
+template <typename T>
+double OrderKey(T value) {
+  double v = static_cast<double>(static_cast<float>(value));
+  if (std::isnan(v)) {
+    return std::signbit(v) ? -std::numeric_limits<double>::max()
+                           : std::numeric_limits<double>::max();
+  }
+  return v;
+}
+
+template <>
+double OrderKey(int32_t value) {
+  return value;
+}
+
+template <typename T>
+std::vector<int32_t> ReferenceTopK(const T* values, int64_t input_size,
+                                   int64_t k) {
+  std::vector<int32_t> indices(input_size);
+  std::iota(indices.begin(), indices.end(), 0);
+  std::stable_sort(indices.begin(), indices.end(), [&](int32_t a, int32_t b) {
+    return OrderKey(values[a]) > OrderKey(values[b]);
+  });
+  indices.resize(k);
+  return indices;
+}
+
+template <typename T>
+std::vector<T> MakeValues(int64_t num_elements) {
+  std::minstd_rand0 engine(42);
+  std::vector<T> values(num_elements);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    // Few distinct values so that ties are common.
+    values[i] = static_cast<T>(static_cast<float>(engine() % 512) - 256.0f);
+  }
+  return values;
+}
+
+template <typename T>
+void RunTopK(const ExecutableRunOptions* run_options, int64_t batch_size,
+             int64_t input_size, int64_t k, const T* values, T* out_values,
+             int32_t* out_indices) {
+  if constexpr (std::is_same_v<T, float>) {
+    __xla_cpu_runtime_TopKF32(run_options, batch_size, input_size, k, values,
+                              out_values, out_indices);
+  } else if constexpr (std::is_same_v<T, Eigen::bfloat16>) {
+    __xla_cpu_runtime_TopKBF16(run_options, batch_size, input_size, k, values,
+                               out_values, out_indices);
+  } else if constexpr (std::is_same_v<T, Eigen::half>) {
+    __xla_cpu_runtime_TopKF16(run_options, batch_size, input_size, k, values,
+                              out_values, out_indices);
+  } else {
+    __xla_cpu_runtime_TopKS32(run_options, batch_size, input_size, k, values,
+                              out_values, out_indices);
+  }
+}
+
+template <typename T>
+class TopKTest : public ::testing::Test {};
+
+using TopKTypes =
+    ::testing::Types<float, Eigen::bfloat16, Eigen::half, int32_t>;
+TYPED_TEST_SUITE(TopKTest, TopKTypes);
+
+TYPED_TEST(TopKTest, MatchesReference) {
+  using T = TypeParam;
+  constexpr int64_t kBatchSize = 7;
+  constexpr int64_t kInputSize = 1000;
+
+  Eigen::ThreadPool pool(4);
+  Eigen::ThreadPoolDevice device(&pool, pool.NumThreads());
+  ExecutableRunOptions run_options;
+  run_options.set_intra_op_thread_pool(&device);
+
+  std::vector<T> values = MakeValues<T>(kBatchSize * kInputSize);
+  // Exercise both the heap and the radix select paths.
+  for (int64_t k : {1, 5, 128, 129, 500, 1000}) {
+    for (const ExecutableRunOptions* options :
+         {&run_options, static_cast<ExecutableRunOptions*>(nullptr)}) {
+      std::vector<T> out_values(kBatchSize * k);
+      std::vector<int32_t> out_indices(kBatchSize * k);
+      RunTopK(options, kBatchSize, kInputSize, k, values.data(),
+              out_values.data(), out_indices.data());
+      for (int64_t batch = 0; batch < kBatchSize; ++batch) {
+        const T* row = values.data() + batch * kInputSize;
+        std::vector<int32_t> expected = ReferenceTopK(row, kInputSize, k);
+        for (int64_t i = 0; i < k; ++i) {
+          ASSERT_EQ(out_indices[batch * k + i], expected[i])
+              << "k=" << k << " batch=" << batch << " i=" << i;
+          ASSERT_EQ(OrderKey(out_values[batch * k + i]),
+                    OrderKey(row[expected[i]]));
+        }
+      }
+    }
+  }
+}
+
+TEST(TopKF32Test, RunsOnPoolThreads) {
+  // As many TopKs as pool threads, each of which would wait for the pool if it
+  // fanned out.
+  constexpr int kNumThreads = 2;
+  constexpr int64_t kBatchSize = 16;
+  constexpr int64_t kInputSize = 1000;
+  constexpr int64_t kK = 8;
+  Eigen::ThreadPool pool(kNumThreads);
+  Eigen::ThreadPoolDevice device(&pool, pool.NumThreads());
+  ExecutableRunOptions run_options;
+  run_options.set_intra_op_thread_pool(&device);
+
+  std::vector<float> values = MakeValues<float>(kBatchSize * kInputSize);
+  std::vector<int32_t> expected(kBatchSize * kK);
+  std::vector<float> expected_values(kBatchSize * kK);
+  __xla_cpu_runtime_TopKF32(nullptr, kBatchSize, kInputSize, kK, values.data(),
+                            expected_values.data(), expected.data());
+  std::vector<std::vector<int32_t>> actual(
+      kNumThreads, std::vector<int32_t>(kBatchSize * kK));
+  std::vector<std::vector<float>> actual_values(
+      kNumThreads, std::vector<float>(kBatchSize * kK));
+  tsl::BlockingCounter counter(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    pool.Schedule([&, i] {
+      __xla_cpu_runtime_TopKF32(&run_options, kBatchSize, kInputSize, kK,
+                                values.data(), actual_values[i].data(),
+                                actual[i].data());
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  for (const std::vector<int32_t>& indices : actual) {
+    EXPECT_EQ(indices, expected);
+  }
+}
+
+TEST(TopKF32Test, TotalOrder) {
+  const float kInf = std::numeric_limits<float>::infinity();
+  const float kNaN = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> values = {0.0f, -kNaN, -kInf, 1.0f, kNaN, -0.0f, kInf};
+  std::vector<float> out_values(values.size());
+  std::vector<int32_t> out_indices(values.size());
+  __xla_cpu_runtime_TopKF32(nullptr, 1, values.size(), values.size(),
+                            values.data(), out_values.data(),
+                            out_indices.data());
+  EXPECT_EQ(out_indices, std::vector<int32_t>({4, 6, 3, 0, 5, 2, 1}));
+}
+
+// Runs TopK over 'batch' rows of 'input_size' elements. 'num_threads' == 0
+// runs without an intra-op thread pool.
+void BM_TopKF32(::testing::benchmark::State& state) {
+  const int64_t batch_size = state.range(0);
+  const int64_t input_size = state.range(1);
+  const int64_t k = state.range(2);
+  const int num_threads = state.range(3);
+
+  std::unique_ptr<Eigen::ThreadPool> pool;
+  std::unique_ptr<Eigen::ThreadPoolDevice> device;
+  ExecutableRunOptions run_options;
+  if (num_threads > 0) {
+    pool = std::make_unique<Eigen::ThreadPool>(num_threads);
+    device =
+        std::make_unique<Eigen::ThreadPoolDevice>(pool.get(), num_threads);
+    run_options.set_intra_op_thread_pool(device.get());
+  }
+
+  std::vector<float> values = MakeValues<float>(batch_size * input_size);
+  std::vector<float> out_values(batch_size * k);
+  std::vector<int32_t> out_indices(batch_size * k);
+  for (auto s : state) {
+    __xla_cpu_runtime_TopKF32(&run_options, batch_size, input_size, k,
+                              values.data(), out_values.data(),
+                              out_indices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size * input_size);
+}
+
+BENCHMARK(BM_TopKF32)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->ArgNames({"batch", "input_size", "k", "threads"})
+    ->Args({1, 1 << 16, 8, 0})
+    ->Args({64, 32000, 8, 0})
+    ->Args({64, 32000, 8, 8})
+    ->Args({64, 32000, 1024, 0})
+    ->Args({64, 32000, 1024, 8});
+
+}  // namespace
+}  // namespace xla
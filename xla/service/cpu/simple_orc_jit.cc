@@ -539,6 +539,9 @@ bool RegisterKnownJITSymbols() {
   REGISTER_CPU_RUNTIME_SYMBOL(StatusIsSuccess);
   REGISTER_CPU_RUNTIME_SYMBOL(KeyValueSort);
   REGISTER_CPU_RUNTIME_SYMBOL(TopKF32);
+  REGISTER_CPU_RUNTIME_SYMBOL(TopKBF16);
+  REGISTER_CPU_RUNTIME_SYMBOL(TopKF16);
+  REGISTER_CPU_RUNTIME_SYMBOL(TopKS32);
   REGISTER_CPU_RUNTIME_SYMBOL(TracingStart);
   REGISTER_CPU_RUNTIME_SYMBOL(TracingEnd);
 #if defined(INTEL_MKL) && defined(ENABLE_ONEDNN_V3)
@@ -0,0 +1,207 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xla/debug_options_flags.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_module_group.h"
+#include "xla/service/compiler.h"
+#include "xla/service/cpu/cpu_compiler.h"
+#include "xla/service/cpu/executable.pb.h"
+#include "xla/service/executable.h"
+#include "xla/service/hlo_module_config.h"
+#include "xla/service/hlo_parser.h"
+#include "xla/tests/hlo_test_base.h"
+#include "xla/xla.pb.h"
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/test_benchmark.h"
+#include "tsl/platform/threadpool.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+// Returns an MLP-like module with `num_layers` layers of dot, bias add and
+// activation, followed by a reduction. Every layer lowers to its own set of
+// LLVM functions, so the module has plenty of functions to split.
+std::string LayeredHloModule(int num_layers) {
+  std::string hlo = R"(
+HloModule layers
+
+add {
+  lhs = f32[] parameter(0)
+  rhs = f32[] parameter(1)
+  ROOT add = f32[] add(lhs, rhs)
+}
+
+ENTRY main {
+  x.0 = f32[16,64] parameter(0)
+  w = f32[64,64] parameter(1)
+  b = f32[64] parameter(2)
+  bias = f32[16,64] broadcast(b), dimensions={1}
+)";
+  for (int i = 0; i < num_layers; ++i) {
+    absl::StrAppendFormat(&hlo, R"(
+  dot.%d = f32[16,64] dot(x.%d, w), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  add.%d = f32[16,64] add(dot.%d, bias)
+  x.%d = f32[16,64] tanh(add.%d)
+)",
+                          i, i, i, i, i + 1, i);
+  }
+  absl::StrAppendFormat(&hlo, R"(
+  zero = f32[] constant(0)
+  ROOT reduce = f32[16] reduce(x.%d, zero), dimensions={1}, to_apply=add
+}
+)",
+                        num_layers);
+  return hlo;
+}
+
+class CpuParallelCodegenTest : public HloTestBase {
+ protected:
+  DebugOptions GetDebugOptionsForTest() override {
+    DebugOptions debug_options = HloTestBase::GetDebugOptionsForTest();
+    debug_options.set_xla_cpu_parallel_codegen_split_count(4);
+    return debug_options;
+  }
+};
+
+TEST_F(CpuParallelCodegenTest, SplitModuleMatchesReference) {
+  EXPECT_TRUE(RunAndCompare(LayeredHloModule(/*num_layers=*/8),
+                            ErrorSpec{1e-4, 1e-4}));
+}
+
+TEST_F(CpuParallelCodegenTest, SplitModuleWithWhileLoop) {
+  const char* hlo_text = R"(
+HloModule while
+
+cond {
+  state = (s32[], f32[8]) parameter(0)
+  i = s32[] get-tuple-element(state), index=0
+  limit = s32[] constant(10)
+  ROOT lt = pred[] compare(i, limit), direction=LT
+}
+
+body {
+  state = (s32[], f32[8]) parameter(0)
+  i = s32[] get-tuple-element(state), index=0
+  x = f32[8] get-tuple-element(state), index=1
+  one = s32[] constant(1)
+  next_i = s32[] add(i, one)
+  constants = f32[8] constant({1, 2, 3, 4, 5, 6, 7, 8})
+  next_x = f32[8] multiply(x, constants)
+  ROOT next_state = (s32[], f32[8]) tuple(next_i, next_x)
+}
+
+ENTRY main {
+  x = f32[8] parameter(0)
+  zero = s32[] constant(0)
+  init = (s32[], f32[8]) tuple(zero, x)
+  ROOT while = (s32[], f32[8]) while(init), condition=cond, body=body
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-4, 1e-4}));
+}
+
+TEST_F(CpuParallelCodegenTest, ExportAndLoadSplitExecutable) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<HloModule> module,
+      ParseAndReturnVerifiedModule(LayeredHloModule(/*num_layers=*/4)));
+
+  Compiler* compiler = backend().compiler();
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::unique_ptr<Executable>> executables,
+      compiler->Compile(std::make_unique<HloModuleGroup>(std::move(module)),
+                        {{backend().default_stream_executor()}},
+                        /*device_allocator=*/nullptr));
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AotCompilationResult> aot_result,
+                          compiler->Export(executables[0].get()));
+  TF_ASSERT_OK_AND_ASSIGN(std::string serialized,
+                          aot_result->SerializeAsString());
+
+  CompilationResultProto proto;
+  ASSERT_TRUE(proto.ParseFromString(serialized));
+  EXPECT_FALSE(proto.obj_file().empty());
+  EXPECT_GT(proto.additional_obj_files_size(), 0);
+
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AotCompilationResult> loaded_aot_result,
+      compiler->LoadAotCompilationResult(serialized));
+  TF_ASSERT_OK(loaded_aot_result
+                   ->LoadExecutable(compiler,
+                                    backend().default_stream_executor())
+                   .status());
+}
+
+// Measures the compile time of the backend (LLVM optimization and codegen) for
+// a module with `num_layers` layers when the LLVM module is split into
+// `split_count` parts.
+void BM_CompileLayeredModule(::testing::benchmark::State& state) {
+  const int num_layers = state.range(0);
+  const int split_count = state.range(1);
+
+  HloModuleConfig config;
+  DebugOptions debug_options = GetDebugOptionsFromFlags();
+  debug_options.set_xla_cpu_parallel_codegen_split_count(split_count);
+  config.set_debug_options(debug_options);
+  std::unique_ptr<HloModule> module =
+      ParseAndReturnUnverifiedModule(LayeredHloModule(num_layers), config)
+          .value();
+
+  CpuCompiler compiler;
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "compile",
+                                      std::max(split_count, 1));
+  Compiler::CompileOptions compile_options;
+  compile_options.thread_pool = &thread_pool;
+  std::unique_ptr<HloModule> optimized_module =
+      compiler
+          .RunHloPasses(std::move(module), /*stream_exec=*/nullptr,
+                        compile_options)
+          .value();
+
+  for (auto s : state) {
+    std::unique_ptr<Executable> executable =
+        compiler
+            .RunBackend(optimized_module->Clone(), /*stream_exec=*/nullptr,
+                        compile_options)
+            .value();
+    ::testing::benchmark::DoNotOptimize(executable);
+  }
+}
+
+BENCHMARK(BM_CompileLayeredModule)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->ArgNames({"layers", "split_count"})
+    ->Args({64, 1})
+    ->Args({64, 4})
+    ->Args({64, 8})
+    ->Args({256, 1})
+    ->Args({256, 8});
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
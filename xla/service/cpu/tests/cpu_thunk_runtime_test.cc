@@ -0,0 +1,292 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_module_group.h"
+#include "xla/hlo/ir/hlo_opcode.h"
+#include "xla/service/compiler.h"
+#include "xla/service/cpu/cpu_executable.h"
+#include "xla/service/cpu/thunk_executor.h"
+#include "xla/service/executable.h"
+#include "xla/stream_executor/stream_executor.h"
+#include "xla/tests/hlo_test_base.h"
+#include "xla/xla.pb.h"
+#include "tsl/platform/statusor.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+class CpuThunkRuntimeTest : public HloTestBase {
+ protected:
+  DebugOptions GetDebugOptionsForTest() override {
+    DebugOptions debug_options = HloTestBase::GetDebugOptionsForTest();
+    debug_options.set_xla_cpu_use_thunk_runtime(true);
+    return debug_options;
+  }
+};
+
+// Two independent chains of dots and convolutions joined at the root.
+constexpr char kIndependentBranches[] = R"(
+HloModule branches
+
+ENTRY main {
+  x = f32[32,32] parameter(0)
+  y = f32[32,32] parameter(1)
+  image = f32[1,16,16,4] parameter(2)
+  kernel = f32[3,3,4,4] parameter(3)
+  dot.0 = f32[32,32] dot(x, x), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  dot.1 = f32[32,32] dot(dot.0, x), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  dot.2 = f32[32,32] dot(y, y), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  dot.3 = f32[32,32] dot(dot.2, y), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  sum = f32[32,32] add(dot.1, dot.3)
+  conv = f32[1,16,16,4] convolution(image, kernel), window={size=3x3 pad=1_1x1_1}, dim_labels=b01f_01io->b01f
+  ROOT result = (f32[32,32], f32[1,16,16,4]) tuple(sum, conv)
+}
+)";
+
+TEST_F(CpuThunkRuntimeTest, IndependentBranches) {
+  EXPECT_TRUE(RunAndCompare(kIndependentBranches, ErrorSpec{1e-3, 1e-3}));
+}
+
+TEST_F(CpuThunkRuntimeTest, CompilesToThunks) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> module,
+                          ParseAndReturnVerifiedModule(kIndependentBranches));
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::unique_ptr<Executable>> executables,
+      backend().compiler()->Compile(
+          std::make_unique<HloModuleGroup>(std::move(module)),
+          {{backend().default_stream_executor()}},
+          /*device_allocator=*/nullptr));
+  auto* cpu_executable = static_cast<CpuExecutable*>(executables[0].get());
+  EXPECT_TRUE(cpu_executable->uses_thunks());
+  for (const HloInstruction* instruction :
+       cpu_executable->module().entry_computation()->instructions()) {
+    EXPECT_TRUE(instruction->opcode() == HloOpcode::kCall ||
+                instruction->opcode() == HloOpcode::kParameter ||
+                instruction->opcode() == HloOpcode::kConstant ||
+                instruction->opcode() == HloOpcode::kGetTupleElement ||
+                instruction->opcode() == HloOpcode::kBitcast)
+        << instruction->ToString();
+  }
+}
+
+TEST_F(CpuThunkRuntimeTest, ExportAndLoadKeepsThunks) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> module,
+                          ParseAndReturnVerifiedModule(kIndependentBranches));
+  Compiler* compiler = backend().compiler();
+  se::StreamExecutor* stream_exec = backend().default_stream_executor();
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::unique_ptr<Executable>> executables,
+      compiler->Compile(std::make_unique<HloModuleGroup>(std::move(module)),
+                        {{stream_exec}}, /*device_allocator=*/nullptr));
+  auto* compiled = static_cast<CpuExecutable*>(executables[0].get());
+
+  // This is the path the CPU client's compilation cache takes as well.
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AotCompilationResult> exported,
+                          compiler->Export(compiled));
+  TF_ASSERT_OK_AND_ASSIGN(std::string serialized,
+                          exported->SerializeAsString());
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AotCompilationResult> loaded,
+                          compiler->LoadAotCompilationResult(serialized));
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Executable> executable,
+                          loaded->LoadExecutable(compiler, stream_exec));
+
+  auto* cpu_executable = static_cast<CpuExecutable*>(executable.get());
+  ASSERT_TRUE(cpu_executable->uses_thunks());
+  ASSERT_EQ(cpu_executable->thunks().size(), compiled->thunks().size());
+  for (int i = 0; i < compiled->thunks().size(); ++i) {
+    const ThunkExecutor::Thunk& expected = compiled->thunks()[i];
+    const ThunkExecutor::Thunk& thunk = cpu_executable->thunks()[i];
+    EXPECT_EQ(thunk.name, expected.name);
+    EXPECT_EQ(thunk.dependencies, expected.dependencies);
+    EXPECT_EQ(thunk.has_side_effects, expected.has_side_effects);
+  }
+}
+
+TEST_F(CpuThunkRuntimeTest, WhileAndConditional) {
+  const char* hlo_text = R"(
+HloModule control_flow
+
+cond {
+  state = (s32[], f32[8]) parameter(0)
+  i = s32[] get-tuple-element(state), index=0
+  limit = s32[] constant(10)
+  ROOT lt = pred[] compare(i, limit), direction=LT
+}
+
+body {
+  state = (s32[], f32[8]) parameter(0)
+  i = s32[] get-tuple-element(state), index=0
+  x = f32[8] get-tuple-element(state), index=1
+  one = s32[] constant(1)
+  next_i = s32[] add(i, one)
+  two = f32[] constant(2)
+  twos = f32[8] broadcast(two), dimensions={}
+  next_x = f32[8] add(x, twos)
+  ROOT next_state = (s32[], f32[8]) tuple(next_i, next_x)
+}
+
+negate {
+  x = f32[8] parameter(0)
+  ROOT negate = f32[8] negate(x)
+}
+
+exp {
+  x = f32[8] parameter(0)
+  ROOT exp = f32[8] exponential(x)
+}
+
+ENTRY main {
+  x = f32[8] parameter(0)
+  p = pred[] parameter(1)
+  zero = s32[] constant(0)
+  init = (s32[], f32[8]) tuple(zero, x)
+  while = (s32[], f32[8]) while(init), condition=cond, body=body
+  looped = f32[8] get-tuple-element(while), index=1
+  branch = f32[8] conditional(p, x, x), true_computation=negate, false_computation=exp
+  ROOT sum = f32[8] add(looped, branch)
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-4, 1e-4}));
+}
+
+TEST_F(CpuThunkRuntimeTest, SortAndReduce) {
+  const char* hlo_text = R"(
+HloModule sort_and_reduce
+
+compare {
+  p.0 = f32[] parameter(0)
+  p.1 = f32[] parameter(1)
+  ROOT lt = pred[] compare(p.0, p.1), direction=LT
+}
+
+add {
+  lhs = f32[] parameter(0)
+  rhs = f32[] parameter(1)
+  ROOT add = f32[] add(lhs, rhs)
+}
+
+ENTRY main {
+  x = f32[16,128] parameter(0)
+  y = f32[16,128] parameter(1)
+  sorted = f32[16,128] sort(x), dimensions={1}, to_apply=compare
+  zero = f32[] constant(0)
+  reduced = f32[16] reduce(y, zero), dimensions={1}, to_apply=add
+  broadcast = f32[16,128] broadcast(reduced), dimensions={0}
+  ROOT result = f32[16,128] multiply(sorted, broadcast)
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-3, 1e-3}));
+}
+
+TEST_F(CpuThunkRuntimeTest, InPlaceUpdateAfterRead) {
+  // The dynamic-update-slice updates the buffer of `copy` in place, so it must
+  // not start before the other reader of `copy` finished.
+  const char* hlo_text = R"(
+HloModule in_place
+
+ENTRY main {
+  x = f32[64] parameter(0)
+  update = f32[8] parameter(1)
+  index = s32[] parameter(2)
+  copy = f32[64] copy(x)
+  negate = f32[64] negate(copy)
+  dus = f32[64] dynamic-update-slice(copy, update, index)
+  ROOT result = (f32[64], f32[64]) tuple(negate, dus)
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{0, 0}));
+}
+
+TEST_F(CpuThunkRuntimeTest, AllReduce) {
+  const char* hlo_text = R"(
+HloModule all_reduce
+
+add {
+  lhs = f32[] parameter(0)
+  rhs = f32[] parameter(1)
+  ROOT add = f32[] add(lhs, rhs)
+}
+
+ENTRY main {
+  x = f32[128] parameter(0)
+  y = f32[128] parameter(1)
+  all-reduce = f32[128] all-reduce(x), replica_groups={}, to_apply=add
+  negate = f32[128] negate(y)
+  ROOT result = f32[128] add(all-reduce, negate)
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-4, 1e-4}));
+}
+
+class CpuThunkRuntimeMemoryLimitTest : public CpuThunkRuntimeTest {
+ protected:
+  DebugOptions GetDebugOptionsForTest() override {
+    DebugOptions debug_options = CpuThunkRuntimeTest::GetDebugOptionsForTest();
+    debug_options.set_xla_cpu_memory_limit_bytes(16 * 1024);
+    return debug_options;
+  }
+};
+
+// `exp` is live across the chain of negates unless it is rematerialized right
+// before its use. The memory limit is below the size of the live buffers, so
+// rematerialization runs on the entry computation before it is outlined.
+constexpr char kRematerializable[] = R"(
+HloModule remat
+
+ENTRY main {
+  x = f32[1024] parameter(0)
+  exp = f32[1024] exponential(x)
+  negate.0 = f32[1024] negate(x)
+  negate.1 = f32[1024] negate(negate.0)
+  negate.2 = f32[1024] negate(negate.1)
+  negate.3 = f32[1024] negate(negate.2)
+  ROOT add = f32[1024] add(exp, negate.3)
+}
+)";
+
+TEST_F(CpuThunkRuntimeMemoryLimitTest, RematerializesBeforeOutlining) {
+  EXPECT_TRUE(RunAndCompare(kRematerializable, ErrorSpec{1e-4, 1e-4}));
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> module,
+                          ParseAndReturnVerifiedModule(kRematerializable));
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::unique_ptr<Executable>> executables,
+      backend().compiler()->Compile(
+          std::make_unique<HloModuleGroup>(std::move(module)),
+          {{backend().default_stream_executor()}},
+          /*device_allocator=*/nullptr));
+  auto* cpu_executable = static_cast<CpuExecutable*>(executables[0].get());
+  EXPECT_TRUE(cpu_executable->uses_thunks());
+  // Instructions added by rematerialization are outlined like all others.
+  for (const HloInstruction* instruction :
+       cpu_executable->module().entry_computation()->instructions()) {
+    EXPECT_TRUE(instruction->opcode() == HloOpcode::kCall ||
+                instruction->opcode() == HloOpcode::kParameter)
+        << instruction->ToString();
+  }
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
@@ -0,0 +1,264 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/cpu/thunk_executor.h"
+
+#define EIGEN_USE_THREADS
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "xla/executable_run_options.h"
+#include "xla/service/custom_call_status.h"
+#include "xla/service/custom_call_status_internal.h"
+#include "xla/util.h"
+#include "tsl/platform/logging.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+// Thunks with parallel loops block a pool thread while waiting for the loop
+// partitions, which run on the same pool. Keeping one thread of every pool free
+// of thunks guarantees that those partitions make progress, so the number of
+// thunks in flight on a pool is capped over all the executions sharing it, not
+// per execution.
+ABSL_CONST_INIT absl::Mutex in_flight_mu(absl::kConstInit);
+
+absl::flat_hash_map<const Eigen::ThreadPoolInterface*, int64_t>& InFlight()
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(in_flight_mu) {
+  static auto* in_flight =
+      new absl::flat_hash_map<const Eigen::ThreadPoolInterface*, int64_t>();
+  return *in_flight;
+}
+
+// Reserves a thread of `pool` for a thunk. Returns false if all but one of
+// its threads already run thunks.
+bool TryAcquirePoolThread(const Eigen::ThreadPoolDevice* pool) {
+  absl::MutexLock lock(&in_flight_mu);
+  int64_t& in_flight = InFlight()[pool->getPool()];
+  if (in_flight >= pool->numThreads() - 1) {
+    return false;
+  }
+  ++in_flight;
+  return true;
+}
+
+void ReleasePoolThread(const Eigen::ThreadPoolDevice* pool) {
+  absl::MutexLock lock(&in_flight_mu);
+  auto it = InFlight().find(pool->getPool());
+  if (--it->second == 0) {
+    InFlight().erase(it);
+  }
+}
+
+}  // namespace
+
+// The state of one execution. Shared with the thunks dispatched to the thread
+// pool, which may still hold on to it after Execute() returned.
+struct ThunkExecutor::ExecuteState {
+  ExecuteState(const ExecutableRunOptions* run_options, void** buffer_table,
+               int64_t num_thunks)
+      : run_options(run_options),
+        buffer_table(buffer_table),
+        num_thunks(num_thunks),
+        pending_dependencies(num_thunks) {}
+
+  bool CanMakeProgress() const ABSL_SHARED_LOCKS_REQUIRED(mu) {
+    if (error.has_value()) {
+      return num_in_flight == 0;
+    }
+    return !ready.empty() || num_finished == num_thunks;
+  }
+
+  const ExecutableRunOptions* run_options;
+  void** buffer_table;
+  const int64_t num_thunks;
+
+  absl::Mutex mu;
+  std::vector<int64_t> pending_dependencies ABSL_GUARDED_BY(mu);
+  // Thunks ready to run. Preferring the smallest index keeps the execution
+  // close to the sequential order the buffers were assigned for.
+  std::priority_queue<int64_t, std::vector<int64_t>, std::greater<>> ready
+      ABSL_GUARDED_BY(mu);
+  int64_t num_finished ABSL_GUARDED_BY(mu) = 0;
+  // Number of thunks dispatched to the thread pool that have not finished.
+  int64_t num_in_flight ABSL_GUARDED_BY(mu) = 0;
+  std::optional<std::string> error ABSL_GUARDED_BY(mu);
+};
+
+/*static*/ absl::StatusOr<ThunkExecutor> ThunkExecutor::Create(
+    std::vector<Thunk> thunks) {
+  for (int64_t i = 0; i < thunks.size(); ++i) {
+    if (thunks[i].function == nullptr) {
+      return Internal("Thunk %s has no function.", thunks[i].name);
+    }
+    for (int64_t dependency : thunks[i].dependencies) {
+      if (dependency < 0 || dependency >= i) {
+        return Internal("Thunk %s has an invalid dependency %d.",
+                        thunks[i].name, dependency);
+      }
+    }
+  }
+  return ThunkExecutor(std::move(thunks));
+}
+
+ThunkExecutor::ThunkExecutor(std::vector<Thunk> thunks)
+    : thunks_(std::move(thunks)),
+      dependents_(thunks_.size()),
+      is_sequential_(true) {
+  for (int64_t i = 0; i < thunks_.size(); ++i) {
+    bool depends_on_predecessor = i == 0;
+    for (int64_t dependency : thunks_[i].dependencies) {
+      dependents_[dependency].push_back(i);
+      depends_on_predecessor |= dependency == i - 1;
+    }
+    is_sequential_ &= depends_on_predecessor;
+  }
+}
+
+void ThunkExecutor::ExecuteSequential(const ExecutableRunOptions* run_options,
+                                      void** buffer_table,
+                                      XlaCustomCallStatus* status) const {
+  for (const Thunk& thunk : thunks_) {
+    thunk.function(nullptr, run_options, nullptr, buffer_table, status,
+                   nullptr);
+    if (CustomCallStatusGetMessage(status).has_value()) {
+      return;
+    }
+  }
+}
+
+void ThunkExecutor::Execute(const ExecutableRunOptions* run_options,
+                            void** buffer_table,
+                            XlaCustomCallStatus* status) const {
+  const Eigen::ThreadPoolDevice* thread_pool =
+      run_options != nullptr ? run_options->intra_op_thread_pool() : nullptr;
+  // Waiting for the pool on one of its own threads could deadlock.
+  if (is_sequential_ || thread_pool == nullptr ||
+      thread_pool->numThreads() <= 1 || thread_pool->currentThreadId() != -1) {
+    ExecuteSequential(run_options, buffer_table, status);
+    return;
+  }
+
+  auto state = std::make_shared<ExecuteState>(run_options, buffer_table,
+                                              thunks_.size());
+  absl::MutexLock lock(&state->mu);
+  for (int64_t i = 0; i < thunks_.size(); ++i) {
+    state->pending_dependencies[i] = thunks_[i].dependencies.size();
+    if (state->pending_dependencies[i] == 0) {
+      state->ready.push(i);
+    }
+  }
+
+  while (true) {
+    state->mu.Await(
+        absl::Condition(state.get(), &ExecuteState::CanMakeProgress));
+    if (state->error.has_value() || state->num_finished == thunks_.size()) {
+      break;
+    }
+
+    // Dispatch all ready thunks to the pool except one, which runs on this
+    // thread instead of waiting idle. Thunks with side effects, of which at
+    // most one is ready at a time, always run here.
+    std::vector<int64_t> batch;
+    while (!state->ready.empty()) {
+      batch.push_back(state->ready.top());
+      state->ready.pop();
+    }
+    int64_t inline_thunk = -1;
+    for (int64_t id : batch) {
+      if (thunks_[id].has_side_effects) {
+        inline_thunk = id;
+      }
+    }
+    for (int64_t i = 0; i < batch.size(); ++i) {
+      int64_t id = batch[i];
+      if (id == inline_thunk) {
+        continue;
+      }
+      if (inline_thunk < 0 && i == batch.size() - 1) {
+        inline_thunk = id;
+      } else if (TryAcquirePoolThread(thread_pool)) {
+        ++state->num_in_flight;
+        thread_pool->enqueueNoNotification([this, state, id] {
+          RunThunk(*state, id, /*dispatched=*/true);
+        });
+      } else {
+        state->ready.push(id);
+      }
+    }
+
+    if (inline_thunk >= 0) {
+      state->mu.Unlock();
+      RunThunk(*state, inline_thunk, /*dispatched=*/false);
+      state->mu.Lock();
+    }
+  }
+
+  if (state->error.has_value()) {
+    XlaCustomCallStatusSetFailure(status, state->error->data(),
+                                  state->error->size());
+  }
+}
+
+void ThunkExecutor::RunThunk(ExecuteState& state, int64_t id,
+                             bool dispatched) const {
+  const Thunk& thunk = thunks_[id];
+  VLOG(3) << "Running thunk " << thunk.name;
+  XlaCustomCallStatus status;
+  thunk.function(nullptr, state.run_options, nullptr, state.buffer_table,
+                 &status, nullptr);
+  std::optional<absl::string_view> error_message =
+      CustomCallStatusGetMessage(&status);
+  // Released before the thunk counts as finished, so that no execution
+  // holds a pool thread once it has returned.
+  if (dispatched) {
+    ReleasePoolThread(state.run_options->intra_op_thread_pool());
+  }
+
+  absl::MutexLock lock(&state.mu);
+  if (dispatched) {
+    --state.num_in_flight;
+  }
+  ++state.num_finished;
+  if (error_message.has_value()) {
+    if (!state.error.has_value()) {
+      state.error = std::string(*error_message);
+    }
+    return;
+  }
+  for (int64_t dependent : dependents_[id]) {
+    if (--state.pending_dependencies[dependent] == 0) {
+      state.ready.push(dependent);
+    }
+  }
+}
+
+}  // namespace cpu
+}  // namespace xla
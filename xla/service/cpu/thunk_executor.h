@@ -0,0 +1,100 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_SERVICE_CPU_THUNK_EXECUTOR_H_
+#define XLA_SERVICE_CPU_THUNK_EXECUTOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xla/executable_run_options.h"
+#include "xla/service/custom_call_status_internal.h"
+
+namespace xla {
+namespace cpu {
+
+// Executes the thunks of a CPU executable compiled for the thunk runtime. A
+// thunk is a compiled function for one top-level instruction of the entry
+// computation (see ThunkOutliner) with the same calling convention as the entry
+// function, so all thunks share the buffer table of an execution.
+//
+// Thunks run in dependency order. When the run options provide an intra-op
+// thread pool, thunks that are ready at the same time are dispatched to the
+// pool concurrently; thunks with side effects always run on the calling thread.
+// This class is thread-safe; concurrent executions share no state.
+class ThunkExecutor {
+ public:
+  using ThunkFunction = void (*)(void* /*result*/,
+                                 const ExecutableRunOptions* /*run_options*/,
+                                 const void** /*args*/,
+                                 void** /*buffer_table*/,
+                                 XlaCustomCallStatus* /*status*/,
+                                 int64_t* /*profile_counters*/);
+
+  struct Thunk {
+    // Name of the compiled function, used for resolving `function`.
+    std::string name;
+    ThunkFunction function = nullptr;
+
+    // Indices of the thunks that have to finish before this one starts. All
+    // of them are smaller than the index of this thunk.
+    std::vector<int64_t> dependencies;
+
+    bool has_side_effects = false;
+  };
+
+  // Returns an error if a thunk has no function or a dependency does not
+  // refer to an earlier thunk.
+  static absl::StatusOr<ThunkExecutor> Create(std::vector<Thunk> thunks);
+
+  // Runs all thunks on `buffer_table`. Stops dispatching thunks after the
+  // first failure and reports it in `status`.
+  void Execute(const ExecutableRunOptions* run_options, void** buffer_table,
+               XlaCustomCallStatus* status) const;
+
+  absl::Span<const Thunk> thunks() const { return thunks_; }
+
+  // Returns true if every thunk depends on its predecessor, in which case
+  // there is nothing to run concurrently.
+  bool is_sequential() const { return is_sequential_; }
+
+ private:
+  struct ExecuteState;
+
+  explicit ThunkExecutor(std::vector<Thunk> thunks);
+
+  void ExecuteSequential(const ExecutableRunOptions* run_options,
+                         void** buffer_table,
+                         XlaCustomCallStatus* status) const;
+
+  // Runs thunk `id` and, under the lock of `state`, releases its dependents.
+  // `dispatched` is true if the thunk runs on the thread pool.
+  void RunThunk(ExecuteState& state, int64_t id, bool dispatched) const;
+
+  std::vector<Thunk> thunks_;
+
+  // For every thunk the thunks that depend on it.
+  std::vector<std::vector<int64_t>> dependents_;
+
+  bool is_sequential_;
+};
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // XLA_SERVICE_CPU_THUNK_EXECUTOR_H_
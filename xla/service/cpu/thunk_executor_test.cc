@@ -0,0 +1,260 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/cpu/thunk_executor.h"
+
+#define EIGEN_USE_THREADS
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/barrier.h"
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "xla/executable_run_options.h"
+#include "xla/service/custom_call_status.h"
+#include "xla/service/custom_call_status_internal.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/threadpool.h"
+
+namespace xla::cpu {
+namespace {
+
+// The thunks below communicate through the first entry of the buffer table,
+// which points to an int64_t array: buffer[i] is written by thunk `i`.
+int64_t* Buffer(void** buffer_table) {
+  return static_cast<int64_t*>(buffer_table[0]);
+}
+
+void Thunk0(void*, const ExecutableRunOptions*, const void**,
+            void** buffer_table, XlaCustomCallStatus*, int64_t*) {
+  Buffer(buffer_table)[0] = 1;
+}
+
+void Thunk1(void*, const ExecutableRunOptions*, const void**,
+            void** buffer_table, XlaCustomCallStatus*, int64_t*) {
+  Buffer(buffer_table)[1] = Buffer(buffer_table)[0] + 10;
+}
+
+void Thunk2(void*, const ExecutableRunOptions*, const void**,
+            void** buffer_table, XlaCustomCallStatus*, int64_t*) {
+  Buffer(buffer_table)[2] = Buffer(buffer_table)[0] + 100;
+}
+
+void Thunk3(void*, const ExecutableRunOptions*, const void**,
+            void** buffer_table, XlaCustomCallStatus*, int64_t*) {
+  Buffer(buffer_table)[3] = Buffer(buffer_table)[1] + Buffer(buffer_table)[2];
+}
+
+void FailingThunk(void*, const ExecutableRunOptions*, const void**, void**,
+                  XlaCustomCallStatus* status, int64_t*) {
+  constexpr absl::string_view kMessage = "thunk failed";
+  XlaCustomCallStatusSetFailure(status, kMessage.data(), kMessage.size());
+}
+
+// Waits until both thunks using the barrier have started, which only happens
+// if they run concurrently.
+absl::Barrier* rendezvous = nullptr;
+
+void RendezvousThunk(void*, const ExecutableRunOptions*, const void**, void**,
+                     XlaCustomCallStatus*, int64_t*) {
+  rendezvous->Block();
+}
+
+// Like a thunk with a parallel loop: runs a partition on the intra-op pool and
+// blocks until it is done.
+void ForkJoinThunk(void*, const ExecutableRunOptions* run_options,
+                   const void**, void**, XlaCustomCallStatus*, int64_t*) {
+  tsl::BlockingCounter counter(1);
+  run_options->intra_op_thread_pool()->enqueueNoNotification(
+      [&counter] { counter.DecrementCount(); });
+  counter.Wait();
+}
+
+std::optional<std::thread::id> side_effect_thread;
+
+void SideEffectThunk(void*, const ExecutableRunOptions*, const void**, void**,
+                     XlaCustomCallStatus*, int64_t*) {
+  side_effect_thread = std::this_thread::get_id();
+}
+
+ThunkExecutor::Thunk MakeThunk(std::string name,
+                               ThunkExecutor::ThunkFunction function,
+                               std::vector<int64_t> dependencies,
+                               bool has_side_effects = false) {
+  ThunkExecutor::Thunk thunk;
+  thunk.name = std::move(name);
+  thunk.function = function;
+  thunk.dependencies = std::move(dependencies);
+  thunk.has_side_effects = has_side_effects;
+  return thunk;
+}
+
+class ThunkExecutorTest : public ::testing::Test {
+ protected:
+  ThunkExecutorTest()
+      : thread_pool_(tsl::Env::Default(), "thunk_executor_test", 4),
+        device_(thread_pool_.AsEigenThreadPool(), thread_pool_.NumThreads()) {
+    run_options_.set_intra_op_thread_pool(&device_);
+  }
+
+  tsl::thread::ThreadPool thread_pool_;
+  Eigen::ThreadPoolDevice device_;
+  ExecutableRunOptions run_options_;
+};
+
+std::vector<ThunkExecutor::Thunk> DiamondThunks() {
+  std::vector<ThunkExecutor::Thunk> thunks;
+  thunks.push_back(MakeThunk("thunk0", &Thunk0, {}));
+  thunks.push_back(MakeThunk("thunk1", &Thunk1, {0}));
+  thunks.push_back(MakeThunk("thunk2", &Thunk2, {0}));
+  thunks.push_back(MakeThunk("thunk3", &Thunk3, {1, 2}));
+  return thunks;
+}
+
+TEST_F(ThunkExecutorTest, Diamond) {
+  TF_ASSERT_OK_AND_ASSIGN(ThunkExecutor executor,
+                          ThunkExecutor::Create(DiamondThunks()));
+  EXPECT_FALSE(executor.is_sequential());
+
+  for (const ExecutableRunOptions* run_options :
+       {static_cast<const ExecutableRunOptions*>(nullptr),
+        static_cast<const ExecutableRunOptions*>(&run_options_)}) {
+    std::vector<int64_t> buffer(4);
+    void* buffer_table[] = {buffer.data()};
+    XlaCustomCallStatus status;
+    executor.Execute(run_options, buffer_table, &status);
+    EXPECT_FALSE(CustomCallStatusGetMessage(&status).has_value());
+    EXPECT_EQ(buffer[3], 11 + 101);
+  }
+}
+
+TEST_F(ThunkExecutorTest, IndependentThunksRunConcurrently) {
+  absl::Barrier barrier(2);
+  rendezvous = &barrier;
+  std::vector<ThunkExecutor::Thunk> thunks;
+  thunks.push_back(MakeThunk("a", &RendezvousThunk, {}));
+  thunks.push_back(MakeThunk("b", &RendezvousThunk, {}));
+  TF_ASSERT_OK_AND_ASSIGN(ThunkExecutor executor,
+                          ThunkExecutor::Create(std::move(thunks)));
+
+  XlaCustomCallStatus status;
+  executor.Execute(&run_options_, /*buffer_table=*/nullptr, &status);
+  EXPECT_FALSE(CustomCallStatusGetMessage(&status).has_value());
+  rendezvous = nullptr;
+}
+
+TEST_F(ThunkExecutorTest, SideEffectsRunOnCallingThread) {
+  std::vector<ThunkExecutor::Thunk> thunks = DiamondThunks();
+  thunks.push_back(MakeThunk("side_effect", &SideEffectThunk, {},
+                             /*has_side_effects=*/true));
+  TF_ASSERT_OK_AND_ASSIGN(ThunkExecutor executor,
+                          ThunkExecutor::Create(std::move(thunks)));
+
+  std::vector<int64_t> buffer(4);
+  void* buffer_table[] = {buffer.data()};
+  XlaCustomCallStatus status;
+  side_effect_thread.reset();
+  executor.Execute(&run_options_, buffer_table, &status);
+  EXPECT_FALSE(CustomCallStatusGetMessage(&status).has_value());
+  EXPECT_EQ(side_effect_thread, std::this_thread::get_id());
+}
+
+TEST_F(ThunkExecutorTest, FailureStopsDependents) {
+  std::vector<ThunkExecutor::Thunk> thunks;
+  thunks.push_back(MakeThunk("thunk0", &Thunk0, {}));
+  thunks.push_back(MakeThunk("failing", &FailingThunk, {0}));
+  thunks.push_back(MakeThunk("thunk2", &Thunk2, {0}));
+  thunks.push_back(MakeThunk("thunk3", &Thunk3, {1, 2}));
+  TF_ASSERT_OK_AND_ASSIGN(ThunkExecutor executor,
+                          ThunkExecutor::Create(std::move(thunks)));
+
+  for (const ExecutableRunOptions* run_options :
+       {static_cast<const ExecutableRunOptions*>(nullptr),
+        static_cast<const ExecutableRunOptions*>(&run_options_)}) {
+    std::vector<int64_t> buffer(4);
+    void* buffer_table[] = {buffer.data()};
+    XlaCustomCallStatus status;
+    executor.Execute(run_options, buffer_table, &status);
+    std::optional<absl::string_view> message =
+        CustomCallStatusGetMessage(&status);
+    ASSERT_TRUE(message.has_value());
+    EXPECT_EQ(*message, "thunk failed");
+    EXPECT_EQ(buffer[3], 0);
+  }
+}
+
+TEST_F(ThunkExecutorTest, ConcurrentExecutionsShareThePool) {
+  // More executions, each with more independent thunks, than the pool has
+  // threads. If every pool thread ran a thunk, the partitions the thunks wait
+  // for could never run.
+  constexpr int kNumExecutions = 4;
+  constexpr int kNumThunks = 8;
+  std::vector<ThunkExecutor::Thunk> thunks;
+  for (int i = 0; i < kNumThunks; ++i) {
+    thunks.push_back(MakeThunk(absl::StrCat("fork_join", i), &ForkJoinThunk,
+                               /*dependencies=*/{}));
+  }
+  TF_ASSERT_OK_AND_ASSIGN(ThunkExecutor executor,
+                          ThunkExecutor::Create(std::move(thunks)));
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumExecutions; ++i) {
+    threads.emplace_back([&] {
+      for (int run = 0; run < 10; ++run) {
+        XlaCustomCallStatus status;
+        executor.Execute(&run_options_, /*buffer_table=*/nullptr, &status);
+        EXPECT_FALSE(CustomCallStatusGetMessage(&status).has_value());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST_F(ThunkExecutorTest, RunsSequentiallyOnPoolThreads) {
+  TF_ASSERT_OK_AND_ASSIGN(ThunkExecutor executor,
+                          ThunkExecutor::Create(DiamondThunks()));
+  std::vector<int64_t> buffer(4);
+  void* buffer_table[] = {buffer.data()};
+  XlaCustomCallStatus status;
+  tsl::BlockingCounter done(1);
+  thread_pool_.Schedule([&] {
+    executor.Execute(&run_options_, buffer_table, &status);
+    done.DecrementCount();
+  });
+  done.Wait();
+  EXPECT_FALSE(CustomCallStatusGetMessage(&status).has_value());
+  EXPECT_EQ(buffer[3], 11 + 101);
+}
+
+TEST_F(ThunkExecutorTest, RejectsInvalidDependencies) {
+  std::vector<ThunkExecutor::Thunk> thunks;
+  thunks.push_back(MakeThunk("thunk0", &Thunk0, {1}));
+  thunks.push_back(MakeThunk("thunk1", &Thunk1, {}));
+  EXPECT_FALSE(ThunkExecutor::Create(std::move(thunks)).ok());
+}
+
+}  // namespace
+}  // namespace xla::cpu
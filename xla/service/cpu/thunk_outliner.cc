@@ -0,0 +1,256 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/cpu/thunk_outliner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "xla/hlo/ir/hlo_computation.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_opcode.h"
+#include "xla/hlo/ir/hlo_schedule.h"
+#include "xla/hlo/utils/hlo_query.h"
+#include "xla/service/buffer_assignment.h"
+#include "xla/shape_util.h"
+#include "xla/status_macros.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+
+namespace xla {
+namespace cpu {
+
+namespace {
+
+// Returns true if `instruction` generates code when emitted as part of the
+// entry computation. Everything else only binds buffer addresses.
+bool GeneratesCode(const HloInstruction* instruction) {
+  switch (instruction->opcode()) {
+    case HloOpcode::kParameter:
+    case HloOpcode::kConstant:
+    case HloOpcode::kGetTupleElement:
+    case HloOpcode::kBitcast:
+    case HloOpcode::kAfterAll:
+    case HloOpcode::kAddDependency:
+      return false;
+    default:
+      return true;
+  }
+}
+
+bool HasSideEffects(const HloComputation* computation) {
+  for (const HloInstruction* instruction : computation->instructions()) {
+    if (instruction->HasSideEffect() ||
+        instruction->opcode() == HloOpcode::kCustomCall ||
+        hlo_query::IsCollectiveCommunicationOp(instruction->opcode())) {
+      return true;
+    }
+    for (const HloComputation* called : instruction->called_computations()) {
+      if (HasSideEffects(called)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Adds the slices of the global buffers of `instruction` to `slices`. If
+// `defined_only` is true, only the buffers of values defined by `instruction`
+// are added, i.e. the buffers it writes.
+void AddSlices(const BufferAssignment& assignment,
+               const HloInstruction* instruction, bool defined_only,
+               absl::flat_hash_set<BufferAllocation::Slice>* slices) {
+  ShapeUtil::ForEachSubshape(
+      instruction->shape(), [&](const Shape&, const ShapeIndex& index) {
+        if (defined_only && !assignment.dataflow_analysis().ValueIsDefinedAt(
+                                instruction, index)) {
+          return;
+        }
+        for (const BufferAllocation::Slice& slice :
+             assignment.GetAllSlices(instruction, index)) {
+          // Thread-local buffers live on the stack of the thunk, and constants
+          // are never written.
+          if (!slice.allocation()->is_thread_local() &&
+              !slice.allocation()->is_constant()) {
+            slices->insert(slice);
+          }
+        }
+      });
+}
+
+// Adds the slices of the buffers `computation` may write to `slices`. Only
+// computations called in a sequential context have buffers of their own;
+// fusion and reduction computations are emitted inline or use thread-local
+// buffers.
+void AddWrittenSlices(const BufferAssignment& assignment,
+                      const HloComputation* computation,
+                      absl::flat_hash_set<BufferAllocation::Slice>* slices) {
+  for (const HloInstruction* instruction : computation->instructions()) {
+    AddSlices(assignment, instruction, /*defined_only=*/true, slices);
+    switch (instruction->opcode()) {
+      case HloOpcode::kCall:
+      case HloOpcode::kWhile:
+      case HloOpcode::kConditional:
+        for (const HloComputation* called :
+             instruction->called_computations()) {
+          AddWrittenSlices(assignment, called, slices);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// An access of a thunk to a buffer slice.
+struct SliceAccess {
+  int64_t thunk;
+  BufferAllocation::Slice slice;
+  bool is_write;
+};
+
+bool IsContainedIn(const BufferAllocation::Slice& slice,
+                   const BufferAllocation::Slice& other) {
+  return slice.index() == other.index() && other.offset() <= slice.offset() &&
+         slice.offset() + slice.size() <= other.offset() + other.size();
+}
+
+}  // namespace
+
+absl::StatusOr<bool> ThunkOutliner::Run(
+    HloModule* module,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  HloComputation* entry = module->entry_computation();
+  bool changed = false;
+  // The outlined instructions are replaced by their calls, so only their
+  // addresses may be used as keys.
+  absl::flat_hash_map<const HloInstruction*, HloInstruction*> calls;
+  for (HloInstruction* instruction : entry->MakeInstructionPostOrder()) {
+    if (!GeneratesCode(instruction)) {
+      continue;
+    }
+    std::string name = absl::StrCat("thunk.", instruction->name());
+    HloInstruction* call = entry->CreateCallInstruction({instruction});
+    module->SetAndUniquifyComputationName(call->to_apply(), name);
+    calls[instruction] = call;
+    changed = true;
+  }
+
+  // Keep the order of a scheduled module: every call takes the place of the
+  // instruction it outlines, and the thunk computations are sequenced.
+  if (changed && module->has_schedule()) {
+    HloInstructionSequence sequence;
+    for (HloInstruction* instruction :
+         module->schedule().sequence(entry).instructions()) {
+      auto it = calls.find(instruction);
+      sequence.push_back(it == calls.end() ? instruction : it->second);
+    }
+    module->schedule().set_sequence(entry, std::move(sequence));
+    TF_RETURN_IF_ERROR(module->schedule().Update(execution_threads));
+  }
+  return changed;
+}
+
+absl::StatusOr<std::vector<ThunkInfo>> AnalyzeThunks(
+    const HloInstructionSequence& entry_sequence,
+    const BufferAssignment& assignment) {
+  std::vector<ThunkInfo> thunks;
+
+  // All accesses of earlier thunks that are not shadowed by a later write.
+  absl::flat_hash_map<BufferAllocation::Index, std::vector<SliceAccess>>
+      accesses;
+  int64_t last_side_effecting_thunk = -1;
+
+  for (const HloInstruction* instruction : entry_sequence.instructions()) {
+    if (instruction->opcode() != HloOpcode::kCall) {
+      TF_RET_CHECK(!GeneratesCode(instruction))
+          << "Entry computation has not been outlined into thunks: "
+          << instruction->ToString();
+      continue;
+    }
+    const int64_t id = thunks.size();
+
+    absl::flat_hash_set<BufferAllocation::Slice> written;
+    AddWrittenSlices(assignment, instruction->to_apply(), &written);
+    absl::flat_hash_set<BufferAllocation::Slice> read;
+    for (const HloInstruction* operand : instruction->operands()) {
+      AddSlices(assignment, operand, /*defined_only=*/false, &read);
+    }
+
+    absl::flat_hash_set<int64_t> dependencies;
+    auto add_access = [&](const BufferAllocation::Slice& slice,
+                          bool is_write) {
+      std::vector<SliceAccess>& allocation_accesses =
+          accesses[slice.index()];
+      for (const SliceAccess& access : allocation_accesses) {
+        if (access.thunk != id && (is_write || access.is_write) &&
+            access.slice.OverlapsWith(slice)) {
+          dependencies.insert(access.thunk);
+        }
+      }
+      if (is_write) {
+        // Every later access that overlaps an access covered by this write
+        // also overlaps the write, and this thunk depends on the covered one.
+        allocation_accesses.erase(
+            std::remove_if(allocation_accesses.begin(),
+                           allocation_accesses.end(),
+                           [&](const SliceAccess& access) {
+                             return access.thunk != id &&
+                                    IsContainedIn(access.slice, slice);
+                           }),
+            allocation_accesses.end());
+      }
+      allocation_accesses.push_back(SliceAccess{id, slice, is_write});
+    };
+    for (const BufferAllocation::Slice& slice : written) {
+      add_access(slice, /*is_write=*/true);
+    }
+    for (const BufferAllocation::Slice& slice : read) {
+      if (!written.contains(slice)) {
+        add_access(slice, /*is_write=*/false);
+      }
+    }
+
+    bool has_side_effects = HasSideEffects(instruction->to_apply());
+    if (has_side_effects) {
+      if (last_side_effecting_thunk >= 0) {
+        dependencies.insert(last_side_effecting_thunk);
+      }
+      last_side_effecting_thunk = id;
+    }
+
+    ThunkInfo& thunk = thunks.emplace_back();
+    thunk.call = instruction;
+    thunk.dependencies.assign(dependencies.begin(), dependencies.end());
+    absl::c_sort(thunk.dependencies);
+    thunk.has_side_effects = has_side_effects;
+    VLOG(3) << "Thunk " << id << " (" << instruction->name()
+            << "): " << thunk.dependencies.size() << " dependencies";
+  }
+  return thunks;
+}
+
+}  // namespace cpu
+}  // namespace xla
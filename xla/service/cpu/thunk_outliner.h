@@ -0,0 +1,81 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_SERVICE_CPU_THUNK_OUTLINER_H_
+#define XLA_SERVICE_CPU_THUNK_OUTLINER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_schedule.h"
+#include "xla/service/buffer_assignment.h"
+#include "xla/service/hlo_pass_interface.h"
+
+namespace xla {
+namespace cpu {
+
+// An HLO pass that outlines every top-level instruction of the entry
+// computation that generates code into a call to its own computation. After
+// this pass the entry computation only consists of parameters, constants,
+// get-tuple-elements, bitcasts and thunk calls, and each thunk computation is
+// emitted as a separately callable function that the thunk runtime can
+// dispatch on its own.
+//
+// If the module is scheduled, every call takes the place of the instruction it
+// outlines in the schedule of the entry computation, so that the pass can run
+// after scheduling and rematerialization.
+class ThunkOutliner : public HloModulePass {
+ public:
+  ~ThunkOutliner() override = default;
+  absl::string_view name() const override { return "cpu-thunk-outliner"; }
+
+  using HloPassInterface::Run;
+  absl::StatusOr<bool> Run(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+};
+
+// A thunk of the entry computation together with the thunks that have to
+// finish before it can start.
+struct ThunkInfo {
+  const HloInstruction* call;
+
+  // Indices (into the vector returned by AnalyzeThunks) of the thunks this
+  // thunk depends on. All of them are smaller than the index of this thunk.
+  std::vector<int64_t> dependencies;
+
+  // Thunks with side effects (collectives, custom calls, infeed/outfeed, ...)
+  // are ordered among each other as in `entry_sequence`.
+  bool has_side_effects;
+};
+
+// Returns the thunks, i.e. the calls, of `entry_sequence` in sequence order.
+// The entry computation must have been processed by ThunkOutliner. A thunk
+// depends on every earlier thunk that accesses an overlapping buffer slice when
+// at least one of the two writes it. This covers data dependencies as well as
+// the buffer reuse that `assignment` derived from the sequential order.
+absl::StatusOr<std::vector<ThunkInfo>> AnalyzeThunks(
+    const HloInstructionSequence& entry_sequence,
+    const BufferAssignment& assignment);
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // XLA_SERVICE_CPU_THUNK_OUTLINER_H_
@@ -15,6 +15,11 @@ limitations under the License.
 
 #include "xla/service/cpu/xfeed_manager.h"
 
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
 #include "xla/shape_util.h"
 #include "tsl/platform/logging.h"
 
@@ -30,40 +35,77 @@ void XfeedManager::Reset() {
 void XfeedQueueManager::Reset() {
   absl::MutexLock l(&mu_);
   CHECK(current_buffer_ == nullptr);
-  for (auto buffer : enqueued_buffers_) {
+  while (XfeedBuffer* buffer = TryPop()) {
+    buffer->Done(ShapeUtil::MakeNil());
+  }
+  for (auto buffer : overflow_) {
     buffer->Done(ShapeUtil::MakeNil());
   }
-  enqueued_buffers_.clear();
+  overflow_.clear();
+}
+
+XfeedBuffer* XfeedQueueManager::TryPop() {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  XfeedBuffer* buffer = ring_[head % kRingCapacity];
+  head_.store(head + 1, std::memory_order_release);
+  return buffer;
+}
+
+void XfeedQueueManager::DrainOverflow() {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  // A stale head only underestimates the free space.
+  uint64_t head = head_.load(std::memory_order_acquire);
+  while (!overflow_.empty() && tail - head < kRingCapacity) {
+    ring_[tail++ % kRingCapacity] = overflow_.front();
+    overflow_.pop_front();
+  }
+  tail_.store(tail, std::memory_order_release);
 }
 
 void XfeedQueueManager::EnqueueBuffersAtomically(
     absl::Span<XfeedBuffer* const> buffers) {
   absl::MutexLock l(&mu_);
-  bool was_empty = enqueued_buffers_.empty();
+  if (!overflow_.empty()) {
+    DrainOverflow();
+  }
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  uint64_t head = head_.load(std::memory_order_acquire);
   for (XfeedBuffer* b : buffers) {
     VLOG(3) << "Enqueueing " << queue_name_ << " buffer (of " << buffers.size()
             << " buffers) with length: " << b->length();
-    enqueued_buffers_.push_back(b);
+    if (overflow_.empty() && tail - head < kRingCapacity) {
+      ring_[tail++ % kRingCapacity] = b;
+    } else {
+      overflow_.push_back(b);
+    }
   }
-  if (was_empty && !buffers.empty()) {
-    // This has the potential to suffer from the notified thread
-    // immediately trying and failing to acquire mu_, but seems
-    // preferable to the alternative of notifying outside the lock
-    // on every enqueue.
+  // The buffers that fit into the ring are published with a single store, so
+  // the consumer picks them up without waking up in between.
+  tail_.store(tail, std::memory_order_release);
+  if (consumer_waiting_ && !buffers.empty()) {
     cv_.Signal();
   }
 }
 
 XfeedBuffer* XfeedQueueManager::BlockingDequeueBuffer() {
-  absl::MutexLock l(&mu_);
-  VLOG(3) << "Waiting for an available buffer.";
-  while (enqueued_buffers_.empty()) {
-    cv_.Wait(&mu_);
+  CHECK(current_buffer_ == nullptr);
+  XfeedBuffer* buffer = TryPop();
+  if (buffer == nullptr) {
+    absl::MutexLock l(&mu_);
+    VLOG(3) << "Waiting for an available buffer.";
+    DrainOverflow();
+    while ((buffer = TryPop()) == nullptr) {
+      consumer_waiting_ = true;
+      cv_.Wait(&mu_);
+      consumer_waiting_ = false;
+      DrainOverflow();
+    }
   }
   VLOG(3) << "A buffer is available!";
-  CHECK(current_buffer_ == nullptr);
-  current_buffer_ = enqueued_buffers_.front();
-  enqueued_buffers_.pop_front();
+  current_buffer_ = buffer;
   return current_buffer_;
 }
 
@@ -72,7 +114,6 @@ void XfeedQueueManager::ReleaseCurrentBuffer(int32_t length, void* data,
   VLOG(3) << "Releasing buffer with shape: "
           << (shape.ok() ? ShapeUtil::HumanString(shape.value())
                          : "<error status>");
-  absl::MutexLock l(&mu_);
   CHECK(current_buffer_ != nullptr);
   CHECK_EQ(length, current_buffer_->length());
   CHECK_EQ(data, current_buffer_->data());
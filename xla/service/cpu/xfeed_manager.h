@@ -20,8 +20,15 @@ limitations under the License.
 #ifndef XLA_SERVICE_CPU_XFEED_MANAGER_H_
 #define XLA_SERVICE_CPU_XFEED_MANAGER_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <deque>
+#include <string>
 
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "xla/shape.h"
 #include "xla/statusor.h"
@@ -48,6 +55,13 @@ class XfeedBuffer {
 };
 
 // Reusable component for managing the infeed and outfeed queue state.
+//
+// Buffers are passed from the client to the runtime through a bounded
+// single-producer/single-consumer ring. Producers are serialized by a mutex, so
+// any number of client threads may enqueue; the runtime, which processes one
+// buffer at a time, is the only consumer and dequeues without taking the lock
+// as long as the ring is not empty. Buffers enqueued while the ring is full
+// spill into an overflow queue that is moved into the ring as space frees up.
 class XfeedQueueManager {
  public:
   XfeedQueueManager(std::string queue_name) : queue_name_(queue_name) {}
@@ -69,7 +83,8 @@ class XfeedQueueManager {
   // the queue. Sets the current buffer to be the returned buffer. It is an
   // error to call BlockingDequeueBuffer if there is an unreleased current
   // buffer, i.e., ReleaseCurrentBuffer must be called between calls to
-  // BlockingDequeueBuffer.
+  // BlockingDequeueBuffer. Buffers enqueued by one EnqueueBuffersAtomically
+  // call become visible together, so the following calls do not block.
   XfeedBuffer* BlockingDequeueBuffer();
 
   // Releases the current buffer, which is the last buffer returned by
@@ -86,20 +101,42 @@ class XfeedQueueManager {
                             absl::StatusOr<Shape> shape);
 
  private:
+  static constexpr uint64_t kRingCapacity = 256;
+
+  // Returns the buffer at the head of the ring, or nullptr if the ring is
+  // empty. Only called by the consumer, or by Reset.
+  XfeedBuffer* TryPop();
+
+  // Moves buffers from the overflow queue into the ring as long as it has
+  // space, then publishes them.
+  void DrainOverflow() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   const std::string queue_name_;
 
+  // Serializes the producers, which makes the ring single-producer, and the
+  // consumer's slow path when the ring is empty.
   absl::Mutex mu_;
 
-  // Condition variable that is signaled every time a buffer is
-  // enqueued to an empty queue.
+  // Condition variable that is signaled when buffers are enqueued while the
+  // consumer is waiting.
   absl::CondVar cv_;
+  bool consumer_waiting_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Buffers that did not fit into the ring, in order. While it is non-empty,
+  // new buffers are appended here to preserve the queue order.
+  std::deque<XfeedBuffer*> overflow_ ABSL_GUARDED_BY(mu_);
 
   // XfeedBuffer* queue contents are not owned, but buffer->Done must
-  // be called when the buffer is no longer needed by the runtime.
-  std::deque<XfeedBuffer*> enqueued_buffers_;
+  // be called when the buffer is no longer needed by the runtime. Slots in
+  // [head_, tail_) hold enqueued buffers; the producer writes a slot before
+  // publishing it with a release store of tail_, and the consumer frees a slot
+  // with a release store of head_.
+  std::array<XfeedBuffer*, kRingCapacity> ring_;
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<uint64_t> head_{0};
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<uint64_t> tail_{0};
 
   // If non-NULL, the buffer that is currently being processed by the
-  // runtime. Not owned.
+  // runtime. Not owned. Only accessed by the consumer.
   XfeedBuffer* current_buffer_ = nullptr;
 };
 
@@ -15,14 +15,21 @@ limitations under the License.
 
 #include "xla/service/cpu/xfeed_manager.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/synchronization/notification.h"
 #include "xla/service/cpu/cpu_runtime.h"
+#include "xla/service/cpu/cpu_xfeed.h"
 #include "xla/shape_util.h"
 #include "tsl/lib/core/status_test_util.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/logging.h"
 #include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
 #include "tsl/platform/threadpool.h"
 
 namespace xla {
@@ -129,6 +136,72 @@ TEST_F(InfeedManagerTest, MultiThreaded) {
   ProcessNextBuffer(length);
 }
 
+TEST_F(InfeedManagerTest, MoreBuffersThanRingSlots) {
+  // Enough buffers to spill over the ring, with distinct lengths so that
+  // ProcessNextBuffer checks the dequeue order.
+  constexpr int32_t kNumBuffers = 1000;
+  cpu::runtime::XfeedManager* xfeed = cpu::runtime::GetXfeedManager(0);
+  std::vector<cpu::runtime::XfeedBuffer*> buffers;
+  for (int32_t i = 1; i <= kNumBuffers / 2; ++i) {
+    buffers.push_back(new TestInfeedBuffer(i));
+  }
+  xfeed->infeed()->EnqueueBuffersAtomically(buffers);
+  for (int32_t i = kNumBuffers / 2 + 1; i <= kNumBuffers; ++i) {
+    xfeed->infeed()->EnqueueBuffersAtomically({new TestInfeedBuffer(i)});
+  }
+  for (int32_t i = 1; i <= kNumBuffers; ++i) {
+    ProcessNextBuffer(i);
+  }
+}
+
+TEST_F(InfeedManagerTest, MultiThreadedStream) {
+  constexpr int32_t kNumBuffers = 10000;
+  tsl::thread::ThreadPool pool(tsl::Env::Default(), "test", 1);
+  cpu::runtime::XfeedManager* xfeed = cpu::runtime::GetXfeedManager(0);
+  pool.Schedule([xfeed]() {
+    for (int32_t i = 1; i <= kNumBuffers; ++i) {
+      xfeed->infeed()->EnqueueBuffersAtomically({new TestInfeedBuffer(i)});
+    }
+  });
+  for (int32_t i = 1; i <= kNumBuffers; ++i) {
+    ProcessNextBuffer(i);
+  }
+}
+
+TEST_F(InfeedManagerTest, ResetReleasesEnqueuedBuffers) {
+  constexpr int32_t kNumBuffers = 300;
+  cpu::runtime::XfeedQueueManager queue("test");
+  for (int32_t i = 0; i < kNumBuffers; ++i) {
+    auto* buffer = new TestInfeedBuffer(0, /*expect_shape_match=*/false);
+    queue.EnqueueBuffersAtomically({buffer});
+  }
+  queue.Reset();
+  TestInfeedBuffer* buffer = new TestInfeedBuffer(32);
+  queue.EnqueueBuffersAtomically({buffer});
+  EXPECT_EQ(queue.BlockingDequeueBuffer(), buffer);
+  queue.ReleaseCurrentBuffer(32, nullptr, buffer->shape());
+}
+
+TEST_F(InfeedManagerTest, HostBufferIsNotCopied) {
+  const std::string bytes = "infeed";
+  absl::Notification done;
+  TF_ASSERT_OK(TransferHostBufferToInfeedOnCpu(
+      /*device_ordinal=*/0, bytes.data(), bytes.size(),
+      [&done]() { done.Notify(); }));
+
+  auto shape = ShapeUtil::MakeShape(U8, {static_cast<int64_t>(bytes.size())});
+  std::string shape_bytes = shape.SerializeAsString();
+  void* buffer = __xla_cpu_runtime_AcquireInfeedBufferForDequeue(
+      /*run_options=*/nullptr, bytes.size(), shape_bytes.data(),
+      shape_bytes.size());
+  EXPECT_EQ(buffer, bytes.data());
+  EXPECT_FALSE(done.HasBeenNotified());
+  __xla_cpu_runtime_ReleaseInfeedBufferAfterDequeue(
+      /*run_options=*/nullptr, bytes.size(), buffer, shape_bytes.data(),
+      shape_bytes.size());
+  EXPECT_TRUE(done.HasBeenNotified());
+}
+
 TEST_F(InfeedManagerTest, OutfeedBasic) {
   TestInfeedBuffer* b = new TestInfeedBuffer(32, /*expect_shape_match=*/true);
   cpu::runtime::XfeedManager* xfeed = cpu::runtime::GetXfeedManager(0);
@@ -153,5 +226,91 @@ TEST_F(InfeedManagerTest, OutfeedWrongShape) {
   ProcessNextOutfeedBuffer(32, ShapeUtil::MakeShape(U8, {33}));
 }
 
+// An infeed buffer that can be enqueued many times; counts its releases.
+class CountingBuffer : public cpu::runtime::XfeedBuffer {
+ public:
+  int32_t length() override { return 64; }
+  void* data() override { return data_; }
+  void Done(absl::StatusOr<Shape> shape) override {
+    num_done_.fetch_add(1, std::memory_order_release);
+  }
+
+  int64_t num_done() const { return num_done_.load(std::memory_order_acquire); }
+
+ private:
+  char data_[64];
+  std::atomic<int64_t> num_done_{0};
+};
+
+// Streams infeed records from a client thread to the consumer, which runs the
+// acquire/release sequence of the runtime. The client enqueues
+// `state.range(0)` records per call and keeps at most four batches in flight.
+void BM_InfeedStream(::testing::benchmark::State& state) {
+  const int64_t batch_size = state.range(0);
+  const int64_t num_batches = state.max_iterations;
+
+  cpu::runtime::XfeedQueueManager queue("benchmark");
+  CountingBuffer buffer;
+  std::vector<cpu::runtime::XfeedBuffer*> batch(batch_size, &buffer);
+  const Shape shape = ShapeUtil::MakeShape(U8, {64});
+
+  tsl::thread::ThreadPool pool(tsl::Env::Default(), "client", 1);
+  pool.Schedule([&]() {
+    for (int64_t i = 0; i < num_batches; ++i) {
+      while ((i - 4) * batch_size > buffer.num_done()) {
+        tsl::Env::Default()->SleepForMicroseconds(0);
+      }
+      queue.EnqueueBuffersAtomically(batch);
+    }
+  });
+
+  for (auto s : state) {
+    for (int64_t i = 0; i < batch_size; ++i) {
+      cpu::runtime::XfeedBuffer* dequeued = queue.BlockingDequeueBuffer();
+      queue.ReleaseCurrentBuffer(dequeued->length(), dequeued->data(), shape);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+BENCHMARK(BM_InfeedStream)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->ArgName("batch")
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(64);
+
+// Round trips of outfeed records: the client enqueues a destination buffer and
+// waits until the runtime populated it.
+void BM_OutfeedRoundTrip(::testing::benchmark::State& state) {
+  cpu::runtime::XfeedQueueManager queue("benchmark");
+  CountingBuffer buffer;
+  const Shape shape = ShapeUtil::MakeShape(U8, {64});
+
+  std::atomic<bool> stop{false};
+  tsl::thread::ThreadPool pool(tsl::Env::Default(), "runtime", 1);
+  pool.Schedule([&]() {
+    while (!stop.load()) {
+      cpu::runtime::XfeedBuffer* dequeued = queue.BlockingDequeueBuffer();
+      queue.ReleaseCurrentBuffer(dequeued->length(), dequeued->data(), shape);
+    }
+  });
+
+  int64_t num_enqueued = 0;
+  for (auto s : state) {
+    queue.EnqueueBuffersAtomically({&buffer});
+    ++num_enqueued;
+    while (buffer.num_done() < num_enqueued) {
+    }
+  }
+  // Wakes up the runtime thread if it already waits for the next buffer.
+  stop.store(true);
+  queue.EnqueueBuffersAtomically({&buffer});
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_OutfeedRoundTrip)->MeasureProcessCPUTime()->UseRealTime();
+
 }  // namespace
 }  // namespace xla
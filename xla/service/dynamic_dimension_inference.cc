@@ -276,6 +276,13 @@ class DynamicDimensionInferenceVisitor : public DfsHloRewriteVisitor {
   // shapes.
   Status InsertPadToStaticOnInstruction(HloInstruction* inst);
 
+  // Updates the dataflow analysis after the uses of `old_instruction` by
+  // `users`, and the root if `was_root` is true, were replaced with
+  // `new_instruction`, so that `RequiresPadToStatic` sees the new uses.
+  Status UpdateDataflowAfterReplacingUses(
+      HloInstruction* old_instruction, HloInstruction* new_instruction,
+      absl::Span<HloInstruction* const> users, bool was_root);
+
   // Insert shape check to make sure `dim1` is equal to `dim2`. If
   // support_implicit_broadcast is true, the check will pass if either of them
   // is 1, even if they are different.
@@ -924,7 +931,11 @@ Status DynamicDimensionInferenceVisitor::HandleGetDimensionSize(
   }
 
   if (replacement != nullptr) {
+    const bool was_root = gds->IsRoot();
+    const std::vector<HloInstruction*> users = gds->users();
     TF_RETURN_IF_ERROR(gds->ReplaceAllUsesWith(replacement));
+    TF_RETURN_IF_ERROR(
+        UpdateDataflowAfterReplacingUses(gds, replacement, users, was_root));
     // The dependency between an instruction and its dynamic dimensions is not
     // modeled in the IR. As instr is being replaced by dynamic_size, also tell
     // dynamic dimension inference that the instruction is being replaced.
@@ -2481,7 +2492,7 @@ Status DynamicDimensionInferenceVisitor::InsertPadToStaticOnInstruction(
     return OkStatus();
   }
 
-  auto users = inst->users();
+  const std::vector<HloInstruction*> users = inst->users();
 
   ShapeTree<HloInstruction*> gtes =
       TupleUtil::DisassembleTupleInstruction(inst);
@@ -2565,15 +2576,41 @@ Status DynamicDimensionInferenceVisitor::InsertPadToStaticOnInstruction(
       TF_RETURN_IF_ERROR(user->ReplaceOperandWith(i, result));
     }
   }
-  if (inst->IsRoot()) {
+  const bool was_root = inst->IsRoot();
+  if (was_root) {
     inst->parent()->set_root_instruction(result);
   }
+  TF_RETURN_IF_ERROR(
+      UpdateDataflowAfterReplacingUses(inst, result, users, was_root));
 
   MarkAsChanged();
 
   return OkStatus();
 }
 
+Status DynamicDimensionInferenceVisitor::UpdateDataflowAfterReplacingUses(
+    HloInstruction* old_instruction, HloInstruction* new_instruction,
+    absl::Span<HloInstruction* const> users, bool was_root) {
+  // Computations created by the inference, like the bodies of while loops
+  // which carry dynamic sizes, and the instructions computing the sizes in
+  // them are not in the analysis.
+  if (!dataflow_analysis_.ContainsInstruction(old_instruction) ||
+      !dataflow_analysis_.CanUpdateWith(new_instruction)) {
+    return OkStatus();
+  }
+  for (HloInstruction* user : users) {
+    if (dataflow_analysis_.ContainsInstruction(user)) {
+      TF_RETURN_IF_ERROR(dataflow_analysis_.UpdateAfterChangingOperand(
+          user, old_instruction, new_instruction));
+    }
+  }
+  if (was_root) {
+    TF_RETURN_IF_ERROR(dataflow_analysis_.UpdateAfterChangingRoot(
+        old_instruction, new_instruction));
+  }
+  return OkStatus();
+}
+
 Status DynamicDimensionInferenceVisitor::InsertShapeCheck(
     HloInstruction* dim1, HloInstruction* dim2,
     bool support_implicit_broadcast) {
@@ -150,7 +150,7 @@ absl::Status AMDGPUCompiler::OptimizeHloConvolutionCanonicalization(
   // GpuConvRewriter, GpuConvPaddingLegalization and
   // CudnnConvPadForTensorCores may add instructions which can be simplified
   // by constant folding.
-  pipeline.AddPass<HloConstantFolding>();
+  pipeline.AddPass<HloConstantFolding>(constant_folding_cache_);
   TF_RETURN_IF_ERROR(pipeline.Run(hlo_module).status());
 
   return absl::OkStatus();
@@ -173,7 +173,7 @@ absl::Status AMDGPUCompiler::OptimizeHloPostLayoutAssignment(
   }
   // Padding a gemm operand that's a constant results in pad(constant).  Run
   // constant-folding to simplify this into a new constant.
-  pre_pipeline.AddPass<HloConstantFolding>();
+  pre_pipeline.AddPass<HloConstantFolding>(constant_folding_cache_);
   TF_RETURN_IF_ERROR(pre_pipeline.Run(hlo_module).status());
 
   TF_RETURN_IF_ERROR(GpuCompiler::OptimizeHloPostLayoutAssignment(
@@ -19,10 +19,12 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
 #include "xla/service/algebraic_simplifier.h"
 #include "xla/service/hlo_pass_interface.h"
 #include "xla/util.h"
+#include "tsl/platform/statusor.h"
 
 namespace xla::gpu {
 
@@ -47,17 +49,17 @@ class GpuAlgebraicSimplifier : public AlgebraicSimplifier {
                                execution_threads) override {
     XLA_VLOG_LINES(
         2, "GpuAlgebraicSimplifier::Run(), before:\n" + module->ToString());
-    bool changed = false;
-    GpuAlgebraicSimplifierVisitor visitor(options_, this);
-    for (auto* comp : module->MakeNonfusionComputations(execution_threads)) {
-      if (visitor.Run(comp, options_, this)) {
-        changed = true;
-      }
-    }
+    TF_ASSIGN_OR_RETURN(bool changed,
+                        AlgebraicSimplifier::Run(module, execution_threads));
     XLA_VLOG_LINES(
         2, "GpuAlgebraicSimplifier::Run(), after:\n" + module->ToString());
     return changed;
   }
+
+  absl::StatusOr<bool> RunOnComputation(HloComputation* computation) override {
+    GpuAlgebraicSimplifierVisitor visitor(options_, this);
+    return visitor.Run(computation, options_, this);
+  }
 };
 
 }  // namespace xla::gpu
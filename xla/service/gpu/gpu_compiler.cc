@@ -620,14 +620,18 @@ absl::Status RunPreSPMDPartitionerPasses(HloModule* hlo_module) {
   // The SPMD partitioner would mess up the sort+slice structure, so we need to
   // rewrite Topk before that happens.
   pre_spmd_pipeline.AddPass<TopkRewriter>(
-      [](const HloSortInstruction*, int64_t) { return true; });
+      [](const HloSortInstruction* sort, int64_t) {
+        PrimitiveType element_type = sort->operand(0)->shape().element_type();
+        return element_type == F32 || element_type == BF16;
+      });
 
   return pre_spmd_pipeline.Run(hlo_module).status();
 }
 
 absl::Status RunSPMDPasses(
     HloModule* hlo_module, const Compiler::TargetConfig& gpu_target_config,
-    const AlgebraicSimplifierOptions& layout_insensitive_algsimp_opts) {
+    const AlgebraicSimplifierOptions& layout_insensitive_algsimp_opts,
+    std::shared_ptr<ConstantFoldingCache> constant_folding_cache) {
   const int64_t num_partitions = hlo_module->config().num_partitions();
   bool auto_sharding = hlo_module->config().use_auto_spmd_partitioning();
 
@@ -661,7 +665,7 @@ absl::Status RunSPMDPasses(
     ReshapeMoverOptions reshape_mover_options;
     reshape_mover_options.reshape_of_1d_broadcast_is_cheap = true;
     spmd_simplify.AddPass<ReshapeMover>(reshape_mover_options);
-    spmd_simplify.AddPass<HloConstantFolding>();
+    spmd_simplify.AddPass<HloConstantFolding>(constant_folding_cache);
     spmd_simplify.AddPass<ConditionalSimplifier>();
 
     spmd_pipeline.AddPass<HloConstantSplitter>();
@@ -720,8 +724,13 @@ absl::Status RunSPMDPasses(
 
 absl::Status RunOptimizationPasses(
     HloModule* hlo_module, const Compiler::TargetConfig& gpu_target_config,
-    const AlgebraicSimplifierOptions& layout_insensitive_algsimp_opts) {
+    const AlgebraicSimplifierOptions& layout_insensitive_algsimp_opts,
+    std::shared_ptr<ConstantFoldingCache> constant_folding_cache,
+    tsl::thread::ThreadPool* thread_pool) {
   HloPassPipeline pipeline("optimization");
+  // Computation-local passes run on the computations of the module in
+  // parallel.
+  pipeline.set_thread_pool(thread_pool);
   AddHloVerifier(&pipeline);
   if (hlo_module->config()
           .debug_options()
@@ -866,7 +875,7 @@ absl::Status RunOptimizationPasses(
     ReshapeMoverOptions reshape_mover_options;
     reshape_mover_options.reshape_of_1d_broadcast_is_cheap = true;
     pipeline.AddPass<ReshapeMover>(reshape_mover_options);
-    pipeline.AddPass<HloConstantFolding>();
+    pipeline.AddPass<HloConstantFolding>(constant_folding_cache);
     pipeline.AddPass<ConditionalSimplifier>();
     pipeline.AddPass<RealImagExpander>();
     pipeline.AddPass<TransposeFolding>(CanFoldTransposeOperandIntoDot);
@@ -1218,9 +1227,11 @@ absl::Status GpuCompiler::OptimizeHloModule(
 
   TF_RETURN_IF_ERROR(RunPreSPMDPartitionerPasses(hlo_module));
   TF_RETURN_IF_ERROR(RunSPMDPasses(hlo_module, gpu_target_config,
-                                   layout_insensitive_algsimp_opts));
-  TF_RETURN_IF_ERROR(RunOptimizationPasses(hlo_module, gpu_target_config,
-                                           layout_insensitive_algsimp_opts));
+                                   layout_insensitive_algsimp_opts,
+                                   constant_folding_cache_));
+  TF_RETURN_IF_ERROR(RunOptimizationPasses(
+      hlo_module, gpu_target_config, layout_insensitive_algsimp_opts,
+      constant_folding_cache_, thread_pool.get()));
   TF_RETURN_IF_ERROR(RunCollectiveOptimizationPasses(
       hlo_module, layout_insensitive_algsimp_opts));
 
@@ -36,6 +36,7 @@ limitations under the License.
 #include "xla/service/gpu/compile_module_to_llvm_ir.h"
 #include "xla/service/gpu/executable.pb.h"
 #include "xla/service/hlo.pb.h"
+#include "xla/service/hlo_constant_folding.h"
 #include "xla/service/hlo_cost_analysis.h"
 #include "xla/service/hlo_dataflow_analysis.h"
 #include "xla/service/hlo_module_config.h"
@@ -173,6 +174,11 @@ class GpuCompiler : public LLVMCompiler {
   AlgebraicSimplifierOptions GetAlgebraicSimplifierOptions(
       const HloModuleConfig& config);
 
+  // Memoizes constant folding across the pipelines and compilations of this
+  // compiler.
+  std::shared_ptr<ConstantFoldingCache> constant_folding_cache_ =
+      std::make_shared<ConstantFoldingCache>();
+
  private:
   struct CompileResultWithMetadata {
     BackendCompileResult backend_result;
@@ -49,6 +49,8 @@ limitations under the License.
 #include "xla/service/time_utils.h"
 #include "xla/status.h"
 #include "xla/util.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 
@@ -576,6 +578,9 @@ GlobalDecreasingSizeBestFitHeap<BufferType>::GlobalDecreasingSizeBestFitHeap(
   if (type == kTemporal) {
     buffer_interval_compare_ = GetTemporalBufferIntervalCompare();
     CHECK(buffer_interval_compare == nullptr);
+  } else if (type == kSpatioTemporal) {
+    buffer_interval_compare_ = GetSpatioTemporalBufferIntervalCompare();
+    CHECK(buffer_interval_compare == nullptr);
   } else if (type == kSpatial) {
     buffer_interval_compare_ = GetSpatialBufferIntervalCompare();
     CHECK(buffer_interval_compare == nullptr);
@@ -591,15 +596,34 @@ typename GlobalDecreasingSizeBestFitHeap<BufferType>::BufferIntervalCompare
 GlobalDecreasingSizeBestFitHeap<BufferType>::GetTemporalBufferIntervalCompare()
     const {
   return LessThanByKey([this](const BufferInterval& x) {
-    int64_t x_end = x.end;
-    for (auto colocation : GetTransitiveColocations(x)) {
-      x_end = std::max(x_end, buffer_intervals_.at(colocation).end);
-    }
+    int64_t x_end = GetLiveRangeEnd(x);
     // Sort by duration (descending), size (descending), buffer (ascending).
     return std::make_tuple(x.start - x_end, -x.size, std::cref(*x.buffer));
   });
 }
 
+template <typename BufferType>
+typename GlobalDecreasingSizeBestFitHeap<BufferType>::BufferIntervalCompare
+GlobalDecreasingSizeBestFitHeap<
+    BufferType>::GetSpatioTemporalBufferIntervalCompare() const {
+  return LessThanByKey([this](const BufferInterval& x) {
+    int64_t x_end = GetLiveRangeEnd(x);
+    // Sort by area (descending), size (descending), buffer (ascending).
+    return std::make_tuple(-x.size * (x_end - x.start + 1), -x.size,
+                           std::cref(*x.buffer));
+  });
+}
+
+template <typename BufferType>
+int64_t GlobalDecreasingSizeBestFitHeap<BufferType>::GetLiveRangeEnd(
+    const BufferInterval& interval) const {
+  int64_t end = interval.end;
+  for (auto colocation : GetTransitiveColocations(interval)) {
+    end = std::max(end, buffer_intervals_.at(colocation).end);
+  }
+  return end;
+}
+
 template <typename BufferType>
 SliceTimePermutationIterator::Ty GlobalDecreasingSizeBestFitHeap<
     BufferType>::slice_time_permutation_iterator_type() const {
@@ -2399,19 +2423,42 @@ template <typename BufferType>
 StatusOr<HeapSimulator::Result<BufferType>>
 ChooseBestHeapAlgorithm<BufferType>::Finish() {
   DCHECK(!algorithms_.empty());
-  std::vector<Result> results(algorithms_.size());
-  int64_t min_size = INT64_MAX;
+  std::vector<StatusOr<Result>> results(algorithms_.size());
+  // Waiting for the pool from one of its threads could deadlock, so finish
+  // the algorithms sequentially then.
+  if (thread_pool_ != nullptr && thread_pool_->CurrentThreadId() == -1 &&
+      algorithms_.size() > 1) {
+    // Finish the first algorithm on this thread while the others run on the
+    // pool.
+    tsl::BlockingCounter counter(algorithms_.size() - 1);
+    for (int i = 1; i < algorithms_.size(); ++i) {
+      thread_pool_->Schedule([&, i] {
+        results[i] = algorithms_[i]->Finish();
+        counter.DecrementCount();
+      });
+    }
+    results[0] = algorithms_[0]->Finish();
+    counter.Wait();
+  } else {
+    for (int i = 0; i < algorithms_.size(); ++i) {
+      results[i] = algorithms_[i]->Finish();
+    }
+  }
+
   int min_size_index = -1;
   for (int i = 0; i < algorithms_.size(); ++i) {
-    TF_ASSIGN_OR_RETURN(results[i], algorithms_[i]->Finish());
-    if (results[i].heap_size < min_size) {
-      min_size = results[i].heap_size;
+    TF_RETURN_IF_ERROR(results[i].status());
+    if (min_size_index < 0 ||
+        results[i]->heap_size < results[min_size_index]->heap_size) {
       min_size_index = i;
     }
   }
 
   DCHECK_GE(min_size_index, 0);
-  return results[min_size_index];
+  VLOG(1) << "Chose heap algorithm " << min_size_index << " of "
+          << algorithms_.size() << " with heap size "
+          << results[min_size_index]->heap_size;
+  return *std::move(results[min_size_index]);
 }
 
 template class GlobalDecreasingSizeBestFitHeap<HloValue>;
@@ -53,6 +53,7 @@ limitations under the License.
 #include "xla/service/memory_space_assignment/repacking.h"
 #include "xla/service/tuple_points_to_analysis.h"
 #include "xla/statusor.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 
@@ -483,6 +484,9 @@ class GlobalDecreasingSizeBestFitHeap : public HeapAlgorithm<BufferType> {
   enum Type {
     kSpatial = 0,
     kTemporal,
+    // Sorts by the area of the buffer in the heap over time, i.e. its size
+    // times its live range.
+    kSpatioTemporal,
     // Custom uses a custom BufferIntervalCompare function provided in the
     // constructor.
     kCustom
@@ -898,6 +902,14 @@ class GlobalDecreasingSizeBestFitHeap : public HeapAlgorithm<BufferType> {
   // contiguous.
   BufferIntervalCompare GetTemporalBufferIntervalCompare() const;
 
+  // Return a BufferIntervalCompare function that sorts by size times live
+  // range, with live ranges as in GetTemporalBufferIntervalCompare.
+  BufferIntervalCompare GetSpatioTemporalBufferIntervalCompare() const;
+
+  // Returns the end of the live range of the buffer, which is the end of the
+  // last co-located buffer.
+  int64_t GetLiveRangeEnd(const BufferInterval& interval) const;
+
   SliceTimePermutationIterator::Ty slice_time_permutation_iterator_type() const;
 
   absl::flat_hash_map<const BufferType*, BufferInterval> buffer_intervals_;
@@ -961,7 +973,12 @@ class ConstrainedGlobalDecreasingSizeBestFitHeap
 };
 
 // A heap algorithm that chooses the best results from other algorithms added to
-// it.
+// it. The best result is the smallest heap, and the one of the earliest
+// algorithm among equally small ones.
+//
+// If `thread_pool` is not null, the algorithms finish concurrently on it,
+// unless Finish is called from a thread of the pool. The algorithms must not
+// share state then.
 template <typename BufferType>
 class ChooseBestHeapAlgorithm : public HeapAlgorithm<BufferType> {
  public:
@@ -969,8 +986,9 @@ class ChooseBestHeapAlgorithm : public HeapAlgorithm<BufferType> {
 
   ChooseBestHeapAlgorithm(
       std::unique_ptr<std::vector<std::unique_ptr<HeapAlgorithm<BufferType>>>>
-          algorithms)
-      : algorithms_(std::move(*algorithms)) {}
+          algorithms,
+      tsl::thread::ThreadPool* thread_pool = nullptr)
+      : algorithms_(std::move(*algorithms)), thread_pool_(thread_pool) {}
   ~ChooseBestHeapAlgorithm() override {}
 
   void Alloc(const BufferType* buffer, int64_t size) override {
@@ -996,6 +1014,7 @@ class ChooseBestHeapAlgorithm : public HeapAlgorithm<BufferType> {
 
  private:
   std::vector<std::unique_ptr<HeapAlgorithm<BufferType>>> algorithms_;
+  tsl::thread::ThreadPool* thread_pool_;
 };
 
 extern template class GlobalDecreasingSizeBestFitHeap<HloValue>;
@@ -26,6 +26,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
 #include "absl/types/span.h"
 #include "xla/hlo/ir/hlo_computation.h"
@@ -41,8 +42,11 @@ limitations under the License.
 #include "xla/status_macros.h"
 #include "xla/tests/hlo_test_base.h"
 #include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/blocking_counter.h"
 #include "tsl/platform/logging.h"
+#include "tsl/platform/env.h"
 #include "tsl/platform/test.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 namespace {
@@ -1382,6 +1386,45 @@ TEST_F(GlobalDecreasingSizeBestFitHeapTest, ColocatedDifferentSize2) {
   EXPECT_EQ(0, result.chunk_map.at(buffer_c_).offset);
 }
 
+TEST_F(GlobalDecreasingSizeBestFitHeapTest, SpatioTemporal) {
+  // space
+  //   ^
+  //   |   +---+
+  //   |   | b |
+  //   |   +---+
+  //   |+---------------+
+  //   |+-------a-------+
+  //   ---------------------> time
+  //
+  // a is smaller than b, but lives much longer, so it is placed first.
+  for (const auto type : {GlobalDecreasingSizeBestFitHeap<HloValue>::kSpatial,
+                          GlobalDecreasingSizeBestFitHeap<
+                              HloValue>::kSpatioTemporal}) {
+    GlobalDecreasingSizeBestFitHeap<HloValue> heap(/*alignment=*/1, type);
+    heap.Alloc(buffer_a_, 10);
+    heap.Alloc(buffer_b_, 20);
+    heap.Free(buffer_b_, 20);
+    heap.Alloc(buffer_c_, 1);
+    heap.Free(buffer_c_, 1);
+    heap.Alloc(buffer_d_, 1);
+    heap.Free(buffer_d_, 1);
+    heap.Free(buffer_a_, 10);
+
+    TF_ASSERT_OK_AND_ASSIGN(const HeapSimulator::Result<HloValue> results,
+                            heap.Finish());
+    const HeapSimulator::HeapResult<HloValue>& result =
+        results.heap_results.at(0);
+    EXPECT_EQ(30, result.heap_size);
+    if (type == GlobalDecreasingSizeBestFitHeap<HloValue>::kSpatial) {
+      EXPECT_EQ(20, result.chunk_map.at(buffer_a_).offset);
+      EXPECT_EQ(0, result.chunk_map.at(buffer_b_).offset);
+    } else {
+      EXPECT_EQ(0, result.chunk_map.at(buffer_a_).offset);
+      EXPECT_EQ(10, result.chunk_map.at(buffer_b_).offset);
+    }
+  }
+}
+
 class FindGlobalDecreasingSizeBestFitTest : public HeapAlgorithmTestBase {
  protected:
   class InheritedGlobalDecreasingSizeBestFitHeap
@@ -1828,6 +1871,87 @@ TEST_F(ConstrainedGlobalDecreasingSizeBestFitHeapTest, ColocatedII) {
   EXPECT_EQ(0, result.heap_results[0].chunk_map.at(buffer_c_).offset);
 }
 
+// A heap algorithm which returns a heap of a fixed size, tagged with the index
+// of the algorithm.
+class FixedSizeHeap : public HeapAlgorithm<HloValue> {
+ public:
+  FixedSizeHeap(int64_t heap_size, int64_t index)
+      : heap_size_(heap_size), index_(index) {}
+
+  void Alloc(const HloValue* buffer, int64_t size) override {}
+  void Free(const HloValue* buffer, int64_t size) override {}
+
+  absl::StatusOr<Result> Finish() override {
+    Result result;
+    result.heap_size = heap_size_;
+    result.heap_results.emplace_back().heap_size = index_;
+    return result;
+  }
+
+ private:
+  int64_t heap_size_;
+  int64_t index_;
+};
+
+class ChooseBestHeapAlgorithmTest : public HeapAlgorithmTestBase,
+                                    public ::testing::WithParamInterface<bool> {
+};
+
+TEST_P(ChooseBestHeapAlgorithmTest, ChoosesFirstSmallestHeap) {
+  std::optional<tsl::thread::ThreadPool> thread_pool;
+  if (GetParam()) {
+    thread_pool.emplace(tsl::Env::Default(), "heap_simulator_test",
+                        /*num_threads=*/4);
+  }
+  auto algorithms =
+      std::make_unique<std::vector<std::unique_ptr<HeapAlgorithm<HloValue>>>>();
+  const std::vector<int64_t> heap_sizes = {30, 20, 40, 20, 25};
+  for (int64_t i = 0; i < heap_sizes.size(); ++i) {
+    algorithms->push_back(std::make_unique<FixedSizeHeap>(heap_sizes[i], i));
+  }
+  ChooseBestHeapAlgorithm<HloValue> heap(
+      std::move(algorithms), thread_pool ? &*thread_pool : nullptr);
+  heap.Alloc(buffer_a_, 10);
+  heap.Free(buffer_a_, 10);
+
+  TF_ASSERT_OK_AND_ASSIGN(const HeapSimulator::Result<HloValue> result,
+                          heap.Finish());
+  EXPECT_EQ(20, result.heap_size);
+  ASSERT_EQ(1, result.heap_results.size());
+  EXPECT_EQ(1, result.heap_results[0].heap_size);
+}
+
+TEST_F(HeapAlgorithmTestBase, ChooseBestHeapAlgorithmFinishesOnThreadPool) {
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(),
+                                      "heap_simulator_test", /*num_threads=*/1);
+  auto algorithms =
+      std::make_unique<std::vector<std::unique_ptr<HeapAlgorithm<HloValue>>>>();
+  const std::vector<int64_t> heap_sizes = {30, 20, 40};
+  for (int64_t i = 0; i < heap_sizes.size(); ++i) {
+    algorithms->push_back(std::make_unique<FixedSizeHeap>(heap_sizes[i], i));
+  }
+  ChooseBestHeapAlgorithm<HloValue> heap(std::move(algorithms), &thread_pool);
+  heap.Alloc(buffer_a_, 10);
+  heap.Free(buffer_a_, 10);
+
+  // With a single thread, waiting for the pool from it would never return.
+  std::optional<absl::StatusOr<HeapSimulator::Result<HloValue>>> result;
+  tsl::BlockingCounter counter(1);
+  thread_pool.Schedule([&] {
+    result = heap.Finish();
+    counter.DecrementCount();
+  });
+  counter.Wait();
+
+  ASSERT_TRUE(result.has_value());
+  TF_ASSERT_OK(result->status());
+  EXPECT_EQ(20, (*result)->heap_size);
+}
+
+INSTANTIATE_TEST_SUITE_P(ChooseBestHeapAlgorithmTestInstantiation,
+                         ChooseBestHeapAlgorithmTest,
+                         ::testing::Values(false, true));
+
 class IntervalTreeTest : public ::testing::Test {};
 
 TEST_F(IntervalTreeTest, InsertAndRemove) {
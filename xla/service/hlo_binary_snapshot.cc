@@ -0,0 +1,326 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/hlo_binary_snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_casting_utils.h"
+#include "xla/hlo/ir/hlo_computation.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_instructions.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_opcode.h"
+#include "xla/layout_util.h"
+#include "xla/literal.h"
+#include "xla/service/hlo.pb.h"
+#include "xla/shape.h"
+#include "xla/shape_util.h"
+#include "xla/status_macros.h"
+#include "xla/util.h"
+#include "tsl/platform/coding.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/raw_coding.h"
+#include "tsl/platform/statusor.h"
+
+namespace xla {
+namespace {
+
+using LiteralSections = HloBinarySnapshotMetadataProto::LiteralSections;
+
+constexpr absl::string_view kMagic = "XLAHSNAP";
+constexpr int64_t kTrailerSize = 2 * sizeof(uint64_t) + kMagic.size();
+
+// A snapshot read into memory instead of mapped from a file.
+class StringMemoryRegion : public tsl::ReadOnlyMemoryRegion {
+ public:
+  explicit StringMemoryRegion(std::string data) : data_(std::move(data)) {}
+
+  const void* data() override { return data_.data(); }
+  uint64_t length() override { return data_.size(); }
+
+ private:
+  std::string data_;
+};
+
+// Appends the snapshot of `module` and `arguments` to a file or a string via
+// `append`.
+absl::Status WriteSnapshot(
+    const HloModule& module, absl::Span<const Literal* const> arguments,
+    absl::FunctionRef<absl::Status(absl::string_view)> append) {
+  int64_t offset = 0;
+  auto write = [&](absl::string_view data) {
+    offset += data.size();
+    return append(data);
+  };
+
+  // Appends the arrays of `literal` to the snapshot and describes them in
+  // `sections`.
+  auto write_literal = [&](const Literal& literal,
+                           LiteralSections* sections) -> absl::Status {
+    *sections->mutable_shape() = literal.shape().ToProto();
+    return ShapeUtil::ForEachSubshapeWithStatus(
+        literal.shape(),
+        [&](const Shape& subshape, const ShapeIndex& index) -> absl::Status {
+          if (!subshape.IsArray()) {
+            return absl::OkStatus();
+          }
+          if (!subshape.is_static() || !LayoutUtil::IsDenseArray(subshape)) {
+            return Unimplemented(
+                "Binary HLO snapshots only support static dense arrays, got "
+                "%s",
+                ShapeUtil::HumanStringWithLayout(subshape));
+          }
+          const int64_t padding =
+              RoundUpTo(offset, kHloBinarySnapshotAlignment) - offset;
+          TF_RETURN_IF_ERROR(write(std::string(padding, '\0')));
+          auto* section = sections->add_sections();
+          section->set_offset(offset);
+          section->set_size(literal.size_bytes(index));
+          return write(absl::string_view(
+              static_cast<const char*>(literal.untyped_data(index)),
+              section->size()));
+        });
+  };
+
+  absl::flat_hash_map<absl::string_view, const HloConstantInstruction*>
+      constants;
+  for (const HloComputation* computation : module.computations()) {
+    for (const HloInstruction* instruction : computation->instructions()) {
+      if (instruction->opcode() == HloOpcode::kConstant) {
+        TF_RET_CHECK(
+            constants
+                .emplace(instruction->name(),
+                         Cast<HloConstantInstruction>(instruction))
+                .second)
+            << "Instruction name is not unique: " << instruction->name();
+      }
+    }
+  }
+
+  TF_RETURN_IF_ERROR(write(kMagic));
+  HloBinarySnapshotMetadataProto metadata;
+  *metadata.mutable_hlo_module() = module.ToProto();
+  for (HloComputationProto& computation :
+       *metadata.mutable_hlo_module()->mutable_computations()) {
+    for (HloInstructionProto& instruction :
+         *computation.mutable_instructions()) {
+      if (instruction.opcode() != HloOpcodeString(HloOpcode::kConstant) ||
+          !instruction.has_literal()) {
+        continue;
+      }
+      auto it = constants.find(instruction.name());
+      TF_RET_CHECK(it != constants.end()) << instruction.name();
+      TF_RETURN_IF_ERROR(
+          write_literal(it->second->literal(),
+                        &(*metadata.mutable_constants())[instruction.name()]));
+      instruction.clear_literal();
+    }
+  }
+  for (const Literal* argument : arguments) {
+    TF_RETURN_IF_ERROR(write_literal(*argument, metadata.add_arguments()));
+  }
+
+  const int64_t metadata_offset = offset;
+  std::string serialized_metadata;
+  if (!metadata.SerializeToString(&serialized_metadata)) {
+    return Internal("Failed to serialize the binary HLO snapshot metadata");
+  }
+  TF_RETURN_IF_ERROR(write(serialized_metadata));
+
+  std::string trailer(kTrailerSize, '\0');
+  tsl::core::EncodeFixed64(trailer.data(), metadata_offset);
+  tsl::core::EncodeFixed64(trailer.data() + sizeof(uint64_t),
+                           serialized_metadata.size());
+  std::memcpy(trailer.data() + 2 * sizeof(uint64_t), kMagic.data(),
+              kMagic.size());
+  return write(trailer);
+}
+
+// Checks that `sections` describes the arrays of a literal within a snapshot
+// of `snapshot_size` bytes, and returns the shape of the literal.
+absl::StatusOr<Shape> CheckLiteralSections(const LiteralSections& sections,
+                                           uint64_t snapshot_size) {
+  Shape shape(sections.shape());
+  TF_RETURN_IF_ERROR(ShapeUtil::ValidateShapeWithOptionalLayout(shape));
+  int64_t next_section = 0;
+  TF_RETURN_IF_ERROR(ShapeUtil::ForEachSubshapeWithStatus(
+      shape,
+      [&](const Shape& subshape, const ShapeIndex& index) -> absl::Status {
+        if (!subshape.IsArray()) {
+          return absl::OkStatus();
+        }
+        TF_RET_CHECK(subshape.is_static() &&
+                     LayoutUtil::IsDenseArray(subshape));
+        TF_RET_CHECK(next_section < sections.sections_size());
+        const auto& section = sections.sections(next_section++);
+        TF_RET_CHECK(section.size() == ShapeUtil::ByteSizeOf(subshape));
+        TF_RET_CHECK(section.offset() >= 0 &&
+                     static_cast<uint64_t>(section.offset()) <= snapshot_size &&
+                     static_cast<uint64_t>(section.size()) <=
+                         snapshot_size - section.offset())
+            << "Section [" << section.offset() << ", "
+            << section.offset() + section.size()
+            << ") is out of the bounds of the snapshot";
+        return absl::OkStatus();
+      }));
+  TF_RET_CHECK(next_section == sections.sections_size());
+  return shape;
+}
+
+// Copies the arrays described by `sections`, which CheckLiteralSections
+// accepted, from `snapshot` into a literal of `shape`.
+Literal ReadLiteral(const char* snapshot, const Shape& shape,
+                    const LiteralSections& sections) {
+  Literal literal(shape);
+  int64_t next_section = 0;
+  ShapeUtil::ForEachSubshape(
+      shape, [&](const Shape& subshape, const ShapeIndex& index) {
+        if (subshape.IsArray()) {
+          const auto& section = sections.sections(next_section++);
+          std::memcpy(literal.untyped_data(index), snapshot + section.offset(),
+                      section.size());
+        }
+      });
+  return literal;
+}
+
+}  // namespace
+
+bool IsHloBinarySnapshot(absl::string_view data) {
+  return data.substr(0, kMagic.size()) == kMagic;
+}
+
+absl::StatusOr<std::string> SerializeHloBinarySnapshot(
+    const HloModule& module, absl::Span<const Literal* const> arguments) {
+  std::string snapshot;
+  TF_RETURN_IF_ERROR(
+      WriteSnapshot(module, arguments, [&](absl::string_view data) {
+        snapshot.append(data.data(), data.size());
+        return absl::OkStatus();
+      }));
+  return snapshot;
+}
+
+absl::Status WriteHloBinarySnapshot(const HloModule& module,
+                                    absl::Span<const Literal* const> arguments,
+                                    const std::string& path, tsl::Env* env) {
+  std::unique_ptr<tsl::WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(path, &file));
+  TF_RETURN_IF_ERROR(WriteSnapshot(
+      module, arguments,
+      [&](absl::string_view data) { return file->Append(data); }));
+  return file->Close();
+}
+
+/*static*/ absl::StatusOr<HloBinarySnapshotReader>
+HloBinarySnapshotReader::OpenFile(const std::string& path, tsl::Env* env) {
+  std::unique_ptr<tsl::ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(env->NewReadOnlyMemoryRegionFromFile(path, &region));
+  return Create(std::move(region));
+}
+
+/*static*/ absl::StatusOr<HloBinarySnapshotReader>
+HloBinarySnapshotReader::FromData(std::string data) {
+  return Create(std::make_shared<StringMemoryRegion>(std::move(data)));
+}
+
+/*static*/ absl::StatusOr<HloBinarySnapshotReader>
+HloBinarySnapshotReader::Create(
+    std::shared_ptr<tsl::ReadOnlyMemoryRegion> region) {
+  const char* data = static_cast<const char*>(region->data());
+  const uint64_t size = region->length();
+  if (size < kMagic.size() + kTrailerSize ||
+      !IsHloBinarySnapshot(absl::string_view(data, size)) ||
+      absl::string_view(data + size - kMagic.size(), kMagic.size()) !=
+          kMagic) {
+    return InvalidArgument("Not a binary HLO snapshot");
+  }
+  const char* trailer = data + size - kTrailerSize;
+  const uint64_t metadata_offset = tsl::core::DecodeFixed64(trailer);
+  const uint64_t metadata_size =
+      tsl::core::DecodeFixed64(trailer + sizeof(uint64_t));
+  if (metadata_offset > size - kTrailerSize ||
+      metadata_size > size - kTrailerSize - metadata_offset ||
+      metadata_size > std::numeric_limits<int>::max()) {
+    return InvalidArgument("Corrupted binary HLO snapshot trailer");
+  }
+  HloBinarySnapshotMetadataProto metadata;
+  if (!metadata.ParseFromArray(data + metadata_offset,
+                               static_cast<int>(metadata_size))) {
+    return InvalidArgument("Failed to parse the binary HLO snapshot metadata");
+  }
+  return HloBinarySnapshotReader(std::move(region), std::move(metadata));
+}
+
+absl::StatusOr<std::unique_ptr<HloModule>>
+HloBinarySnapshotReader::CreateModule(const HloModuleConfig& config) const {
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<HloModule> module,
+      HloModule::CreateFromProto(metadata_.hlo_module(), config));
+  int64_t num_constants = 0;
+  for (HloComputation* computation : module->computations()) {
+    for (HloInstruction* instruction : computation->instructions()) {
+      auto it = metadata_.constants().find(std::string(instruction->name()));
+      if (instruction->opcode() != HloOpcode::kConstant ||
+          it == metadata_.constants().end()) {
+        continue;
+      }
+      auto* constant = Cast<HloConstantInstruction>(instruction);
+      TF_RET_CHECK(!constant->HasLiteral()) << constant->name();
+      TF_ASSIGN_OR_RETURN(Shape shape,
+                          CheckLiteralSections(it->second, region_->length()));
+      constant->set_lazy_literal(std::make_shared<LazyLiteral>(
+          [region = region_, shape = std::move(shape),
+           sections = it->second]() {
+            return ReadLiteral(static_cast<const char*>(region->data()), shape,
+                               sections);
+          }));
+      ++num_constants;
+    }
+  }
+  TF_RET_CHECK(num_constants == metadata_.constants_size())
+      << "The snapshot holds literals of constants that are not in the module";
+  return module;
+}
+
+absl::StatusOr<std::vector<Literal>> HloBinarySnapshotReader::LoadArguments()
+    const {
+  std::vector<Literal> arguments;
+  arguments.reserve(metadata_.arguments_size());
+  for (const LiteralSections& sections : metadata_.arguments()) {
+    TF_ASSIGN_OR_RETURN(Shape shape,
+                        CheckLiteralSections(sections, region_->length()));
+    arguments.push_back(ReadLiteral(static_cast<const char*>(region_->data()),
+                                    shape, sections));
+  }
+  return arguments;
+}
+
+}  // namespace xla
@@ -0,0 +1,104 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_SERVICE_HLO_BINARY_SNAPSHOT_H_
+#define XLA_SERVICE_HLO_BINARY_SNAPSHOT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/literal.h"
+#include "xla/service/hlo.pb.h"
+#include "xla/service/hlo_module_config.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/file_system.h"
+
+namespace xla {
+
+// A binary HLO snapshot holds an HloModule and the arguments to run it with.
+// Unlike an HloSnapshot proto, it stores the literals of the constants and the
+// arguments as raw bytes outside of any proto, so it is not bound by the 2GB
+// protobuf limit, and it can be memory-mapped: the constants of a module loaded
+// from a snapshot reference the mapped bytes and are only copied into literals
+// when they are first accessed. The layout of a snapshot is
+//
+//   "XLAHSNAP"
+//   the arrays of the literals, each aligned to kHloBinarySnapshotAlignment
+//   HloBinarySnapshotMetadataProto
+//   the offset and the size of the metadata, as little endian uint64s
+//   "XLAHSNAP"
+//
+// The arrays are stored in the byte order of the host that wrote the snapshot.
+inline constexpr int64_t kHloBinarySnapshotAlignment = 64;
+
+// Returns whether `data` starts like a binary HLO snapshot.
+bool IsHloBinarySnapshot(absl::string_view data);
+
+// Returns the binary snapshot of `module` and `arguments`.
+absl::StatusOr<std::string> SerializeHloBinarySnapshot(
+    const HloModule& module, absl::Span<const Literal* const> arguments);
+
+// Writes the binary snapshot of `module` and `arguments` to the file at `path`.
+absl::Status WriteHloBinarySnapshot(const HloModule& module,
+                                    absl::Span<const Literal* const> arguments,
+                                    const std::string& path,
+                                    tsl::Env* env = tsl::Env::Default());
+
+// A binary HLO snapshot opened for reading.
+class HloBinarySnapshotReader {
+ public:
+  // Memory-maps the snapshot in the file at `path`.
+  static absl::StatusOr<HloBinarySnapshotReader> OpenFile(
+      const std::string& path, tsl::Env* env = tsl::Env::Default());
+
+  // Reads the snapshot in `data`.
+  static absl::StatusOr<HloBinarySnapshotReader> FromData(std::string data);
+
+  // Returns the module proto of the snapshot, whose constants have no literals.
+  const HloModuleProto& module_proto() const {
+    return metadata_.hlo_module();
+  }
+
+  // Creates the module of the snapshot with `config`. The literals of its
+  // constants are loaded from the snapshot when they are first accessed. Until
+  // then they keep the snapshot mapped, even after the reader is destroyed.
+  absl::StatusOr<std::unique_ptr<HloModule>> CreateModule(
+      const HloModuleConfig& config) const;
+
+  // Loads the arguments stored in the snapshot.
+  absl::StatusOr<std::vector<Literal>> LoadArguments() const;
+
+ private:
+  HloBinarySnapshotReader(std::shared_ptr<tsl::ReadOnlyMemoryRegion> region,
+                          HloBinarySnapshotMetadataProto metadata)
+      : region_(std::move(region)), metadata_(std::move(metadata)) {}
+
+  static absl::StatusOr<HloBinarySnapshotReader> Create(
+      std::shared_ptr<tsl::ReadOnlyMemoryRegion> region);
+
+  std::shared_ptr<tsl::ReadOnlyMemoryRegion> region_;
+  HloBinarySnapshotMetadataProto metadata_;
+};
+
+}  // namespace xla
+
+#endif  // XLA_SERVICE_HLO_BINARY_SNAPSHOT_H_
@@ -0,0 +1,192 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/hlo_binary_snapshot.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "xla/hlo/ir/hlo_casting_utils.h"
+#include "xla/hlo/ir/hlo_instructions.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/layout_util.h"
+#include "xla/literal.h"
+#include "xla/literal_util.h"
+#include "xla/service/hlo_module_config.h"
+#include "xla/tests/hlo_test_base.h"
+#include "xla/tests/literal_test_util.h"
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/path.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/test.h"
+
+namespace xla {
+namespace {
+
+class HloBinarySnapshotTest : public HloTestBase {
+ protected:
+  static constexpr absl::string_view kModuleStr = R"(
+    HloModule m
+
+    add {
+      lhs = f32[] parameter(0)
+      rhs = f32[] parameter(1)
+      ROOT add = f32[] add(lhs, rhs)
+    }
+
+    ENTRY main {
+      p0 = f32[2,3]{0,1} parameter(0)
+      weights = f32[2,3]{0,1} constant({{1, 2, 3}, {4, 5, 6}})
+      pred = pred[5] constant({true, false, true, true, false})
+      tuple = (s8[3], u16[]) constant((s8[3]{-1, 0, 1}, u16[] 7))
+      mul = f32[2,3]{0,1} multiply(p0, weights)
+      zero = f32[] constant(0)
+      reduce = f32[2] reduce(mul, zero), dimensions={1}, to_apply=add
+      ROOT result = (f32[2], pred[5], (s8[3], u16[])) tuple(reduce, pred, tuple)
+    }
+  )";
+
+  // Returns the constants of `module`.
+  static std::vector<const HloConstantInstruction*> Constants(
+      const HloModule& module) {
+    std::vector<const HloConstantInstruction*> constants;
+    for (const HloComputation* computation : module.computations()) {
+      for (const HloInstruction* instruction : computation->instructions()) {
+        if (instruction->opcode() == HloOpcode::kConstant) {
+          constants.push_back(Cast<HloConstantInstruction>(instruction));
+        }
+      }
+    }
+    return constants;
+  }
+};
+
+TEST_F(HloBinarySnapshotTest, RoundTripsModuleAndArguments) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  Literal argument =
+      LiteralUtil::CreateR2WithLayout<float>({{1, 2, 3}, {4, 5, 6}},
+                                             LayoutUtil::MakeLayout({0, 1}));
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot,
+                          SerializeHloBinarySnapshot(*module, {&argument}));
+  EXPECT_TRUE(IsHloBinarySnapshot(snapshot));
+
+  TF_ASSERT_OK_AND_ASSIGN(HloBinarySnapshotReader reader,
+                          HloBinarySnapshotReader::FromData(snapshot));
+  TF_ASSERT_OK_AND_ASSIGN(auto loaded,
+                          reader.CreateModule(module->config()));
+  for (const HloConstantInstruction* constant : Constants(*loaded)) {
+    EXPECT_TRUE(constant->HasLazyLiteral()) << constant->name();
+  }
+  const HloPrintOptions options =
+      HloPrintOptions().set_print_large_constants(true);
+  EXPECT_EQ(loaded->ToString(options), module->ToString(options));
+  for (const HloConstantInstruction* constant : Constants(*module)) {
+    const HloInstruction* loaded_constant =
+        FindInstruction(loaded.get(), constant->name());
+    ASSERT_NE(loaded_constant, nullptr);
+    EXPECT_TRUE(
+        LiteralTestUtil::Equal(constant->literal(), loaded_constant->literal()))
+        << constant->name();
+  }
+
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<Literal> arguments,
+                          reader.LoadArguments());
+  ASSERT_EQ(arguments.size(), 1);
+  EXPECT_TRUE(LiteralTestUtil::Equal(argument, arguments[0]));
+  EXPECT_EQ(arguments[0].shape().layout(), argument.shape().layout());
+
+  TF_ASSERT_OK_AND_ASSIGN(Literal expected,
+                          Execute(std::move(module), {&argument}));
+  TF_ASSERT_OK_AND_ASSIGN(Literal actual,
+                          Execute(std::move(loaded), {&arguments[0]}));
+  EXPECT_TRUE(LiteralTestUtil::Equal(expected, actual));
+}
+
+TEST_F(HloBinarySnapshotTest, ConstantsAreLoadedOnFirstAccess) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot,
+                          SerializeHloBinarySnapshot(*module, {}));
+  TF_ASSERT_OK_AND_ASSIGN(HloBinarySnapshotReader reader,
+                          HloBinarySnapshotReader::FromData(snapshot));
+  TF_ASSERT_OK_AND_ASSIGN(auto loaded,
+                          reader.CreateModule(module->config()));
+
+  // Clones share the lazy literal, and so the literal it loads.
+  auto* weights =
+      Cast<HloConstantInstruction>(FindInstruction(loaded.get(), "weights"));
+  std::unique_ptr<HloInstruction> clone = weights->Clone();
+  EXPECT_TRUE(Cast<HloConstantInstruction>(clone.get())->HasLazyLiteral());
+  EXPECT_EQ(&weights->literal(), &clone->literal());
+  EXPECT_EQ(weights->literal().Get<float>({1, 2}), 6);
+
+  // Mutating the literal detaches it from the snapshot and from the clone.
+  weights->mutable_literal()->Set<float>({1, 2}, 7);
+  EXPECT_FALSE(weights->HasLazyLiteral());
+  EXPECT_EQ(weights->literal().Get<float>({1, 2}), 7);
+  EXPECT_EQ(clone->literal().Get<float>({1, 2}), 6);
+}
+
+TEST_F(HloBinarySnapshotTest, ReadsMappedFile) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  Literal argument =
+      LiteralUtil::CreateR2WithLayout<float>({{1, 2, 3}, {4, 5, 6}},
+                                             LayoutUtil::MakeLayout({0, 1}));
+  const std::string path =
+      tsl::io::JoinPath(::testing::TempDir(), "module.hlosnap");
+  TF_ASSERT_OK(WriteHloBinarySnapshot(*module, {&argument}, path));
+
+  std::unique_ptr<HloModule> loaded;
+  {
+    TF_ASSERT_OK_AND_ASSIGN(HloBinarySnapshotReader reader,
+                            HloBinarySnapshotReader::OpenFile(path));
+    TF_ASSERT_OK_AND_ASSIGN(loaded, reader.CreateModule(module->config()));
+    TF_ASSERT_OK_AND_ASSIGN(std::vector<Literal> arguments,
+                            reader.LoadArguments());
+    ASSERT_EQ(arguments.size(), 1);
+    EXPECT_TRUE(LiteralTestUtil::Equal(argument, arguments[0]));
+  }
+  // The constants keep the file mapped after the reader is gone.
+  EXPECT_TRUE(LiteralTestUtil::Equal(
+      FindInstruction(module.get(), "weights")->literal(),
+      FindInstruction(loaded.get(), "weights")->literal()));
+}
+
+TEST_F(HloBinarySnapshotTest, RejectsCorruptedSnapshots) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot,
+                          SerializeHloBinarySnapshot(*module, {}));
+
+  EXPECT_FALSE(HloBinarySnapshotReader::FromData("HloModule m").ok());
+  EXPECT_FALSE(
+      HloBinarySnapshotReader::FromData(snapshot.substr(0, snapshot.size() / 2))
+          .ok());
+
+  // Point the metadata offset past the end of the snapshot.
+  std::string bad_offset = snapshot;
+  bad_offset[bad_offset.size() - 17] = '\x7f';
+  EXPECT_FALSE(HloBinarySnapshotReader::FromData(bad_offset).ok());
+}
+
+}  // namespace
+}  // namespace xla
@@ -26,6 +26,7 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "xla/hlo/ir/dfs_hlo_visitor_with_default.h"
 #include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_instructions.h"
 #include "xla/hlo/ir/hlo_opcode.h"
 #include "xla/hlo/utils/hlo_matchers.h"
 #include "xla/literal.h"
@@ -37,6 +38,7 @@ limitations under the License.
 #include "xla/test.h"
 #include "xla/test_helpers.h"
 #include "xla/tests/hlo_test_base.h"
+#include "tsl/lib/core/status_test_util.h"
 #include "tsl/platform/statusor.h"
 
 namespace xla {
@@ -126,6 +128,79 @@ TEST_F(HloComputationTest, GetEmbeddedComputationsDiamond) {
                                    map2_computation));
 }
 
+TEST_F(HloComputationTest, MutationGeneration) {
+  auto module = CreateNewVerifiedModule();
+  HloComputation* computation =
+      module->AddEntryComputation(CreateNegateComputation());
+  HloInstruction* negate = computation->root_instruction();
+  int64_t generation = computation->mutation_generation();
+
+  // Renaming an instruction is not a mutation.
+  negate->SetAndSanitizeName("negate");
+  EXPECT_EQ(computation->mutation_generation(), generation);
+
+  HloInstruction* negate2 = computation->AddInstruction(
+      HloInstruction::CreateUnary(r0f32_, HloOpcode::kNegate, negate));
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  computation->set_root_instruction(negate2);
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  TF_ASSERT_OK(negate2->ReplaceOperandWith(0, negate->mutable_operand(0)));
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  TF_ASSERT_OK(computation->RemoveInstruction(negate));
+  EXPECT_GT(computation->mutation_generation(), generation);
+}
+
+TEST_F(HloComputationTest, MutationGenerationTracksAttributes) {
+  const char* const hlo_string = R"(
+HloModule m
+
+ENTRY main {
+  p0 = f32[2] parameter(0)
+  p1 = f32[2] parameter(1)
+  tuple = (f32[2], f32[2]) tuple(p0, p1)
+  gte = f32[2] get-tuple-element(tuple), index=0
+  ROOT broadcast = f32[2,2] broadcast(gte), dimensions={0}
+})";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  HloComputation* computation = module->entry_computation();
+  HloInstruction* broadcast = computation->root_instruction();
+  HloInstruction* gte = broadcast->mutable_operand(0);
+  int64_t generation = computation->mutation_generation();
+
+  gte->set_tuple_index(1);
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  (*broadcast->mutable_dimensions())[0] = 1;
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  broadcast->set_sharding(HloSharding::Replicate());
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  broadcast->set_raw_backend_config_string("{}");
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  auto* constant = Cast<HloConstantInstruction>(computation->AddInstruction(
+      HloInstruction::CreateConstant(LiteralUtil::CreateR0<float>(1.0f))));
+  generation = computation->mutation_generation();
+  constant->mutable_literal()->Set<float>({}, 2.0f);
+  EXPECT_GT(computation->mutation_generation(), generation);
+  generation = computation->mutation_generation();
+
+  // Reading the generation again without a mutation returns the same value.
+  EXPECT_EQ(computation->mutation_generation(), generation);
+}
+
 TEST_F(HloComputationTest, PostOrderSingleton) {
   // Test GetInstructionPostOrder for a computation with one instruction.
   auto builder = HloComputation::Builder(TestName());
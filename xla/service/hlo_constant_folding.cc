@@ -16,15 +16,23 @@ limitations under the License.
 #include "xla/service/hlo_constant_folding.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "xla/hlo/evaluator/hlo_evaluator.h"
 #include "xla/hlo/ir/dfs_hlo_visitor_with_default.h"
+#include "xla/hlo/ir/hlo_casting_utils.h"
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_instructions.h"
 #include "xla/hlo/ir/hlo_opcode.h"
 #include "xla/hlo/utils/hlo_query.h"
 #include "xla/layout_util.h"
@@ -64,8 +72,198 @@ static bool IsOrContainsIllegalInstr(const HloInstruction* instr) {
   return false;
 }
 
+// Returns the size of the array data of a value of `shape`.
+static int64_t ArraySizeBytes(const Shape& shape) {
+  int64_t size = 0;
+  ShapeUtil::ForEachSubshape(
+      shape, [&](const Shape& subshape, const ShapeIndex& index) {
+        if (subshape.IsArray()) {
+          size += ShapeUtil::ByteSizeOf(subshape);
+        }
+      });
+  return size;
+}
+
+// Returns a fingerprint of the shape and the array data of `literal`.
+static tsl::Fprint128 FingerprintLiteral(const Literal& literal) {
+  tsl::Fprint128 fingerprint =
+      tsl::Fingerprint128(literal.shape().ToString(/*print_layout=*/true));
+  ShapeUtil::ForEachSubshape(
+      literal.shape(), [&](const Shape& subshape, const ShapeIndex& index) {
+        if (subshape.IsArray()) {
+          fingerprint = tsl::FingerprintCat128(
+              fingerprint,
+              tsl::Fingerprint128(absl::string_view(
+                  static_cast<const char*>(literal.untyped_data(index)),
+                  literal.size_bytes(index))));
+        }
+      });
+  return fingerprint;
+}
+
+std::optional<ConstantFoldingCache::Key> ConstantFoldingCache::MakeKey(
+    const HloInstruction* instruction) const {
+  if (ArraySizeBytes(instruction->shape()) > memory_budget_bytes_) {
+    return std::nullopt;
+  }
+
+  static const HloPrintOptions* options =
+      new HloPrintOptions(HloPrintOptions::Canonical());
+  Key key;
+  key.text = instruction->ToString(*options);
+  for (const HloInstruction* operand : instruction->operands()) {
+    if (operand->opcode() == HloOpcode::kBroadcast) {
+      absl::StrAppend(&key.text, "\n", operand->ToString(*options));
+      operand = operand->operand(0);
+    }
+    const auto* constant = Cast<HloConstantInstruction>(operand);
+    if (!constant->HasLiteral()) {
+      return std::nullopt;
+    }
+    key.literal_fingerprints.push_back(FingerprintLiteral(constant->literal()));
+  }
+  // Large constants in called computations are elided from the text, so their
+  // literals are fingerprinted as well.
+  auto add_constants = [&](const HloComputation* computation) {
+    for (const HloInstruction* callee_instruction :
+         computation->MakeInstructionPostOrder()) {
+      const auto* constant =
+          DynCast<HloConstantInstruction>(callee_instruction);
+      if (constant != nullptr && constant->HasLiteral()) {
+        key.literal_fingerprints.push_back(
+            FingerprintLiteral(constant->literal()));
+      }
+    }
+  };
+  for (const HloComputation* computation :
+       instruction->called_computations()) {
+    for (const HloComputation* embedded :
+         computation->MakeEmbeddedComputationsList()) {
+      add_constants(embedded);
+    }
+    add_constants(computation);
+  }
+  return key;
+}
+
+std::optional<std::shared_ptr<Literal>> ConstantFoldingCache::Lookup(
+    const Key& key) {
+  absl::MutexLock lock(&mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    ++stats_.misses;
+    return std::nullopt;
+  }
+  ++stats_.hits;
+  stats_.saved_time += it->second.folding_time;
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  return it->second.literal;
+}
+
+void ConstantFoldingCache::Insert(Key key, std::shared_ptr<Literal> literal,
+                                  absl::Duration folding_time) {
+  int64_t size_bytes =
+      key.text.size() +
+      key.literal_fingerprints.size() * sizeof(tsl::Fprint128);
+  if (literal != nullptr) {
+    size_bytes += ArraySizeBytes(literal->shape());
+  }
+  if (size_bytes > memory_budget_bytes_) {
+    return;
+  }
+
+  absl::MutexLock lock(&mu_);
+  auto [it, inserted] = entries_.try_emplace(std::move(key));
+  if (!inserted) {
+    return;
+  }
+  lru_.push_front(&it->first);
+  it->second = Entry{std::move(literal), size_bytes, folding_time,
+                     lru_.begin()};
+  size_bytes_ += size_bytes;
+  EvictUntilWithinBudget();
+}
+
+void ConstantFoldingCache::EvictUntilWithinBudget() {
+  while (size_bytes_ > memory_budget_bytes_) {
+    auto it = entries_.find(*lru_.back());
+    size_bytes_ -= it->second.size_bytes;
+    lru_.pop_back();
+    entries_.erase(it);
+    ++stats_.evictions;
+  }
+}
+
+void ConstantFoldingCache::SetModule(const HloModule& module) {
+  absl::MutexLock lock(&mu_);
+  if (module_id_ == module.unique_id()) {
+    return;
+  }
+  module_id_ = module.unique_id();
+  entries_.clear();
+  lru_.clear();
+  size_bytes_ = 0;
+}
+
+ConstantFoldingCache::Stats ConstantFoldingCache::stats() const {
+  absl::MutexLock lock(&mu_);
+  return stats_;
+}
+
+int64_t ConstantFoldingCache::size_bytes() const {
+  absl::MutexLock lock(&mu_);
+  return size_bytes_;
+}
+
 /*static*/ std::atomic<int64_t> HloConstantFolding::slow_op_counter_{0};
 
+/*static*/ std::shared_ptr<Literal> HloConstantFolding::Fold(
+    HloEvaluator& evaluator, const HloInstruction* instruction) {
+  absl::Duration slow_timeout =
+      absl::Seconds(uint64_t{1} << slow_op_counter_.load());
+  SlowOperationAlarm slow_alarm(slow_timeout, [instruction, slow_timeout] {
+    const bool ndebug =
+#if NDEBUG
+        true;
+#else
+        false;
+#endif
+    absl::string_view explanation_msg =
+        ndebug
+            ? "This isn't necessarily a bug; constant-folding is "
+              "inherently a trade-off between compilation time and speed "
+              "at runtime. XLA has some guards that attempt to keep "
+              "constant folding from taking too long, but fundamentally "
+              "you'll always be able to come up with an input program that "
+              "takes a long time.\n\n"
+              "If you'd like to file a bug, run with envvar "
+              "XLA_FLAGS=--xla_dump_to=/tmp/foo and attach the results."
+            : "XLA was built without compiler optimizations, which can be "
+              "slow. Try rebuilding with -c opt.";
+    return absl::StrFormat(
+        "Constant folding an instruction is taking > %s:\n\n"
+        "  %s\n\n"  // instruction->name() or instruction->ToString()
+        "%s",       // explanation_msg
+        absl::FormatDuration(slow_timeout), instruction->ToString(),
+        explanation_msg);
+  });
+
+  // Currently we skip unimplemented operations.
+  // TODO(b/35975797): Fold constant computations for more operations.
+  Literal result;
+  if (!evaluator.TryEvaluate(
+          instruction, &result,
+          /*recursively_evaluate_nonconstant_operands=*/true)) {
+    return nullptr;
+  }
+
+  slow_alarm.cancel();
+  if (slow_alarm.fired()) {
+    slow_op_counter_++;
+  }
+  return std::make_shared<Literal>(std::move(result));
+}
+
 absl::StatusOr<bool> HloConstantFolding::Run(
     HloModule* module,
     const absl::flat_hash_set<absl::string_view>& execution_threads) {
@@ -75,6 +273,16 @@ absl::StatusOr<bool> HloConstantFolding::Run(
   auto evaluator = std::make_unique<HloEvaluator>(/*max_loop_iterations=*/0);
   // fast-path lets us e.g. use Eigen for matmuls.
   evaluator->set_use_fast_path(true);
+  evaluator->set_use_fast_elementwise_path(
+      module->config()
+          .debug_options()
+          .xla_hlo_evaluator_use_fast_elementwise_path());
+
+  ConstantFoldingCache::Stats cache_stats_before;
+  if (cache_ != nullptr) {
+    cache_->SetModule(*module);
+    cache_stats_before = cache_->stats();
+  }
 
   // We delay deleting dead instructions so that we can print them out if we are
   // taking too long without use-after-free or other sorts of races.
@@ -184,55 +392,36 @@ absl::StatusOr<bool> HloConstantFolding::Run(
 
       VLOG(5) << "Constant folding: " << instruction->ToString();
 
-      absl::Duration slow_timeout =
-          absl::Seconds(uint64_t{1} << slow_op_counter_.load());
-      SlowOperationAlarm slow_alarm(slow_timeout, [instruction, slow_timeout] {
-        const bool ndebug =
-#if NDEBUG
-            true;
-#else
-            false;
-#endif
-        absl::string_view explanation_msg =
-            ndebug
-                ? "This isn't necessarily a bug; constant-folding is "
-                  "inherently a trade-off between compilation time and speed "
-                  "at runtime. XLA has some guards that attempt to keep "
-                  "constant folding from taking too long, but fundamentally "
-                  "you'll always be able to come up with an input program that "
-                  "takes a long time.\n\n"
-                  "If you'd like to file a bug, run with envvar "
-                  "XLA_FLAGS=--xla_dump_to=/tmp/foo and attach the results."
-                : "XLA was built without compiler optimizations, which can be "
-                  "slow. Try rebuilding with -c opt.";
-        return absl::StrFormat(
-            "Constant folding an instruction is taking > %s:\n\n"
-            "  %s\n\n"  // instruction->name() or instruction->ToString()
-            "%s",       // explanation_msg
-            absl::FormatDuration(slow_timeout), instruction->ToString(),
-            explanation_msg);
-      });
-
-      // Currently we skip unimplemented operations.
-      // TODO(b/35975797): Fold constant computations for more operations.
-      Literal result;
-      if (!evaluator->TryEvaluate(
-              instruction, &result,
-              /*recursively_evaluate_nonconstant_operands=*/true)) {
+      std::optional<ConstantFoldingCache::Key> cache_key;
+      if (cache_ != nullptr) {
+        cache_key = cache_->MakeKey(instruction);
+      }
+      std::optional<std::shared_ptr<Literal>> cached;
+      if (cache_key.has_value()) {
+        cached = cache_->Lookup(*cache_key);
+      }
+      std::shared_ptr<Literal> result;
+      if (cached.has_value()) {
+        result = *std::move(cached);
+      } else {
+        absl::Time start_time = absl::Now();
+        result = Fold(*evaluator, instruction);
+        if (cache_key.has_value()) {
+          cache_->Insert(*std::move(cache_key), result,
+                         absl::Now() - start_time);
+        }
+      }
+      if (result == nullptr) {
         VLOG(2) << "Constant folding failed for instruction: "
                 << instruction->ToString();
         continue;
       }
 
-      slow_alarm.cancel();
-      if (slow_alarm.fired()) {
-        slow_op_counter_++;
-      }
-
       VLOG(4) << "Constant folded: " << instruction->ToString();
       dead_instructions.push_back(instruction);
+      // The constant shares the literal with the cache.
       HloInstruction* new_constant = instruction->AddInstruction(
-          HloInstruction::CreateConstant(std::move(result)));
+          std::make_unique<HloConstantInstruction>(result, result->shape()));
       if (new_constant->shape().has_layout()) {
         // Update element_size_in_bits on the new instruction's layout. Literals
         // always have element_size_in_bits set to 0, and CreateConstant copies
@@ -246,6 +435,21 @@ absl::StatusOr<bool> HloConstantFolding::Run(
       TF_RETURN_IF_ERROR(instruction->ReplaceAllUsesWith(new_constant));
     }
   }
+  if (cache_ != nullptr) {
+    ConstantFoldingCache::Stats cache_stats = cache_->stats();
+    absl::Duration saved_time =
+        cache_stats.saved_time - cache_stats_before.saved_time;
+    VLOG(1) << "Constant folding cache: "
+            << cache_stats.hits - cache_stats_before.hits << " hits, "
+            << cache_stats.misses - cache_stats_before.misses << " misses, "
+            << cache_stats.evictions - cache_stats_before.evictions
+            << " evictions, " << cache_->size_bytes() << " bytes, saved "
+            << absl::FormatDuration(saved_time);
+    if (compilation_stats_ != nullptr) {
+      compilation_stats_->RecordPassSavings(
+          name(), absl::ToDoubleMilliseconds(saved_time));
+    }
+  }
   const bool changed = !dead_instructions.empty();
   for (HloInstruction* dead_instruction : dead_instructions) {
     CHECK(dead_instruction->IsDead());
@@ -16,15 +16,136 @@ limitations under the License.
 #ifndef XLA_SERVICE_HLO_CONSTANT_FOLDING_H_
 #define XLA_SERVICE_HLO_CONSTANT_FOLDING_H_
 
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "xla/hlo/evaluator/hlo_evaluator.h"
+#include "xla/hlo/ir/hlo_instruction.h"
 #include "xla/hlo/ir/hlo_module.h"
+#include "xla/literal.h"
+#include "xla/service/compilation_stats.h"
 #include "xla/service/hlo_pass_interface.h"
+#include "tsl/platform/fingerprint.h"
 
 namespace xla {
 
+// Memoizes the results of constant folding across runs of HloConstantFolding,
+// which typically runs many times on a module (e.g. inside HloPassFix and
+// simplification loops) and would otherwise evaluate the same subgraphs, or
+// fail to evaluate them, over and over.
+//
+// An entry maps an instruction, including the bodies of the computations it
+// calls, the broadcasts it reads and fingerprints of the literals of the
+// constants it reads, to the folded literal. Entries are evicted in least
+// recently used order once their total size exceeds the memory budget. The
+// cache is scoped to a module: using it for another module clears it.
+class ConstantFoldingCache {
+ public:
+  static constexpr int64_t kDefaultMemoryBudgetBytes = int64_t{128} << 20;
+
+  // Identifies what an instruction folds to.
+  struct Key {
+    // The canonical text of the instruction and of its broadcast operands,
+    // with large constants elided.
+    std::string text;
+    // Fingerprints of the literals of the constants the instruction reads:
+    // its operands in operand order, then the constants of the computations
+    // it calls.
+    std::vector<tsl::Fprint128> literal_fingerprints;
+
+    bool operator==(const Key& other) const {
+      return text == other.text &&
+             literal_fingerprints == other.literal_fingerprints;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      for (const tsl::Fprint128& fingerprint : key.literal_fingerprints) {
+        h = H::combine(std::move(h), fingerprint.low64, fingerprint.high64);
+      }
+      return H::combine(std::move(h), key.text,
+                        key.literal_fingerprints.size());
+    }
+  };
+
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    // The evaluation time of the folds the hits did not need to repeat.
+    absl::Duration saved_time;
+  };
+
+  explicit ConstantFoldingCache(
+      int64_t memory_budget_bytes = kDefaultMemoryBudgetBytes)
+      : memory_budget_bytes_(memory_budget_bytes) {}
+
+  // Returns the key of `instruction`, whose operands must be constants or
+  // broadcasts of constants, or nullopt if it cannot be cached. Instructions
+  // whose result alone exceeds the memory budget are never cached, which is
+  // checked before anything is printed or fingerprinted.
+  std::optional<Key> MakeKey(const HloInstruction* instruction) const;
+
+  // Returns nullopt if there is no entry for `key`. Otherwise returns the
+  // folded literal, or null if folding failed.
+  std::optional<std::shared_ptr<Literal>> Lookup(const Key& key);
+
+  // Records that folding an instruction with `key` took `folding_time` and
+  // resulted in `literal`, or failed if `literal` is null.
+  void Insert(Key key, std::shared_ptr<Literal> literal,
+              absl::Duration folding_time);
+
+  // Clears the cache unless its entries are for `module`.
+  void SetModule(const HloModule& module);
+
+  Stats stats() const;
+  int64_t size_bytes() const;
+
+ private:
+  struct Entry {
+    std::shared_ptr<Literal> literal;
+    int64_t size_bytes;
+    absl::Duration folding_time;
+    std::list<const Key*>::iterator lru_position;
+  };
+
+  void EvictUntilWithinBudget() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t memory_budget_bytes_;
+  mutable absl::Mutex mu_;
+  std::optional<int> module_id_ ABSL_GUARDED_BY(mu_);
+  absl::node_hash_map<Key, Entry> entries_ ABSL_GUARDED_BY(mu_);
+  // The keys of `entries_`, most recently used first.
+  std::list<const Key*> lru_ ABSL_GUARDED_BY(mu_);
+  int64_t size_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+  Stats stats_ ABSL_GUARDED_BY(mu_);
+};
+
 // A pass which performs constant folding in order to avoid unnecessary
 // computation on constants.
 class HloConstantFolding : public HloModulePass {
  public:
+  // Memoizes folded instructions in a cache of its own, so that repeated runs
+  // of the pass reuse them.
+  HloConstantFolding()
+      : HloConstantFolding(std::make_shared<ConstantFoldingCache>()) {}
+
+  // Memoizes folded instructions in `cache`, which may be shared with other
+  // instances of the pass, e.g. by all pipelines of a compiler, or not at all
+  // if it is null.
+  explicit HloConstantFolding(std::shared_ptr<ConstantFoldingCache> cache)
+      : cache_(std::move(cache)) {}
+
   absl::string_view name() const override { return "constant_folding"; }
 
   // Run constant folding operations on the given module. Returns whether the
@@ -34,10 +155,26 @@ class HloConstantFolding : public HloModulePass {
       HloModule* module,
       const absl::flat_hash_set<absl::string_view>& execution_threads) override;
 
+  const std::shared_ptr<ConstantFoldingCache>& cache() const { return cache_; }
+
+  // The compile time the cache saves is reported to `compilation_stats` if it
+  // is not null. HloPassPipeline sets its own stats when it runs the pass.
+  void set_compilation_stats(CompilationStats* compilation_stats) override {
+    compilation_stats_ = compilation_stats;
+  }
+
  private:
+  // Evaluates `instruction`, firing a SlowOperationAlarm if that takes long.
+  // Returns null if the instruction cannot be evaluated.
+  static std::shared_ptr<Literal> Fold(HloEvaluator& evaluator,
+                                       const HloInstruction* instruction);
+
   // Number of slow constant-folds we've encountered.  Used for firing
   // SlowOperationAlarms.
   static std::atomic<int64_t> slow_op_counter_;
+
+  std::shared_ptr<ConstantFoldingCache> cache_;
+  CompilationStats* compilation_stats_ = nullptr;
 };
 
 }  // namespace xla
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "xla/service/hlo_constant_folding.h"
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -27,8 +29,10 @@ limitations under the License.
 #include "xla/layout_util.h"
 #include "xla/literal.h"
 #include "xla/permutation_util.h"
+#include "xla/service/compilation_stats.h"
 #include "xla/service/hlo_parser.h"
 #include "xla/service/hlo_pass_fix.h"
+#include "xla/service/hlo_pass_pipeline.h"
 #include "xla/service/pattern_matcher.h"
 #include "xla/service/pattern_matcher_gmock.h"
 #include "xla/shape_util.h"
@@ -448,5 +452,233 @@ TEST_F(HloConstantFoldingTest, TimingConsumingTest) {
   EXPECT_FALSE(result);
 }
 
+TEST_F(HloConstantFoldingTest, CacheReusesIdenticalFolds) {
+  constexpr absl::string_view kModuleStr = R"(
+    HloModule CacheReusesIdenticalFolds
+
+    ENTRY main {
+      c0 = f32[4] constant({1, 2, 3, 4})
+      c1 = f32[4] constant({1, 2, 3, 4})
+      c2 = f32[4] constant({5, 6, 7, 8})
+      a = f32[4] add(c0, c0)
+      b = f32[4] add(c1, c1)
+      c = f32[4] add(c2, c2)
+      ROOT tuple = (f32[4], f32[4], f32[4]) tuple(a, b, c)
+    }
+  )";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  HloConstantFolding constant_folding;
+  TF_ASSERT_OK_AND_ASSIGN(bool result,
+                          RunHloPass(&constant_folding, module.get()));
+  EXPECT_TRUE(result);
+
+  ConstantFoldingCache::Stats stats = constant_folding.cache()->stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_THAT(root, op::Tuple(op::Constant(), op::Constant(), op::Constant()));
+  EXPECT_EQ(root->operand(0)->literal(),
+            LiteralUtil::CreateR1<float>({2, 4, 6, 8}));
+  EXPECT_EQ(root->operand(1)->literal(),
+            LiteralUtil::CreateR1<float>({2, 4, 6, 8}));
+  EXPECT_EQ(root->operand(2)->literal(),
+            LiteralUtil::CreateR1<float>({10, 12, 14, 16}));
+}
+
+TEST_F(HloConstantFoldingTest, CacheDistinguishesBroadcastsAndComputations) {
+  constexpr absl::string_view kModuleStr = R"(
+    HloModule CacheDistinguishesBroadcastsAndComputations
+
+    add {
+      lhs = f32[] parameter(0)
+      rhs = f32[] parameter(1)
+      ROOT add = f32[] add(lhs, rhs)
+    }
+
+    max {
+      lhs = f32[] parameter(0)
+      rhs = f32[] parameter(1)
+      ROOT max = f32[] maximum(lhs, rhs)
+    }
+
+    ENTRY main {
+      c0 = f32[2,2] constant({{1, 2}, {3, 4}})
+      c1 = f32[2] constant({10, 20})
+      b0 = f32[2,2] broadcast(c1), dimensions={0}
+      b1 = f32[2,2] broadcast(c1), dimensions={1}
+      a0 = f32[2,2] add(c0, b0)
+      a1 = f32[2,2] add(c0, b1)
+      zero = f32[] constant(0)
+      r0 = f32[2] reduce(c0, zero), dimensions={1}, to_apply=add
+      r1 = f32[2] reduce(c0, zero), dimensions={1}, to_apply=max
+      ROOT tuple = (f32[2,2], f32[2,2], f32[2], f32[2]) tuple(a0, a1, r0, r1)
+    }
+  )";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  HloConstantFolding constant_folding;
+  TF_ASSERT_OK_AND_ASSIGN(bool result,
+                          RunHloPass(&constant_folding, module.get()));
+  EXPECT_TRUE(result);
+
+  EXPECT_EQ(constant_folding.cache()->stats().hits, 0);
+  HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_EQ(root->operand(0)->literal(),
+            LiteralUtil::CreateR2<float>({{11, 12}, {23, 24}}));
+  EXPECT_EQ(root->operand(1)->literal(),
+            LiteralUtil::CreateR2<float>({{11, 22}, {13, 24}}));
+  EXPECT_EQ(root->operand(2)->literal(), LiteralUtil::CreateR1<float>({3, 7}));
+  EXPECT_EQ(root->operand(3)->literal(), LiteralUtil::CreateR1<float>({2, 4}));
+}
+
+// Records the savings passes report.
+class SavingsRecordingStats : public CompilationStats {
+ public:
+  void StartPass(absl::string_view pass_name) override {}
+  void EndPass(absl::string_view pass_name) override {}
+  void CompilationReport() override {}
+  int GetPassesSize() override { return 0; }
+  void RecordPassError(absl::string_view pass_name,
+                       absl::string_view err) override {}
+  void RecordPassSavings(absl::string_view pass_name,
+                         double saved_ms) override {
+    reported_passes.push_back(std::string(pass_name));
+  }
+
+  std::vector<std::string> reported_passes;
+};
+
+TEST_F(HloConstantFoldingTest, CacheRemembersFailedFoldsAcrossRuns) {
+  constexpr absl::string_view kModuleStr = R"(
+    HloModule CacheRemembersFailedFoldsAcrossRuns
+
+    ENTRY main {
+      c0 = f32[4] constant({1, 2, 3, 4})
+      ROOT custom-call = f32[4] custom-call(c0), custom_call_target="foo"
+    }
+  )";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  auto cache = std::make_shared<ConstantFoldingCache>();
+  SavingsRecordingStats compilation_stats;
+  HloConstantFolding constant_folding(cache);
+  constant_folding.set_compilation_stats(&compilation_stats);
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(bool result,
+                            RunHloPass(&constant_folding, module.get()));
+    EXPECT_FALSE(result);
+  }
+
+  ConstantFoldingCache::Stats stats = cache->stats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_THAT(compilation_stats.reported_passes,
+              ::testing::ElementsAre("constant_folding", "constant_folding",
+                                     "constant_folding"));
+}
+
+TEST_F(HloConstantFoldingTest, PipelineReportsCacheSavings) {
+  constexpr absl::string_view kModuleStr = R"(
+    HloModule PipelineReportsCacheSavings
+
+    ENTRY main {
+      c0 = f32[4] constant({1, 2, 3, 4})
+      ROOT custom-call = f32[4] custom-call(c0), custom_call_target="foo"
+    }
+  )";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kModuleStr));
+  SavingsRecordingStats compilation_stats;
+  HloPassPipeline pipeline("pipeline", &compilation_stats);
+  // The nested pipeline has no stats of its own, so its passes report to the
+  // stats of the enclosing one.
+  HloPassPipeline& nested_pipeline =
+      pipeline.AddPass<HloPassPipeline>("nested");
+  auto cache = std::make_shared<ConstantFoldingCache>();
+  nested_pipeline.AddPass<HloConstantFolding>(cache);
+  nested_pipeline.AddPass<HloConstantFolding>(cache);
+  TF_ASSERT_OK_AND_ASSIGN(bool result, pipeline.Run(module.get()));
+  EXPECT_FALSE(result);
+
+  EXPECT_EQ(cache->stats().misses, 1);
+  EXPECT_EQ(cache->stats().hits, 1);
+  EXPECT_THAT(compilation_stats.reported_passes,
+              ::testing::ElementsAre("constant_folding", "constant_folding"));
+}
+
+TEST_F(HloConstantFoldingTest, CacheIsScopedToModule) {
+  constexpr absl::string_view kModuleStr = R"(
+    HloModule CacheIsScopedToModule
+
+    ENTRY main {
+      c0 = f32[4] constant({1, 2, 3, 4})
+      ROOT negate = f32[4] negate(c0)
+    }
+  )";
+  auto cache = std::make_shared<ConstantFoldingCache>();
+  HloConstantFolding constant_folding(cache);
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(auto module,
+                            ParseAndReturnVerifiedModule(kModuleStr));
+    TF_ASSERT_OK_AND_ASSIGN(bool result,
+                            RunHloPass(&constant_folding, module.get()));
+    EXPECT_TRUE(result);
+    EXPECT_GT(cache->size_bytes(), 0);
+  }
+  EXPECT_EQ(cache->stats().hits, 0);
+  EXPECT_EQ(cache->stats().misses, 2);
+}
+
+TEST_F(HloConstantFoldingTest, CacheEvictsToStayWithinBudget) {
+  HloComputation::Builder builder(TestName());
+  const Shape shape = ShapeUtil::MakeShape(F32, {1000});
+  HloInstruction* c0 = builder.AddInstruction(HloInstruction::CreateConstant(
+      LiteralUtil::CreateFullWithDescendingLayout<float>({1000}, 1.0f)));
+  HloInstruction* c1 = builder.AddInstruction(HloInstruction::CreateConstant(
+      LiteralUtil::CreateFullWithDescendingLayout<float>({1000}, 2.0f)));
+  HloInstruction* add = builder.AddInstruction(
+      HloInstruction::CreateBinary(shape, HloOpcode::kAdd, c0, c1));
+  HloInstruction* multiply = builder.AddInstruction(
+      HloInstruction::CreateBinary(shape, HloOpcode::kMultiply, c0, c1));
+  builder.AddInstruction(HloInstruction::CreateTuple({add, multiply}));
+  auto module = CreateNewVerifiedModule();
+  module->AddEntryComputation(builder.Build());
+
+  // Every entry holds a result of 4000 bytes, so only one of them fits.
+  constexpr int64_t kMemoryBudgetBytes = 6000;
+  auto cache = std::make_shared<ConstantFoldingCache>(kMemoryBudgetBytes);
+  HloConstantFolding constant_folding(cache);
+  TF_ASSERT_OK_AND_ASSIGN(bool result,
+                          RunHloPass(&constant_folding, module.get()));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(cache->stats().misses, 2);
+  EXPECT_EQ(cache->stats().evictions, 1);
+  EXPECT_GT(cache->size_bytes(), 0);
+  EXPECT_LE(cache->size_bytes(), kMemoryBudgetBytes);
+}
+
+TEST_F(HloConstantFoldingTest, CacheSkipsResultsLargerThanBudget) {
+  HloComputation::Builder builder(TestName());
+  HloInstruction* c0 = builder.AddInstruction(HloInstruction::CreateConstant(
+      LiteralUtil::CreateFullWithDescendingLayout<float>({1000}, 1.0f)));
+  builder.AddInstruction(
+      HloInstruction::CreateUnary(c0->shape(), HloOpcode::kNegate, c0));
+  auto module = CreateNewVerifiedModule();
+  module->AddEntryComputation(builder.Build());
+
+  // The 4000 byte result does not fit, so the instruction is not even looked
+  // up.
+  auto cache = std::make_shared<ConstantFoldingCache>(
+      /*memory_budget_bytes=*/1000);
+  HloConstantFolding constant_folding(cache);
+  TF_ASSERT_OK_AND_ASSIGN(bool result,
+                          RunHloPass(&constant_folding, module.get()));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(cache->stats().hits, 0);
+  EXPECT_EQ(cache->stats().misses, 0);
+  EXPECT_EQ(cache->size_bytes(), 0);
+}
+
 }  // namespace
 }  // namespace xla
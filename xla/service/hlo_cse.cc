@@ -19,6 +19,7 @@ limitations under the License.
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
@@ -221,9 +222,20 @@ struct CseKey {
 
 }  // namespace
 
-absl::StatusOr<bool> HloCSE::Run(
+std::vector<HloComputation*> HloCSE::ComputationsToRun(
     HloModule* module,
     const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  std::vector<HloComputation*> computations;
+  for (HloComputation* computation : module->computations(execution_threads)) {
+    if (only_fusion_computations_ && !computation->IsFusionComputation()) {
+      continue;
+    }
+    computations.push_back(computation);
+  }
+  return computations;
+}
+
+absl::StatusOr<bool> HloCSE::RunOnComputation(HloComputation* computation) {
   bool changed = false;
 
   const auto eq_instructions = [&](const HloInstruction* a,
@@ -250,69 +262,63 @@ absl::StatusOr<bool> HloCSE::Run(
         /*sharding_sensitive=*/true);
   };
 
-  for (auto* computation : module->computations(execution_threads)) {
-    if (only_fusion_computations_ && !computation->IsFusionComputation()) {
+  TF_ASSIGN_OR_RETURN(
+      bool combined,
+      is_layout_sensitive_
+          ? CombineConstants<true>(computation, only_scalars_)
+          : CombineConstants<false>(computation, only_scalars_));
+  changed |= combined;
+
+  // HLO instructions are grouped into equivalency classes by using the
+  // cse_equal predicate defined above. This set holds a representative
+  // instruction for each class.
+  absl::flat_hash_set<CseKey, absl::Hash<CseKey>, decltype(cse_equal)>
+      representatives(/*N=*/computation->instruction_count() + 1,
+                      absl::Hash<CseKey>{}, cse_equal);
+  for (auto instruction : computation->MakeInstructionPostOrder()) {
+    // If the instruction has zero operands (constants, parameters, etc.) skip
+    // over it.
+    if (instruction->operand_count() == 0 &&
+        instruction->opcode() != HloOpcode::kPartitionId &&
+        instruction->opcode() != HloOpcode::kReplicaId) {
+      continue;
+    }
+    // Skip instructions which have side effects.
+    if (instruction->HasSideEffect()) {
       continue;
     }
 
-    TF_ASSIGN_OR_RETURN(
-        bool combined,
-        is_layout_sensitive_
-            ? CombineConstants<true>(computation, only_scalars_)
-            : CombineConstants<false>(computation, only_scalars_));
-    changed |= combined;
-
-    // HLO instructions are grouped into equivalency classes by using the
-    // cse_equal predicate defined above. This set holds a representative
-    // instruction for each class.
-    absl::flat_hash_set<CseKey, absl::Hash<CseKey>, decltype(cse_equal)>
-        representatives(/*N=*/computation->instruction_count() + 1,
-                        absl::Hash<CseKey>{}, cse_equal);
-    for (auto instruction : computation->MakeInstructionPostOrder()) {
-      // If the instruction has zero operands (constants, parameters, etc.) skip
-      // over it.
-      if (instruction->operand_count() == 0 &&
-          instruction->opcode() != HloOpcode::kPartitionId &&
-          instruction->opcode() != HloOpcode::kReplicaId) {
-        continue;
-      }
-      // Skip instructions which have side effects.
-      if (instruction->HasSideEffect()) {
-        continue;
-      }
-
-      if (only_scalars_ && !ShapeUtil::IsScalar(instruction->shape())) {
-        continue;
-      }
+    if (only_scalars_ && !ShapeUtil::IsScalar(instruction->shape())) {
+      continue;
+    }
 
-      auto pair = representatives.insert(CseKey{instruction});
-      if (!pair.second) {
-        HloInstruction* equivalent_instruction = pair.first->hlo;
-        TF_RETURN_IF_ERROR(
-            instruction->ReplaceAllUsesWith(equivalent_instruction));
-        TF_RETURN_IF_ERROR(computation->RemoveInstructionAndUnusedOperands(
-            instruction, /*cleanup=*/std::nullopt,
-            ignore_control_dependencies_));
-        VLOG(4) << "Replaced " << instruction->name() << " with "
-                << equivalent_instruction->name();
-        changed = true;
+    auto pair = representatives.insert(CseKey{instruction});
+    if (!pair.second) {
+      HloInstruction* equivalent_instruction = pair.first->hlo;
+      TF_RETURN_IF_ERROR(
+          instruction->ReplaceAllUsesWith(equivalent_instruction));
+      TF_RETURN_IF_ERROR(computation->RemoveInstructionAndUnusedOperands(
+          instruction, /*cleanup=*/std::nullopt,
+          ignore_control_dependencies_));
+      VLOG(4) << "Replaced " << instruction->name() << " with "
+              << equivalent_instruction->name();
+      changed = true;
+      continue;
+    }
+    for (int64_t i = 0; i < instruction->operand_count(); ++i) {
+      HloInstruction* a = instruction->mutable_operand(i);
+      if (a->opcode() != HloOpcode::kIota) {
         continue;
       }
-      for (int64_t i = 0; i < instruction->operand_count(); ++i) {
-        HloInstruction* a = instruction->mutable_operand(i);
-        if (a->opcode() != HloOpcode::kIota) {
+      for (int64_t j = i + 1; j < instruction->operand_count(); ++j) {
+        HloInstruction* b = instruction->mutable_operand(j);
+        if (a == b || !eq_instructions(a, b)) {
           continue;
         }
-        for (int64_t j = i + 1; j < instruction->operand_count(); ++j) {
-          HloInstruction* b = instruction->mutable_operand(j);
-          if (a == b || !eq_instructions(a, b)) {
-            continue;
-          }
-          TF_RETURN_IF_ERROR(instruction->ReplaceOperandWith(j, a));
-          changed = true;
-          if (b->IsDead()) {
-            TF_RETURN_IF_ERROR(computation->RemoveInstruction(b));
-          }
+        TF_RETURN_IF_ERROR(instruction->ReplaceOperandWith(j, a));
+        changed = true;
+        if (b->IsDead()) {
+          TF_RETURN_IF_ERROR(computation->RemoveInstruction(b));
         }
       }
     }
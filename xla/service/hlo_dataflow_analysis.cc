@@ -16,6 +16,8 @@ limitations under the License.
 #include "xla/service/hlo_dataflow_analysis.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <optional>
 #include <queue>
@@ -34,6 +36,9 @@ limitations under the License.
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "xla/hlo/ir/hlo_casting_utils.h"
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
@@ -87,6 +92,58 @@ absl::flat_hash_map<HloInstruction*, int64_t> CalculatePostOrderSchedule(
   return map;
 }
 
+// Returns true if UpdateInstructionValueSet has a rule for `opcode`. The value
+// sets of the other instructions only hold the values they define, which
+// InitializeInstructionValueSets sets already, so unless values are forwarded,
+// they need not be propagated unless an operand changes.
+bool HasValueSetUpdateRule(HloOpcode opcode) {
+  switch (opcode) {
+    case HloOpcode::kAddDependency:
+    case HloOpcode::kAllGatherStart:
+    case HloOpcode::kAllGatherDone:
+    case HloOpcode::kAsyncStart:
+    case HloOpcode::kAsyncUpdate:
+    case HloOpcode::kAsyncDone:
+    case HloOpcode::kBitcast:
+    case HloOpcode::kDomain:
+    case HloOpcode::kCopy:
+    case HloOpcode::kGetTupleElement:
+    case HloOpcode::kTuple:
+    case HloOpcode::kParameter:
+    case HloOpcode::kCall:
+    case HloOpcode::kWhile:
+    case HloOpcode::kSend:
+    case HloOpcode::kRecvDone:
+    case HloOpcode::kCopyStart:
+    case HloOpcode::kCopyDone:
+    case HloOpcode::kConditional:
+    case HloOpcode::kAllReduceDone:
+    case HloOpcode::kCollectivePermuteStart:
+    case HloOpcode::kCollectivePermuteDone:
+    case HloOpcode::kOptimizationBarrier:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The time the dataflow analyses run and updated on this thread took so far.
+thread_local int64_t thread_analysis_time_usec = 0;
+
+// Adds the time between its construction and destruction to
+// thread_analysis_time_usec.
+class ScopedAnalysisTimer {
+ public:
+  ScopedAnalysisTimer() : start_(absl::Now()) {}
+  ~ScopedAnalysisTimer() {
+    thread_analysis_time_usec +=
+        absl::ToInt64Microseconds(absl::Now() - start_);
+  }
+
+ private:
+  absl::Time start_;
+};
+
 }  // namespace
 using absl::StrAppend;
 using absl::StrCat;
@@ -1260,6 +1317,8 @@ bool HloDataflowAnalysis::UpdateInstructionValueSet(
       break;
     }
     default:
+      // Keep HasValueSetUpdateRule in sync with the cases above.
+      DCHECK(!HasValueSetUpdateRule(instruction->opcode()));
       break;
   }
 
@@ -1283,20 +1342,11 @@ bool HloDataflowAnalysis::UpdateInstructionValueSet(
 }
 
 void HloDataflowAnalysis::Propagate() {
-  using Work = std::pair<int64_t, HloInstruction*>;
-  // Avoid duplicating work by preferring work items early in the post order
-  // schedule. Intuitively, we start from entry parameters and propagate buffers
-  // updates throughout the module only once.
-  std::priority_queue<Work, std::vector<Work>, std::greater<Work>> worklist;
-  absl::flat_hash_set<HloInstruction*> workset;
-  auto priority_map = CalculatePostOrderSchedule(module_);
-  auto add_to_worklist = [&priority_map, &worklist,
-                          &workset](HloInstruction* instruction) {
-    if (workset.insert(instruction).second) {
-      worklist.emplace(priority_map[instruction], instruction);
-    }
-  };
+  priority_map_ = CalculatePostOrderSchedule(module_);
 
+  // Only the instructions whose value sets depend on other instructions need
+  // to be visited; the others are visited when one of their operands changes.
+  std::vector<HloInstruction*> instructions;
   auto comps = module_.MakeComputationPostOrder();
   for (HloComputation* computation : comps) {
     if (!HloInstruction::IsThreadIncluded(computation->execution_thread(),
@@ -1305,10 +1355,35 @@ void HloDataflowAnalysis::Propagate() {
     }
     for (HloInstruction* instruction :
          computation->MakeInstructionPostOrder()) {
-      add_to_worklist(instruction);
+      if (forwards_value_ != nullptr ||
+          HasValueSetUpdateRule(instruction->opcode())) {
+        instructions.push_back(instruction);
+      }
     }
   }
   VLOG(1) << "SSA_FORM_: " << ssa_form_;
+  PropagateFrom(instructions);
+}
+
+void HloDataflowAnalysis::PropagateFrom(
+    absl::Span<HloInstruction* const> instructions,
+    absl::flat_hash_map<HloInstruction*, InstructionValueSet>*
+        prev_value_sets) {
+  using Work = std::pair<int64_t, HloInstruction*>;
+  // Avoid duplicating work by preferring work items early in the post order
+  // schedule. Intuitively, we start from entry parameters and propagate buffers
+  // updates throughout the module only once.
+  std::priority_queue<Work, std::vector<Work>, std::greater<Work>> worklist;
+  absl::flat_hash_set<HloInstruction*> workset;
+  auto add_to_worklist = [this, &worklist,
+                          &workset](HloInstruction* instruction) {
+    if (workset.insert(instruction).second) {
+      worklist.emplace(priority_map_[instruction], instruction);
+    }
+  };
+  for (HloInstruction* instruction : instructions) {
+    add_to_worklist(instruction);
+  }
 
   while (!worklist.empty()) {
     HloInstruction* instruction = worklist.top().second;
@@ -1319,7 +1394,18 @@ void HloDataflowAnalysis::Propagate() {
     VLOG(3) << "Worklist top: " << instruction->name();
     XLA_VLOG_LINES(3, ToString());
 
+    // Save the value set before the first change, if it is asked for.
+    bool saved_prev_value_set = false;
+    if (prev_value_sets != nullptr && !prev_value_sets->contains(instruction)) {
+      prev_value_sets->emplace(instruction,
+                               GetInstructionValueSet(instruction));
+      saved_prev_value_set = true;
+    }
+
     if (!UpdateInstructionValueSet(instruction)) {
+      if (saved_prev_value_set) {
+        prev_value_sets->erase(instruction);
+      }
       // No change to the instruction's value set.
       VLOG(4) << "No change.";
       continue;
@@ -1404,6 +1490,214 @@ void HloDataflowAnalysis::Propagate() {
   }
 }
 
+void HloDataflowAnalysis::UpdatePositionsOfValuesAt(
+    HloInstruction* instruction, const InstructionValueSet& new_value_set,
+    const InstructionValueSet* prev_value_set) {
+  for (const auto& [index, value_set] : new_value_set) {
+    const HloPosition position{instruction, index};
+    std::vector<const HloValue*> added_values;
+    std::vector<const HloValue*> removed_values;
+    if (prev_value_set == nullptr) {
+      added_values = value_set.values();
+    } else {
+      // The values of both value sets are sorted by id.
+      const HloValueSet& prev_values = prev_value_set->element(index);
+      absl::c_set_difference(value_set.values(), prev_values.values(),
+                             std::back_inserter(added_values),
+                             HloValue::IdLessThan);
+      absl::c_set_difference(prev_values.values(), value_set.values(),
+                             std::back_inserter(removed_values),
+                             HloValue::IdLessThan);
+    }
+    for (const HloValue* value : added_values) {
+      if (value->defining_position() != position) {
+        GetValue(value->id()).AddPosition(position);
+      }
+    }
+    for (const HloValue* value : removed_values) {
+      GetValue(value->id()).RemovePosition(position);
+    }
+  }
+}
+
+void HloDataflowAnalysis::UpdateUsesOfValuesAt(
+    const HloInstruction* instruction) {
+  for (const auto& [index, value_set] : GetInstructionValueSet(instruction)) {
+    for (const HloValue* value : value_set.values()) {
+      GetValue(value->id()).UpdateUsesAndLiveOut();
+    }
+  }
+}
+
+Status HloDataflowAnalysis::UpdateFrom(
+    absl::Span<HloInstruction* const> instructions) {
+  absl::flat_hash_map<HloInstruction*, InstructionValueSet> prev_value_sets;
+  PropagateFrom(instructions, &prev_value_sets);
+  for (auto& [instruction, prev_value_set] : prev_value_sets) {
+    UpdatePositionsOfValuesAt(instruction, GetInstructionValueSet(instruction),
+                              &prev_value_set);
+  }
+  VLOG(2) << "Updated the value sets of " << prev_value_sets.size()
+          << " instructions";
+  TF_DCHECK_OK(Verify());
+  return OkStatus();
+}
+
+bool HloDataflowAnalysis::CanUpdateWith(
+    const HloInstruction* instruction) const {
+  if (ssa_form_) {
+    return false;
+  }
+  absl::flat_hash_set<const HloInstruction*> visited;
+  std::vector<const HloInstruction*> stack = {instruction};
+  while (!stack.empty()) {
+    const HloInstruction* current = stack.back();
+    stack.pop_back();
+    if (value_sets_.contains(current) || !visited.insert(current).second) {
+      continue;
+    }
+    if (current->opcode() == HloOpcode::kParameter ||
+        !current->called_computations().empty()) {
+      return false;
+    }
+    for (const HloInstruction* operand : current->operands()) {
+      stack.push_back(operand);
+    }
+  }
+  return true;
+}
+
+absl::StatusOr<std::vector<HloInstruction*>>
+HloDataflowAnalysis::AddNewInstructions(HloInstruction* instruction,
+                                        int64_t priority) {
+  // Visit the instructions which are not in the analysis in post order, so the
+  // operands of each are added before it.
+  std::vector<HloInstruction*> added;
+  absl::flat_hash_set<HloInstruction*> visited;
+  std::vector<std::pair<HloInstruction*, bool>> stack = {{instruction, false}};
+  while (!stack.empty()) {
+    auto [current, operands_added] = stack.back();
+    stack.pop_back();
+    if (!operands_added) {
+      if (value_sets_.contains(current) || !visited.insert(current).second) {
+        continue;
+      }
+      stack.push_back({current, true});
+      for (HloInstruction* operand : current->operands()) {
+        stack.push_back({operand, false});
+      }
+      continue;
+    }
+
+    // The call graph is not updated, so new instructions may not call any
+    // computation.
+    TF_RET_CHECK(current->called_computations().empty())
+        << "New instruction " << current->name()
+        << " calls computations, which are not in the analysis";
+    TF_RET_CHECK(current->opcode() != HloOpcode::kParameter)
+        << "New parameter " << current->name()
+        << " cannot be added to the analysis";
+    const HloValue::Id first_new_value_id = next_value_id_;
+    TF_RETURN_IF_ERROR(InitializeInstructionValueSet(current));
+    // The new values have the largest ids, so values_vector_ stays sorted.
+    for (HloValue::Id id = first_new_value_id; id < next_value_id_; ++id) {
+      values_vector_.push_back(values_.at(id).get());
+    }
+    priority_map_[current] = priority;
+    // The new instruction uses the values of its operands.
+    for (const HloInstruction* operand : current->operands()) {
+      UpdateUsesOfValuesAt(operand);
+    }
+    added.push_back(current);
+  }
+  return added;
+}
+
+Status HloDataflowAnalysis::UpdateAfterChangingOperand(
+    HloInstruction* instruction, HloInstruction* old_operand,
+    HloInstruction* new_operand) {
+  TF_RET_CHECK(!ssa_form_)
+      << "The SSA form dataflow analysis cannot be updated";
+  TF_RET_CHECK(value_sets_.contains(instruction) &&
+               value_sets_.contains(old_operand))
+      << "Instruction " << instruction->name() << " or its operand "
+      << old_operand->name() << " is not in the analysis";
+  ScopedAnalysisTimer timer;
+
+  // New instructions may forward the values of their operands, so they are
+  // propagated, too.
+  TF_ASSIGN_OR_RETURN(
+      std::vector<HloInstruction*> instructions,
+      AddNewInstructions(new_operand, priority_map_.at(instruction)));
+
+  // The uses of the values of both operands changed, whether or not any value
+  // set changes.
+  UpdateUsesOfValuesAt(old_operand);
+  UpdateUsesOfValuesAt(new_operand);
+
+  // The operand may flow into the parameters of the computations the
+  // instruction calls.
+  instructions.push_back(instruction);
+  for (HloComputation* called_computation :
+       instruction->called_computations()) {
+    if (!HloInstruction::IsThreadIncluded(
+            called_computation->execution_thread(), execution_threads_)) {
+      continue;
+    }
+    for (HloInstruction* parameter :
+         called_computation->parameter_instructions()) {
+      instructions.push_back(parameter);
+    }
+  }
+  return UpdateFrom(instructions);
+}
+
+Status HloDataflowAnalysis::UpdateAfterChangingRoot(HloInstruction* old_root,
+                                                    HloInstruction* new_root) {
+  TF_RET_CHECK(!ssa_form_)
+      << "The SSA form dataflow analysis cannot be updated";
+  TF_RET_CHECK(new_root->IsRoot() && old_root->parent() == new_root->parent())
+      << new_root->name() << " is not the root which replaced "
+      << old_root->name();
+  TF_RET_CHECK(value_sets_.contains(old_root))
+      << "Root " << old_root->name() << " is not in the analysis";
+  ScopedAnalysisTimer timer;
+
+  TF_ASSIGN_OR_RETURN(
+      std::vector<HloInstruction*> instructions,
+      AddNewInstructions(new_root, priority_map_.at(old_root)));
+
+  // Roots use all their values, and the values at the root of the entry are
+  // live out of the module. The operands of a root use their values at it, too.
+  for (HloInstruction* root : {old_root, new_root}) {
+    UpdateUsesOfValuesAt(root);
+    for (const HloInstruction* operand : root->operands()) {
+      UpdateUsesOfValuesAt(operand);
+    }
+  }
+
+  // The root flows into the callers of the computation, and across the
+  // backedge of while loops.
+  const CallGraphNode& call_graph_node =
+      call_graph_->GetNode(new_root->parent());
+  for (const CallSite& callsite : call_graph_node.caller_callsites()) {
+    if (callsite.instruction()->opcode() == HloOpcode::kWhile) {
+      instructions.push_back(callsite.instruction());
+      instructions.push_back(
+          callsite.instruction()->while_body()->parameter_instruction(0));
+      instructions.push_back(
+          callsite.instruction()->while_condition()->parameter_instruction(0));
+    } else if (call_graph_node.context() == CallContext::kControlFlow) {
+      instructions.push_back(callsite.instruction());
+    }
+  }
+  return UpdateFrom(instructions);
+}
+
+/*static*/ int64_t HloDataflowAnalysis::ThreadAnalysisTimeUsec() {
+  return thread_analysis_time_usec;
+}
+
 const InstructionValueSet& HloDataflowAnalysis::GetInstructionValueSet(
     const HloInstruction* instruction) const {
   DCHECK(value_sets_.contains(instruction))
@@ -1418,206 +1712,215 @@ InstructionValueSet& HloDataflowAnalysis::GetInstructionValueSet(
   return *value_sets_.find(instruction)->second;
 }
 
+Status HloDataflowAnalysis::InitializeInstructionValueSet(
+    HloInstruction* instruction) {
+  const CallGraphNode& call_graph_node =
+      call_graph_->GetNode(instruction->parent());
+
+  // Create an empty shape tree.
+  value_sets_.insert({instruction, std::make_unique<InstructionValueSet>(
+                                       instruction->shape())});
+
+  // For each sub-shape of the instruction shape, add a new HloValue to its
+  // HloValueSet. should_define may be provided to define a subset of
+  // values.
+  auto define_all_values =
+      [this, &instruction](
+          absl::FunctionRef<bool(const ShapeIndex&)> should_define =
+              [](const ShapeIndex&) { return true; }) {
+        for (auto& pair : GetInstructionValueSet(instruction)) {
+          const ShapeIndex& index = pair.first;
+
+          bool defines_value;
+          if (forwards_value_ != nullptr &&
+              forwards_value_(instruction, index).has_value()) {
+            defines_value = false;
+          } else {
+            defines_value = should_define(index);
+          }
+
+          if (defines_value) {
+            HloValue* value =
+                NewHloValue(instruction, index, /*is_phi=*/false);
+            GetValueSet(instruction, index).AddValue(value);
+          }
+        }
+      };
+
+  // Add a new HloValue to the HloValueSet corresponding to the given index
+  // of the instruction shape.
+  auto define_value_at = [this, &instruction](const ShapeIndex& index) {
+    HloValue* value = NewHloValue(instruction, index, /*is_phi=*/false);
+    GetValueSet(instruction, index).AddValue(value);
+  };
+
+  switch (instruction->opcode()) {
+    case HloOpcode::kBitcast:
+      if (bitcast_defines_value_) {
+        define_all_values();
+      }
+      break;
+    case HloOpcode::kAddDependency:
+    case HloOpcode::kWhile:
+    case HloOpcode::kCall:
+    case HloOpcode::kConditional:
+    case HloOpcode::kGetTupleElement:
+    case HloOpcode::kDomain:
+    case HloOpcode::kOptimizationBarrier:
+      // These instructions define no values. The values in their output
+      // flow from their operands or from cross computation dataflow.
+      break;
+    case HloOpcode::kParameter:
+      if (call_graph_node.context() == CallContext::kBoth) {
+        // We do not support a subcomputation that is called from both a
+        // parallel and sequential context. In this case, the parameter
+        // would both define a value and propagate a value from its
+        // caller. This limitation is not really a problem because the call
+        // graph is typically flattened.
+        return Unimplemented(
+            "Computation %s is called in both a parallel (eg, kMap) and "
+            "sequential (eg, kCall) context",
+            instruction->parent()->name());
+      }
+      if (call_graph_node.caller_callsites().empty() ||
+          call_graph_node.context() == CallContext::kEmbedded) {
+        // Parameters of computations called in a parallel context (eg, map
+        // and reduce) as well as parameters of dead computations define all
+        // values in their output. Otherwise the values of the parameter
+        // come from the caller (eg, operands to the kCall instruction).
+        define_all_values();
+      }
+      break;
+    case HloOpcode::kCopy:
+    case HloOpcode::kTuple:
+      // These instructions only define their top-level values. Any other
+      // values flow from their operands.
+      define_value_at(/*index=*/{});
+      break;
+    case HloOpcode::kAsyncStart: {
+      // AsyncStart produces a tuple of {{aliased operands}, {destination},
+      // contexts}. It defines all of the tuple-shaped values and the
+      // contexts.
+      // If the thread is excluded, then we don't track the contained
+      // dataflow, and define the destination values too.
+      bool thread_included = HloInstruction::IsThreadIncluded(
+          instruction->async_execution_thread(), execution_threads_);
+      define_all_values([&](const ShapeIndex& index) {
+        return ShapeUtil::GetSubshape(instruction->shape(), index)
+                   .IsTuple() ||
+               (!thread_included && index.front() == 1) ||
+               (index.front() > 1);
+      });
+      break;
+    }
+    case HloOpcode::kAsyncUpdate:
+      // AsyncUpdate produces a tuple of {{aliased operands}, {destination},
+      // contexts} where all of the array-typed values alias with the
+      // operand. So, only tuple-shaped values are defined by AsyncUpdate.
+      define_all_values([&](const ShapeIndex& index) {
+        return ShapeUtil::GetSubshape(instruction->shape(), index)
+            .IsTuple();
+      });
+      break;
+    case HloOpcode::kAsyncDone:
+      // AsyncDone's output aliases its output. It defines all remaining
+      // tuple-shaped values.
+      define_all_values([&](const ShapeIndex& index) {
+        return ShapeUtil::GetSubshape(instruction->shape(), index)
+            .IsTuple();
+      });
+      break;
+    case HloOpcode::kCopyStart:
+      // CopyStart produces a tuple of {destination buffer, aliased operand,
+      // U32 context}.
+      define_value_at(/*index=*/{});
+      define_value_at(/*index=*/{0});
+      define_value_at(/*index=*/{2});
+      break;
+    case HloOpcode::kCopyDone:
+      // CopyDone consumes a tuple produced by CopyStart and produces an
+      // element. Its output aliases its input tuple element {0}.
+      break;
+    case HloOpcode::kAllGatherStart:
+      // AllGatherStart produces a tuple of
+      // {aliased operands, destination buffers}. If there is more than
+      // one operand, then both aliased operands and destination buffers
+      // will be tuples themselves. all-gather-start will define all tuples
+      // and all tuple leaves (arrays) in tuple sub-index 1 (destination
+      // buffers).
+      define_all_values([&](const ShapeIndex& index) {
+        return ShapeUtil::GetSubshape(instruction->shape(), index)
+                   .IsTuple() ||
+               index.front() == 1;
+      });
+      break;
+    case HloOpcode::kAllGatherDone:
+      // AllGatherDone's output aliases its input tuple element {1}.
+      if (instruction->shape().IsTuple()) {
+        define_value_at(/*index=*/{});
+      }
+      break;
+    case HloOpcode::kAllReduceDone:
+      // AllReduceDone's output aliases its input.
+      break;
+    case HloOpcode::kCollectivePermuteStart:
+      // CollectivePermuteStart produces a tuple of
+      // {aliased operand, destination buffer, contexts}, where the context
+      // data are optional.
+      define_value_at(/*index=*/{});
+      define_value_at(/*index=*/{1});
+      for (int i = 2; i < instruction->shape().tuple_shapes_size(); ++i) {
+        define_value_at(/*index=*/{i});
+      }
+
+      if (instruction->operand_count() > 1) {
+        CHECK_EQ(instruction->operand_count(), 4);
+        if (instruction->operand(1)->shape().IsTuple()) {
+          for (int i = 0; i < ShapeUtil::TupleElementCount(
+                                  instruction->operand(1)->shape());
+               ++i) {
+            define_value_at(/*index=*/{1, i});
+          }
+        }
+      }
+      break;
+    case HloOpcode::kCollectivePermuteDone:
+      // CollectivePermuteDone's output aliases its input tuple element {1}.
+      if (instruction->shape().IsTuple()) {
+        define_value_at(/*index=*/{});
+      }
+      break;
+    case HloOpcode::kRecvDone:
+      // RecvDone produces a two-element tuple. Element zero aliases its
+      // input tuple element {0}; element one is a token.
+      define_value_at(/*index=*/{});
+      define_value_at(/*index=*/{1});
+      break;
+    case HloOpcode::kSend:
+      // Send produces a tuple of {aliased operand, U32 context, token},
+      // therefore only defines the top-level tuple and the tuple elements
+      // at {1} and {2}.
+      define_value_at(/*index=*/{});
+      define_value_at(/*index=*/{1});
+      define_value_at(/*index=*/{2});
+      break;
+    default:
+      define_all_values();
+      break;
+  }
+
+  return OkStatus();
+}
+
 Status HloDataflowAnalysis::InitializeInstructionValueSets() {
   for (const HloComputation* computation : module_.MakeComputationSorted()) {
     if (!HloInstruction::IsThreadIncluded(computation->execution_thread(),
                                           execution_threads_)) {
       continue;
     }
-    const CallGraphNode& call_graph_node = call_graph_->GetNode(computation);
     for (HloInstruction* instruction :
          computation->MakeInstructionPostOrder()) {
-      // Create an empty shape tree.
-      value_sets_.insert({instruction, std::make_unique<InstructionValueSet>(
-                                           instruction->shape())});
-
-      // For each sub-shape of the instruction shape, add a new HloValue to its
-      // HloValueSet. should_define may be provided to define a subset of
-      // values.
-      auto define_all_values =
-          [this, &instruction](
-              absl::FunctionRef<bool(const ShapeIndex&)> should_define =
-                  [](const ShapeIndex&) { return true; }) {
-            for (auto& pair : GetInstructionValueSet(instruction)) {
-              const ShapeIndex& index = pair.first;
-
-              bool defines_value;
-              if (forwards_value_ != nullptr &&
-                  forwards_value_(instruction, index).has_value()) {
-                defines_value = false;
-              } else {
-                defines_value = should_define(index);
-              }
-
-              if (defines_value) {
-                HloValue* value =
-                    NewHloValue(instruction, index, /*is_phi=*/false);
-                GetValueSet(instruction, index).AddValue(value);
-              }
-            }
-          };
-
-      // Add a new HloValue to the HloValueSet corresponding to the given index
-      // of the instruction shape.
-      auto define_value_at = [this, &instruction](const ShapeIndex& index) {
-        HloValue* value = NewHloValue(instruction, index, /*is_phi=*/false);
-        GetValueSet(instruction, index).AddValue(value);
-      };
-
-      switch (instruction->opcode()) {
-        case HloOpcode::kBitcast:
-          if (bitcast_defines_value_) {
-            define_all_values();
-          }
-          break;
-        case HloOpcode::kAddDependency:
-        case HloOpcode::kWhile:
-        case HloOpcode::kCall:
-        case HloOpcode::kConditional:
-        case HloOpcode::kGetTupleElement:
-        case HloOpcode::kDomain:
-        case HloOpcode::kOptimizationBarrier:
-          // These instructions define no values. The values in their output
-          // flow from their operands or from cross computation dataflow.
-          break;
-        case HloOpcode::kParameter:
-          if (call_graph_node.context() == CallContext::kBoth) {
-            // We do not support a subcomputation that is called from both a
-            // parallel and sequential context. In this case, the parameter
-            // would both define a value and propagate a value from its
-            // caller. This limitation is not really a problem because the call
-            // graph is typically flattened.
-            return Unimplemented(
-                "Computation %s is called in both a parallel (eg, kMap) and "
-                "sequential (eg, kCall) context",
-                computation->name());
-          }
-          if (call_graph_node.caller_callsites().empty() ||
-              call_graph_node.context() == CallContext::kEmbedded) {
-            // Parameters of computations called in a parallel context (eg, map
-            // and reduce) as well as parameters of dead computations define all
-            // values in their output. Otherwise the values of the parameter
-            // come from the caller (eg, operands to the kCall instruction).
-            define_all_values();
-          }
-          break;
-        case HloOpcode::kCopy:
-        case HloOpcode::kTuple:
-          // These instructions only define their top-level values. Any other
-          // values flow from their operands.
-          define_value_at(/*index=*/{});
-          break;
-        case HloOpcode::kAsyncStart: {
-          // AsyncStart produces a tuple of {{aliased operands}, {destination},
-          // contexts}. It defines all of the tuple-shaped values and the
-          // contexts.
-          // If the thread is excluded, then we don't track the contained
-          // dataflow, and define the destination values too.
-          bool thread_included = HloInstruction::IsThreadIncluded(
-              instruction->async_execution_thread(), execution_threads_);
-          define_all_values([&](const ShapeIndex& index) {
-            return ShapeUtil::GetSubshape(instruction->shape(), index)
-                       .IsTuple() ||
-                   (!thread_included && index.front() == 1) ||
-                   (index.front() > 1);
-          });
-          break;
-        }
-        case HloOpcode::kAsyncUpdate:
-          // AsyncUpdate produces a tuple of {{aliased operands}, {destination},
-          // contexts} where all of the array-typed values alias with the
-          // operand. So, only tuple-shaped values are defined by AsyncUpdate.
-          define_all_values([&](const ShapeIndex& index) {
-            return ShapeUtil::GetSubshape(instruction->shape(), index)
-                .IsTuple();
-          });
-          break;
-        case HloOpcode::kAsyncDone:
-          // AsyncDone's output aliases its output. It defines all remaining
-          // tuple-shaped values.
-          define_all_values([&](const ShapeIndex& index) {
-            return ShapeUtil::GetSubshape(instruction->shape(), index)
-                .IsTuple();
-          });
-          break;
-        case HloOpcode::kCopyStart:
-          // CopyStart produces a tuple of {destination buffer, aliased operand,
-          // U32 context}.
-          define_value_at(/*index=*/{});
-          define_value_at(/*index=*/{0});
-          define_value_at(/*index=*/{2});
-          break;
-        case HloOpcode::kCopyDone:
-          // CopyDone consumes a tuple produced by CopyStart and produces an
-          // element. Its output aliases its input tuple element {0}.
-          break;
-        case HloOpcode::kAllGatherStart:
-          // AllGatherStart produces a tuple of
-          // {aliased operands, destination buffers}. If there is more than
-          // one operand, then both aliased operands and destination buffers
-          // will be tuples themselves. all-gather-start will define all tuples
-          // and all tuple leaves (arrays) in tuple sub-index 1 (destination
-          // buffers).
-          define_all_values([&](const ShapeIndex& index) {
-            return ShapeUtil::GetSubshape(instruction->shape(), index)
-                       .IsTuple() ||
-                   index.front() == 1;
-          });
-          break;
-        case HloOpcode::kAllGatherDone:
-          // AllGatherDone's output aliases its input tuple element {1}.
-          if (instruction->shape().IsTuple()) {
-            define_value_at(/*index=*/{});
-          }
-          break;
-        case HloOpcode::kAllReduceDone:
-          // AllReduceDone's output aliases its input.
-          break;
-        case HloOpcode::kCollectivePermuteStart:
-          // CollectivePermuteStart produces a tuple of
-          // {aliased operand, destination buffer, contexts}, where the context
-          // data are optional.
-          define_value_at(/*index=*/{});
-          define_value_at(/*index=*/{1});
-          for (int i = 2; i < instruction->shape().tuple_shapes_size(); ++i) {
-            define_value_at(/*index=*/{i});
-          }
-
-          if (instruction->operand_count() > 1) {
-            CHECK_EQ(instruction->operand_count(), 4);
-            if (instruction->operand(1)->shape().IsTuple()) {
-              for (int i = 0; i < ShapeUtil::TupleElementCount(
-                                      instruction->operand(1)->shape());
-                   ++i) {
-                define_value_at(/*index=*/{1, i});
-              }
-            }
-          }
-          break;
-        case HloOpcode::kCollectivePermuteDone:
-          // CollectivePermuteDone's output aliases its input tuple element {1}.
-          if (instruction->shape().IsTuple()) {
-            define_value_at(/*index=*/{});
-          }
-          break;
-        case HloOpcode::kRecvDone:
-          // RecvDone produces a two-element tuple. Element zero aliases its
-          // input tuple element {0}; element one is a token.
-          define_value_at(/*index=*/{});
-          define_value_at(/*index=*/{1});
-          break;
-        case HloOpcode::kSend:
-          // Send produces a tuple of {aliased operand, U32 context, token},
-          // therefore only defines the top-level tuple and the tuple elements
-          // at {1} and {2}.
-          define_value_at(/*index=*/{});
-          define_value_at(/*index=*/{1});
-          define_value_at(/*index=*/{2});
-          break;
-        default:
-          define_all_values();
-          break;
-      }
+      TF_RETURN_IF_ERROR(InitializeInstructionValueSet(instruction));
     }
   }
 
@@ -1674,6 +1977,7 @@ absl::StatusOr<std::unique_ptr<HloDataflowAnalysis>> HloDataflowAnalysis::Run(
     absl::flat_hash_set<absl::string_view> execution_threads) {
   VLOG(1) << "HloDataflowAnalysis::Run on module " << module.name();
   XLA_VLOG_LINES(2, module.ToString());
+  ScopedAnalysisTimer timer;
 
   auto dataflow_analysis = absl::WrapUnique(new HloDataflowAnalysis(
       module, ssa_form, bitcast_defines_value, can_share_buffer, forwards_value,
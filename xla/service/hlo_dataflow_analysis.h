@@ -117,6 +117,45 @@ class HloDataflowAnalysis {
       const ForwardsValue& forwards_value = nullptr,
       absl::flat_hash_set<absl::string_view> execution_threads = {});
 
+  // Updates the analysis after `instruction` replaced its operand `old_operand`
+  // with `new_operand`, e.g. by HloInstruction::ReplaceOperandWith. If
+  // `new_operand` or any of its transitive operands were added to the module
+  // after the analysis ran, they are added to the analysis; they may not be
+  // parameters or call computations. Only the value sets the change reaches
+  // are propagated again, which is much cheaper than running the analysis
+  // again after a local rewrite. Analyses built on this one, like
+  // HloAliasAnalysis, are not updated.
+  //
+  // Only supported if the analysis is not in SSA form, where a change may add
+  // or remove phi values.
+  Status UpdateAfterChangingOperand(HloInstruction* instruction,
+                                    HloInstruction* old_operand,
+                                    HloInstruction* new_operand);
+
+  // Updates the analysis after the root of the computation of `new_root` was
+  // changed from `old_root` to `new_root`. A new `new_root` is added to the
+  // analysis as in UpdateAfterChangingOperand. Only supported if the analysis
+  // is not in SSA form.
+  Status UpdateAfterChangingRoot(HloInstruction* old_root,
+                                 HloInstruction* new_root);
+
+  // Returns true if `instruction` is in the analysis, i.e. it was in the module
+  // when the analysis ran or an update added it.
+  bool ContainsInstruction(const HloInstruction* instruction) const {
+    return value_sets_.contains(instruction);
+  }
+
+  // Returns true if the analysis can be updated after an operand or root was
+  // changed to `instruction`: the analysis is not in SSA form, and none of the
+  // instructions among `instruction` and its transitive operands which are not
+  // in the analysis is a parameter or calls computations.
+  bool CanUpdateWith(const HloInstruction* instruction) const;
+
+  // Returns the time, in microseconds, the dataflow analyses run and updated on
+  // the calling thread took so far. HloPassPipeline records the difference
+  // over a pass in the pass metadata.
+  static int64_t ThreadAnalysisTimeUsec();
+
   // Returns true if 'instruction' defines an HLO value at the given shape index
   // of its output.
   bool ValueIsDefinedAt(const HloInstruction* instruction,
@@ -266,6 +305,15 @@ class HloDataflowAnalysis {
   // then propagated throughout the HLO graph by calling Propagate.
   Status InitializeInstructionValueSets();
 
+  // Constructs and initializes the InstructionValueSet of one instruction.
+  Status InitializeInstructionValueSet(HloInstruction* instruction);
+
+  // Adds `instruction` and its transitive operands which were added to the
+  // module after the analysis ran to the analysis, with the given priority in
+  // the propagation worklist. Returns the added instructions in post order.
+  absl::StatusOr<std::vector<HloInstruction*>> AddNewInstructions(
+      HloInstruction* instruction, int64_t priority);
+
   // Updates the value set of the given instruction based on the values flowing
   // into the instruction (operands and cross-computation dataflow).
   bool UpdateInstructionValueSet(HloInstruction* instruction);
@@ -315,6 +363,22 @@ class HloDataflowAnalysis {
   // instructions.
   void Propagate();
 
+  // Propagates the dataflow from `instructions` until the value sets do not
+  // change anymore. If `prev_value_sets` is not null, the value set each
+  // changed instruction had before its first change is added to it.
+  void PropagateFrom(
+      absl::Span<HloInstruction* const> instructions,
+      absl::flat_hash_map<HloInstruction*, InstructionValueSet>*
+          prev_value_sets = nullptr);
+
+  // Propagates the dataflow from `instructions` after a change of the module,
+  // and updates the positions of the values whose value sets changed.
+  Status UpdateFrom(absl::Span<HloInstruction* const> instructions);
+
+  // Recomputes the uses and liveout status of the values in the output of
+  // `instruction`.
+  void UpdateUsesOfValuesAt(const HloInstruction* instruction);
+
   // Returns the result of the SSA Phi function applied to the given inputs at
   // the given instruction.
   bool Phi(HloInstruction* instruction,
@@ -338,6 +402,10 @@ class HloDataflowAnalysis {
 
   std::unique_ptr<CallGraph> call_graph_;
 
+  // The position of each instruction in the post order of the module, which
+  // orders the worklist of the propagation.
+  absl::flat_hash_map<HloInstruction*, int64_t> priority_map_;
+
   // The map of all HloValues in the module. We pass around pointers to the
   // mapped HloValues, so the underlying container must keep them valid despite
   // mutations touching other map entries.
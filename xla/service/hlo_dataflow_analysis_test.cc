@@ -25,6 +25,7 @@ limitations under the License.
 #include <gtest/gtest.h>
 #include "absl/log/check.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "xla/comparison_util.h"
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
@@ -51,7 +52,9 @@ namespace {
 
 using ::testing::ElementsAre;
 using ::testing::IsEmpty;
+using ::testing::SizeIs;
 using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 
 // Test is parameterized on a bool which is whether the dataflow analysis is
 // performed with SSA form.
@@ -2142,6 +2145,157 @@ TEST_F(HloDataflowAnalysisTest, AllGatherStartAndDoneWithTuple) {
               UnorderedElementsAre(&analysis.GetValueDefinedAt(start, {1, 1})));
 }
 
+// Expects `analysis` to have the same value sets, positions and uses as an
+// analysis of its module run from scratch.
+void ExpectSameAsRerun(const HloDataflowAnalysis& analysis) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloDataflowAnalysis> rerun,
+                          HloDataflowAnalysis::Run(analysis.module()));
+  ASSERT_EQ(analysis.values().size(), rerun->values().size());
+  for (const HloComputation* computation : analysis.module().computations()) {
+    for (const HloInstruction* instruction : computation->instructions()) {
+      for (const auto& [index, value_set] :
+           analysis.GetInstructionValueSet(instruction)) {
+        SCOPED_TRACE(absl::StrCat(instruction->name(), index.ToString()));
+        const HloValueSet& rerun_value_set =
+            rerun->GetValueSet(instruction, index);
+        ASSERT_EQ(value_set.values().size(), rerun_value_set.values().size());
+        for (int64_t i = 0; i < value_set.values().size(); ++i) {
+          const HloValue& value = *value_set.values()[i];
+          const HloValue& rerun_value = *rerun_value_set.values()[i];
+          EXPECT_EQ(value.defining_position(), rerun_value.defining_position());
+          EXPECT_THAT(value.positions(),
+                      UnorderedElementsAreArray(rerun_value.positions()));
+          EXPECT_THAT(value.GetUses(),
+                      UnorderedElementsAreArray(rerun_value.GetUses()));
+          EXPECT_EQ(value.live_out_of_module(),
+                    rerun_value.live_out_of_module());
+        }
+      }
+    }
+  }
+}
+
+constexpr absl::string_view kUpdateTestModule = R"(
+HloModule UpdateTest
+
+body {
+  body_param = (f32[], f32[]) parameter(0)
+  body_gte0 = f32[] get-tuple-element(body_param), index=0
+  body_gte1 = f32[] get-tuple-element(body_param), index=1
+  add = f32[] add(body_gte0, body_gte1)
+  swap = (f32[], f32[]) tuple(body_gte1, add)
+  ROOT tuple = (f32[], f32[]) tuple(add, body_gte1)
+}
+
+cond {
+  cond_param = (f32[], f32[]) parameter(0)
+  ROOT constant = pred[] constant(false)
+}
+
+ENTRY entry {
+  p0 = f32[] parameter(0)
+  p1 = f32[] parameter(1)
+  negate = f32[] negate(p0)
+  init = (f32[], f32[]) tuple(p0, p1)
+  while = (f32[], f32[]) while(init), condition=cond, body=body
+  gte0 = f32[] get-tuple-element(while), index=0
+  ROOT gte1 = f32[] get-tuple-element(while), index=1
+}
+)";
+
+TEST_F(HloDataflowAnalysisTest, UpdateAfterChangingOperand) {
+  TF_ASSERT_OK_AND_ASSIGN(module_,
+                          ParseAndReturnVerifiedModule(kUpdateTestModule));
+  RunAnalysis(/*ssa_form=*/false, /*bitcast_defines_value=*/false,
+              /*run_dce=*/false);
+  HloComputation* entry = module_->entry_computation();
+  HloInstruction* p1 = entry->parameter_instruction(1);
+  HloInstruction* negate = FindInstruction(module_.get(), "negate");
+  HloInstruction* init = FindInstruction(module_.get(), "init");
+  EXPECT_THAT(HloValuesAt(entry->root_instruction()),
+              ElementsAre(&analysis_->GetValueDefinedAt(p1)));
+
+  TF_ASSERT_OK(init->ReplaceOperandWith(1, negate));
+  TF_ASSERT_OK(analysis_->UpdateAfterChangingOperand(init, p1, negate));
+  EXPECT_THAT(HloValuesAt(entry->root_instruction()),
+              ElementsAre(&analysis_->GetValueDefinedAt(negate)));
+  EXPECT_THAT(analysis_->GetValueDefinedAt(p1).positions(), SizeIs(1));
+  EXPECT_THAT(analysis_->GetValueDefinedAt(p1).GetUses(), IsEmpty());
+  ExpectSameAsRerun(*analysis_);
+}
+
+TEST_F(HloDataflowAnalysisTest, UpdateAfterChangingRoot) {
+  TF_ASSERT_OK_AND_ASSIGN(module_,
+                          ParseAndReturnVerifiedModule(kUpdateTestModule));
+  RunAnalysis(/*ssa_form=*/false, /*bitcast_defines_value=*/false,
+              /*run_dce=*/false);
+
+  // Swap the elements of the loop state on every iteration.
+  HloComputation* body = FindComputation(module_.get(), "body");
+  HloInstruction* old_body_root = body->root_instruction();
+  HloInstruction* swap = FindInstruction(module_.get(), "swap");
+  body->set_root_instruction(swap);
+  TF_ASSERT_OK(analysis_->UpdateAfterChangingRoot(old_body_root, swap));
+  ExpectSameAsRerun(*analysis_);
+
+  // Make the first element of the loop state the output of the module.
+  HloComputation* entry = module_->entry_computation();
+  HloInstruction* old_entry_root = entry->root_instruction();
+  HloInstruction* gte0 = FindInstruction(module_.get(), "gte0");
+  entry->set_root_instruction(gte0);
+  TF_ASSERT_OK(analysis_->UpdateAfterChangingRoot(old_entry_root, gte0));
+  EXPECT_TRUE(
+      analysis_->GetValueDefinedAt(entry->parameter_instruction(0))
+          .live_out_of_module());
+  ExpectSameAsRerun(*analysis_);
+}
+
+TEST_F(HloDataflowAnalysisTest, UpdateAddsNewInstructions) {
+  TF_ASSERT_OK_AND_ASSIGN(module_,
+                          ParseAndReturnVerifiedModule(kUpdateTestModule));
+  RunAnalysis(/*ssa_form=*/false, /*bitcast_defines_value=*/false,
+              /*run_dce=*/false);
+  HloComputation* entry = module_->entry_computation();
+  HloInstruction* p1 = entry->parameter_instruction(1);
+  HloInstruction* init = FindInstruction(module_.get(), "init");
+
+  // Feed a new copy of the parameter into the loop.
+  HloInstruction* copy = entry->AddInstruction(
+      HloInstruction::CreateUnary(p1->shape(), HloOpcode::kCopy, p1));
+  EXPECT_TRUE(analysis_->CanUpdateWith(copy));
+  TF_ASSERT_OK(init->ReplaceOperandWith(1, copy));
+  TF_ASSERT_OK(analysis_->UpdateAfterChangingOperand(init, p1, copy));
+  EXPECT_THAT(HloValuesAt(entry->root_instruction()),
+              ElementsAre(&analysis_->GetValueDefinedAt(copy)));
+  ExpectSameAsRerun(*analysis_);
+
+  // Return a new tuple of the first output and a new negate of the second.
+  HloInstruction* old_root = entry->root_instruction();
+  HloInstruction* gte0 = FindInstruction(module_.get(), "gte0");
+  HloInstruction* negate = entry->AddInstruction(
+      HloInstruction::CreateUnary(old_root->shape(), HloOpcode::kNegate,
+                                  old_root));
+  HloInstruction* tuple =
+      entry->AddInstruction(HloInstruction::CreateTuple({gte0, negate}));
+  entry->set_root_instruction(tuple, /*accept_different_shape=*/true);
+  TF_ASSERT_OK(analysis_->UpdateAfterChangingRoot(old_root, tuple));
+  EXPECT_TRUE(analysis_->GetValueDefinedAt(negate).live_out_of_module());
+  ExpectSameAsRerun(*analysis_);
+}
+
+TEST_F(HloDataflowAnalysisTest, UpdateOfSsaFormIsAnError) {
+  TF_ASSERT_OK_AND_ASSIGN(module_,
+                          ParseAndReturnVerifiedModule(kUpdateTestModule));
+  RunAnalysis(/*ssa_form=*/true, /*bitcast_defines_value=*/false,
+              /*run_dce=*/false);
+  HloInstruction* p1 = module_->entry_computation()->parameter_instruction(1);
+  HloInstruction* negate = FindInstruction(module_.get(), "negate");
+  HloInstruction* init = FindInstruction(module_.get(), "init");
+  EXPECT_FALSE(analysis_->CanUpdateWith(negate));
+  TF_ASSERT_OK(init->ReplaceOperandWith(1, negate));
+  EXPECT_FALSE(analysis_->UpdateAfterChangingOperand(init, p1, negate).ok());
+}
+
 INSTANTIATE_TEST_SUITE_P(HloDataflowAnalysisInstantiation,
                          HloDataflowAnalysisTest,
                          ::testing::Values(false, true));
@@ -82,11 +82,13 @@ TokKind HloLexer::LookAhead() {
     return GetKind();
   }
 
+  // Move rather than copy the token state, so that looking ahead of a long
+  // name or string does not allocate.
   const char* old_current_ptr = current_ptr_;
-  TokenState old_token_state = token_state_;
+  TokenState old_token_state = std::move(token_state_);
   Lex();
   TokKind kind = GetKind();
-  token_state_ = old_token_state;
+  token_state_ = std::move(old_token_state);
   current_ptr_ = old_current_ptr;
   return kind;
 }
@@ -388,6 +390,10 @@ TokKind HloLexer::LexPercent() {
 // int ::=  [-]?[0-9]+
 // negative inf ::= '-inf'
 TokKind HloLexer::LexNumberOrPattern() {
+  if (std::optional<TokKind> kind = LexPlainNumber()) {
+    return *kind;
+  }
+
   absl::string_view consumable = StringViewFromPointers(
       token_state_.token_start, buf_.data() + buf_.size());
   static LazyRE2 float_pattern = {
@@ -464,6 +470,85 @@ TokKind HloLexer::LexNumberOrPattern() {
   return TokKind::kError;
 }
 
+// Integers and decimals make up the bulk of large literals, so they are
+// scanned by hand instead of with the patterns of LexNumberOrPattern. Returns
+// nullopt, leaving the lexer unchanged, unless the token is a number that is
+// followed by a character no other number pattern can continue with; the
+// caller then falls back to the patterns, which produce the same token.
+std::optional<TokKind> HloLexer::LexPlainNumber() {
+  const char* const end = buf_.data() + buf_.size();
+  const char* ptr = token_state_.token_start;
+  auto skip_digits = [&] {
+    const char* begin = ptr;
+    while (ptr != end &&
+           absl::ascii_isdigit(static_cast<unsigned char>(*ptr))) {
+      ++ptr;
+    }
+    return ptr - begin;
+  };
+
+  if (ptr != end && *ptr == '-') {
+    ++ptr;
+  }
+  int64_t mantissa_digits = skip_digits();
+  bool is_decimal = false;
+  if (ptr != end && *ptr == '.') {
+    ++ptr;
+    is_decimal = true;
+    mantissa_digits += skip_digits();
+  }
+  if (mantissa_digits == 0) {
+    return std::nullopt;
+  }
+  if (ptr != end && (*ptr == 'e' || *ptr == 'E')) {
+    ++ptr;
+    if (ptr != end && (*ptr == '+' || *ptr == '-')) {
+      ++ptr;
+    }
+    if (skip_digits() == 0) {
+      return std::nullopt;
+    }
+    is_decimal = true;
+  }
+  if (ptr != end) {
+    switch (*ptr) {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+      case ',':
+      case ':':
+      case ')':
+      case ']':
+      case '}':
+        break;
+      default:
+        return std::nullopt;
+    }
+  }
+
+  absl::string_view slice =
+      StringViewFromPointers(token_state_.token_start, ptr);
+  if (is_decimal) {
+    if (!absl::SimpleAtod(slice, &token_state_.decimal_val)) {
+      return std::nullopt;
+    }
+    current_ptr_ = ptr;
+    return TokKind::kDecimal;
+  }
+  if (absl::SimpleAtoi(slice, &token_state_.int64_val)) {
+    current_ptr_ = ptr;
+    return TokKind::kInt;
+  }
+  uint64_t uint64_val;
+  if (absl::SimpleAtoi(slice, &uint64_val)) {
+    token_state_.int64_val = absl::bit_cast<int64_t>(uint64_val);
+    current_ptr_ = ptr;
+    return TokKind::kInt;
+  }
+  return std::nullopt;
+}
+
 std::pair<unsigned, unsigned> HloLexer::GetLineAndColumn(LocTy location) const {
   unsigned line_no = 1;
   const char* start = buf_.data();
@@ -180,6 +180,7 @@ class HloLexer {
   TokKind LexShape();
   TokKind LexConstant();
   TokKind LexNumberOrPattern();
+  std::optional<TokKind> LexPlainNumber();
   TokKind LexString();
 
   std::optional<int64_t> LexNanPayload(absl::string_view& consumable);
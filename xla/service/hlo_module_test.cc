@@ -116,6 +116,45 @@ TEST_F(HloModuleTest, TwoComputationsPostOrder) {
   EXPECT_EQ(computation2->name(), "Constant.1");
 }
 
+TEST_F(HloModuleTest, DeferUniqueIdentifiers) {
+  auto module = CreateNewVerifiedModule();
+  HloComputation* computation1 =
+      module->AddEmbeddedComputation(CreateConstantComputation());
+  HloComputation* computation2 =
+      module->AddEmbeddedComputation(CreateConstantComputation());
+  auto add_negate = [&](HloComputation* computation) {
+    return computation->AddInstruction(HloInstruction::CreateUnary(
+        r0f32_, HloOpcode::kNegate, computation->root_instruction()));
+  };
+
+  module->DeferUniqueIdentifiers({computation1, computation2});
+  // Instructions are added to the second computation first.
+  HloInstruction* negate2 = add_negate(computation2);
+  HloInstruction* negate1 = add_negate(computation1);
+  HloInstruction* removed = add_negate(computation1);
+  HloInstruction* negate3 = add_negate(computation1);
+  EXPECT_EQ(negate1->name(), "negate");
+  EXPECT_EQ(negate2->name(), "negate");
+  EXPECT_LT(negate1->unique_id(), -1);
+  EXPECT_NE(negate1->unique_id(), negate2->unique_id());
+  EXPECT_NE(negate1->unique_id(), negate3->unique_id());
+  EXPECT_NE(negate2->unique_id(), negate3->unique_id());
+  TF_ASSERT_OK(computation1->RemoveInstruction(removed));
+
+  // Names and ids follow the order of the computations.
+  const int next_id = module->NewUniqueInstructionId() + 1;
+  module->AssignDeferredUniqueIdentifiers({computation1, computation2});
+  EXPECT_EQ(negate1->name(), "negate");
+  EXPECT_EQ(negate1->unique_id(), next_id);
+  EXPECT_EQ(negate3->name(), "negate.1");
+  EXPECT_EQ(negate3->unique_id(), next_id + 1);
+  EXPECT_EQ(negate2->name(), "negate.2");
+  EXPECT_EQ(negate2->unique_id(), next_id + 2);
+
+  // Instructions added afterwards get unique identifiers right away.
+  EXPECT_EQ(add_negate(computation2)->unique_id(), next_id + 3);
+}
+
 TEST_F(HloModuleTest, CloneTest) {
   // Create and copy a module with a diamond call graph of computations.
   auto module = CreateNewVerifiedModule();
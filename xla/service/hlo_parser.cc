@@ -50,6 +50,7 @@ limitations under the License.
 #include "xla/hlo/ir/hlo_domain_metadata.h"
 #include "xla/hlo/ir/hlo_input_output_alias_config.h"
 #include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_instruction_arena.h"
 #include "xla/hlo/ir/hlo_instructions.h"
 #include "xla/hlo/ir/hlo_opcode.h"
 #include "xla/hlo/ir/hlo_schedule.h"
@@ -368,7 +369,7 @@ class HloParserImpl : public HloParser {
       HloComputation::Builder* builder, absl::string_view name,
       std::optional<Shape> shape, HloOpcode opcode,
       std::optional<HloOpcode> async_wrapped_opcode,
-      absl::flat_hash_map<std::string, AttrConfig>& attrs,
+      absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
       bool allow_attributes,
       std::vector<HloInstruction*>* preset_operands = nullptr);
 
@@ -432,7 +433,7 @@ class HloParserImpl : public HloParser {
   //
   // Example usage:
   //
-  //  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  //  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
   //  optional<int64_t> foo;
   //  attrs["foo"] = {/*required=*/false, AttrTy::kInt64, &foo};
   //  optional<Window> bar;
@@ -444,28 +445,28 @@ class HloParserImpl : public HloParser {
   //  if (foo) { // If attr foo is seen, do something with 'foo'. }
   //
   bool ParseAttributes(
-      const absl::flat_hash_map<std::string, AttrConfig>& attrs,
+      const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
       bool allow_attributes = true);
 
   // sub_attributes ::= '{' (','? attribute)* '}'
   //
   // Usage is the same as ParseAttributes. See immediately above.
   bool ParseSubAttributes(
-      const absl::flat_hash_map<std::string, AttrConfig>& attrs);
+      const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs);
 
   // Parses one attribute. If it has already been seen, return error. Returns
   // true and adds to seen_attrs on success.
   //
   // Do not call this except in ParseAttributes or ParseSubAttributes.
   bool ParseAttributeHelper(
-      const absl::flat_hash_map<std::string, AttrConfig>& attrs,
-      absl::flat_hash_set<std::string>* seen_attrs);
+      const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
+      absl::flat_hash_set<absl::string_view>* seen_attrs);
 
   // Copy attributes from `attrs` to `message`, unless the attribute name is in
   // `non_proto_attrs`.
   bool CopyAttributeToProtoMessage(
-      absl::flat_hash_set<std::string> non_proto_attrs,
-      const absl::flat_hash_map<std::string, AttrConfig>& attrs,
+      absl::flat_hash_set<absl::string_view> non_proto_attrs,
+      const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
       tsl::protobuf::Message* message);
 
   // Parses an attribute string into a protocol buffer `message`.
@@ -474,7 +475,7 @@ class HloParserImpl : public HloParser {
   // `non_proto_attrs` specifies attributes that are not written to the proto,
   // but added to the HloInstruction.
   bool ParseAttributesAsProtoMessage(
-      const absl::flat_hash_map<std::string, AttrConfig>& non_proto_attrs,
+      const absl::flat_hash_map<absl::string_view, AttrConfig>& non_proto_attrs,
       tsl::protobuf::Message* message);
 
   // Parses a name and finds the corresponding hlo computation.
@@ -696,6 +697,7 @@ bool HloParserImpl::TokenError(absl::string_view msg) {
 }
 
 Status HloParserImpl::Run(HloModule* module) {
+  HloInstructionArena::Scope arena_scope(module->instruction_arena());
   lexer_.Lex();
   if ((lexer_.GetKind() == TokKind::kw_HloModule) ||
       (lexer_.GetKind() == TokKind::kw_ENTRY) ||
@@ -1052,7 +1054,7 @@ bool HloParserImpl::ParseHloModule(HloModule* module,
   std::optional<AliasingData> aliasing_data;
   std::optional<BufferDonor> buffer_donor_data;
   std::optional<bool> alias_passthrough_params;
-  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
   std::optional<ComputationLayout> entry_computation_layout;
   std::optional<FrontendAttributes> frontend_attributes;
   BoolList allow_spmd_sharding_propagation_to_parameters;
@@ -1245,7 +1247,7 @@ bool HloParserImpl::ParseComputation(HloComputation** entry_computation) {
             computation->root_instruction()->name(), ", ",
             ShapeUtil::HumanString(computation->root_instruction()->shape())));
   }
-  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
   optional<std::string> execution_thread = HloInstruction::kMainExecutionThread;
   attrs["execution_thread"] = {/*required=*/false, AttrTy::kString,
                                &execution_thread};
@@ -1349,7 +1351,7 @@ bool HloParserImpl::ParseInstructionRhs(HloComputation::Builder* builder,
 
   // Add optional attributes. These are added to any HloInstruction type if
   // present.
-  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
   optional<OpSharding> sharding;
   optional<FrontendAttributes> frontend_attributes;
   optional<StatisticsViz> statistics_viz;
@@ -1451,7 +1453,8 @@ HloInstruction* HloParserImpl::CreateInstruction(  // NOLINT
     HloComputation::Builder* builder, absl::string_view name,
     std::optional<Shape> shape, HloOpcode opcode,
     std::optional<HloOpcode> async_wrapped_opcode,
-    absl::flat_hash_map<std::string, AttrConfig>& attrs, bool allow_attributes,
+    absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
+    bool allow_attributes,
     std::vector<HloInstruction*>* preset_operands) {
   std::vector<HloInstruction*> operands;
   if (preset_operands) {
@@ -3790,7 +3793,7 @@ bool HloParserImpl::ParseReplicaGroupsOnly(
 // domain ::= '{' 'kind=' domain_kind ',' 'entry=' entry_sharding ','
 //            'exit=' exit_sharding '}'
 bool HloParserImpl::ParseDomain(DomainData* domain) {
-  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
   optional<std::string> kind;
   optional<OpSharding> entry_sharding;
   optional<OpSharding> exit_sharding;
@@ -4015,7 +4018,8 @@ bool HloParserImpl::SetValueInLiteralHelper(LocTy loc, ParsedElemT value,
   }
 
   // Check that the index is in range and assign into the literal
-  if (index >= ShapeUtil::ElementsIn(literal->shape())) {
+  absl::Span<LiteralNativeT> data = literal->data<LiteralNativeT>();
+  if (index >= static_cast<int64_t>(data.size())) {
     return Error(loc, StrCat("tries to set value ", StringifyValue(value),
                              " to a literal in shape ",
                              ShapeUtil::HumanString(literal->shape()),
@@ -4083,9 +4087,8 @@ bool HloParserImpl::SetValueInLiteralHelper(LocTy loc, ParsedElemT value,
       return false;
     }
   }
-  literal->data<LiteralNativeT>().at(index) =
-      LiteralNativeFromRealImag<LiteralNativeT>(literal_real_value,
-                                                literal_imag_value);
+  data[index] = LiteralNativeFromRealImag<LiteralNativeT>(literal_real_value,
+                                                         literal_imag_value);
   return true;
 }
 
@@ -4234,9 +4237,21 @@ bool HloParserImpl::ParseDenseLiteral(Literal* literal, const Shape& shape) {
   // implementation-defined behavior.
   const int rank = static_cast<int>(shape.rank());
 
-  // Create a literal with the given shape in default layout.
-  *literal = LiteralUtil::CreateFromDimensions(shape.element_type(),
-                                               shape.dimensions());
+  // The elements are listed in row-major order. If that is the order of the
+  // layout of `shape`, they are parsed straight into the storage of the
+  // literal; otherwise into a literal in the default layout, which is relaid
+  // out at the end.
+  const bool parse_in_place =
+      shape.is_static() && shape.has_layout() &&
+      LayoutUtil::IsMonotonicWithDim0Major(shape.layout()) &&
+      shape.layout().tiles().empty() &&
+      shape.layout().element_size_in_bits() == 0;
+  if (parse_in_place) {
+    *literal = Literal(shape);
+  } else {
+    *literal = LiteralUtil::CreateFromDimensions(shape.element_type(),
+                                                 shape.dimensions());
+  }
   int64_t nest_level = 0;
   int64_t linear_index = 0;
   // elems_seen_per_dim[i] is how many elements or sub-arrays we have seen for
@@ -4414,7 +4429,9 @@ bool HloParserImpl::ParseDenseLiteral(Literal* literal, const Shape& shape) {
     }  // end of switch
   } while (nest_level > 0);
 
-  *literal = literal->Relayout(shape.layout());
+  if (!parse_in_place) {
+    *literal = literal->Relayout(shape.layout());
+  }
   return true;
 }
 
@@ -4549,12 +4566,12 @@ bool HloParserImpl::ParseOperands(std::vector<HloInstruction*>* operands,
 
 // sub_attributes ::= '{' (','? attribute)* '}'
 bool HloParserImpl::ParseSubAttributes(
-    const absl::flat_hash_map<std::string, AttrConfig>& attrs) {
+    const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs) {
   LocTy loc = lexer_.GetLoc();
   if (!ParseToken(TokKind::kLbrace, "expects '{' to start sub attributes")) {
     return false;
   }
-  absl::flat_hash_set<std::string> seen_attrs;
+  absl::flat_hash_set<absl::string_view> seen_attrs;
   if (lexer_.GetKind() == TokKind::kRbrace) {
     // empty
   } else {
@@ -4578,10 +4595,10 @@ bool HloParserImpl::ParseSubAttributes(
 
 // attributes ::= (',' attribute)*
 bool HloParserImpl::ParseAttributes(
-    const absl::flat_hash_map<std::string, AttrConfig>& attrs,
+    const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
     bool allow_attributes) {
   LocTy loc = lexer_.GetLoc();
-  absl::flat_hash_set<std::string> seen_attrs;
+  absl::flat_hash_set<absl::string_view> seen_attrs;
   if (allow_attributes) {
     while (EatIfPresent(TokKind::kComma)) {
       if (!ParseAttributeHelper(attrs, &seen_attrs)) {
@@ -4602,17 +4619,14 @@ bool HloParserImpl::ParseAttributes(
 }
 
 bool HloParserImpl::ParseAttributeHelper(
-    const absl::flat_hash_map<std::string, AttrConfig>& attrs,
-    absl::flat_hash_set<std::string>* seen_attrs) {
+    const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
+    absl::flat_hash_set<absl::string_view>* seen_attrs) {
   LocTy loc = lexer_.GetLoc();
   std::string name;
   if (!ParseAttributeName(&name)) {
     return Error(loc, "error parsing attributes");
   }
   VLOG(3) << "Parsing attribute " << name;
-  if (!seen_attrs->insert(name).second) {
-    return Error(loc, StrFormat("attribute %s already exists", name));
-  }
   auto attr_it = attrs.find(name);
   if (attr_it == attrs.end()) {
     std::string allowed_attrs;
@@ -4622,14 +4636,18 @@ bool HloParserImpl::ParseAttributeHelper(
       allowed_attrs =
           StrCat("Allowed attributes: ",
                  StrJoin(attrs, ", ",
-                         [&](std::string* out,
-                             const std::pair<std::string, AttrConfig>& kv) {
+                         [&](std::string* out, const auto& kv) {
                            StrAppend(out, kv.first);
                          }));
     }
     return Error(
         loc, StrFormat("unexpected attribute \"%s\". %s", name, allowed_attrs));
   }
+  // The names of the attributes are views of the keys of `attrs`, which
+  // outlive the parsing of the attribute list.
+  if (!seen_attrs->insert(attr_it->first).second) {
+    return Error(loc, StrFormat("attribute %s already exists", name));
+  }
   AttrTy attr_type = attr_it->second.attr_type;
   void* attr_out_ptr = attr_it->second.result;
   bool success = [&] {
@@ -5023,19 +5041,19 @@ bool HloParserImpl::ParseAttributeHelper(
 }
 
 bool HloParserImpl::CopyAttributeToProtoMessage(
-    absl::flat_hash_set<std::string> non_proto_attrs,
-    const absl::flat_hash_map<std::string, AttrConfig>& attrs,
+    absl::flat_hash_set<absl::string_view> non_proto_attrs,
+    const absl::flat_hash_map<absl::string_view, AttrConfig>& attrs,
     tsl::protobuf::Message* message) {
   const tsl::protobuf::Descriptor* descriptor = message->GetDescriptor();
   const tsl::protobuf::Reflection* reflection = message->GetReflection();
 
   for (const auto& p : attrs) {
-    const std::string& name = p.first;
+    absl::string_view name = p.first;
     if (non_proto_attrs.find(name) != non_proto_attrs.end()) {
       continue;
     }
     const tsl::protobuf::FieldDescriptor* fd =
-        descriptor->FindFieldByName(name);
+        descriptor->FindFieldByName(std::string(name));
     if (!fd) {
       std::string allowed_attrs = "Allowed attributes: ";
 
@@ -5085,10 +5103,10 @@ bool HloParserImpl::CopyAttributeToProtoMessage(
 
 // attributes ::= (',' attribute)*
 bool HloParserImpl::ParseAttributesAsProtoMessage(
-    const absl::flat_hash_map<std::string, AttrConfig>& non_proto_attrs,
+    const absl::flat_hash_map<absl::string_view, AttrConfig>& non_proto_attrs,
     tsl::protobuf::Message* message) {
   const tsl::protobuf::Descriptor* descriptor = message->GetDescriptor();
-  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
 
   // Storage for attributes.
   std::vector<optional<bool>> bool_params;
@@ -5121,10 +5139,10 @@ bool HloParserImpl::ParseAttributesAsProtoMessage(
     }
   }
 
-  absl::flat_hash_set<std::string> non_proto_attrs_names;
+  absl::flat_hash_set<absl::string_view> non_proto_attrs_names;
   non_proto_attrs_names.reserve(non_proto_attrs.size());
   for (const auto& p : non_proto_attrs) {
-    const std::string& attr_name = p.first;
+    absl::string_view attr_name = p.first;
     // If an attribute is both specified within 'non_proto_attrs' and an
     // attribute of the proto message, we prefer the attribute of the proto
     // message.
@@ -6172,7 +6190,7 @@ bool HloParserImpl::ParsePaddingConfig(PaddingConfig* padding) {
 
 // '{' metadata_string '}'
 bool HloParserImpl::ParseMetadata(OpMetadata* metadata) {
-  absl::flat_hash_map<std::string, AttrConfig> attrs;
+  absl::flat_hash_map<absl::string_view, AttrConfig> attrs;
   optional<std::string> op_type;
   optional<std::string> op_name;
   optional<std::string> source_file;
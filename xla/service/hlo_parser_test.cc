@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "xla/service/hlo_parser.h"
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -42,6 +44,7 @@ limitations under the License.
 #include "tsl/platform/status_matchers.h"
 #include "tsl/platform/statusor.h"
 #include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
 
 namespace xla {
 namespace {
@@ -5306,5 +5309,87 @@ TEST_F(HloParserTest, ReplicaIdWithLayout) {
                    .empty());
 }
 
+TEST_F(HloParserTest, ParseNumbersInLiterals) {
+  const char* const hlo_string = R"(
+  HloModule Numbers
+
+  ENTRY Numbers {
+    f32 = f32[7] constant({1, -2.5, 1e3, -1.5E-2, 3., -0.25e+1, -inf})
+    u64 = u64[2] constant({18446744073709551615, 0})
+    s32 = s32[3] constant({-7, 0, 42})
+    column_major = f32[2,3]{0,1} constant({{1, 2, 3}, {4, 5, 6}})
+    ROOT tuple = (f32[7], u64[2], s32[3], f32[2,3]{0,1}) tuple(f32, u64, s32,
+      column_major)
+  }
+  )";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnUnverifiedModule(hlo_string));
+  const HloInstruction* root = module->entry_computation()->root_instruction();
+
+  const Literal& f32 = root->operand(0)->literal();
+  EXPECT_EQ(f32.Get<float>({0}), 1.0f);
+  EXPECT_EQ(f32.Get<float>({1}), -2.5f);
+  EXPECT_EQ(f32.Get<float>({2}), 1000.0f);
+  EXPECT_EQ(f32.Get<float>({3}), -0.015f);
+  EXPECT_EQ(f32.Get<float>({4}), 3.0f);
+  EXPECT_EQ(f32.Get<float>({5}), -2.5f);
+  EXPECT_EQ(f32.Get<float>({6}), -std::numeric_limits<float>::infinity());
+
+  const Literal& u64 = root->operand(1)->literal();
+  EXPECT_EQ(u64.Get<uint64_t>({0}), std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(u64.Get<uint64_t>({1}), 0);
+
+  const Literal& s32 = root->operand(2)->literal();
+  EXPECT_EQ(s32.Get<int32_t>({0}), -7);
+  EXPECT_EQ(s32.Get<int32_t>({2}), 42);
+
+  const Literal& column_major = root->operand(3)->literal();
+  EXPECT_EQ(column_major.shape().layout().minor_to_major(0), 0);
+  EXPECT_EQ(column_major.Get<float>({0, 2}), 3.0f);
+  EXPECT_EQ(column_major.Get<float>({1, 0}), 4.0f);
+}
+
+// Parses a synthetic module with `state.range(0)` computations of
+// `state.range(1)` instructions each, whose entry computation holds a constant
+// of `state.range(2)` elements. Reports the parsed bytes per second.
+void BM_ParseModule(::testing::benchmark::State& state) {
+  const int64_t num_computations = state.range(0);
+  const int64_t num_instructions = state.range(1);
+  const int64_t num_elements = state.range(2);
+
+  std::string hlo_string = "HloModule BM_ParseModule\n\n";
+  for (int64_t c = 0; c < num_computations; ++c) {
+    absl::StrAppend(&hlo_string, "computation.", c,
+                    " {\n  p.0 = f32[128,256]{1,0} parameter(0)\n");
+    std::string previous = "p.0";
+    for (int64_t i = 1; i < num_instructions; ++i) {
+      const std::string name = absl::StrCat("add.", i);
+      absl::StrAppend(&hlo_string, i + 1 == num_instructions ? "  ROOT " : "  ",
+                      name, " = f32[128,256]{1,0} add(f32[128,256]{1,0} ",
+                      previous, ", f32[128,256]{1,0} p.0), ",
+                      "metadata={op_name=\"add\"}\n");
+      previous = name;
+    }
+    absl::StrAppend(&hlo_string, "}\n\n");
+  }
+  absl::StrAppend(&hlo_string, "ENTRY main {\n  ROOT constant = f32[",
+                  num_elements, "] constant({");
+  for (int64_t e = 0; e < num_elements; ++e) {
+    absl::StrAppend(&hlo_string, e == 0 ? "" : ", ", e % 2 ? "-" : "",
+                    e * 0.125);
+  }
+  absl::StrAppend(&hlo_string, "})\n}\n");
+
+  for (auto s : state) {
+    ParseAndReturnUnverifiedModule(hlo_string).value();
+  }
+  state.SetBytesProcessed(state.iterations() * hlo_string.size());
+}
+
+BENCHMARK(BM_ParseModule)
+    ->Args({1, 16, 1 << 20})
+    ->Args({256, 64, 16})
+    ->Args({64, 256, 1 << 16});
+
 }  // namespace
 }  // namespace xla
@@ -0,0 +1,190 @@
+/* Copyright 2024 The OpenXLA Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/service/hlo_pass_interface.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_computation.h"
+#include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/hlo/ir/hlo_instruction_arena.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/threadpool.h"
+
+namespace xla {
+namespace {
+
+// Returns the largest mutation generation of `computation` and of the
+// computations it calls, directly or transitively. Memoized in `generations`.
+int64_t TransitiveMutationGeneration(
+    const HloComputation* computation,
+    absl::flat_hash_map<const HloComputation*, int64_t>& generations) {
+  auto it = generations.find(computation);
+  if (it != generations.end()) {
+    return it->second;
+  }
+  int64_t generation = computation->mutation_generation();
+  for (const HloInstruction* instruction : computation->instructions()) {
+    for (const HloComputation* callee : instruction->called_computations()) {
+      generation = std::max(generation,
+                            TransitiveMutationGeneration(callee, generations));
+    }
+  }
+  generations[computation] = generation;
+  return generation;
+}
+
+// Returns the length of the longest chain of calls starting at `computation`.
+// Memoized in `depths`.
+int64_t CallDepth(const HloComputation* computation,
+                  absl::flat_hash_map<const HloComputation*, int64_t>& depths) {
+  auto it = depths.find(computation);
+  if (it != depths.end()) {
+    return it->second;
+  }
+  int64_t depth = 0;
+  for (const HloInstruction* instruction : computation->instructions()) {
+    for (const HloComputation* callee : instruction->called_computations()) {
+      depth = std::max(depth, CallDepth(callee, depths) + 1);
+    }
+  }
+  depths[computation] = depth;
+  return depth;
+}
+
+}  // namespace
+
+absl::StatusOr<bool> HloComputationPass::Run(
+    HloModule* module,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  std::vector<HloComputation*> computations =
+      ComputationsToRun(module, execution_threads);
+  // Running on the threads of the pool from one of them could deadlock.
+  if (IsComputationLocal() && thread_pool_ != nullptr &&
+      thread_pool_->NumThreads() > 1 && thread_pool_->CurrentThreadId() == -1 &&
+      computations.size() > 1) {
+    return RunInParallel(module, computations);
+  }
+
+  bool changed = false;
+  absl::flat_hash_map<const HloComputation*, int64_t> generations;
+  for (HloComputation* computation : computations) {
+    auto it = clean_generations_.find(computation);
+    if (it != clean_generations_.end() &&
+        it->second == TransitiveMutationGeneration(computation, generations)) {
+      ++computation_counts_.skipped;
+      continue;
+    }
+    ++computation_counts_.processed;
+    TF_ASSIGN_OR_RETURN(bool computation_changed,
+                        RunOnComputation(computation));
+    if (computation_changed) {
+      changed = true;
+      clean_generations_.erase(computation);
+      // The generations of the computation and of the computations calling
+      // it went up.
+      generations.clear();
+    } else {
+      // If running the pass on a later computation mutates this one, its
+      // generation moves past the recorded one and it is not skipped.
+      clean_generations_[computation] =
+          TransitiveMutationGeneration(computation, generations);
+    }
+  }
+  VLOG(2) << name() << ": ran on " << computation_counts_.processed
+          << " computations and skipped " << computation_counts_.skipped
+          << " unchanged ones so far";
+  return changed;
+}
+
+absl::StatusOr<bool> HloComputationPass::RunInParallel(
+    HloModule* module, absl::Span<HloComputation* const> computations) {
+  // The pass runs on the computations in waves, by increasing call depth, so
+  // that a computation only runs once the computations it calls are done.
+  // Every computation thus sees the same callees as when the pass runs
+  // sequentially in post order.
+  absl::flat_hash_map<const HloComputation*, int64_t> depths;
+  std::vector<std::vector<HloComputation*>> waves;
+  for (HloComputation* computation : computations) {
+    int64_t depth = CallDepth(computation, depths);
+    if (waves.size() <= depth) {
+      waves.resize(depth + 1);
+    }
+    waves[depth].push_back(computation);
+  }
+
+  bool changed = false;
+  for (const std::vector<HloComputation*>& wave : waves) {
+    absl::flat_hash_map<const HloComputation*, int64_t> generations;
+    std::vector<HloComputation*> to_run;
+    for (HloComputation* computation : wave) {
+      auto it = clean_generations_.find(computation);
+      if (it != clean_generations_.end() &&
+          it->second ==
+              TransitiveMutationGeneration(computation, generations)) {
+        ++computation_counts_.skipped;
+      } else {
+        to_run.push_back(computation);
+      }
+    }
+    if (to_run.empty()) {
+      continue;
+    }
+    computation_counts_.processed += to_run.size();
+
+    std::vector<absl::StatusOr<bool>> results(to_run.size(), false);
+    module->DeferUniqueIdentifiers(to_run);
+    HloInstructionArena* arena = HloInstructionArena::current();
+    tsl::BlockingCounter counter(to_run.size());
+    for (int64_t i = 0; i < to_run.size(); ++i) {
+      thread_pool_->Schedule([&, i] {
+        HloInstructionArena::Scope arena_scope(arena);
+        results[i] = RunOnComputation(to_run[i]);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    module->AssignDeferredUniqueIdentifiers(to_run);
+
+    generations.clear();
+    for (int64_t i = 0; i < to_run.size(); ++i) {
+      TF_ASSIGN_OR_RETURN(bool computation_changed, std::move(results[i]));
+      if (computation_changed) {
+        changed = true;
+        clean_generations_.erase(to_run[i]);
+      } else {
+        clean_generations_[to_run[i]] =
+            TransitiveMutationGeneration(to_run[i], generations);
+      }
+    }
+  }
+  VLOG(2) << name() << ": ran on " << computation_counts_.processed
+          << " computations and skipped " << computation_counts_.skipped
+          << " unchanged ones so far, in parallel";
+  return changed;
+}
+
+}  // namespace xla
@@ -16,16 +16,24 @@ limitations under the License.
 #ifndef XLA_SERVICE_HLO_PASS_INTERFACE_H_
 #define XLA_SERVICE_HLO_PASS_INTERFACE_H_
 
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "xla/hlo/ir/hlo_module.h"
 #include "xla/hlo/ir/hlo_module_group.h"
 #include "xla/status_macros.h"
 #include "xla/statusor.h"
 #include "xla/types.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 
+class CompilationStats;
+
 // Base class for HLO passes. These are used with the HloPassPipeline to
 // organize a sequence of passes. An HLO pass should not extend this class
 // directly; it should extend HloModulePass or HloModuleGroupPass.
@@ -140,6 +148,28 @@ class HloPassInterface {
       const absl::flat_hash_set<absl::string_view>& execution_threads) = 0;
 
   virtual bool IsPassPipeline() { return false; }
+
+  // The number of computations a pass ran on, and the number it skipped
+  // because they were not mutated since it last ran on them without changing
+  // them.
+  struct ComputationCounts {
+    int64_t processed = 0;
+    int64_t skipped = 0;
+  };
+
+  // Returns the computation counts of all the runs of the pass so far. Only
+  // passes which skip unchanged computations (see HloComputationPass) count
+  // them.
+  virtual ComputationCounts computation_counts() const { return {}; }
+
+  // Sets the thread pool on which the pass may run on different computations
+  // concurrently (see HloComputationPass::IsComputationLocal). Passes run
+  // sequentially without one.
+  virtual void set_thread_pool(tsl::thread::ThreadPool* thread_pool) {}
+
+  // Sets the stats of the compilation the pass runs in, to which the pass may
+  // report its own stats, e.g. the compile time it saved.
+  virtual void set_compilation_stats(CompilationStats* compilation_stats) {}
 };
 
 // Base class for passes which are module-scoped.
@@ -168,6 +198,71 @@ class HloModulePass : public HloPassInterface {
   virtual void UpdateLayout(Shape* shape) {}
 };
 
+// Base class for passes which run on every computation of a module on its own,
+// and whose result on a computation only depends on the computation and on the
+// computations it calls.
+//
+// Running such a pass again on a computation that it did not change, and that
+// was not mutated since, cannot change it, so the pass skips the computation.
+// This makes reruns cheap, e.g. the iterations of HloPassFix after the first
+// one, or later iterations of a fixed-point pipeline, which only process the
+// computations that were mutated since the pass last ran on them. Mutations
+// are tracked with HloComputation::mutation_generation.
+//
+// Computation-local passes run on the computations of a module concurrently
+// when they are given a thread pool.
+class HloComputationPass : public HloModulePass {
+ public:
+  // Runs the pass on `computation`. Returns whether it changed the
+  // computation.
+  virtual absl::StatusOr<bool> RunOnComputation(
+      HloComputation* computation) = 0;
+
+  using HloPassInterface::Run;
+  absl::StatusOr<bool> Run(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+
+  ComputationCounts computation_counts() const override {
+    return computation_counts_;
+  }
+
+  // Returns whether the pass is computation-local: running it on a computation
+  // only mutates that computation, only reads it and the computations it
+  // calls, and neither adds nor removes computations. RunOnComputation must
+  // then be safe to call concurrently on different computations.
+  //
+  // With a thread pool, such a pass runs on the computations which do not
+  // call each other concurrently. The instructions it adds are named and
+  // numbered afterwards, in the order of the computations, so the result does
+  // not depend on the thread pool.
+  virtual bool IsComputationLocal() const { return false; }
+
+  void set_thread_pool(tsl::thread::ThreadPool* thread_pool) override {
+    thread_pool_ = thread_pool;
+  }
+
+ protected:
+  // Returns the computations of `module` with the given `execution_threads`
+  // that the pass runs on, in order. By default, these are the non-fusion
+  // computations.
+  virtual std::vector<HloComputation*> ComputationsToRun(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) {
+    return module->MakeNonfusionComputations(execution_threads);
+  }
+
+ private:
+  absl::StatusOr<bool> RunInParallel(
+      HloModule* module, absl::Span<HloComputation* const> computations);
+
+  // For the computations the pass ran on last without changing them, their
+  // transitive mutation generation after that run.
+  absl::flat_hash_map<const HloComputation*, int64_t> clean_generations_;
+  ComputationCounts computation_counts_;
+  tsl::thread::ThreadPool* thread_pool_ = nullptr;
+};
+
 // Base class for passes which are module-group scoped. These passes cannot run
 // on an HLO module.
 class HloModuleGroupPass : public HloPassInterface {
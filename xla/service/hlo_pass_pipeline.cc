@@ -15,14 +15,24 @@ limitations under the License.
 
 #include "xla/service/hlo_pass_pipeline.h"
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/span.h"
+#include "xla/hlo/ir/hlo_instruction_arena.h"
 #include "xla/service/dump.h"
+#include "xla/service/hlo_dataflow_analysis.h"
 #include "xla/service/hlo_graph_dumper.h"
 #include "xla/service/hlo_proto_util.h"
 #include "xla/status_macros.h"
@@ -32,6 +42,8 @@ limitations under the License.
 #include "tsl/platform/logging.h"
 #include "tsl/platform/status.h"
 #include "tsl/profiler/lib/scoped_annotation.h"
+#include "tsl/profiler/lib/traceme.h"
+#include "tsl/profiler/lib/traceme_encode.h"
 
 namespace xla {
 
@@ -99,6 +111,106 @@ void RecordPassEndMetadata(HloModuleGroup& module_group,
   }
 }
 
+// Returns the peak resident memory of the process in bytes, or 0 where it is
+// not known.
+int64_t PeakMemoryBytes() {
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  // Linux reports kilobytes.
+  return int64_t{usage.ru_maxrss} * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+HloInstructionArena* InstructionArena(const HloModule& module) {
+  return module.instruction_arena();
+}
+
+// The modules of a group allocate from arenas of their own, if any, so module
+// group passes allocate from the heap.
+HloInstructionArena* InstructionArena(const HloModuleGroup& module_group) {
+  return nullptr;
+}
+
+std::vector<int64_t> InstructionCounts(const HloModule& module) {
+  return {module.instruction_count()};
+}
+
+std::vector<int64_t> InstructionCounts(const HloModuleGroup& module_group) {
+  std::vector<int64_t> counts;
+  for (const HloModule* module : module_group.modules()) {
+    counts.push_back(module->instruction_count());
+  }
+  return counts;
+}
+
+// Records the instruction counts of the module before and after the current
+// pass, and the peak memory of the process, in the pass metadata.
+void RecordPassSizes(HloModule& module,
+                     absl::Span<const int64_t> instruction_counts_before,
+                     absl::Span<const int64_t> instruction_counts_after,
+                     int64_t peak_memory_bytes_before,
+                     int64_t peak_memory_bytes_after) {
+  TF_CHECK_OK(module.metadata()->set_current_pass_instruction_counts(
+      instruction_counts_before[0], instruction_counts_after[0]));
+  TF_CHECK_OK(module.metadata()->set_current_pass_peak_memory_bytes(
+      peak_memory_bytes_before, peak_memory_bytes_after));
+}
+
+void RecordPassSizes(HloModuleGroup& module_group,
+                     absl::Span<const int64_t> instruction_counts_before,
+                     absl::Span<const int64_t> instruction_counts_after,
+                     int64_t peak_memory_bytes_before,
+                     int64_t peak_memory_bytes_after) {
+  const std::vector<HloModule*>& modules = module_group.modules();
+  // Module group passes may add or remove modules.
+  if (instruction_counts_before.size() != modules.size() ||
+      instruction_counts_after.size() != modules.size()) {
+    return;
+  }
+  for (int64_t i = 0; i < modules.size(); ++i) {
+    RecordPassSizes(*modules[i], instruction_counts_before.subspan(i, 1),
+                    instruction_counts_after.subspan(i, 1),
+                    peak_memory_bytes_before, peak_memory_bytes_after);
+  }
+}
+
+// Records the time the current pass spent in dataflow analysis in the pass
+// metadata.
+void RecordPassDataflowAnalysisTime(HloModule& module, int64_t usec) {
+  TF_CHECK_OK(
+      module.metadata()->set_current_pass_dataflow_analysis_usec(usec));
+}
+
+void RecordPassDataflowAnalysisTime(HloModuleGroup& module_group,
+                                    int64_t usec) {
+  for (HloModule* module : module_group.modules()) {
+    RecordPassDataflowAnalysisTime(*module, usec);
+  }
+}
+
+void RecordPassComputationCounts(
+    HloModule& module, const HloPassInterface::ComputationCounts& counts) {
+  TF_CHECK_OK(module.metadata()->set_current_pass_computation_counts(
+      counts.processed, counts.skipped));
+}
+
+void RecordPassComputationCounts(
+    HloModuleGroup& module_group,
+    const HloPassInterface::ComputationCounts& counts) {
+  for (HloModule* module : module_group.modules()) {
+    RecordPassComputationCounts(*module, counts);
+  }
+}
+
 }  // namespace
 
 template <typename HloT>
@@ -173,12 +285,32 @@ absl::StatusOr<bool> HloPassPipeline::RunPassesInternal(
       return absl::StrFormat("XlaPass:#name=%s,module=%s,program_id=%s#",
                              pass_name, hlo->name(), UniqueId(*hlo));
     }};
+    tsl::profiler::TraceMe trace_me(
+        [&] {
+          return tsl::profiler::TraceMeEncode("HloPass",
+                                              {{"name", pass_name},
+                                               {"pipeline", pipeline_name},
+                                               {"module", hlo->name()}});
+        },
+        tsl::profiler::TraceMeLevel::kInfo);
     VLOG(1) << "  HLO pass " << pass_name;
     VLOG(2) << "  Module hash " << absl::HashOf(*hlo);
     if (!pass->IsPassPipeline()) {
       compilation_stats_->StartPass(pass_name);
     }
     RecordPassStartMetadata(*hlo, pass_name, pipeline_name);
+    const std::vector<int64_t> instruction_counts_before =
+        InstructionCounts(*hlo);
+    const int64_t peak_memory_bytes_before = PeakMemoryBytes();
+    const int64_t dataflow_analysis_usec_before =
+        HloDataflowAnalysis::ThreadAnalysisTimeUsec();
+    if (thread_pool_ != nullptr) {
+      pass->set_thread_pool(thread_pool_);
+    }
+    pass->set_compilation_stats(compilation_stats_);
+    const HloPassInterface::ComputationCounts counts_before =
+        pass->computation_counts();
+    HloInstructionArena::Scope arena_scope(InstructionArena(*hlo));
     auto status_or_changed = RunHelper(pass, hlo, execution_threads);
     if (auto status = status_or_changed.status(); !status.ok()) {
       compilation_stats_->RecordPassError(
@@ -192,6 +324,34 @@ absl::StatusOr<bool> HloPassPipeline::RunPassesInternal(
                                        ? kPipelineEnd
                                        : passes[i + 1]->name());
     }
+    const HloPassInterface::ComputationCounts counts_after =
+        pass->computation_counts();
+    const HloPassInterface::ComputationCounts counts{
+        counts_after.processed - counts_before.processed,
+        counts_after.skipped - counts_before.skipped};
+    if (counts.processed != 0 || counts.skipped != 0) {
+      VLOG(1) << "  HLO pass " << pass_name << " ran on " << counts.processed
+              << " computations and skipped " << counts.skipped
+              << " unchanged ones";
+      RecordPassComputationCounts(*hlo, counts);
+    }
+    const std::vector<int64_t> instruction_counts_after =
+        pass_changed ? InstructionCounts(*hlo) : instruction_counts_before;
+    const int64_t peak_memory_bytes_after = PeakMemoryBytes();
+    RecordPassSizes(*hlo, instruction_counts_before, instruction_counts_after,
+                    peak_memory_bytes_before, peak_memory_bytes_after);
+    RecordPassDataflowAnalysisTime(
+        *hlo, HloDataflowAnalysis::ThreadAnalysisTimeUsec() -
+                  dataflow_analysis_usec_before);
+    trace_me.AppendMetadata([&] {
+      return tsl::profiler::TraceMeEncode(
+          {{"changed", pass_changed ? "true" : "false"},
+           {"instructions_before",
+            absl::c_accumulate(instruction_counts_before, int64_t{0})},
+           {"instructions_after",
+            absl::c_accumulate(instruction_counts_after, int64_t{0})},
+           {"peak_memory_bytes", peak_memory_bytes_after}});
+    });
     RecordPassEndMetadata(*hlo, pass_name, pass_changed);
     changed |= pass_changed;
     if (pass_changed) {
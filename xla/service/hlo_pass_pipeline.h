@@ -27,6 +27,7 @@ limitations under the License.
 #include "xla/service/hlo_pass_interface.h"
 #include "xla/statusor.h"
 #include "xla/types.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 
@@ -89,6 +90,20 @@ class HloPassPipeline : public HloPassInterface {
 
   bool IsPassPipeline() override { return true; }
 
+  // Sets the thread pool of the passes of the pipeline, including nested
+  // pipelines, when they run.
+  void set_thread_pool(tsl::thread::ThreadPool* thread_pool) override {
+    thread_pool_ = thread_pool;
+  }
+
+  // Makes a nested pipeline that has no stats of its own record its passes in
+  // the stats of the enclosing pipeline.
+  void set_compilation_stats(CompilationStats* compilation_stats) override {
+    if (empty_compilation_stats_ != nullptr) {
+      compilation_stats_ = compilation_stats;
+    }
+  }
+
   // Return size of passes_.
   int PassesSize() { return passes_.size(); }
   // Return reference to pass specified by index.
@@ -154,6 +169,7 @@ class HloPassPipeline : public HloPassInterface {
   std::vector<std::unique_ptr<HloPassInterface>> passes_;
   std::vector<std::unique_ptr<HloPassInterface>> invariant_checkers_;
   bool run_called_ = false;
+  tsl::thread::ThreadPool* thread_pool_ = nullptr;
 
   CompilationStats* compilation_stats_;
   // Default stats instance for when one is not passed in the constructor.
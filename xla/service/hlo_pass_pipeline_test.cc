@@ -15,13 +15,23 @@ limitations under the License.
 
 #include "xla/service/hlo_pass_pipeline.h"
 
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
 #include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/ir/hlo_opcode.h"
 #include "xla/service/hlo_parser.h"
+#include "xla/service/hlo_pass_fix.h"
 #include "xla/tests/hlo_test_base.h"
 #include "xla/util.h"
 #include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/threadpool.h"
 
 namespace xla {
 namespace {
@@ -134,6 +144,39 @@ class BarBlowerUpper : public HloModulePass {
   }
 };
 
+// A computation pass which removes one negate instruction per run.
+class RemoveOneNegatePass : public HloComputationPass {
+ public:
+  absl::string_view name() const override { return "remove-one-negate"; }
+
+  absl::StatusOr<bool> RunOnComputation(HloComputation* computation) override {
+    for (HloInstruction* instruction : computation->instructions()) {
+      if (instruction->opcode() == HloOpcode::kNegate) {
+        TF_RETURN_IF_ERROR(computation->ReplaceInstruction(
+            instruction, instruction->mutable_operand(0)));
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+// A computation-local pass which negates the root of every computation.
+class NegateRootPass : public HloComputationPass {
+ public:
+  absl::string_view name() const override { return "negate-root"; }
+
+  bool IsComputationLocal() const override { return true; }
+
+  absl::StatusOr<bool> RunOnComputation(HloComputation* computation) override {
+    HloInstruction* root = computation->root_instruction();
+    computation->set_root_instruction(
+        computation->AddInstruction(HloInstruction::CreateUnary(
+            root->shape(), HloOpcode::kNegate, root)));
+    return true;
+  }
+};
+
 TEST_F(HloPassPipelineTest, ModulePassChanged) {
   // Test an HLO module pass which changes a module.
   const std::string module_str = R"(
@@ -401,5 +444,156 @@ TEST_F(HloPassPipelineTest, SetHloModuleMetadata) {
   }
 }
 
+TEST_F(HloPassPipelineTest, RecordsPassSizes) {
+  const std::string module_str = R"(
+HloModule RecordsPassSizes
+
+ENTRY main {
+  p0 = f32[] parameter(0)
+  negate0 = f32[] negate(p0)
+  ROOT negate1 = f32[] negate(negate0)
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(module_str));
+  HloPassPipeline pipeline(TestName());
+  pipeline.AddPass<RemoveOneNegatePass>();
+  pipeline.AddPass<NegateRootPass>();
+  pipeline.AddPass<FooToBarModulePass>();
+  TF_ASSERT_OK(pipeline.Run(module.get()).status());
+
+  const HloModuleMetadataProto& metadata = module->metadata()->proto();
+  ASSERT_THAT(metadata.pass_metadata(), SizeIs(4));
+  std::vector<std::pair<int64_t, int64_t>> instruction_counts;
+  for (const HloPassMetadata& pass_metadata : metadata.pass_metadata()) {
+    instruction_counts.emplace_back(pass_metadata.instruction_count_before(),
+                                    pass_metadata.instruction_count_after());
+    EXPECT_LE(pass_metadata.peak_memory_bytes_before(),
+              pass_metadata.peak_memory_bytes_after());
+  }
+  EXPECT_THAT(instruction_counts,
+              ElementsAre(std::pair(0, 0), std::pair(3, 2), std::pair(2, 3),
+                          std::pair(3, 3)));
+}
+
+// Test that a computation pass which is run to a fixed point skips the
+// computations it did not change.
+TEST_F(HloPassPipelineTest, ComputationPassSkipsUnchangedComputations) {
+  const std::string module_str = R"(
+HloModule ComputationPassSkipsUnchangedComputations
+
+callee {
+  ROOT p0 = f32[] parameter(0)
+}
+
+ENTRY main {
+  p0 = f32[] parameter(0)
+  call = f32[] call(p0), to_apply=callee
+  negate0 = f32[] negate(call)
+  ROOT negate1 = f32[] negate(negate0)
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(module_str));
+  HloPassPipeline pipeline(TestName());
+  pipeline.AddPass<HloPassFix<RemoveOneNegatePass>>();
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, pipeline.Run(module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(module->entry_computation()->root_instruction()->opcode(),
+            HloOpcode::kCall);
+
+  // The entry computation is run on until it stops changing, the callee only
+  // once.
+  const HloModuleMetadataProto& metadata = module->metadata()->proto();
+  ASSERT_THAT(metadata.pass_metadata(), SizeIs(2));
+  const HloPassMetadata& pass_metadata = metadata.pass_metadata(1);
+  EXPECT_THAT(pass_metadata.pass_name(), StrEq("remove-one-negate"));
+  EXPECT_EQ(pass_metadata.computations_processed(), 4);
+  EXPECT_EQ(pass_metadata.computations_skipped(), 2);
+}
+
+// Test that mutating a computation called by a skipped computation makes the
+// pass run on the caller again.
+TEST_F(HloPassPipelineTest, ComputationPassRerunsCallersOfMutatedCallees) {
+  const std::string module_str = R"(
+HloModule ComputationPassRerunsCallersOfMutatedCallees
+
+callee {
+  ROOT p0 = f32[] parameter(0)
+}
+
+ENTRY main {
+  p0 = f32[] parameter(0)
+  ROOT call = f32[] call(p0), to_apply=callee
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(module_str));
+  RemoveOneNegatePass pass;
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunHloPass(&pass, module.get()));
+  EXPECT_FALSE(changed);
+  EXPECT_EQ(pass.computation_counts().processed, 2);
+  TF_ASSERT_OK_AND_ASSIGN(changed, RunHloPass(&pass, module.get()));
+  EXPECT_FALSE(changed);
+  EXPECT_EQ(pass.computation_counts().processed, 2);
+  EXPECT_EQ(pass.computation_counts().skipped, 2);
+
+  HloComputation* callee = FindComputation(module.get(), "callee");
+  HloInstruction* root = callee->root_instruction();
+  callee->set_root_instruction(callee->AddInstruction(
+      HloInstruction::CreateUnary(root->shape(), HloOpcode::kNegate, root)));
+  TF_ASSERT_OK_AND_ASSIGN(changed, RunHloPass(&pass, module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(pass.computation_counts().processed, 4);
+  EXPECT_EQ(pass.computation_counts().skipped, 2);
+}
+
+// Test that running a computation-local pass in parallel gives the same module
+// as running it sequentially.
+TEST_F(HloPassPipelineTest, ComputationLocalPassRunsInParallel) {
+  std::string module_str = "HloModule ComputationLocalPassRunsInParallel\n";
+  std::string entry =
+      "ENTRY main {\n  p0 = f32[] parameter(0)\n  c0 = f32[] call(p0), "
+      "to_apply=callee0\n";
+  for (int i = 0; i < 16; ++i) {
+    absl::StrAppend(&module_str, "callee", i,
+                    " {\n  p0 = f32[] parameter(0)\n  ROOT add = f32[] "
+                    "add(p0, p0)\n}\n");
+    if (i > 0) {
+      absl::StrAppend(&entry, "  c", i, " = f32[] call(c", i - 1,
+                      "), to_apply=callee", i, "\n");
+    }
+  }
+  absl::StrAppend(&module_str, entry, "  ROOT r = f32[] negate(c15)\n}\n");
+
+  TF_ASSERT_OK_AND_ASSIGN(auto sequential,
+                          ParseAndReturnVerifiedModule(module_str));
+  NegateRootPass pass;
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunHloPass(&pass, sequential.get()));
+  EXPECT_TRUE(changed);
+
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test", 4);
+  for (int run = 0; run < 8; ++run) {
+    TF_ASSERT_OK_AND_ASSIGN(auto parallel,
+                            ParseAndReturnVerifiedModule(module_str));
+    HloPassPipeline pipeline(TestName());
+    pipeline.AddPass<NegateRootPass>();
+    pipeline.set_thread_pool(&thread_pool);
+    TF_ASSERT_OK_AND_ASSIGN(changed, pipeline.Run(parallel.get()));
+    EXPECT_TRUE(changed);
+    TF_EXPECT_OK(
+        parallel->CheckUniqueNamesAndIdsForComputationsAndInstructions());
+    EXPECT_EQ(parallel->ToString(), sequential->ToString());
+    for (const HloComputation* computation : parallel->computations()) {
+      for (const HloInstruction* instruction : computation->instructions()) {
+        EXPECT_EQ(
+            instruction->unique_id(),
+            FindInstruction(sequential.get(), instruction->name())->unique_id())
+            << instruction->name();
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace xla
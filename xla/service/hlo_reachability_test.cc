@@ -17,14 +17,19 @@ limitations under the License.
 
 #include <memory>
 #include <set>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
 #include "xla/hlo/ir/hlo_instruction.h"
 #include "xla/service/computation_placer.h"
 #include "xla/test.h"
 #include "xla/test_helpers.h"
 #include "xla/tests/hlo_test_base.h"
+#include "tsl/lib/core/status_test_util.h"
 #include "tsl/platform/test_benchmark.h"
 
 namespace xla {
@@ -244,6 +249,70 @@ TEST_F(HloReachabilityTest, ReplaceInstructions) {
   EXPECT_TRUE(reachability->IsReachable(p0, fusion));
 }
 
+// Expects `reachability` to agree with a map built from scratch.
+void ExpectSameAsRebuilt(const HloReachabilityMap& reachability,
+                         const HloComputation* computation) {
+  auto rebuilt = HloReachabilityMap::Build(computation);
+  for (const HloInstruction* a : computation->instructions()) {
+    for (const HloInstruction* b : computation->instructions()) {
+      EXPECT_EQ(reachability.IsReachable(a, b), rebuilt->IsReachable(a, b))
+          << a->name() << " -> " << b->name();
+    }
+  }
+}
+
+TEST_F(HloReachabilityTest, UpdateAfterGraphChanges) {
+  auto module = ParseAndReturnVerifiedModule(R"(
+    HloModule test
+
+    ENTRY entry {
+      p0 = f32[] parameter(0)
+      p1 = f32[] parameter(1)
+      a = f32[] negate(p0)
+      b = f32[] negate(p1)
+      c = f32[] exponential(b)
+      ROOT add = f32[] add(a, c)
+    })")
+                    .value();
+  HloComputation* computation = module->entry_computation();
+  auto reachability = HloReachabilityMap::Build(computation);
+  HloInstruction* p0 = computation->parameter_instruction(0);
+  HloInstruction* a = computation->GetInstructionWithName("a");
+  HloInstruction* b = computation->GetInstructionWithName("b");
+  HloInstruction* c = computation->GetInstructionWithName("c");
+  HloInstruction* add = computation->root_instruction();
+  EXPECT_FALSE(reachability->IsReachable(a, c));
+
+  // Adding an edge makes everything reaching its source reach everything
+  // reachable from its destination.
+  TF_ASSERT_OK(a->AddControlDependencyTo(b));
+  reachability->AddEdge(a, b);
+  EXPECT_TRUE(reachability->IsReachable(p0, c));
+  EXPECT_FALSE(reachability->IsReachable(c, a));
+  ExpectSameAsRebuilt(*reachability, computation);
+
+  // Removing the edge again updates the instructions reachable from it.
+  TF_ASSERT_OK(a->RemoveControlDependencyTo(b));
+  reachability->UpdateReachabilityThroughInstruction(b);
+  EXPECT_FALSE(reachability->IsReachable(p0, c));
+  ExpectSameAsRebuilt(*reachability, computation);
+
+  // Added instructions grow the map.
+  HloInstruction* prev = c;
+  for (int i = 0; i < 100; ++i) {
+    HloInstruction* negate = computation->AddInstruction(
+        HloInstruction::CreateUnary(c->shape(), HloOpcode::kNegate, prev));
+    reachability->AddInstruction(negate);
+    reachability->FastSetReachabilityToUnion({prev}, negate);
+    prev = negate;
+  }
+  TF_ASSERT_OK(add->ReplaceOperandWith(1, prev));
+  reachability->AddEdge(prev, add);
+  EXPECT_TRUE(reachability->IsReachable(b, prev));
+  EXPECT_FALSE(reachability->IsReachable(a, prev));
+  ExpectSameAsRebuilt(*reachability, computation);
+}
+
 }  // namespace
 
 class HloReachabilityMapBitSetBenchmark {
@@ -314,6 +383,110 @@ void BM_HloReachabilityBuild(benchmark::State& state) {
 }
 BENCHMARK(BM_HloReachabilityBuild)->BM_ARGS;
 
+// A wide computation of `depth` layers of `width` elementwise instructions,
+// each reading two neighbouring instructions of the layer before it. A fusion
+// workload adds control dependencies between neighbouring instructions of a
+// layer, which are the edges multi-output fusion of siblings adds to the graph,
+// and keeps the reachability map up to date after each of them.
+class HloReachabilityFusionBenchmark {
+ public:
+  static constexpr int kNumEdges = 64;
+
+  HloReachabilityFusionBenchmark(int width, int depth, std::string_view name) {
+    Shape r0f32 = ShapeUtil::MakeShape(F32, {});
+    auto builder = HloComputation::Builder(name);
+    std::vector<HloInstruction*> layer;
+    for (int i = 0; i < width; ++i) {
+      layer.push_back(builder.AddInstruction(HloInstruction::CreateParameter(
+          i, r0f32, absl::StrCat("p", i))));
+    }
+    std::vector<std::vector<HloInstruction*>> layers;
+    for (int d = 1; d < depth; ++d) {
+      std::vector<HloInstruction*> next_layer;
+      for (int i = 0; i < width; ++i) {
+        next_layer.push_back(
+            builder.AddInstruction(HloInstruction::CreateBinary(
+                r0f32, HloOpcode::kAdd, layer[i], layer[(i + 1) % width])));
+      }
+      layers.push_back(layer = std::move(next_layer));
+    }
+    HloInstruction* root =
+        builder.AddInstruction(HloInstruction::CreateTuple(layer));
+
+    for (int e = 0; e < kNumEdges; ++e) {
+      const std::vector<HloInstruction*>& edge_layer =
+          layers[e % layers.size()];
+      int i = (e * 7) % (width - 1);
+      edges_.emplace_back(edge_layer[i], edge_layer[i + 1]);
+    }
+
+    module_ = std::make_unique<HloModule>(std::string(name), HloModuleConfig());
+    computation_ = module_->AddEntryComputation(builder.Build(root));
+  }
+
+  // Removes the edges added by the workloads.
+  void Reset() {
+    for (auto& [from, to] : edges_) {
+      CHECK_OK(from->DropAllControlDeps());
+    }
+  }
+
+  std::unique_ptr<HloReachabilityMap> Build() {
+    return HloReachabilityMap::Build(computation_);
+  }
+
+  // Adds the edges, rebuilding the reachability map after each of them.
+  std::unique_ptr<HloReachabilityMap> RebuildAfterEachEdge() {
+    std::unique_ptr<HloReachabilityMap> reachability;
+    for (auto& [from, to] : edges_) {
+      CHECK_OK(from->AddControlDependencyTo(to));
+      reachability = Build();
+    }
+    return reachability;
+  }
+
+  // Adds the edges, updating `reachability` after each of them.
+  void UpdateAfterEachEdge(HloReachabilityMap& reachability) {
+    for (auto& [from, to] : edges_) {
+      CHECK_OK(from->AddControlDependencyTo(to));
+      reachability.AddEdge(from, to);
+    }
+  }
+
+ private:
+  std::unique_ptr<HloModule> module_;
+  HloComputation* computation_;
+  std::vector<std::pair<HloInstruction*, HloInstruction*>> edges_;
+};
+
+void BM_HloReachabilityRebuildAfterFusion(benchmark::State& state) {
+  HloReachabilityFusionBenchmark bm(state.range(0), /*depth=*/16,
+                                    state.name());
+  for (auto s : state) {
+    benchmark::DoNotOptimize(bm.RebuildAfterEachEdge());
+    state.PauseTiming();
+    bm.Reset();
+    state.ResumeTiming();
+  }
+}
+
+void BM_HloReachabilityUpdateAfterFusion(benchmark::State& state) {
+  HloReachabilityFusionBenchmark bm(state.range(0), /*depth=*/16,
+                                    state.name());
+  for (auto s : state) {
+    state.PauseTiming();
+    bm.Reset();
+    std::unique_ptr<HloReachabilityMap> reachability = bm.Build();
+    state.ResumeTiming();
+    bm.UpdateAfterEachEdge(*reachability);
+    benchmark::DoNotOptimize(reachability);
+  }
+}
+
+#define BM_FUSION_ARGS Arg(64)->Arg(256)->Arg(1024)->Arg(4096)
+BENCHMARK(BM_HloReachabilityRebuildAfterFusion)->BM_FUSION_ARGS;
+BENCHMARK(BM_HloReachabilityUpdateAfterFusion)->BM_FUSION_ARGS;
+
 }  // namespace
 
 }  // namespace xla
@@ -304,6 +304,27 @@ absl::StatusOr<ExecutionOutput> HloRunner::ExecuteWithDeviceBuffers(
                                     profile);
 }
 
+absl::StatusOr<Literal> HloRunner::ExecuteWithExecutableAndHloProfile(
+    Executable* executable, absl::Span<const Literal* const> arguments,
+    ExecutionProfile* profile, HloExecutionProfile* hlo_profile) {
+  TF_RET_CHECK(executable->hlo_profiling_enabled())
+      << "The executable was compiled without HLO profiling.";
+  entry_computation_layout_ =
+      &(executable->module().entry_computation_layout());
+  TF_ASSIGN_OR_RETURN(std::vector<ScopedShapedBuffer> argument_buffers,
+                      TransferLiteralsToDevice(arguments));
+  std::vector<ExecutionInput> execution_arguments =
+      ExecutionInputsFromScopedShapedBuffers(
+          argument_buffers, executable->module().input_output_alias_config(),
+          backend().default_stream_executor()->device_ordinal(),
+          GetAllocator());
+  TF_ASSIGN_OR_RETURN(
+      ExecutionOutput result,
+      ExecuteWithExecutionInputs(executable, std::move(execution_arguments),
+                                 profile, hlo_profile));
+  return TransferLiteralFromDevice(result.Result());
+}
+
 absl::StatusOr<ExecutionOutput> HloRunner::ExecuteWithMovedDeviceBuffers(
     std::unique_ptr<HloModule> module,
     std::vector<ScopedShapedBuffer> arguments, bool run_hlo_passes,
@@ -352,7 +373,7 @@ absl::StatusOr<ExecutionOutput> HloRunner::ExecuteWithMovedDeviceBuffers(
 
 absl::StatusOr<ExecutionOutput> HloRunner::ExecuteWithExecutionInputs(
     Executable* executable, std::vector<ExecutionInput> arguments,
-    ExecutionProfile* profile) {
+    ExecutionProfile* profile, HloExecutionProfile* hlo_profile) {
   xla::UpdateEntryComputationLayout(&executable->module(),
                                     device_shape_representation_fn_);
 
@@ -364,9 +385,14 @@ absl::StatusOr<ExecutionOutput> HloRunner::ExecuteWithExecutionInputs(
                                     stream.get(), nullptr, RunId());
   service_run_options.mutable_run_options()->set_execution_profile(profile);
 
-  TF_ASSIGN_OR_RETURN(ExecutionOutput retval,
-                      executable->ExecuteOnStreamWrapper(&service_run_options,
-                                                         std::move(arguments)));
+  // The wrapper does not pass HLO profiles on to the executable.
+  TF_ASSIGN_OR_RETURN(
+      ExecutionOutput retval,
+      hlo_profile == nullptr
+          ? executable->ExecuteOnStreamWrapper(&service_run_options,
+                                               std::move(arguments))
+          : executable->ExecuteOnStream(&service_run_options,
+                                        std::move(arguments), hlo_profile));
   TF_RETURN_IF_ERROR(stream->BlockHostUntilDone());
   return std::move(retval);
 }
@@ -631,6 +657,20 @@ absl::StatusOr<std::vector<Literal>> HloRunner::ExecuteReplicated(
   return ExecuteReplicated(std::move(module), options, &device_assignment);
 }
 
+absl::StatusOr<std::unique_ptr<HloModule>> HloRunner::RunHloPasses(
+    std::unique_ptr<HloModule> module) {
+  xla::UpdateEntryComputationLayout(module.get(),
+                                    device_shape_representation_fn_);
+  // Setup intra-op threads in module config
+  if (backend().eigen_intra_op_thread_pool() != nullptr) {
+    module->mutable_config().set_intra_op_parallelism_threads(
+        backend().eigen_intra_op_thread_pool()->NumThreads());
+  }
+  return backend().compiler()->RunHloPasses(
+      std::move(module), backend().default_stream_executor(),
+      backend().memory_allocator());
+}
+
 absl::StatusOr<std::unique_ptr<Executable>> HloRunner::CreateExecutable(
     std::unique_ptr<HloModule> module, bool run_hlo_passes) {
   return CreateExecutableWithBufferAssignment(
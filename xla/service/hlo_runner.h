@@ -94,6 +94,10 @@ class HloRunner : public HloRunnerInterface {
       Executable* executable, absl::Span<const Literal* const> arguments,
       ExecutionProfile* profile) override;
 
+  absl::StatusOr<Literal> ExecuteWithExecutableAndHloProfile(
+      Executable* executable, absl::Span<const Literal* const> arguments,
+      ExecutionProfile* profile, HloExecutionProfile* hlo_profile) override;
+
   // As Execute(), but accepts and returns device buffers instead of host
   // buffers.
   //
@@ -132,6 +136,12 @@ class HloRunner : public HloRunnerInterface {
       Executable* executable, std::vector<ScopedShapedBuffer> arguments,
       ExecutionProfile* profile = nullptr);
 
+  // Runs the HLO passes of the compiler of the backend on the module, as
+  // CreateExecutable does when run_hlo_passes is true. Running them separately
+  // from CreateExecutable(run_hlo_passes=false) lets callers time them.
+  absl::StatusOr<std::unique_ptr<HloModule>> RunHloPasses(
+      std::unique_ptr<HloModule> module);
+
   // Creates an executable object given an HLO module. If run_hlo_passes is
   // true, the HLO passes will be run as part of compilation.
   absl::StatusOr<std::unique_ptr<Executable>> CreateExecutable(
@@ -194,7 +204,7 @@ class HloRunner : public HloRunnerInterface {
  private:
   absl::StatusOr<ExecutionOutput> ExecuteWithExecutionInputs(
       Executable* executable, std::vector<ExecutionInput> arguments,
-      ExecutionProfile* profile);
+      ExecutionProfile* profile, HloExecutionProfile* hlo_profile = nullptr);
 
   // Creates a ServiceExecutableRunOptions object to configure a run on device,
   // using the provided stream object. If device_assignment is not nullptr, it
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "xla/service/hlo_runner_interface.h"
 
+#include "xla/service/hlo_binary_snapshot.h"
 #include "xla/service/hlo_parser.h"
 
 namespace xla {
@@ -93,6 +94,18 @@ HloRunnerInterface::ReadModuleFromModuleBinaryProtofile(
   return HloModule::CreateFromProto(module_proto, module_config);
 }
 
+/*static*/ absl::StatusOr<std::unique_ptr<HloModule>>
+HloRunnerInterface::ReadModuleFromBinarySnapshotFile(
+    const std::string& filename, const DebugOptions& debug_options) {
+  TF_ASSIGN_OR_RETURN(HloBinarySnapshotReader reader,
+                      HloBinarySnapshotReader::OpenFile(filename));
+  TF_ASSIGN_OR_RETURN(
+      HloModuleConfig module_config,
+      HloModule::CreateModuleConfigFromProto(reader.module_proto(),
+                                             debug_options));
+  return reader.CreateModule(module_config);
+}
+
 absl::StatusOr<Literal> HloRunnerInterface::Execute(
     std::unique_ptr<HloModule> module, absl::Span<const Literal> arguments,
     bool run_hlo_passes, ExecutionProfile* profile) {
@@ -112,6 +112,13 @@ class HloRunnerInterface {
   static absl::StatusOr<std::unique_ptr<HloModule>> ReadModuleFromHloTextFile(
       const std::string& filename, const DebugOptions& debug_options);
 
+  // Memory-maps the binary HLO snapshot file (see hlo_binary_snapshot.h),
+  // creates and returns its HloModule. The literals of the constants of the
+  // module are loaded when they are first accessed.
+  static absl::StatusOr<std::unique_ptr<HloModule>>
+  ReadModuleFromBinarySnapshotFile(const std::string& filename,
+                                   const DebugOptions& debug_options);
+
   // Creates an executable object given an HLO module. If run_hlo_passes is
   // true, the HLO passes will be run as part of compilation.
   virtual absl::StatusOr<std::unique_ptr<Executable>> CreateExecutable(
@@ -193,6 +200,15 @@ class HloRunnerInterface {
       Executable* executable, absl::Span<const Literal* const> arguments,
       ExecutionProfile* profile) = 0;
 
+  // As ExecuteWithExecutable, but also records the cycles spent in every
+  // instruction in `hlo_profile`, which must have been created from the HLO
+  // profile data of `executable` (see Executable::hlo_profiling_enabled).
+  virtual absl::StatusOr<Literal> ExecuteWithExecutableAndHloProfile(
+      Executable* executable, absl::Span<const Literal* const> arguments,
+      ExecutionProfile* profile, HloExecutionProfile* hlo_profile) {
+    return Unimplemented("%s does not support HLO profiles.", Name());
+  }
+
   // Executes a given HLO module into a set of replicas, and returns a map
   // with the replica number as key, and the corresponding returned literal as
   // value.
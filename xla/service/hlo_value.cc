@@ -16,6 +16,7 @@ limitations under the License.
 #include "xla/service/hlo_value.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 #include <string>
@@ -157,6 +158,26 @@ void HloValue::SetPositions(absl::Span<const HloPosition> positions) {
       IsRootOf(defining_instruction()->GetModule()->entry_computation());
 }
 
+void HloValue::AddPosition(const HloPosition& position) {
+  DCHECK(!absl::c_linear_search(positions_, position));
+  positions_.push_back(position);
+  UpdateUsesAndLiveOut();
+}
+
+void HloValue::RemovePosition(const HloPosition& position) {
+  CHECK_NE(position, defining_position());
+  auto it = absl::c_find(positions_, position);
+  CHECK(it != positions_.end());
+  positions_.erase(it);
+  UpdateUsesAndLiveOut();
+}
+
+void HloValue::UpdateUsesAndLiveOut() {
+  uses_ = Lazy<Uses>([this] { return ComputeUses(); });
+  live_out_of_module_ =
+      IsRootOf(defining_instruction()->GetModule()->entry_computation());
+}
+
 HloValue::Uses HloValue::ComputeUses() const {
   // Gather the computation roots at which this value appears.
   absl::flat_hash_set<HloInstruction*> root_positions;
@@ -247,7 +268,21 @@ std::string HloValueSet::ToString() const {
 }
 
 bool HloValueSet::AssignUnionOf(absl::Span<const HloValueSet* const> inputs) {
+  // Most value sets are the value set of a single operand, which is sorted and
+  // unique already, so there is no union to build.
+  if (inputs.size() == 1) {
+    if (*this == *inputs[0]) {
+      return false;
+    }
+    values_ = inputs[0]->values_;
+    return true;
+  }
+  size_t num_values = 0;
+  for (const HloValueSet* input : inputs) {
+    num_values += input->values_.size();
+  }
   HloValueSet union_set;
+  union_set.values_.reserve(num_values);
   for (const HloValueSet* input : inputs) {
     for (const HloValue* value : input->values()) {
       union_set.values_.push_back(value);
@@ -255,7 +290,7 @@ bool HloValueSet::AssignUnionOf(absl::Span<const HloValueSet* const> inputs) {
   }
   union_set.SortAndUniquifyValues();
   if (*this != union_set) {
-    *this = union_set;
+    values_ = std::move(union_set.values_);
     return true;
   }
   return false;
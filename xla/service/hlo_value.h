@@ -129,6 +129,15 @@ class HloValue : public BufferValue {
   // 'positions' as this is set at construction time.
   void SetPositions(absl::Span<const HloPosition> positions);
 
+  // Adds or removes a position other than the defining one, after the dataflow
+  // analysis was updated for a change of the module.
+  void AddPosition(const HloPosition& position);
+  void RemovePosition(const HloPosition& position);
+
+  // Recomputes the uses and the liveout status of the value, after the users
+  // of its positions or the roots of their computations changed.
+  void UpdateUsesAndLiveOut();
+
   // Returns whether this value is a phi value.
   bool is_phi() const { return is_phi_; }
 
@@ -498,6 +498,37 @@ class ReversePostOrderFusionQueue : public FusionQueue {
   std::vector<bool> fusion_config_;
 };
 
+// Updates `reachability` after `producer` was fused into the instruction at
+// `consumer_index`, which is now `fusion`, so that the map stays exact without
+// being rebuilt.
+void UpdateReachabilityAfterFusion(HloReachabilityMap& reachability,
+                                   HloReachabilityMap::Index consumer_index,
+                                   const HloInstruction* producer,
+                                   const HloInstruction* fusion) {
+  // A new fusion instruction has the same predecessors and successors as the
+  // consumer it replaced, except for the producer.
+  if (!reachability.IsPresent(fusion)) {
+    reachability.Replace(consumer_index, fusion);
+  }
+  // Multi-output fusion replaces the uses of the producer, and the uses of a
+  // fusion which had a single output, by new get-tuple-elements of the fusion.
+  for (const HloInstruction* user : fusion->users()) {
+    if (reachability.IsPresent(user)) {
+      continue;
+    }
+    HloReachabilityMap::Index user_index = reachability.AddInstruction(user);
+    reachability.FastSetReachabilityToUnion({consumer_index}, user_index);
+    for (const HloInstruction* user_user : user->users()) {
+      reachability.AddEdge(user_index, reachability.GetIndex(user_user));
+    }
+  }
+  // A duplicated producer is no longer a predecessor of the fusion. If the
+  // producer is dead instead, it stays in the map, but it's never queried.
+  if (producer->user_count() != 0) {
+    reachability.UpdateReachabilityThroughInstruction(fusion);
+  }
+}
+
 }  // namespace
 
 std::vector<HloComputation*> InstructionFusion::GetNonFusionComputations(
@@ -577,6 +608,8 @@ absl::StatusOr<bool> InstructionFusion::Run(
         };
 
         HloInstruction* fusion_instruction = nullptr;
+        const HloReachabilityMap::Index instruction_index =
+            reachability->GetIndex(instruction);
 
         // Try "regular" fusion if the operand may be duplicated. Otherwise,
         // perform multi-output fusion, unless this creates a cycle.
@@ -643,6 +676,8 @@ absl::StatusOr<bool> InstructionFusion::Run(
         std::string producer_name(operand->name());
         fusion_queue->OnFusingInstruction(fusion_instruction, operand,
                                           instruction);
+        UpdateReachabilityAfterFusion(*reachability, instruction_index, operand,
+                                      fusion_instruction);
         changed = true;
         ++fuse_count;
 
@@ -777,17 +812,21 @@ bool InstructionFusion::MultiOutputFusionCreatesCycle(
       continue;
     }
 
-    // If the reachability map already contains the producer and the operand of
-    // the consumer, and the producer can reach the operand, then we know for
-    // sure MultiOutputFusion would create a cycle. If not, we need to do a DFS
-    // traversal of the computation to verify that this multioutput fusion would
-    // not create a cycle.
-    if (reachability.IsPresent(producer) && reachability.IsPresent(operand) &&
-        reachability.IsReachable(producer, operand)) {
-      return true;
+    // If the reachability map contains the producer and the operand of the
+    // consumer, it answers whether MultiOutputFusion would create a cycle. If
+    // not, we need to do a DFS traversal of the computation to verify that this
+    // multioutput fusion would not create a cycle.
+    if (reachability.IsPresent(producer) && reachability.IsPresent(operand)) {
+      if (reachability.IsReachable(producer, operand)) {
+        return true;
+      }
+      continue;
     }
     operands.insert(operand->unique_id());
   }
+  if (operands.empty()) {
+    return false;
+  }
 
   // Do a DFS on the producer to see if any of the other consumer operands are
   // reachable in the current state of the graph.
@@ -248,6 +248,8 @@ class InstructionFusion : public HloModulePass {
   }
 
   // Whether multi-output fusion would introduce a cycle into the HLO graph.
+  // `reachability` must be up to date for the instructions it contains; the
+  // other instructions are checked with a traversal of the graph.
   bool MultiOutputFusionCreatesCycle(HloInstruction* producer,
                                      HloInstruction* consumer,
                                      const HloReachabilityMap& reachability);
@@ -378,22 +378,15 @@ absl::StatusOr<bool> ReshapeMover::TryReshapeMoveOnCandidates(
   return true;
 }
 
-absl::StatusOr<bool> ReshapeMover::Run(
-    HloModule* module,
-    const absl::flat_hash_set<absl::string_view>& execution_threads) {
-  bool changed = false;
-  for (auto* comp : module->MakeNonfusionComputations(execution_threads)) {
-    HloInstructionSet candidates;
-    for (HloInstruction* instruction : comp->instructions()) {
-      if (IsReshapeMoveCandidate(instruction)) {
-        candidates.insert(instruction);
-      }
+absl::StatusOr<bool> ReshapeMover::RunOnComputation(
+    HloComputation* computation) {
+  HloInstructionSet candidates;
+  for (HloInstruction* instruction : computation->instructions()) {
+    if (IsReshapeMoveCandidate(instruction)) {
+      candidates.insert(instruction);
     }
-    TF_ASSIGN_OR_RETURN(bool did_change,
-                        TryReshapeMoveOnCandidates(&candidates));
-    changed |= did_change;
   }
-  return changed;
+  return TryReshapeMoveOnCandidates(&candidates);
 }
 
 }  // namespace xla
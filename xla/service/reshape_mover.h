@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef XLA_SERVICE_RESHAPE_MOVER_H_
 #define XLA_SERVICE_RESHAPE_MOVER_H_
 
+#include "xla/hlo/ir/hlo_computation.h"
 #include "xla/service/hlo_pass_interface.h"
 
 namespace xla {
@@ -42,7 +43,7 @@ struct ReshapeMoverOptions {
   bool reshape_of_1d_broadcast_is_cheap = false;
 };
 
-class ReshapeMover : public HloModulePass {
+class ReshapeMover : public HloComputationPass {
  public:
   explicit ReshapeMover(
       const ReshapeMoverOptions& options = ReshapeMoverOptions{})
@@ -50,10 +51,9 @@ class ReshapeMover : public HloModulePass {
 
   absl::string_view name() const override { return "reshape-mover"; }
 
-  using HloPassInterface::Run;
-  absl::StatusOr<bool> Run(
-      HloModule* module,
-      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+  // Not computation-local: rewrites consume optimization fuel, which has to be
+  // consumed in the same order on every run.
+  absl::StatusOr<bool> RunOnComputation(HloComputation* computation) override;
 
  private:
   absl::StatusOr<bool> TryReshapeMoveOnCandidates(
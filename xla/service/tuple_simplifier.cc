@@ -16,6 +16,7 @@ limitations under the License.
 #include "xla/service/tuple_simplifier.h"
 
 #include <queue>
+#include <vector>
 
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
@@ -53,61 +54,68 @@ absl::StatusOr<bool> TupleSimplifier::RemoveWholeTuple(HloInstruction* tuple) {
   return changed;
 }
 
-absl::StatusOr<bool> TupleSimplifier::Run(
+std::vector<HloComputation*> TupleSimplifier::ComputationsToRun(
     HloModule* module,
     const absl::flat_hash_set<absl::string_view>& execution_threads) {
-  // Initially add all GTE and Tuple instructions to the worklist.
-  bool changed = false;
-  for (auto* computation : module->computations(execution_threads)) {
+  std::vector<HloComputation*> computations;
+  for (HloComputation* computation : module->computations(execution_threads)) {
     if (exclude_entry_computation_ &&
         computation == module->entry_computation()) {
       continue;
     }
-    for (auto* instruction : computation->MakeInstructionPostOrder()) {
-      if (instruction->opcode() == HloOpcode::kTuple) {
-        TF_ASSIGN_OR_RETURN(bool c, RemoveWholeTuple(instruction));
-        changed |= c;
-      } else {
-        auto ancestor = instruction->LatestNonGteAncestorAndIndex();
-        if (ancestor.first == instruction) {
-          continue;
-        }
-        // If possible replace a chain of GTE with the operation which produces
-        // the element. For example, replace uses of GTE with below with just
-        // 'Op' (assuming 'Op' is at the index of the GTE instruction):
-        //
-        //     ...  Op ...
-        //       \  |   /
-        //        Tuple
-        //          |
-        //         GTE
-        //         ...
-        //          |
-        //         GTE
-        //          |
-        //         GTE
-        //
-        // Note that this deletes the Tuple instruction altogether. In addition,
-        // if only a subset of tuple's elements are used, this transform
-        // optimizes them one at a time, and after the last use is optimized,
-        // the Tuple will also be deleted.
-        HloInstruction* replacement = ancestor.first;
-        for (int i = 0; i < ancestor.second.size(); ++i) {
-          if (replacement->opcode() != HloOpcode::kTuple) {
-            replacement = nullptr;
-            break;
-          }
-          replacement = replacement->mutable_operand(ancestor.second[i]);
-        }
+    computations.push_back(computation);
+  }
+  return computations;
+}
 
-        if (replacement) {
-          TF_ASSIGN_OR_RETURN(bool replaced,
-                              computation->ReplaceInstruction(
-                                  instruction, replacement,
-                                  /*preserve_sharding=*/true,
-                                  /*relay_control_dependency=*/true));
-          changed |= replaced;
+absl::StatusOr<bool> TupleSimplifier::RunOnComputation(
+    HloComputation* computation) {
+  // Initially add all GTE and Tuple instructions to the worklist.
+  bool changed = false;
+  for (auto* instruction : computation->MakeInstructionPostOrder()) {
+    if (instruction->opcode() == HloOpcode::kTuple) {
+      TF_ASSIGN_OR_RETURN(bool c, RemoveWholeTuple(instruction));
+      changed |= c;
+    } else {
+      auto ancestor = instruction->LatestNonGteAncestorAndIndex();
+      if (ancestor.first == instruction) {
+        continue;
+      }
+      // If possible replace a chain of GTE with the operation which produces
+      // the element. For example, replace uses of GTE with below with just
+      // 'Op' (assuming 'Op' is at the index of the GTE instruction):
+      //
+      //     ...  Op ...
+      //       \  |   /
+      //        Tuple
+      //          |
+      //         GTE
+      //         ...
+      //          |
+      //         GTE
+      //          |
+      //         GTE
+      //
+      // Note that this deletes the Tuple instruction altogether. In addition,
+      // if only a subset of tuple's elements are used, this transform
+      // optimizes them one at a time, and after the last use is optimized,
+      // the Tuple will also be deleted.
+      HloInstruction* replacement = ancestor.first;
+      for (int i = 0; i < ancestor.second.size(); ++i) {
+        if (replacement->opcode() != HloOpcode::kTuple) {
+          replacement = nullptr;
+          break;
         }
+        replacement = replacement->mutable_operand(ancestor.second[i]);
+      }
+
+      if (replacement) {
+        TF_ASSIGN_OR_RETURN(bool replaced,
+                            computation->ReplaceInstruction(
+                                instruction, replacement,
+                                /*preserve_sharding=*/true,
+                                /*relay_control_dependency=*/true));
+        changed |= replaced;
       }
     }
   }
@@ -17,7 +17,9 @@ limitations under the License.
 #define XLA_SERVICE_TUPLE_SIMPLIFIER_H_
 
 #include <utility>
+#include <vector>
 
+#include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
 #include "xla/hlo/ir/hlo_module.h"
 #include "xla/service/hlo_pass_interface.h"
@@ -26,7 +28,7 @@ namespace xla {
 
 // A pass which simplifies patterns of Tuple and GetTupleElement instructions in
 // the module.
-class TupleSimplifier : public HloModulePass {
+class TupleSimplifier : public HloComputationPass {
  public:
   TupleSimplifier() : TupleSimplifier(/*exclude_entry_computation=*/false) {}
   explicit TupleSimplifier(bool exclude_entry_computation);
@@ -35,9 +37,13 @@ class TupleSimplifier : public HloModulePass {
 
   // Run tuple simplification on the given computation. Returns whether the
   // computation was changed.
-  using HloPassInterface::Run;
   using HloPassInterface::RunOnModuleGroup;
-  absl::StatusOr<bool> Run(
+  absl::StatusOr<bool> RunOnComputation(HloComputation* computation) override;
+
+  bool IsComputationLocal() const override { return true; }
+
+ protected:
+  std::vector<HloComputation*> ComputationsToRun(
       HloModule* module,
       const absl::flat_hash_set<absl::string_view>& execution_threads) override;
 
@@ -22,6 +22,7 @@ limitations under the License.
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -29,6 +30,7 @@ limitations under the License.
 #include "xla/debug_options_flags.h"
 #include "xla/hlo/ir/hlo_computation.h"
 #include "xla/hlo/ir/hlo_instruction.h"
+#include "xla/service/hlo_binary_snapshot.h"
 #include "xla/service/hlo_module_config.h"
 #include "xla/service/hlo_parser.h"
 #include "tsl/platform/env.h"
@@ -46,6 +48,32 @@ absl::Status OverrideConfig(const hlo_module_loader_details::Config& ovr_config,
   return OkStatus();
 }
 
+absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromBinarySnapshot(
+    const HloBinarySnapshotReader& reader,
+    const hlo_module_loader_details::Config& ovr_config,
+    const std::function<void(HloModuleConfig*)>& config_modifier_hook) {
+  TF_ASSIGN_OR_RETURN(
+      HloModuleConfig config,
+      HloModule::CreateModuleConfigFromProto(reader.module_proto(),
+                                             GetDebugOptionsFromFlags()));
+  TF_RETURN_IF_ERROR(OverrideConfig(ovr_config, &config));
+  if (config_modifier_hook) {
+    config_modifier_hook(&config);
+  }
+  return reader.CreateModule(config);
+}
+
+absl::StatusOr<std::unique_ptr<RunHloModuleIterationLiterals>>
+LoadInputFromBinarySnapshot(const HloBinarySnapshotReader& reader) {
+  TF_ASSIGN_OR_RETURN(std::vector<Literal> arguments, reader.LoadArguments());
+  auto iteration_literals_proto =
+      std::make_unique<RunHloModuleIterationLiterals>();
+  for (const Literal& argument : arguments) {
+    *iteration_literals_proto->add_arguments() = argument.ToProto();
+  }
+  return std::move(iteration_literals_proto);
+}
+
 }  // namespace
 
 std::string StripLogHeaders(std::string_view hlo_string) {
@@ -83,6 +111,11 @@ absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromData(
     }
     TF_ASSIGN_OR_RETURN(module,
                         ParseAndReturnUnverifiedModule(hlo_string, config));
+  } else if (format == "hlosnap") {
+    TF_ASSIGN_OR_RETURN(HloBinarySnapshotReader reader,
+                        HloBinarySnapshotReader::FromData(data));
+    TF_ASSIGN_OR_RETURN(module, LoadModuleFromBinarySnapshot(
+                                    reader, ovr_config, config_modifier_hook));
   } else {
     HloSnapshot proto;
     if (format == "pb") {
@@ -110,7 +143,7 @@ absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromData(
     } else {
       return InvalidArgument(
           "Invalid format from file extension: '%s'. Expected: hlo, txt, pb, "
-          "or pbtxt",
+          "pbtxt or hlosnap",
           format);
     }
     TF_ASSIGN_OR_RETURN(HloModuleConfig config,
@@ -135,6 +168,14 @@ absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromFile(
   if (format.empty()) {
     format = std::string(tsl::io::Extension(path));
   }
+  if (format == "hlosnap") {
+    // Map the snapshot instead of reading it, so that its constants are only
+    // loaded when they are used.
+    TF_ASSIGN_OR_RETURN(HloBinarySnapshotReader reader,
+                        HloBinarySnapshotReader::OpenFile(path));
+    return LoadModuleFromBinarySnapshot(reader, ovr_config,
+                                        config_modifier_hook);
+  }
   TF_RETURN_IF_ERROR(tsl::ReadFileToString(tsl::Env::Default(), path, &data));
   return LoadModuleFromData(data, format, ovr_config, config_modifier_hook,
                             buffer_assignment_proto);
@@ -142,6 +183,11 @@ absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromFile(
 
 absl::StatusOr<std::unique_ptr<RunHloModuleIterationLiterals>>
 LoadInputFromData(const std::string& data, std::string_view format) {
+  if (format == "hlosnap") {
+    TF_ASSIGN_OR_RETURN(HloBinarySnapshotReader reader,
+                        HloBinarySnapshotReader::FromData(data));
+    return LoadInputFromBinarySnapshot(reader);
+  }
   HloSnapshot proto;
   if (format == "pb") {
     if (!proto.ParseFromString(data) &&
@@ -160,7 +206,7 @@ LoadInputFromData(const std::string& data, std::string_view format) {
   } else {
     return InvalidArgument(
         "Invalid format from file extension: '%s'. Expected: pb, "
-        "or pbtxt",
+        "pbtxt or hlosnap",
         format);
   }
 
@@ -178,6 +224,11 @@ LoadInputFromFile(const std::string& path, std::string format) {
   if (format.empty()) {
     format = std::string(tsl::io::Extension(path));
   }
+  if (format == "hlosnap") {
+    TF_ASSIGN_OR_RETURN(HloBinarySnapshotReader reader,
+                        HloBinarySnapshotReader::OpenFile(path));
+    return LoadInputFromBinarySnapshot(reader);
+  }
   TF_RETURN_IF_ERROR(tsl::ReadFileToString(tsl::Env::Default(), path, &data));
   return LoadInputFromData(data, format);
 }
@@ -49,6 +49,8 @@ std::string StripLogHeaders(std::string_view hlo_string);
 // 2) A hlo text dump, the string should be in HloModule::ToString() format
 //    (format must be "txt" or "hlo"). The input data can also contain log
 //    headers, which will be stripped.
+// 3) A binary HLO snapshot, see xla/service/hlo_binary_snapshot.h (format must
+//    be "hlosnap").
 // The ovr_config data can be used to override certain fields of the
 // HloModuleConfig.
 // The HloModuleConfig is passed to config_modifier_hook for custom
@@ -70,6 +72,9 @@ absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromData(
 // 2) A hlo text dump, the string should be in HloModule::ToString() format
 //    (with a .hlo or .txt extension). A text file can also contain log headers,
 //    which will be stripped.
+// 3) A binary HLO snapshot (with a .hlosnap extension). The file is
+//    memory-mapped and the literals of the constants of the module are only
+//    loaded when they are first accessed.
 // If the format is specified (not empty), it overrides the one guessed from the
 // file extension. The ovr_config data can be used to override certain fields of
 // the HloModuleConfig.
@@ -88,6 +93,7 @@ absl::StatusOr<std::unique_ptr<HloModule>> LoadModuleFromFile(
 // The data format must be one of the following:
 // 1) A binary proto (format "pb")
 // 2) A text proto (format "pbtxt")
+// 3) A binary HLO snapshot (format "hlosnap")
 absl::StatusOr<std::unique_ptr<RunHloModuleIterationLiterals>>
 LoadInputFromData(const std::string& data, std::string_view format);
 
@@ -95,6 +101,7 @@ LoadInputFromData(const std::string& data, std::string_view format);
 // The file must be one of the following:
 // 1) A binary proto (with .pb extension)
 // 2) A text proto (with a .pbtxt extension)
+// 3) A binary HLO snapshot (with a .hlosnap extension)
 // If the format is specified (not empty), it overrides the one guessed from the
 // file extension.
 absl::StatusOr<std::unique_ptr<RunHloModuleIterationLiterals>>
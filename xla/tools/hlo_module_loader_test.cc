@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "xla/tools/hlo_module_loader.h"
 
+#include <memory>
 #include <string>
 
+#include "xla/literal_util.h"
+#include "xla/service/hlo_binary_snapshot.h"
 #include "xla/tests/hlo_test_base.h"
 #include "tsl/lib/core/status_test_util.h"
 #include "tsl/platform/test.h"
@@ -46,5 +49,30 @@ I0521 12:04:45.883483    1509 service.cc:186] }
   EXPECT_NE(FindInstruction(hlo_module.get(), "rooty"), nullptr);
 }
 
+TEST_F(HloModuleLoaderTest, LoadsBinarySnapshot) {
+  const std::string& hlo_string = R"(
+HloModule test_binary_snapshot
+
+ENTRY entry {
+  p0 = f32[4]{0} parameter(0)
+  c0 = f32[4]{0} constant({1, 2, 3, 4})
+  ROOT add = f32[4]{0} add(p0, c0)
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  Literal argument = LiteralUtil::CreateR1<float>({5, 6, 7, 8});
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot,
+                          SerializeHloBinarySnapshot(*module, {&argument}));
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> hlo_module,
+                          LoadModuleFromData(snapshot, "hlosnap"));
+  EXPECT_EQ(hlo_module->ToString(), module->ToString());
+  TF_ASSERT_OK_AND_ASSIGN(auto iteration_literals,
+                          LoadInputFromData(snapshot, "hlosnap"));
+  ASSERT_EQ(iteration_literals->arguments_size(), 1);
+  EXPECT_EQ(iteration_literals->arguments(0).f32s_size(), 4);
+}
+
 }  // namespace
 }  // namespace xla
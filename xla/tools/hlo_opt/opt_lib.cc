@@ -32,8 +32,10 @@ limitations under the License.
 #include "absl/synchronization/mutex.h"
 #include "xla/debug_options_flags.h"
 #include "xla/hlo/ir/hlo_module.h"
+#include "xla/service/compile_stats.h"
 #include "xla/service/compiler.h"
 #include "xla/service/executable.h"
+#include "xla/service/hlo.pb.h"
 #include "xla/service/hlo_graph_dumper.h"
 #include "xla/service/platform_util.h"
 #include "xla/stream_executor/platform.h"
@@ -143,6 +145,11 @@ absl::StatusOr<std::unique_ptr<HloModule>> OptProvider::GetOptimizedHlo(
       std::unique_ptr<HloModule> optimized_module,
       compiler->RunHloPasses(std::move(input_module), executor, opts));
 
+  const HloModuleMetadata& metadata = *optimized_module->metadata();
+  if (metadata.prepartitioning_metadata().has_value()) {
+    compiled_module_metadata_.push_back(*metadata.prepartitioning_metadata());
+  }
+  compiled_module_metadata_.push_back(metadata.proto());
   return optimized_module;
 }
 
@@ -159,6 +166,16 @@ absl::StatusOr<std::unique_ptr<Executable>> OptProvider::GetExecutable(
   return executable;
 }
 
+CompileStats OptProvider::GetCompileStats() const {
+  std::vector<const HloModuleMetadataProto*> metadata;
+  metadata.reserve(compiled_module_metadata_.size());
+  for (const HloModuleMetadataProto& module_metadata :
+       compiled_module_metadata_) {
+    metadata.push_back(&module_metadata);
+  }
+  return CompileStats::FromMetadata(metadata);
+}
+
 std::set<std::string> OptProvider::SupportedStages() {
   return {"hlo", "html", "hlo-backend"};
 }
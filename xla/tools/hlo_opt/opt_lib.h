@@ -20,11 +20,14 @@ limitations under the License.
 #include <optional>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "xla/hlo/ir/hlo_module.h"
+#include "xla/service/compile_stats.h"
 #include "xla/service/compiler.h"
+#include "xla/service/hlo.pb.h"
 #include "xla/service/executable.h"
 #include "xla/statusor.h"
 #include "xla/stream_executor/platform.h"
@@ -45,6 +48,10 @@ class OptProvider {
   // Returns a set of stages supported by the opt provider.
   virtual std::set<std::string> SupportedStages();
 
+  // Returns the compile time statistics of the HLO passes the provider has run
+  // so far.
+  CompileStats GetCompileStats() const;
+
   // Registers a given provider for a given platform.
   static void RegisterForPlatform(
       std::string platform, std::unique_ptr<OptProvider> translate_provider);
@@ -70,6 +77,10 @@ class OptProvider {
 
   // Gets a compiler associated with the provider.
   virtual absl::StatusOr<Compiler *> GetCompiler();
+
+ private:
+  // The pass metadata of the modules GetOptimizedHlo optimized.
+  std::vector<HloModuleMetadataProto> compiled_module_metadata_;
 };
 
 }  // namespace xla
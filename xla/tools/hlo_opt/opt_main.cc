@@ -70,6 +70,7 @@ struct HloOptConfig {
   std::string output_file{"-"};
   std::string stage{"hlo"};
   bool list_stages{false};
+  int64_t print_pass_stats{0};
 };
 
 }  // namespace
@@ -165,6 +166,9 @@ absl::StatusOr<std::string> TranslateToStage(int argc, char** argv,
     absl::StrAppend(&out_combined, *out, "\n");
   }
 
+  if (opts.print_pass_stats != 0) {
+    std::cerr << provider->GetCompileStats().ToTable(opts.print_pass_stats);
+  }
   return out_combined;
 }
 
@@ -210,7 +214,11 @@ int main(int argc, char** argv) {
                 "Print all supported stages for a given platform and exit"),
       tsl::Flag("split-input-file", &opts.split_input_file,
                 "Splits the input file in pieces based on '// -----' "
-                "substring, and processes each chunk independently")};
+                "substring, and processes each chunk independently"),
+      tsl::Flag("print-pass-stats", &opts.print_pass_stats,
+                "Print the time, instruction count change and peak memory "
+                "rise of the N slowest HLO passes to stderr, or of all of "
+                "them if N is negative. 0 (default) prints nothing.")};
   // Modifies global DebugOptions, populates flags with every flag available
   // from xla.proto.
   xla::AppendDebugOptionsFlags(&flag_list);
@@ -15,6 +15,11 @@ limitations under the License.
 
 #include "xla/tools/run_hlo_module.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <ctime>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -40,7 +45,9 @@ limitations under the License.
 #include "xla/hlo/ir/hlo_opcode.h"
 #include "xla/literal.h"
 #include "xla/literal_comparison.h"
+#include "xla/service/executable.h"
 #include "xla/service/hlo.pb.h"
+#include "xla/service/hlo_execution_profile.h"
 #include "xla/service/hlo_module_config.h"
 #include "xla/service/hlo_verifier.h"
 #include "xla/status.h"
@@ -50,6 +57,7 @@ limitations under the License.
 #include "xla/tools/hlo_module_loader.h"
 #include "xla/tools/prepare_reference_module.h"
 #include "xla/tools/run_hlo_module.pb.h"
+#include "xla/tsl/util/stats_calculator.h"
 #include "xla/util.h"
 #include "xla/xla_data.pb.h"
 #include "tsl/platform/errors.h"
@@ -461,6 +469,41 @@ Status RunIsolatedAndCompare(
   return status;
 }
 
+// Returns the microseconds elapsed since 'start'.
+double MicrosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Returns the distribution of 'samples_us'. The percentiles are nearest-rank
+// percentiles.
+RunHloModuleBenchmarkResult::Distribution MakeDistribution(
+    std::vector<double> samples_us) {
+  RunHloModuleBenchmarkResult::Distribution distribution;
+  if (samples_us.empty()) {
+    return distribution;
+  }
+  tsl::Stat<double> stat;
+  for (double sample : samples_us) {
+    stat.UpdateStat(sample);
+  }
+  absl::c_sort(samples_us);
+  auto percentile = [&](double p) {
+    int64_t rank = static_cast<int64_t>(std::ceil(p * samples_us.size()));
+    return samples_us[std::clamp<int64_t>(rank - 1, 0, samples_us.size() - 1)];
+  };
+  distribution.set_count(stat.count());
+  distribution.set_min_us(samples_us.front());
+  distribution.set_max_us(samples_us.back());
+  distribution.set_mean_us(stat.avg());
+  distribution.set_stddev_us(stat.std_deviation());
+  distribution.set_p50_us(percentile(0.5));
+  distribution.set_p90_us(percentile(0.9));
+  distribution.set_p99_us(percentile(0.99));
+  return distribution;
+}
+
 }  // namespace
 
 Status RunAndCompare(
@@ -520,7 +563,8 @@ Status RunAndCompare(
   if (iteration_literals_proto == nullptr) {
     // User did not explicitly give input
     if (!options.force_fake_data && !options.isolate_instructions &&
-        (options.input_format == "pb" || options.input_format == "pbtxt")) {
+        (options.input_format == "pb" || options.input_format == "pbtxt" ||
+         options.input_format == "hlosnap")) {
       // User is giving a snapshot (which contains inputs)
       LOG(INFO) << "Using input data from the user-provided snapshot.";
       TF_ASSIGN_OR_RETURN(
@@ -528,7 +572,8 @@ Status RunAndCompare(
           LoadInputFromFile(hlo_filename, options.input_format));
       iteration_literals_proto = iteration_literals_proto_local.get();
     } else if (options.input_format == "pb" ||
-               options.input_format == "pbtxt") {
+               options.input_format == "pbtxt" ||
+               options.input_format == "hlosnap") {
       LOG(INFO)
           << "Ignoring input data from snapshot and using fake data instead.";
     }
@@ -540,4 +585,178 @@ Status RunAndCompare(
       test_runner, reference_runner, engine, options, iteration_literals_proto,
       reference_module_modifier_hook, config_modifier_hook);
 }
+
+absl::StatusOr<RunHloModuleBenchmarkResult> RunBenchmark(
+    const std::string& hlo_filename, HloRunner* test_runner,
+    std::minstd_rand0* engine, const RunHloModuleOptions& options,
+    std::function<void(HloModuleConfig*)> config_modifier_hook,
+    std::function<Status(const RunHloModuleOptions& options, HloModule& module)>
+        compilation_env_modifier_hook) {
+  RunHloModuleBenchmarkResult result;
+  result.set_platform(std::string(test_runner->Name()));
+  result.set_warmup_iterations(options.warmup_iterations);
+  result.set_iterations(options.iterations);
+  auto add_compile_phase = [&](absl::string_view name,
+                               std::chrono::steady_clock::time_point start) {
+    RunHloModuleBenchmarkResult::CompilePhase* phase =
+        result.add_compile_phases();
+    phase->set_name(std::string(name));
+    phase->set_wall_time_us(MicrosSince(start));
+  };
+
+  if (!config_modifier_hook) {
+    config_modifier_hook = [](HloModuleConfig* config) {
+      config->set_seed(42);
+    };
+  }
+  BufferAssignmentProto buffer_assignment_proto;
+  auto start = std::chrono::steady_clock::now();
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<HloModule> module,
+      LoadModuleFromFile(
+          hlo_filename, options.input_format,
+          hlo_module_loader_details::Config(), config_modifier_hook,
+          options.use_buffer_assignment_from_proto ? &buffer_assignment_proto
+                                                   : nullptr));
+  if (compilation_env_modifier_hook) {
+    TF_RETURN_IF_ERROR(compilation_env_modifier_hook(options, *module));
+  }
+  add_compile_phase("load", start);
+  result.set_module_name(module->name());
+
+  start = std::chrono::steady_clock::now();
+  HloVerifier verifier(
+      HloVerifierOpts{}.WithLayoutSensitive(false).WithAllowMixedPrecision(
+          true));
+  TF_RETURN_IF_ERROR(verifier.Run(module.get()).status());
+  add_compile_phase("verify", start);
+
+  if (options.flatten_control_flow) {
+    start = std::chrono::steady_clock::now();
+    HloControlFlowFlattening control_flow_flattening(
+        HloControlFlowFlattening::Options{/*while_execution_count=*/1});
+    TF_RETURN_IF_ERROR(control_flow_flattening.Run(module.get()).status());
+    add_compile_phase("flatten_control_flow", start);
+  }
+
+  // Use the arguments of the snapshot, if the module comes from one.
+  std::vector<Literal> args;
+  if (!options.force_fake_data &&
+      (options.input_format == "pb" || options.input_format == "pbtxt" ||
+       options.input_format == "hlosnap")) {
+    TF_ASSIGN_OR_RETURN(
+        std::unique_ptr<RunHloModuleIterationLiterals> literals,
+        LoadInputFromFile(hlo_filename, options.input_format));
+    for (const LiteralProto& argument : literals->arguments()) {
+      TF_ASSIGN_OR_RETURN(Literal arg, Literal::CreateFromProto(argument));
+      args.push_back(std::move(arg));
+    }
+  }
+  if (args.empty()) {
+    TF_ASSIGN_OR_RETURN(
+        args, MakeFakeArguments(module.get(), engine,
+                                options.use_large_float_range,
+                                options.treat_gte_as_data_formatting));
+  }
+  std::vector<const Literal*> arg_ptrs;
+  for (const Literal& arg : args) {
+    arg_ptrs.push_back(&arg);
+  }
+
+  if (options.run_test_hlo_passes) {
+    start = std::chrono::steady_clock::now();
+    TF_ASSIGN_OR_RETURN(module, test_runner->RunHloPasses(std::move(module)));
+    add_compile_phase("hlo_passes", start);
+  }
+  start = std::chrono::steady_clock::now();
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<Executable> executable,
+      test_runner->CreateExecutableWithBufferAssignment(
+          std::move(module),
+          options.use_buffer_assignment_from_proto ? &buffer_assignment_proto
+                                                   : nullptr,
+          /*run_hlo_passes=*/false));
+  add_compile_phase("backend", start);
+
+  // The HLO profile counters are only collected if the compiler set up the
+  // executable for them.
+  const bool hlo_profiling = executable->hlo_profiling_enabled();
+  std::vector<tsl::Stat<double>> counter_stats;
+  if (hlo_profiling) {
+    counter_stats.resize(executable->hlo_profile_index_map().total_count());
+  }
+  std::vector<double> wall_times_us;
+  std::vector<double> cpu_times_us;
+  std::vector<double> compute_times_us;
+  for (int i = 0; i < options.warmup_iterations + options.iterations; ++i) {
+    ExecutionProfile profile;
+    std::optional<HloExecutionProfile> hlo_profile;
+    if (hlo_profiling) {
+      hlo_profile.emplace(&executable->hlo_profile_printer_data(),
+                          &executable->hlo_profile_index_map());
+    }
+    const std::clock_t cpu_start = std::clock();
+    start = std::chrono::steady_clock::now();
+    absl::StatusOr<Literal> output =
+        hlo_profiling ? test_runner->ExecuteWithExecutableAndHloProfile(
+                            executable.get(), arg_ptrs, &profile,
+                            &hlo_profile.value())
+                      : test_runner->ExecuteWithExecutable(executable.get(),
+                                                           arg_ptrs, &profile);
+    const double wall_time_us = MicrosSince(start);
+    const std::clock_t cpu_end = std::clock();
+    TF_RETURN_WITH_CONTEXT_IF_ERROR(
+        output.status(),
+        absl::StrCat("Failed to execute on ", test_runner->Name()));
+    if (i < options.warmup_iterations) {
+      continue;
+    }
+    wall_times_us.push_back(wall_time_us);
+    cpu_times_us.push_back(1e6 * static_cast<double>(cpu_end - cpu_start) /
+                           CLOCKS_PER_SEC);
+    compute_times_us.push_back(
+        static_cast<double>(profile.compute_time_ns()) / 1e3);
+    if (hlo_profiling) {
+      for (int64_t j = 0; j < counter_stats.size(); ++j) {
+        counter_stats[j].UpdateStat(hlo_profile->profile_counters()[j]);
+      }
+    }
+  }
+  *result.mutable_wall_time() = MakeDistribution(std::move(wall_times_us));
+  *result.mutable_cpu_time() = MakeDistribution(std::move(cpu_times_us));
+  *result.mutable_compute_time() =
+      MakeDistribution(std::move(compute_times_us));
+
+  if (hlo_profiling && options.iterations > 0) {
+    const HloProfileIndexMap& index_map = executable->hlo_profile_index_map();
+    const double total_cycles =
+        counter_stats[index_map.GetProfileIndexFor(
+                          *executable->module().entry_computation())]
+            .avg();
+    for (const auto& [instruction, index] :
+         index_map.instruction_to_profile_idx()) {
+      const tsl::Stat<double>& stat = counter_stats[index];
+      RunHloModuleBenchmarkResult::InstructionProfile* instruction_profile =
+          result.add_instructions();
+      instruction_profile->set_name(instruction->name());
+      instruction_profile->set_opcode(
+          std::string(HloOpcodeString(instruction->opcode())));
+      instruction_profile->set_computation(instruction->parent()->name());
+      instruction_profile->set_mean_cycles(stat.avg());
+      instruction_profile->set_min_cycles(stat.min());
+      instruction_profile->set_max_cycles(stat.max());
+      instruction_profile->set_fraction_of_total(
+          total_cycles > 0 ? stat.avg() / total_cycles : 0);
+    }
+    absl::c_sort(*result.mutable_instructions(),
+                 [](const RunHloModuleBenchmarkResult::InstructionProfile& a,
+                    const RunHloModuleBenchmarkResult::InstructionProfile& b) {
+                   if (a.mean_cycles() != b.mean_cycles()) {
+                     return a.mean_cycles() > b.mean_cycles();
+                   }
+                   return a.name() < b.name();
+                 });
+  }
+  return result;
+}
 }  // namespace xla
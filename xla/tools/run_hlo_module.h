@@ -21,6 +21,7 @@ limitations under the License.
 #include <random>
 #include <string>
 
+#include "absl/status/statusor.h"
 #include "xla/hlo/ir/hlo_module.h"
 #include "xla/service/hlo_runner.h"
 #include "xla/status.h"
@@ -57,6 +58,11 @@ struct RunHloModuleOptions {
   bool random_init_input_literals{true};
   bool force_fake_data{false};
   bool isolate_instructions{false};
+  // Benchmark mode, see RunBenchmark. 'iterations' is the number of timed
+  // iterations.
+  bool benchmark{false};
+  int warmup_iterations{1};
+  std::string benchmark_output_file;
 };
 
 // Runs test_module on the platform with the name
@@ -89,6 +95,19 @@ Status RunAndCompare(
     std::function<void(HloModuleConfig*)> config_modifier_hook = {},
     std::function<Status(const RunHloModuleOptions& options, HloModule& module)>
         compilation_env_modifier_hook = {});
+
+// Reads an HloModule from 'hlo_filename', compiles it once with 'test_runner'
+// and runs it 'options.warmup_iterations' times, then 'options.iterations'
+// timed times, always with the same arguments. Returns how long loading and
+// compiling the module took, the distributions of the times of the timed
+// iterations and, if the module was compiled with HLO profiling
+// (--xla_hlo_profile), the cycles spent in every instruction.
+absl::StatusOr<RunHloModuleBenchmarkResult> RunBenchmark(
+    const std::string& hlo_filename, HloRunner* test_runner,
+    std::minstd_rand0* engine, const RunHloModuleOptions& options,
+    std::function<void(HloModuleConfig*)> config_modifier_hook = {},
+    std::function<Status(const RunHloModuleOptions& options, HloModule& module)>
+        compilation_env_modifier_hook = {});
 }  // namespace xla
 
 #endif  // XLA_TOOLS_RUN_HLO_MODULE_H_
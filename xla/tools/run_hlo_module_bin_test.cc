@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include <string>
+#include <vector>
 
 #include "tsl/platform/path.h"
 #include "tsl/platform/subprocess.h"
@@ -24,7 +25,8 @@ namespace {
 
 class RunHloModuleTest : public ::testing::Test {
  protected:
-  void RunHlo(const std::string& file_name) {
+  void RunHlo(const std::string& file_name,
+              const std::vector<std::string>& extra_args = {}) {
     std::string run_hlo_module_bin = tsl::io::JoinPath(
         tsl::testing::XlaSrcRoot(), "tools", "run_hlo_module");
 
@@ -32,8 +34,10 @@ class RunHloModuleTest : public ::testing::Test {
                                              "tools", "data", file_name);
 
     tsl::SubProcess proc;
-    proc.SetProgram(run_hlo_module_bin,
-                    {run_hlo_module_bin, hlo_path, "--platform=Host"});
+    std::vector<std::string> args = {run_hlo_module_bin, hlo_path,
+                                     "--platform=Host"};
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
+    proc.SetProgram(run_hlo_module_bin, args);
     proc.SetChannelAction(tsl::CHAN_STDOUT, tsl::ACTION_PIPE);
     proc.SetChannelAction(tsl::CHAN_STDERR, tsl::ACTION_PIPE);
     EXPECT_TRUE(proc.Start());
@@ -90,5 +94,18 @@ TEST_F(RunHloModuleTest, MustAliasWithSharding) {
               testing::Not(testing::HasSubstr("memory allocation bug")));
 }
 
+TEST_F(RunHloModuleTest, Benchmark) {
+  RunHlo("add.hlo",
+         {"--benchmark", "--warmup_iterations=2", "--iterations=5"});
+
+  EXPECT_TRUE(exited_normally_);
+  EXPECT_EQ(exit_status_, 0);
+  EXPECT_THAT(stdout_output_, testing::HasSubstr("\"iterations\": 5"));
+  EXPECT_THAT(stdout_output_, testing::HasSubstr("\"compilePhases\""));
+  EXPECT_THAT(stdout_output_, testing::HasSubstr("\"p99Us\""));
+  EXPECT_THAT(stderr_output_,
+              testing::Not(testing::HasSubstr("Results on Host")));
+}
+
 }  // namespace
 }  // namespace xla
@@ -21,6 +21,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "xla/debug_options_flags.h"
 #include "xla/service/hlo_runner.h"
@@ -28,7 +29,9 @@ limitations under the License.
 #include "xla/tools/run_hlo_module.h"
 #include "xla/tsl/util/command_line_flags.h"
 #include "tsl/platform/init_main.h"
+#include "tsl/platform/env.h"
 #include "tsl/platform/logging.h"
+#include "tsl/platform/protobuf.h"
 #include "tsl/platform/status.h"
 #include "tsl/platform/test.h"
 
@@ -40,16 +43,23 @@ platform.
 The file can be one of the followings:
 1) a binary or text proto file, the proto should be in xla.HloProto type.
 2) a hlo text dump, the string should be in HloModule::ToString() format.
+3) a binary HLO snapshot, which is memory-mapped and whose constants are only
+   loaded when they are used.
 
 By default, the module is run on a reference platform such as the interpreter
 and the reference result is compared against the test result.
 
+With --benchmark, the module is instead compiled once and run repeatedly on
+the test platform only. The compile-time phases, the distributions of the
+wall, CPU and compute times of the runs and, with --xla_hlo_profile, the cycles
+spent in every instruction are printed as JSON.
+
 You can also pass in debug option flags for the HloModule.
 
 Usage:
 
   bazel run run_hlo_module -- \
-    --input_format=[hlo|pb|pbtxt]               \
+    --input_format=[hlo|pb|pbtxt|hlosnap]       \
     --platform=[CPU|CUDA|Interpreter] \
     path/to/hlo_module
 )";
@@ -119,14 +129,16 @@ int main(int argc, char** argv) {
                 "The format of the input file. Valid values:\n"
                 "  hlo : HLO textual format\n"
                 "  pb : xla::HloProto in binary proto format\n"
-                "  pbtxt : xla::HloProto in text proto format"),
+                "  pbtxt : xla::HloProto in text proto format\n"
+                "  hlosnap : binary HLO snapshot"),
       tsl::Flag("input_module", &opts.input_module,
                 "A path to a file containing the HLO module. Can also pass "
                 "a this as argv[1], but this flag is more explicit."),
       tsl::Flag(
           "iterations", &opts.iterations,
           "The number of times to run the module. Each iteration will be run "
-          "with different input data."),
+          "with different input data, except in benchmark mode, where this is "
+          "the number of timed runs with the same input data."),
       tsl::Flag(
           "isolate_instructions", &opts.isolate_instructions,
           "Rather than executing the entire module at once, run every "
@@ -136,6 +148,16 @@ int main(int argc, char** argv) {
       tsl::Flag("different_random_seeds", &different_random_seeds,
                 "Whether each iteration should use a different random seed for "
                 "the HloModuleConfig."),
+      tsl::Flag("benchmark", &opts.benchmark,
+                "Compile the module once and time repeated runs of it on the "
+                "test platform, without comparing against the reference "
+                "platform."),
+      tsl::Flag("warmup_iterations", &opts.warmup_iterations,
+                "In benchmark mode, the number of untimed runs before the "
+                "timed ones."),
+      tsl::Flag("benchmark_output_file", &opts.benchmark_output_file,
+                "In benchmark mode, the file to write the JSON results to. "
+                "They are printed to stdout if empty."),
   };
   xla::AppendDebugOptionsFlags(&flag_list);
   // The usage string includes the message at the top of the file, the
@@ -174,6 +196,26 @@ int main(int argc, char** argv) {
   if (opts.random_init_input_literals) {
     engine = std::make_unique<std::minstd_rand0>();
   }
+  if (opts.benchmark) {
+    absl::StatusOr<xla::RunHloModuleBenchmarkResult> result =
+        xla::RunBenchmark(hlo_filename, &test_runner, engine.get(), opts);
+    TF_QCHECK_OK(result.status());
+    std::string json;
+    tsl::protobuf::util::JsonPrintOptions json_options;
+    json_options.add_whitespace = true;
+    json_options.always_print_primitive_fields = true;
+    QCHECK(tsl::protobuf::util::MessageToJsonString(*result, &json,
+                                                    json_options)
+               .ok());
+    if (opts.benchmark_output_file.empty()) {
+      std::cout << json;
+    } else {
+      TF_QCHECK_OK(tsl::WriteStringToFile(tsl::Env::Default(),
+                                          opts.benchmark_output_file, json));
+    }
+    return 0;
+  }
+
   int failure_count = 0;
   const int iteration_count = opts.iterations;
   for (int i = 1; i <= iteration_count; ++i) {